@@ -0,0 +1,122 @@
+// Detokenization microbenchmark: cost per generated token of rendering pieces with
+// llama_token_to_piece into a new string (the old path) versus copying them out of
+// the precomputed piece table, with and without the UTF-8 boundary check done when
+// streaming. Only the vocabulary of the model is loaded.
+//
+//   cmake --build build-host --target detok-bench
+//   ./build-host/detok-bench model.gguf [tokens per response] [responses]
+
+#include "llm_core.h"
+#include "model_loader.h"
+#include "model_registry.h"
+#include "piece_table.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+// English with accented, CJK and emoji text, so byte-level vocabularies split
+// characters across tokens
+const char* SAMPLE_TEXT =
+    "Machine learning systems improve with experience. A naïve model, trained at a café "
+    "in São Paulo, learns that 機械学習 and 人工知能 are related, and answers with 🙂 or 🚀. ";
+
+template <typename F>
+double ns_per_token(int n_tokens, int n_responses, F&& fn) {
+    auto start = bench_clock::now();
+    for (int r = 0; r < n_responses; r++) {
+        fn();
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(bench_clock::now() - start);
+    return elapsed.count() / ((double) n_tokens * n_responses);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s model.gguf [tokens per response] [responses]\n", argv[0]);
+        return 2;
+    }
+    const int n_tokens = argc > 2 ? std::atoi(argv[2]) : 512;
+    const int n_responses = argc > 3 ? std::atoi(argv[3]) : 200;
+
+    llama_model_params model_params = llama_model_default_params();
+    model_params.vocab_only = true;
+    load_phases phases;
+    llama_model* model = load_model_from_path(argv[1], model_params, phases);
+    if (!model) {
+        fprintf(stderr, "failed to load %s\n", argv[1]);
+        return 1;
+    }
+    const llama_vocab* vocab = llama_model_get_vocab(model);
+
+    // A response-length token stream cut from the sample text
+    std::string text;
+    std::vector<llama_token> stream;
+    while ((int) stream.size() < n_tokens) {
+        text += SAMPLE_TEXT;
+        stream = tokenize(vocab, text, false);
+    }
+    stream.resize(n_tokens);
+
+    piece_table table;
+    const auto t_build = bench_clock::now();
+    table.build(vocab);
+    const double build_ms = std::chrono::duration<double, std::milli>(bench_clock::now() - t_build).count();
+
+    // Both paths must produce the same text
+    std::string expected;
+    std::string actual;
+    for (llama_token token : stream) {
+        expected += token_to_piece(vocab, token);
+        table.append(token, actual);
+    }
+    if (expected != actual) {
+        fprintf(stderr, "piece table output differs from llama_token_to_piece\n");
+        model_registry::instance().release(model);
+        return 1;
+    }
+
+    std::string response;
+    const double before_ns = ns_per_token(n_tokens, n_responses, [&] {
+        response = std::string();
+        for (llama_token token : stream) {
+            std::string piece = token_to_piece(vocab, token);
+            response += piece;
+        }
+    });
+    const double after_ns = ns_per_token(n_tokens, n_responses, [&] {
+        response.clear();
+        for (llama_token token : stream) {
+            table.append(token, response);
+        }
+    });
+    volatile size_t sink = 0;
+    const double streaming_ns = ns_per_token(n_tokens, n_responses, [&] {
+        response.clear();
+        for (llama_token token : stream) {
+            table.append(token, response);
+            sink = utf8_complete_prefix(response.data(), response.size());
+        }
+    });
+
+    printf("vocab: %u tokens, piece table %.1f KiB built in %.1f ms\n",
+           table.size(), table.bytes() / 1024.0, build_ms);
+    printf("stream: %d tokens, %zu bytes, %d responses\n\n", n_tokens, expected.size(), n_responses);
+    printf("%-28s %10s\n", "path", "ns/token");
+    printf("%-28s %10.1f\n", "token_to_piece + append", before_ns);
+    printf("%-28s %10.1f\n", "piece table", after_ns);
+    printf("%-28s %10.1f\n", "piece table + utf8 boundary", streaming_ns);
+    printf("\nspeedup %.1fx\n", after_ns > 0 ? before_ns / after_ns : 0.0);
+    (void) sink;
+
+    model_registry::instance().release(model);
+    return 0;
+}
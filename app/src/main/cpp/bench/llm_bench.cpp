@@ -0,0 +1,598 @@
+// Host benchmark driver: replays the QueryScheduler test prompts through the same
+// llm_core code path the app uses and reports load, latency and throughput.
+//
+//   scripts/setup_llama.sh    (once, fetches llama.cpp sources into app/src/main/cpp)
+//   cmake -S app/src/main/cpp -B build-host -DCMAKE_BUILD_TYPE=Release
+//   cmake --build build-host --target llm-bench -j
+//   ./build-host/llm-bench -m app/src/main/assets/models/qwen2.5-0.5b-instruct-q4_k_m.gguf
+
+#include "chat_session.h"
+#include "cpu_topology.h"
+#include "power_sampler.h"
+#include "proc_sampler.h"
+#include "llm_core.h"
+#include "memory_probe.h"
+#include "model_loader.h"
+#include "state_cache.h"
+#include "thermal_governor.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Keep in sync with QueryScheduler.TEST_QUERIES
+const char* const TEST_QUERIES[] = {
+    "What is machine learning and how does it work?",
+    "Explain quantum computing in simple terms",
+    "Write a haiku about artificial intelligence",
+    "What are the benefits of renewable energy?",
+    "Describe the process of photosynthesis",
+    "What is the difference between AI and machine learning?",
+    "Explain the concept of blockchain technology",
+    "Write a short story about a robot learning to paint",
+    "What are the ethical implications of artificial intelligence?",
+    "Describe the water cycle in detail",
+    "What is the theory of relativity?",
+    "Explain how neural networks work",
+    "Write a poem about the future of technology",
+    "What are the main causes of climate change?",
+    "Describe the structure of DNA",
+    "What is the difference between supervised and unsupervised learning?",
+    "Explain the concept of sustainable development",
+    "Write a dialogue between a human and an AI assistant",
+    "What are the potential risks of artificial general intelligence?",
+    "Describe the process of cellular respiration",
+};
+
+// Defaults mirror LLMService's companion constants and ModelConfig
+struct bench_params {
+    std::string model_path;
+    std::string prompts_path;
+    int n_threads = 4;
+    int n_ctx = 2048;
+    int n_batch = 512;
+    int n_ubatch = 512;
+    int n_seq_max = 4;
+    ggml_type type_k = GGML_TYPE_F16;
+    ggml_type type_v = GGML_TYPE_F16;
+    llama_flash_attn_type flash_attn = LLAMA_FLASH_ATTN_TYPE_AUTO;
+    bool offload_kqv = true;
+    bool op_offload = true;
+    int max_tokens = 512;
+    int repeat = 1;
+    bool batched = false;
+    bool pretokenize = false;
+    bool chat = false;              // prompts are successive turns of one chat session per pass
+    std::string system_prompt;
+    bool csv = false;
+    placement_policy prefill_policy = PLACEMENT_OS;
+    placement_policy decode_policy = PLACEMENT_OS;
+    int n_threads_prefill = 0;      // 0: -t for PLACEMENT_OS, else one per selected core
+    int n_threads_decode = 0;
+    std::string sysfs_root = "/sys/devices/system/cpu";
+    bool topology_only = false;
+    std::string power_supply;       // empty: no energy measurement
+    int power_rate_hz = 50;
+    int current_scale = 1;
+    int cpu_rate_hz = 0;            // 0: no CPU sampling
+    std::string prefix;             // prepended to every prompt and warmed before the runs
+    std::string state_dir;          // empty: prefix state is not persisted
+    double thermal_target_c = 0.0;  // 0: no thermal governor
+    std::string thermal_zone;       // zone type filter, empty for all zones
+    std::string thermal_root = "/sys";
+    generation_limits limits;       // --stop, --deadline-ms, --energy-budget-mj
+};
+
+void print_usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s -m model.gguf [options]\n"
+            "  -p FILE     prompts, one per line (default: QueryScheduler test queries)\n"
+            "  -n N        max tokens per response (default 512)\n"
+            "  -t N        threads (default 4)\n"
+            "  -c N        context size (default 2048)\n"
+            "  -b N        batch size (default 512)\n"
+            "  -ub N       micro-batch size (default 512)\n"
+            "  --kv-type T            KV cache type for K and V: f16, q8_0, q4_0, ... (default f16)\n"
+            "  --kv-type-k T, --kv-type-v T  K or V cache type alone; a quantized V needs flash attention\n"
+            "  --flash-attn M         flash attention: auto, on or off (default auto)\n"
+            "  --no-kqv-offload       keep the KV cache and attention off the offload device\n"
+            "  --no-op-offload        do not offload ops on host-resident weights\n"
+            "  -r N        passes over the prompt set (default 1)\n"
+            "  --batched   run prompts n_seq_max at a time through generate_batch\n"
+            "  --pretokenize  tokenize the prompt set once up front and run prompts by index\n"
+            "  --chat      run each pass as one conversation, a prompt per user turn, with the\n"
+            "              model's chat template; reused shows the conversation kept in the KV cache\n"
+            "  --system TEXT  system prompt of --chat conversations\n"
+            "  --csv       print one CSV row per query instead of a table\n"
+            "  --prefill-placement P, --decode-placement P\n"
+            "              pin worker threads: os, all, big, prime or little (default os)\n"
+            "  --prefill-threads N, --decode-threads N\n"
+            "              threads per phase (default: one per selected core)\n"
+            "  --sysfs-root DIR  read the CPU topology from DIR (default /sys/devices/system/cpu)\n"
+            "  --topology  print the detected clusters and placements, then exit\n"
+            "  --power-supply DIR  sample current_now/voltage_now in DIR and report energy per query\n"
+            "  --power-rate HZ     power samples per second (default 50)\n"
+            "  --current-scale N   multiply current_now by N to get uA (default 1)\n"
+            "  --cpu-rate HZ       sample per-core and per-thread CPU usage at HZ (default off)\n"
+            "  --prefix TEXT       shared prompt prefix, warmed once before the runs\n"
+            "  --state-dir DIR     save the warmed prefix state in DIR and restore it on later runs\n"
+            "  --thermal-target C  let the thermal governor hold the hottest zone below C degrees,\n"
+            "                      choosing placement, threads and pacing per query\n"
+            "  --thermal-zone S    govern only thermal zones whose type contains S\n"
+            "  --thermal-root DIR  sysfs root holding class/thermal and devices/system/cpu (default /sys)\n"
+            "  --stop S            end a response before S; repeat for more stop strings\n"
+            "  --deadline-ms N     stop decoding N ms after a generation starts\n"
+            "  --energy-budget-mj N  stop decoding after N mJ (needs --power-supply)\n",
+            argv0);
+}
+
+bool parse_args(int argc, char** argv, bench_params& params) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        auto next_int = [&](int& out) {
+            if (i + 1 >= argc) return false;
+            out = std::atoi(argv[++i]);
+            return true;
+        };
+        auto next_policy = [&](placement_policy& out) {
+            return i + 1 < argc && parse_placement_policy(argv[++i], out);
+        };
+        auto next_kv_type = [&](ggml_type& out) {
+            return i + 1 < argc && parse_kv_cache_type(argv[++i], out);
+        };
+        bool ok = true;
+        if (arg == "-m" && i + 1 < argc) {
+            params.model_path = argv[++i];
+        } else if (arg == "-p" && i + 1 < argc) {
+            params.prompts_path = argv[++i];
+        } else if (arg == "-n") {
+            ok = next_int(params.max_tokens);
+        } else if (arg == "-t") {
+            ok = next_int(params.n_threads);
+        } else if (arg == "-c") {
+            ok = next_int(params.n_ctx);
+        } else if (arg == "-b") {
+            ok = next_int(params.n_batch);
+        } else if (arg == "-ub") {
+            ok = next_int(params.n_ubatch);
+        } else if (arg == "--kv-type") {
+            ok = next_kv_type(params.type_k);
+            params.type_v = params.type_k;
+        } else if (arg == "--kv-type-k") {
+            ok = next_kv_type(params.type_k);
+        } else if (arg == "--kv-type-v") {
+            ok = next_kv_type(params.type_v);
+        } else if (arg == "--flash-attn") {
+            ok = i + 1 < argc && parse_flash_attn_type(argv[++i], params.flash_attn);
+        } else if (arg == "--no-kqv-offload") {
+            params.offload_kqv = false;
+        } else if (arg == "--no-op-offload") {
+            params.op_offload = false;
+        } else if (arg == "-r") {
+            ok = next_int(params.repeat);
+        } else if (arg == "--batched") {
+            params.batched = true;
+        } else if (arg == "--pretokenize") {
+            params.pretokenize = true;
+        } else if (arg == "--chat") {
+            params.chat = true;
+        } else if (arg == "--system" && i + 1 < argc) {
+            params.system_prompt = argv[++i];
+        } else if (arg == "--csv") {
+            params.csv = true;
+        } else if (arg == "--prefill-placement") {
+            ok = next_policy(params.prefill_policy);
+        } else if (arg == "--decode-placement") {
+            ok = next_policy(params.decode_policy);
+        } else if (arg == "--prefill-threads") {
+            ok = next_int(params.n_threads_prefill);
+        } else if (arg == "--decode-threads") {
+            ok = next_int(params.n_threads_decode);
+        } else if (arg == "--sysfs-root" && i + 1 < argc) {
+            params.sysfs_root = argv[++i];
+        } else if (arg == "--topology") {
+            params.topology_only = true;
+        } else if (arg == "--power-supply" && i + 1 < argc) {
+            params.power_supply = argv[++i];
+        } else if (arg == "--power-rate") {
+            ok = next_int(params.power_rate_hz);
+        } else if (arg == "--current-scale") {
+            ok = next_int(params.current_scale);
+        } else if (arg == "--cpu-rate") {
+            ok = next_int(params.cpu_rate_hz);
+        } else if (arg == "--prefix" && i + 1 < argc) {
+            params.prefix = argv[++i];
+        } else if (arg == "--state-dir" && i + 1 < argc) {
+            params.state_dir = argv[++i];
+        } else if (arg == "--thermal-target" && i + 1 < argc) {
+            params.thermal_target_c = std::atof(argv[++i]);
+        } else if (arg == "--thermal-zone" && i + 1 < argc) {
+            params.thermal_zone = argv[++i];
+        } else if (arg == "--thermal-root" && i + 1 < argc) {
+            params.thermal_root = argv[++i];
+        } else if (arg == "--stop" && i + 1 < argc) {
+            params.limits.stop_strings.push_back(argv[++i]);
+        } else if (arg == "--deadline-ms" && i + 1 < argc) {
+            params.limits.deadline_us = std::atoll(argv[++i]) * 1000;
+        } else if (arg == "--energy-budget-mj" && i + 1 < argc) {
+            params.limits.energy_budget_uj = std::atoll(argv[++i]) * 1000;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "invalid argument: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    if (params.chat && (params.batched || params.pretokenize || !params.prefix.empty())) {
+        fprintf(stderr, "--chat cannot be combined with --batched, --pretokenize or --prefix\n");
+        return false;
+    }
+    return params.topology_only || !params.model_path.empty();
+}
+
+std::vector<std::string> load_prompts(const std::string& path) {
+    std::vector<std::string> prompts;
+    if (path.empty()) {
+        prompts.assign(std::begin(TEST_QUERIES), std::end(TEST_QUERIES));
+        return prompts;
+    }
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty()) prompts.push_back(line);
+    }
+    return prompts;
+}
+
+double mean(const std::vector<double>& values) {
+    if (values.empty()) return 0.0;
+    double sum = 0.0;
+    for (double v : values) sum += v;
+    return sum / values.size();
+}
+
+double median(std::vector<double> values) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench_params params;
+    if (!parse_args(argc, argv, params)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    cpu_topology topo;
+    if (!read_cpu_topology(topo, params.sysfs_root)) {
+        fprintf(stderr, "no CPU topology under %s\n", params.sysfs_root.c_str());
+    }
+    if (params.topology_only) {
+        printf("%s", describe_topology(topo).c_str());
+        for (int p = 0; p < PLACEMENT_POLICY_COUNT; p++) {
+            const std::vector<int> cpus = placement_cpus(topo, (placement_policy) p);
+            printf("%-7s cpus 0x%llx (%zu cores)\n", placement_policy_name((placement_policy) p),
+                   (unsigned long long) cpu_mask_bits(cpus), cpus.size());
+        }
+        return 0;
+    }
+
+    std::vector<std::string> prompts = load_prompts(params.prompts_path);
+    if (prompts.empty()) {
+        fprintf(stderr, "no prompts to run\n");
+        return 2;
+    }
+    for (std::string& prompt : prompts) {
+        prompt.insert(0, params.prefix);
+    }
+
+    load_phases phases;
+    llama_model* model = load_model_from_path(params.model_path, llama_model_default_params(), phases);
+    if (!model) {
+        fprintf(stderr, "failed to load %s\n", params.model_path.c_str());
+        return 1;
+    }
+    context_options options;
+    options.n_threads = params.n_threads;
+    options.n_ctx = params.n_ctx;
+    options.n_batch = params.n_batch;
+    options.n_ubatch = params.n_ubatch;
+    options.n_seq_max = params.n_seq_max;
+    options.type_k = params.type_k;
+    options.type_v = params.type_v;
+    options.flash_attn = params.flash_attn;
+    options.offload_kqv = params.offload_kqv;
+    options.op_offload = params.op_offload;
+    llama_context_wrapper* wrapper = create_wrapper(model, options);
+    if (!wrapper) {
+        fprintf(stderr, "failed to create context\n");
+        return 1;
+    }
+    if (params.prefill_policy != PLACEMENT_OS || params.decode_policy != PLACEMENT_OS ||
+        params.n_threads_prefill > 0 || params.n_threads_decode > 0) {
+        if (!set_thread_placement(wrapper, topo, params.prefill_policy, params.n_threads_prefill,
+                                  params.decode_policy, params.n_threads_decode)) {
+            fprintf(stderr, "failed to apply thread placement\n");
+            free_wrapper(wrapper);
+            return 1;
+        }
+    }
+    measure_first_touch(wrapper, phases);
+    const thread_placement& placement = wrapper->placement;
+    set_generation_limits(wrapper, params.limits);
+
+    power_sampler sampler;
+    if (!params.power_supply.empty()) {
+        if (!sampler.start(params.power_supply, params.power_rate_hz, params.current_scale)) {
+            fprintf(stderr, "cannot sample power from %s\n", params.power_supply.c_str());
+            free_wrapper(wrapper);
+            return 1;
+        }
+        wrapper->power = &sampler;
+    }
+    proc_sampler cpu_sampler;
+    if (params.cpu_rate_hz > 0) {
+        if (!cpu_sampler.start(params.cpu_rate_hz)) {
+            fprintf(stderr, "cannot sample CPU usage from /proc\n");
+            free_wrapper(wrapper);
+            return 1;
+        }
+        wrapper->proc = &cpu_sampler;
+    }
+    thermal_governor governor(params.thermal_root);
+    if (params.thermal_target_c > 0.0) {
+        thermal_envelope envelope;
+        envelope.target_mc = (int) (params.thermal_target_c * 1000);
+        envelope.zone_filter = params.thermal_zone;
+        if (!governor.start(envelope, 2)) {
+            fprintf(stderr, "no thermal zone to govern under %s\n", params.thermal_root.c_str());
+            free_wrapper(wrapper);
+            return 1;
+        }
+        wrapper->governor = &governor;
+    }
+
+    printf("model: %s (%.1f MB)\n", params.model_path.c_str(), phases.bytes / 1048576.0);
+    printf("load: open %.1f ms, tensor setup %.1f ms, mmap %.1f ms, first touch %.1f ms (%lld major faults)%s\n",
+           phases.t_open_us / 1000.0, phases.t_tensor_setup_us / 1000.0, phases.t_mmap_us / 1000.0,
+           phases.t_first_touch_us / 1000.0, (long long) phases.first_touch_majflt,
+           phases.resident ? " (resident)" : "");
+    printf("context: %s\n", describe_context_memory(wrapper).c_str());
+    printf("memory at load: %s\n", describe_memory_snapshot(wrapper->memory.at_load).c_str());
+    printf("prefill: %s x%d (cpus 0x%llx), decode: %s x%d (cpus 0x%llx)\n",
+           placement_policy_name(placement.prefill_policy), placement.n_threads_prefill,
+           (unsigned long long) placement.prefill_cpus,
+           placement_policy_name(placement.decode_policy), placement.n_threads_decode,
+           (unsigned long long) placement.decode_cpus);
+    printf("n_ctx %d, n_batch %d, n_ubatch %d, max_tokens %d, %zu prompts x %d\n\n",
+           params.n_ctx, params.n_batch, params.n_ubatch,
+           params.max_tokens, prompts.size(), params.repeat);
+    if (wrapper->governor) {
+        printf("thermal governor: target %.1f C, %zu operating points\n\n",
+               params.thermal_target_c, governor.ladder().size());
+    }
+
+    if (!params.prefix.empty()) {
+        state_io io;
+        if (!warm_prefix(wrapper, params.state_dir, params.prefix, io)) {
+            fprintf(stderr, "failed to warm prefix\n");
+            free_wrapper(wrapper);
+            return 1;
+        }
+        const char* source = io.source == PREFIX_RESTORED ? "restored" :
+                             io.source == PREFIX_PREFILLED ? "prefilled" : "resident";
+        printf("prefix: %d tokens %s in %.1f ms (restore %.1f ms, prefill %.1f ms), %lld bytes",
+               io.n_tokens, source, (io.t_restore_us + io.t_prefill_us) / 1000.0,
+               io.t_restore_us / 1000.0, io.t_prefill_us / 1000.0, (long long) io.bytes);
+        if (io.t_save_us > 0) printf(", saved in %.1f ms", io.t_save_us / 1000.0);
+        printf("\n\n");
+    }
+
+    if (params.pretokenize && !params.batched) {
+        const int64_t t_start = now_ns();
+        if (!pretokenize_prompts(wrapper, prompts)) {
+            fprintf(stderr, "failed to pretokenize prompts\n");
+            free_wrapper(wrapper);
+            return 1;
+        }
+        printf("pretokenized %d prompts into %zu tokens in %.1f ms\n\n", wrapper->prompt_arena.size(),
+               wrapper->prompt_arena.tokens.size(), (now_ns() - t_start) / 1e6);
+    }
+
+    std::vector<double> tokenize_us, ttft_ms, prefill_tps, decode_tps, decode_p50_ms, total_ms, decode_mj_per_token, decode_util;
+    std::vector<double> prefill_pss_mib, decode_pss_mib, decode_anon_mib;
+    int failures = 0;
+    int stop_counts[STOP_REASON_COUNT] = {};
+
+    if (params.csv) {
+        printf("pass,query,prompt_tokens,reused_tokens,generated_tokens,ttft_ms,prefill_ms,decode_ms,"
+               "prefill_tok_s,decode_tok_s,decode_p50_ms,decode_p90_ms,decode_p99_ms,prefill_placement,decode_placement,"
+               "prefill_mj,decode_mj,prefill_cpu_util,decode_cpu_util,prefill_cpu_ms,decode_cpu_ms,"
+               "governor_level,governor_reason,temp_c,pacing_ms,stop_reason,"
+               "prefill_rss_mib,prefill_pss_mib,decode_rss_mib,decode_pss_mib,decode_anon_mib,kv_used_mib,state_mib\n");
+    } else if (!params.batched) {
+        printf("%4s %5s %6s %6s %6s %9s %11s %10s %9s %9s\n",
+               "pass", "query", "prompt", "reused", "gen", "ttft_ms", "prefill_t/s", "decode_t/s", "p50_ms", "p90_ms");
+    }
+
+    for (int pass = 0; pass < params.repeat; pass++) {
+        if (params.batched) {
+            // Same chunking as LLMService.generateResponses
+            for (size_t start = 0; start < prompts.size(); start += params.n_seq_max) {
+                const size_t end = std::min(prompts.size(), start + (size_t) params.n_seq_max);
+                std::vector<std::string> chunk(prompts.begin() + start, prompts.begin() + end);
+                std::vector<std::string> responses;
+                std::vector<generation_stats> seq_stats;
+
+                const int64_t t_start = now_ns();
+                const bool ok = generate_batch(wrapper, chunk, params.max_tokens, responses, seq_stats);
+                const double wall_ms = (now_ns() - t_start) / 1e6;
+                const generation_stats& stats = wrapper->last_stats;
+                if (!ok) failures++;
+
+                const double tps = stats.t_decode_us > 0 ? stats.n_generated * 1e6 / stats.t_decode_us : 0.0;
+                decode_tps.push_back(tps);
+                total_ms.push_back(wall_ms);
+                printf("pass %d queries %zu-%zu: prompt %d, gen %d, prefill %.1f ms, decode %.1f ms (%.2f tok/s aggregate)\n",
+                       pass, start, end - 1, stats.n_prompt, stats.n_generated,
+                       stats.t_prefill_us / 1000.0, stats.t_decode_us / 1000.0, tps);
+            }
+            continue;
+        }
+
+        std::unique_ptr<chat_session> session;
+        if (params.chat) {
+            session.reset(new chat_session(wrapper, params.system_prompt));
+        }
+
+        for (size_t q = 0; q < prompts.size(); q++) {
+            // Stream one token at a time like LLMService.generateStreaming
+            const int64_t t_start = now_ns();
+            int64_t t_first_ns = 0;
+            piece_callback on_piece = [&](std::string_view, int, int64_t timestamp_ns) {
+                if (t_first_ns == 0) t_first_ns = timestamp_ns;
+                return true;
+            };
+
+            std::string response;
+            bool ok;
+            if (session) {
+                ok = session->respond(prompts[q], params.max_tokens, 1, on_piece, response);
+            } else if (params.pretokenize) {
+                ok = generate_indexed(wrapper, q, params.max_tokens, 1, on_piece, response);
+            } else {
+                ok = generate(wrapper, prompts[q], params.max_tokens, 1, on_piece, response);
+            }
+            const generation_stats& stats = wrapper->last_stats;
+            if (!ok) {
+                failures++;
+                fprintf(stderr, "query %zu failed\n", q);
+                continue;
+            }
+
+            const int n_prefilled = stats.n_prompt - stats.n_reused;
+            const double ttft = t_first_ns > 0 ? (t_first_ns - t_start) / 1e6 : 0.0;
+            const double p_tps = stats.t_prefill_us > 0 ? n_prefilled * 1e6 / stats.t_prefill_us : 0.0;
+            const double d_tps = stats.t_decode_us > 0 ? stats.n_generated * 1e6 / stats.t_decode_us : 0.0;
+            tokenize_us.push_back(stats.t_tokenize_us);
+            ttft_ms.push_back(ttft);
+            prefill_tps.push_back(p_tps);
+            decode_tps.push_back(d_tps);
+            decode_p50_ms.push_back(stats.decode_p50_us / 1000.0);
+            total_ms.push_back((stats.t_tokenize_us + stats.t_prefill_us + stats.t_decode_us) / 1000.0);
+            if (stats.energy_decode_uj >= 0 && stats.n_generated > 0) {
+                decode_mj_per_token.push_back(stats.energy_decode_uj / 1000.0 / stats.n_generated);
+            }
+            if (stats.cpu_decode.n_frames > 0) {
+                decode_util.push_back(stats.cpu_decode.util_mean_permille / 10.0);
+            }
+            stop_counts[stats.stop]++;
+            if (stats.mem_decode.pss >= 0) {
+                prefill_pss_mib.push_back(stats.mem_prefill.pss / 1048576.0);
+                decode_pss_mib.push_back(stats.mem_decode.pss / 1048576.0);
+                decode_anon_mib.push_back(stats.mem_decode.rss_anon / 1048576.0);
+            }
+
+            if (params.csv) {
+                char energy[64] = ",";
+                if (stats.energy_prefill_uj >= 0) {
+                    snprintf(energy, sizeof(energy), "%.3f,%.3f",
+                             stats.energy_prefill_uj / 1000.0, stats.energy_decode_uj / 1000.0);
+                }
+                char cpu[96] = ",,,";
+                if (stats.cpu_decode.n_frames > 0) {
+                    snprintf(cpu, sizeof(cpu), "%.1f,%.1f,%.2f,%.2f",
+                             stats.cpu_prefill.util_mean_permille / 10.0, stats.cpu_decode.util_mean_permille / 10.0,
+                             stats.cpu_prefill.process_cpu_us / 1000.0, stats.cpu_decode.process_cpu_us / 1000.0);
+                }
+                char thermal[96] = ",,,";
+                if (stats.governor.level >= 0) {
+                    snprintf(thermal, sizeof(thermal), "%d,%s,%.1f,%.1f", stats.governor.level,
+                             governor_reason_name(stats.governor.reason), stats.governor.reading.temp_mc / 1000.0,
+                             stats.t_pacing_us / 1000.0);
+                }
+                auto mib = [](int64_t bytes) { return bytes / 1048576.0; };
+                char memory[128] = ",,,,,,";
+                if (stats.mem_decode.rss >= 0) {
+                    snprintf(memory, sizeof(memory), "%.1f,%.1f,%.1f,%.1f,%.1f,%.2f,%.2f",
+                             mib(stats.mem_prefill.rss), mib(stats.mem_prefill.pss), mib(stats.mem_decode.rss),
+                             mib(stats.mem_decode.pss), mib(stats.mem_decode.rss_anon),
+                             mib(stats.kv_used_bytes), mib(stats.state_bytes));
+                }
+                printf("%d,%zu,%d,%d,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.3f,%.3f,%.3f,%s,%s,%s,%s,%s,%s,%s\n",
+                       pass, q, stats.n_prompt, stats.n_reused, stats.n_generated, ttft,
+                       stats.t_prefill_us / 1000.0, stats.t_decode_us / 1000.0, p_tps, d_tps,
+                       stats.decode_p50_us / 1000.0, stats.decode_p90_us / 1000.0, stats.decode_p99_us / 1000.0,
+                       placement_policy_name(stats.placement.prefill_policy),
+                       placement_policy_name(stats.placement.decode_policy), energy, cpu, thermal,
+                       stop_reason_name(stats.stop), memory);
+            } else {
+                printf("%4d %5zu %6d %6d %6d %9.1f %11.1f %10.2f %9.2f %9.2f\n",
+                       pass, q, stats.n_prompt, stats.n_reused, stats.n_generated, ttft,
+                       p_tps, d_tps, stats.decode_p50_us / 1000.0, stats.decode_p90_us / 1000.0);
+                if (stats.governor.level >= 0) {
+                    printf("           %s, paced %.1f ms\n", governor.describe(stats.governor).c_str(),
+                           stats.t_pacing_us / 1000.0);
+                }
+            }
+        }
+    }
+
+    if (!params.csv) {
+        printf("\nsummary over %zu runs (%d failed):\n", total_ms.size(), failures);
+        if (!params.batched) {
+            printf("  tokenize      mean %8.1f us   median %8.1f us  (cache %lld hits, %lld misses)\n",
+                   mean(tokenize_us), median(tokenize_us), (long long) wrapper->prompt_cache.hits(),
+                   (long long) wrapper->prompt_cache.misses());
+            printf("  ttft          mean %8.1f ms   median %8.1f ms\n", mean(ttft_ms), median(ttft_ms));
+            printf("  prefill       mean %8.1f t/s  median %8.1f t/s\n", mean(prefill_tps), median(prefill_tps));
+            printf("  decode p50    mean %8.2f ms   median %8.2f ms\n", mean(decode_p50_ms), median(decode_p50_ms));
+            printf("  stopped by   ");
+            for (int r = STOP_EOG; r < STOP_REASON_COUNT; r++) {
+                if (stop_counts[r] > 0) printf(" %s %d", stop_reason_name((stop_reason) r), stop_counts[r]);
+            }
+            printf("\n");
+        }
+        printf("  decode        mean %8.2f t/s  median %8.2f t/s\n", mean(decode_tps), median(decode_tps));
+        printf("  total         mean %8.1f ms   median %8.1f ms\n", mean(total_ms), median(total_ms));
+        if (!decode_mj_per_token.empty()) {
+            printf("  decode energy mean %8.2f mJ/t median %8.2f mJ/t\n",
+                   mean(decode_mj_per_token), median(decode_mj_per_token));
+        }
+        if (!decode_util.empty()) {
+            printf("  decode cpu    mean %8.1f %%    median %8.1f %%\n", mean(decode_util), median(decode_util));
+            printf("  cpu sampler   %.1f us per sample\n", cpu_sampler.mean_sample_ns() / 1000.0);
+        }
+        if (!decode_pss_mib.empty()) {
+            printf("  pss prefill   mean %8.1f MiB  max %8.1f MiB\n", mean(prefill_pss_mib),
+                   *std::max_element(prefill_pss_mib.begin(), prefill_pss_mib.end()));
+            printf("  pss decode    mean %8.1f MiB  max %8.1f MiB  (anon max %.1f MiB)\n", mean(decode_pss_mib),
+                   *std::max_element(decode_pss_mib.begin(), decode_pss_mib.end()),
+                   *std::max_element(decode_anon_mib.begin(), decode_anon_mib.end()));
+        }
+    }
+
+    sampler.stop();
+    cpu_sampler.stop();
+    governor.stop();
+    free_wrapper(wrapper);
+
+    // What freeing the context leaves behind; the weights stay resident in the model registry
+    memory_probe probe;
+    memory_snapshot after_free;
+    if (!params.csv && probe.open() && probe.read(after_free)) {
+        printf("memory after free: %s\n", describe_memory_snapshot(after_free).c_str());
+    }
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,236 @@
+// Energy-efficiency sweep driver: runs every combination of models (quantizations),
+// thread counts, context sizes, batch sizes and max_tokens through the same llm_core
+// code path the app uses and writes one JSON report with tokens/s, TTFT and joules
+// per token for each cell. Energy comes from RAPL on a Linux host (usually needs root)
+// or from a power_supply directory.
+//
+//   cmake --build build-host --target llm-sweep -j
+//   sudo ./build-host/llm-sweep -m q4_k_m.gguf -m q8_0.gguf -t 2,4,8 -c 512,2048 -b 64,512 -n 64,256 -o sweep.json
+
+#include "llm_core.h"
+#include "power_sampler.h"
+#include "sweep_runner.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// A few of QueryScheduler.TEST_QUERIES, short enough to keep large sweeps tractable
+const char* const DEFAULT_PROMPTS[] = {
+    "What is machine learning and how does it work?",
+    "Write a haiku about artificial intelligence",
+    "Describe the process of photosynthesis",
+};
+
+struct sweep_params {
+    sweep_matrix matrix;
+    std::string prompts_path;
+    std::string output_path;        // empty: report on stdout
+    std::string energy = "rapl";    // rapl, supply or none
+    std::string rapl_domain = "package";
+    std::string sysfs_root = "/sys";
+    std::string power_supply;
+    int power_rate_hz = 50;
+    int current_scale = 1;
+};
+
+void print_usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s -m model.gguf [-m other.gguf ...] [options]\n"
+            "  lists are comma separated; every combination is one cell\n"
+            "  -t LIST     threads (default 4)\n"
+            "  -c LIST     context sizes (default 2048)\n"
+            "  -b LIST     batch sizes, micro-batch follows (default 512)\n"
+            "  -n LIST     max tokens per response (default 128)\n"
+            "  -p FILE     prompts, one per line (default: three QueryScheduler test queries)\n"
+            "  -w N        warmup generations per cell, not recorded (default 1)\n"
+            "  -r N        recorded passes over the prompts per cell (default 3)\n"
+            "  --cooldown-ms N     idle before each cell (default 0)\n"
+            "  --energy SRC        rapl, supply or none (default rapl)\n"
+            "  --rapl-domain S     sum top-level RAPL zones whose name starts with S (default package)\n"
+            "  --sysfs-root DIR    sysfs root holding class/powercap (default /sys)\n"
+            "  --power-supply DIR  with --energy supply: sample current_now/voltage_now in DIR\n"
+            "  --power-rate HZ     power samples per second (default 50)\n"
+            "  --current-scale N   multiply current_now by N to get uA (default 1)\n"
+            "  -o FILE     write the JSON report to FILE (default stdout)\n",
+            argv0);
+}
+
+bool parse_list(const char* text, std::vector<int>& out) {
+    out.clear();
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        const int value = std::atoi(item.c_str());
+        if (value <= 0) return false;
+        out.push_back(value);
+    }
+    return !out.empty();
+}
+
+bool parse_args(int argc, char** argv, sweep_params& params) {
+    sweep_matrix& matrix = params.matrix;
+    matrix.n_threads = {4};
+    matrix.n_ctx = {2048};
+    matrix.n_batch = {512};
+    matrix.max_tokens = {128};
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        auto next_list = [&](std::vector<int>& out) {
+            return i + 1 < argc && parse_list(argv[++i], out);
+        };
+        auto next_int = [&](int& out) {
+            if (i + 1 >= argc) return false;
+            out = std::atoi(argv[++i]);
+            return true;
+        };
+        bool ok = true;
+        if (arg == "-m" && i + 1 < argc) {
+            matrix.models.push_back(argv[++i]);
+        } else if (arg == "-t") {
+            ok = next_list(matrix.n_threads);
+        } else if (arg == "-c") {
+            ok = next_list(matrix.n_ctx);
+        } else if (arg == "-b") {
+            ok = next_list(matrix.n_batch);
+        } else if (arg == "-n") {
+            ok = next_list(matrix.max_tokens);
+        } else if (arg == "-p" && i + 1 < argc) {
+            params.prompts_path = argv[++i];
+        } else if (arg == "-w") {
+            ok = next_int(matrix.warmup);
+        } else if (arg == "-r") {
+            ok = next_int(matrix.repetitions);
+        } else if (arg == "--cooldown-ms") {
+            ok = next_int(matrix.cooldown_ms);
+        } else if (arg == "--energy" && i + 1 < argc) {
+            params.energy = argv[++i];
+            ok = params.energy == "rapl" || params.energy == "supply" || params.energy == "none";
+        } else if (arg == "--rapl-domain" && i + 1 < argc) {
+            params.rapl_domain = argv[++i];
+        } else if (arg == "--sysfs-root" && i + 1 < argc) {
+            params.sysfs_root = argv[++i];
+        } else if (arg == "--power-supply" && i + 1 < argc) {
+            params.power_supply = argv[++i];
+        } else if (arg == "--power-rate") {
+            ok = next_int(params.power_rate_hz);
+        } else if (arg == "--current-scale") {
+            ok = next_int(params.current_scale);
+        } else if (arg == "-o" && i + 1 < argc) {
+            params.output_path = argv[++i];
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "invalid argument: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    if (params.energy == "supply" && params.power_supply.empty()) {
+        fprintf(stderr, "--energy supply needs --power-supply DIR\n");
+        return false;
+    }
+    return !matrix.models.empty() && matrix.repetitions > 0 && matrix.warmup >= 0;
+}
+
+std::vector<std::string> load_prompts(const std::string& path) {
+    std::vector<std::string> prompts;
+    if (path.empty()) {
+        prompts.assign(std::begin(DEFAULT_PROMPTS), std::end(DEFAULT_PROMPTS));
+        return prompts;
+    }
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty()) prompts.push_back(line);
+    }
+    return prompts;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    sweep_params params;
+    if (!parse_args(argc, argv, params)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    sweep_matrix& matrix = params.matrix;
+    matrix.prompts = load_prompts(params.prompts_path);
+    if (matrix.prompts.empty()) {
+        fprintf(stderr, "no prompts to run\n");
+        return 2;
+    }
+
+    power_sampler sampler;
+    std::unique_ptr<energy_meter> meter;
+    if (params.energy == "rapl") {
+        auto rapl = std::make_unique<rapl_meter>(params.sysfs_root, params.rapl_domain);
+        if (!rapl->open()) {
+            fprintf(stderr, "no readable RAPL %s zone under %s/class/powercap (try root or --energy none)\n",
+                    params.rapl_domain.c_str(), params.sysfs_root.c_str());
+            return 1;
+        }
+        for (const std::string& zone : rapl->zones()) {
+            fprintf(stderr, "energy: rapl %s\n", zone.c_str());
+        }
+        meter = std::move(rapl);
+    } else if (params.energy == "supply") {
+        if (!sampler.start(params.power_supply, params.power_rate_hz, params.current_scale)) {
+            fprintf(stderr, "cannot sample power from %s\n", params.power_supply.c_str());
+            return 1;
+        }
+        meter = std::make_unique<sampler_meter>(&sampler);
+    }
+
+    const size_t n_cells = matrix.models.size() * matrix.n_threads.size() * matrix.n_ctx.size() *
+                           matrix.n_batch.size() * matrix.max_tokens.size();
+    fprintf(stderr, "%zu cells x (%d warmup + %d x %zu prompts)\n", n_cells, matrix.warmup,
+            matrix.repetitions, matrix.prompts.size());
+
+    int failed_cells = 0;
+    sweep_progress on_cell = [&](const sweep_cell& cell, size_t index, size_t total) {
+        if (!cell.ok) {
+            failed_cells++;
+            fprintf(stderr, "[%zu/%zu] %s t%d c%d b%d n%d: %s\n", index + 1, total, cell.model.c_str(),
+                    cell.n_threads, cell.n_ctx, cell.n_batch, cell.max_tokens, cell.error.c_str());
+            return;
+        }
+        int64_t n_generated = 0, t_decode_us = 0, energy_uj = 0;
+        for (const sweep_run& run : cell.runs) {
+            n_generated += run.n_generated;
+            t_decode_us += run.t_decode_us;
+            energy_uj += run.energy_prefill_uj + run.energy_decode_uj;
+        }
+        fprintf(stderr, "[%zu/%zu] %s t%d c%d b%d n%d: %zu runs, decode %.2f tok/s", index + 1, total,
+                cell.model.c_str(), cell.n_threads, cell.n_ctx, cell.n_batch, cell.max_tokens, cell.runs.size(),
+                t_decode_us > 0 ? n_generated * 1e6 / t_decode_us : 0.0);
+        if (meter && n_generated > 0 && !cell.runs.empty() && cell.runs[0].energy_prefill_uj >= 0) {
+            fprintf(stderr, ", %.1f mJ/token", energy_uj / 1000.0 / n_generated);
+        }
+        fprintf(stderr, "\n");
+    };
+
+    const std::vector<sweep_cell> cells = run_sweep(matrix, meter.get(), on_cell);
+    const std::string report = sweep_report_json(matrix, meter.get(), cells);
+    sampler.stop();
+
+    if (params.output_path.empty()) {
+        fwrite(report.data(), 1, report.size(), stdout);
+    } else {
+        std::ofstream out(params.output_path, std::ios::trunc);
+        out << report;
+        if (!out) {
+            fprintf(stderr, "cannot write %s\n", params.output_path.c_str());
+            return 1;
+        }
+        fprintf(stderr, "report written to %s\n", params.output_path.c_str());
+    }
+    return failed_cells > 0 ? 1 : 0;
+}
@@ -0,0 +1,80 @@
+// Sampling microbenchmark: time per token for argmax and top-k/top-p sampling
+// at the vocabulary sizes of the models we care about.
+//
+//   cmake -S app/src/main/cpp -B build-host && cmake --build build-host --target sampler-bench
+//   ./build-host/sampler-bench [iterations]
+
+#include "sampler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+template <typename F>
+double time_per_call_us(int iterations, F&& fn) {
+    auto start = bench_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        fn(i);
+    }
+    auto elapsed = std::chrono::duration<double, std::micro>(bench_clock::now() - start);
+    return elapsed.count() / iterations;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+
+    // Llama-2, Llama-3 and Qwen2.5 vocabulary sizes
+    const int32_t vocab_sizes[] = {32000, 128256, 151936};
+
+    std::mt19937 rng(42);
+    std::normal_distribution<float> dist(0.0f, 4.0f);
+
+    printf("%-8s %12s %12s %12s %12s\n", "n_vocab", "argmax_ref", "argmax", "top-k/p", "full-vocab");
+
+    for (int32_t n_vocab : vocab_sizes) {
+        // A few distinct rows so the branch predictor cannot learn the answer
+        const int n_rows = 8;
+        std::vector<float> logits((size_t) n_rows * n_vocab);
+        for (float& v : logits) {
+            v = dist(rng);
+        }
+        auto row = [&](int i) { return logits.data() + (size_t) (i % n_rows) * n_vocab; };
+
+        for (int r = 0; r < n_rows; r++) {
+            if (argmax_f32(row(r), n_vocab) != argmax_f32_ref(row(r), n_vocab)) {
+                fprintf(stderr, "argmax mismatch at n_vocab=%d row=%d\n", n_vocab, r);
+                return 1;
+            }
+        }
+
+        volatile int32_t sink = 0;
+        double t_ref = time_per_call_us(iterations, [&](int i) { sink = argmax_f32_ref(row(i), n_vocab); });
+        double t_simd = time_per_call_us(iterations, [&](int i) { sink = argmax_f32(row(i), n_vocab); });
+
+        sampler_params params;
+        params.temperature = 0.8f;
+        params.top_k = 40;
+        params.top_p = 0.95f;
+        params.min_p = 0.05f;
+        params.seed = 1234;
+        token_sampler topk_sampler(n_vocab, params);
+        double t_topk = time_per_call_us(iterations, [&](int i) { sink = topk_sampler.sample(row(i)); });
+
+        params.top_k = 0;
+        token_sampler full_sampler(n_vocab, params);
+        double t_full = time_per_call_us(iterations, [&](int i) { sink = full_sampler.sample(row(i)); });
+        (void) sink;
+
+        printf("%-8d %10.1fus %10.1fus %10.1fus %10.1fus\n", n_vocab, t_ref, t_simd, t_topk, t_full);
+    }
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+// Converts a telemetry log pulled from a device into the CSV files DataLogger exports,
+// without loading it into memory. Works on logs cut short by a crash.
+//
+//   adb pull /sdcard/Android/data/com.research.llmbattery/files/Documents/telemetry
+//   cmake -S app/src/main/cpp -B build-host && cmake --build build-host --target telemetry-dump
+//   ./build-host/telemetry-dump telemetry out/                 query_results.csv + battery_metrics.csv
+//   ./build-host/telemetry-dump telemetry --combined all.csv   one interleaved file
+
+#include "telemetry_log.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+int main(int argc, char** argv) {
+    if (argc != 3 && !(argc == 4 && std::strcmp(argv[2], "--combined") == 0)) {
+        fprintf(stderr,
+                "usage: %s LOG_DIR OUT_DIR\n"
+                "       %s LOG_DIR --combined FILE\n",
+                argv[0], argv[0]);
+        return 2;
+    }
+
+    const std::string log_dir = argv[1];
+    int64_t n;
+    if (argc == 4) {
+        n = export_combined_csv(log_dir, argv[3]);
+    } else {
+        const std::string out_dir = argv[2];
+        n = export_csv(log_dir, out_dir + "/query_results.csv", out_dir + "/battery_metrics.csv");
+    }
+    if (n < 0) {
+        fprintf(stderr, "export failed\n");
+        return 1;
+    }
+    printf("%lld records\n", (long long) n);
+    return 0;
+}
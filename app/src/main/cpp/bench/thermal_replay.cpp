@@ -0,0 +1,153 @@
+// Replays a scripted temperature trace through the thermal governor on a fake sysfs
+// tree, printing the operating point it picks for each query. The tree has a little
+// and a big cluster; each trace line is one query:
+//
+//   # temp_c [cap_percent]      cap_percent scales scaling_max_freq of the big cores
+//   41.0
+//   46.5 100
+//   48.0 80
+//
+// Decode efficiency is synthetic: big-cluster points measure 1 token per joule and
+// little-cluster points --little-efficiency, so the efficiency and exploration paths
+// can be exercised as well.
+//
+//   cmake --build build-host --target thermal-replay
+//   ./build-host/thermal-replay trace.txt [--target C] [--hysteresis C] [--little-efficiency X]
+
+#include "thermal_governor.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+constexpr int N_LITTLE = 4;
+constexpr int N_BIG = 4;
+constexpr int64_t LITTLE_MAX_KHZ = 1800000;
+constexpr int64_t BIG_MAX_KHZ = 2800000;
+
+bool write_file(const std::string& path, const std::string& text) {
+    std::ofstream out(path, std::ios::trunc);
+    out << text << '\n';
+    return (bool) out;
+}
+
+void make_dirs(const std::string& path) {
+    for (size_t i = 1; i <= path.size(); i++) {
+        if (i == path.size() || path[i] == '/') {
+            mkdir(path.substr(0, i).c_str(), 0755);
+        }
+    }
+}
+
+// <root>/class/thermal/thermal_zone0 and <root>/devices/system/cpu for 4 little + 4 big cores
+bool make_tree(const std::string& root) {
+    const std::string zone = root + "/class/thermal/thermal_zone0";
+    make_dirs(zone);
+    bool ok = write_file(zone + "/type", "cpu-thermal") && write_file(zone + "/temp", "40000");
+
+    const std::string cpu_root = root + "/devices/system/cpu";
+    make_dirs(cpu_root);
+    ok = ok && write_file(cpu_root + "/online", "0-" + std::to_string(N_LITTLE + N_BIG - 1));
+    for (int c = 0; c < N_LITTLE + N_BIG; c++) {
+        const bool big = c >= N_LITTLE;
+        const std::string freq = cpu_root + "/cpu" + std::to_string(c) + "/cpufreq";
+        make_dirs(freq);
+        const std::string max_khz = std::to_string(big ? BIG_MAX_KHZ : LITTLE_MAX_KHZ);
+        std::string related;
+        for (int r = big ? N_LITTLE : 0; r < (big ? N_LITTLE + N_BIG : N_LITTLE); r++) {
+            related += (related.empty() ? "" : " ") + std::to_string(r);
+        }
+        ok = ok && write_file(cpu_root + "/cpu" + std::to_string(c) + "/cpu_capacity", big ? "1024" : "400") &&
+             write_file(freq + "/cpuinfo_max_freq", max_khz) &&
+             write_file(freq + "/scaling_max_freq", max_khz) &&
+             write_file(freq + "/related_cpus", related);
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s trace.txt [--target C] [--hysteresis C] [--little-efficiency X]\n", argv[0]);
+        return 2;
+    }
+    thermal_envelope envelope;
+    double little_efficiency = 1.0;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--target") == 0) {
+            envelope.target_mc = (int) (std::atof(argv[i + 1]) * 1000);
+        } else if (std::strcmp(argv[i], "--hysteresis") == 0) {
+            envelope.hysteresis_mc = (int) (std::atof(argv[i + 1]) * 1000);
+        } else if (std::strcmp(argv[i], "--little-efficiency") == 0) {
+            little_efficiency = std::atof(argv[i + 1]);
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    std::ifstream trace(argv[1]);
+    if (!trace) {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 1;
+    }
+    char root_template[] = "/tmp/thermal-replay-XXXXXX";
+    if (!mkdtemp(root_template) || !make_tree(root_template)) {
+        fprintf(stderr, "cannot create the fake sysfs tree\n");
+        return 1;
+    }
+    const std::string root = root_template;
+
+    thermal_governor governor(root);
+    if (!governor.start(envelope, 0)) {
+        fprintf(stderr, "governor did not start on %s\n", root.c_str());
+        return 1;
+    }
+    printf("operating points:\n");
+    for (size_t l = 0; l < governor.ladder().size(); l++) {
+        const operating_point& p = governor.ladder()[l];
+        printf("  %zu: %s x%d, pacing %d ms\n", l, placement_policy_name(p.policy), p.n_threads, p.pacing_us / 1000);
+    }
+    printf("%5s %7s %5s %5s %-7s %7s %9s %s\n", "query", "temp_c", "cap%", "level", "cores", "threads", "pacing_ms", "reason");
+
+    std::string line;
+    int query = 0;
+    while (std::getline(trace, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        double temp_c = 0.0;
+        double cap_percent = 100.0;
+        std::istringstream fields(line);
+        if (!(fields >> temp_c)) continue;
+        fields >> cap_percent;
+
+        write_file(root + "/class/thermal/thermal_zone0/temp", std::to_string((int64_t) (temp_c * 1000)));
+        for (int c = N_LITTLE; c < N_LITTLE + N_BIG; c++) {
+            write_file(root + "/devices/system/cpu/cpu" + std::to_string(c) + "/cpufreq/scaling_max_freq",
+                       std::to_string((int64_t) (BIG_MAX_KHZ * cap_percent / 100.0)));
+        }
+
+        const governor_decision d = governor.decide();
+        printf("%5d %7.1f %5d %5d %-7s %7d %9d %s\n", query++, d.reading.temp_mc / 1000.0,
+               d.reading.cap_permille / 10, d.level, placement_policy_name(d.point.policy), d.point.n_threads,
+               d.point.pacing_us / 1000, governor_reason_name(d.reason));
+
+        // 100 tokens at the synthetic efficiency of the chosen cluster
+        const double tokens_per_joule = d.point.policy == PLACEMENT_LITTLE ? little_efficiency : 1.0;
+        governor.record(d.level, 100, (int64_t) (100 * 1e6 / tokens_per_joule));
+    }
+
+    governor.stop();
+    std::string cleanup = "rm -rf '" + root + "'";
+    if (std::system(cleanup.c_str()) != 0) {
+        fprintf(stderr, "could not remove %s\n", root.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "chat_session.h"
+
+#include <algorithm>
+#include <utility>
+#include "native_log.h"
+
+chat_session::chat_session(llama_context_wrapper* wrapper, std::string system_prompt) : wrapper_(wrapper) {
+    const char* tmpl = llama_model_chat_template(wrapper_->model, nullptr);
+    template_ = tmpl ? tmpl : "chatml";
+    if (!system_prompt.empty()) {
+        messages_.push_back({"system", std::move(system_prompt)});
+        has_system_ = true;
+    }
+
+    // llama_chat_apply_template only knows the templates built into llama.cpp
+    std::string probe;
+    if (!format(true, probe)) {
+        LOGW("Chat template of the model is not supported, using chatml");
+        template_ = "chatml";
+    }
+    LOGD("Chat session created (%zu byte template)", template_.size());
+}
+
+bool chat_session::format(bool add_assistant, std::string& out) const {
+    std::vector<llama_chat_message> chat;
+    chat.reserve(messages_.size());
+    size_t n_chars = 0;
+    for (const message& m : messages_) {
+        chat.push_back({m.role.c_str(), m.content.c_str()});
+        n_chars += m.role.size() + m.content.size();
+    }
+
+    out.resize(std::max(out.capacity(), 2 * n_chars + 256));
+    int32_t n = llama_chat_apply_template(template_.c_str(), chat.data(), chat.size(), add_assistant,
+                                          &out[0], (int32_t) out.size());
+    if (n > (int32_t) out.size()) {
+        out.resize(n);
+        n = llama_chat_apply_template(template_.c_str(), chat.data(), chat.size(), add_assistant,
+                                      &out[0], (int32_t) out.size());
+    }
+    if (n < 0) {
+        out.clear();
+        return false;
+    }
+    out.resize(n);
+    return true;
+}
+
+bool chat_session::respond(const std::string& user_text, int max_tokens, int flush_every,
+                           const piece_callback& on_piece, std::string& reply) {
+    reply.clear();
+    messages_.push_back({"user", user_text});
+    if (!format(true, formatted_)) {
+        LOGE("Failed to apply the chat template");
+        messages_.pop_back();
+        return false;
+    }
+
+    // Keep the cached tokens whose text the conversation still starts with; normally
+    // that is all of them and only the new turn is left
+    const int64_t t_start = now_ns();
+    size_t n_common = kv_text_.size();
+    if (formatted_.compare(0, kv_text_.size(), kv_text_) != 0) {
+        n_common = std::mismatch(kv_text_.begin(), kv_text_.end(), formatted_.begin(), formatted_.end()).first -
+                   kv_text_.begin();
+        LOGD("Chat history changed at byte %zu of %zu, rolling back", n_common, kv_text_.size());
+    }
+    const size_t n_keep = std::upper_bound(text_end_.begin(), text_end_.end(), n_common) - text_end_.begin();
+    tokens_.resize(n_keep);
+    text_end_.resize(n_keep);
+    kv_text_.resize(n_keep > 0 ? text_end_.back() : 0);
+
+    // Template markers in the new text are special tokens; BOS only starts the conversation
+    const std::string_view delta = std::string_view(formatted_).substr(kv_text_.size());
+    const std::vector<llama_token> delta_tokens =
+        tokenize(llama_model_get_vocab(wrapper_->model), delta, tokens_.empty(), true);
+    tokens_.insert(tokens_.end(), delta_tokens.begin(), delta_tokens.end());
+    text_end_.insert(text_end_.end(), delta_tokens.size(), formatted_.size());
+    kv_text_.append(delta);
+    const size_t n_prompt = tokens_.size();
+    const int64_t t_tokenize_us = (now_ns() - t_start) / 1000;
+    LOGD("Chat turn %d: %zu new tokens on %zu cached", n_turns() + 1, delta_tokens.size(), n_keep);
+
+    text_sink sink(reply);
+    const bool ok = generate_tokens(wrapper_, tokens_.data(), tokens_.size(), t_tokenize_us,
+                                    max_tokens, flush_every, on_piece, sink);
+    const std::vector<llama_token>& cached = wrapper_->cached_tokens;
+    if (!ok) {
+        messages_.pop_back();
+        if (cached.size() < n_prompt) {
+            // The prefill failed or was cancelled; only the prefix it reused is still cached
+            tokens_.resize(cached.size());
+            text_end_.resize(cached.size());
+            kv_text_.resize(text_end_.empty() ? 0 : text_end_.back());
+        }
+        return false;
+    }
+
+    // The reply tokens decoded into the cache follow the prompt. The end-of-turn token
+    // that stopped the generation was never decoded, so the template's closing text is
+    // part of the next turn's new text.
+    for (size_t i = n_prompt; i < cached.size(); i++) {
+        tokens_.push_back(cached[i]);
+        wrapper_->pieces.append(cached[i], kv_text_);
+        text_end_.push_back(kv_text_.size());
+    }
+    messages_.push_back({"assistant", reply});
+    return true;
+}
+
+void chat_session::reset() {
+    messages_.resize(has_system_ ? 1 : 0);
+}
+
+int chat_session::n_turns() const {
+    return (int) std::count_if(messages_.begin(), messages_.end(),
+                               [](const message& m) { return m.role == "assistant"; });
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "llm_core.h"
+
+// Multi-turn conversation on sequence 0 of a context. Every turn formats the whole
+// conversation with the model's chat template (llama_chat_apply_template), but only the
+// text appended since the previous turn is tokenized and prefilled: the session keeps
+// the tokens its turns left in the KV cache together with the text they stand for, and
+// hands generate_tokens those tokens followed by the new ones, so the prefix cache reuses
+// everything before them. Per-turn cost scales with the turn, not the conversation.
+//
+// If the formatted conversation no longer starts with the cached text (a template that
+// rewrites earlier turns, a stop string cut inside the cache) the session falls back to
+// the last token that still matches. Other generations on the same context replace the
+// cached tokens; the next turn then prefills whatever is no longer cached.
+class chat_session {
+public:
+    // Uses the template stored in the model, or chatml if it has none or llama.cpp does
+    // not recognize it. `system_prompt` may be empty.
+    chat_session(llama_context_wrapper* wrapper, std::string system_prompt);
+
+    // Appends a user turn and generates the assistant turn into `reply` (replacing its
+    // contents), streaming through `on_piece` like generate. The stop conditions of the
+    // context apply. On failure the user turn is dropped again.
+    bool respond(const std::string& user_text, int max_tokens, int flush_every,
+                 const piece_callback& on_piece, std::string& reply);
+
+    // Forgets every turn but the system prompt, whose tokens stay cached
+    void reset();
+
+    int n_turns() const;            // completed user and assistant exchanges
+    int n_tokens() const { return (int) tokens_.size(); }
+    const std::string& chat_template() const { return template_; }
+
+private:
+    struct message {
+        std::string role;
+        std::string content;
+    };
+
+    bool format(bool add_assistant, std::string& out) const;
+
+    llama_context_wrapper* wrapper_;
+    std::string template_;          // template text from the GGUF, or a built-in name
+    std::vector<message> messages_;
+    bool has_system_ = false;
+    std::vector<llama_token> tokens_;   // conversation tokens in the KV cache, by position
+    std::vector<size_t> text_end_;      // end of the text of each token in kv_text_
+    std::string kv_text_;               // formatted conversation the tokens stand for
+    std::string formatted_;             // scratch, reused across turns
+};
@@ -0,0 +1,189 @@
+#include "cpu_topology.h"
+
+#include <dirent.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace {
+
+bool read_first_line(const std::string& path, std::string& line) {
+    std::ifstream in(path);
+    return in && std::getline(in, line);
+}
+
+int64_t read_int(const std::string& path, int64_t fallback) {
+    std::string line;
+    if (!read_first_line(path, line) || line.empty()) return fallback;
+    return std::strtoll(line.c_str(), nullptr, 10);
+}
+
+// Parses cpu lists in either sysfs format: ranges ("0-3,6") or space separated ("4 5 6 7")
+std::vector<int> parse_cpu_list(const std::string& text) {
+    std::vector<int> cpus;
+    std::string normalized = text;
+    std::replace(normalized.begin(), normalized.end(), ',', ' ');
+    std::istringstream in(normalized);
+    std::string item;
+    while (in >> item) {
+        const size_t dash = item.find('-');
+        const int first = std::atoi(item.substr(0, dash).c_str());
+        const int last = dash == std::string::npos ? first : std::atoi(item.substr(dash + 1).c_str());
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+// Fallback when <root>/online is missing: every cpuN directory
+std::vector<int> list_cpu_dirs(const std::string& root) {
+    std::vector<int> cpus;
+    DIR* dir = opendir(root.c_str());
+    if (!dir) return cpus;
+    while (dirent* entry = readdir(dir)) {
+        int id;
+        char extra;
+        if (std::sscanf(entry->d_name, "cpu%d%c", &id, &extra) == 1) {
+            cpus.push_back(id);
+        }
+    }
+    closedir(dir);
+    std::sort(cpus.begin(), cpus.end());
+    return cpus;
+}
+
+} // namespace
+
+const char* placement_policy_name(placement_policy policy) {
+    switch (policy) {
+        case PLACEMENT_OS: return "os";
+        case PLACEMENT_ALL: return "all";
+        case PLACEMENT_BIG: return "big";
+        case PLACEMENT_PRIME: return "prime";
+        case PLACEMENT_LITTLE: return "little";
+        default: return "unknown";
+    }
+}
+
+bool parse_placement_policy(const std::string& name, placement_policy& policy) {
+    for (int p = 0; p < PLACEMENT_POLICY_COUNT; p++) {
+        if (name == placement_policy_name((placement_policy) p)) {
+            policy = (placement_policy) p;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool read_cpu_topology(cpu_topology& topo, const std::string& sysfs_root) {
+    topo = cpu_topology();
+
+    std::string online;
+    std::vector<int> ids = read_first_line(sysfs_root + "/online", online)
+        ? parse_cpu_list(online) : list_cpu_dirs(sysfs_root);
+    if (ids.empty()) return false;
+
+    // Cores sharing a frequency domain (related_cpus) form a cluster; without cpufreq,
+    // cores with identical capacity and frequency are grouped instead
+    std::map<std::string, std::vector<int>> domains;
+    int64_t max_freq_all = 0;
+    for (int id : ids) {
+        const std::string dir = sysfs_root + "/cpu" + std::to_string(id);
+        cpu_core core;
+        core.id = id;
+        core.max_freq_khz = read_int(dir + "/cpufreq/cpuinfo_max_freq", 0);
+        core.capacity = (int) read_int(dir + "/cpu_capacity", -1);
+        core.cluster = -1;
+        max_freq_all = std::max(max_freq_all, core.max_freq_khz);
+        topo.cores.push_back(core);
+
+        std::string related;
+        std::string key = read_first_line(dir + "/cpufreq/related_cpus", related) && !related.empty()
+            ? "rel:" + std::to_string(parse_cpu_list(related).front())
+            : "cap:" + std::to_string(core.capacity) + ":" + std::to_string(core.max_freq_khz);
+        domains[key].push_back(id);
+    }
+
+    // Kernels without cpu_capacity: scale max frequency to the same 0..1024 range
+    for (cpu_core& core : topo.cores) {
+        if (core.capacity < 0) {
+            core.capacity = max_freq_all > 0 ? (int) (core.max_freq_khz * 1024 / max_freq_all) : 1024;
+        }
+    }
+
+    auto find_core = [&](int id) -> cpu_core& {
+        return *std::find_if(topo.cores.begin(), topo.cores.end(), [&](const cpu_core& c) { return c.id == id; });
+    };
+
+    for (auto& domain : domains) {
+        cpu_cluster cluster;
+        cluster.cpus = domain.second;
+        cluster.capacity = 0;
+        cluster.max_freq_khz = 0;
+        for (int id : cluster.cpus) {
+            const cpu_core& core = find_core(id);
+            cluster.capacity = std::max(cluster.capacity, core.capacity);
+            cluster.max_freq_khz = std::max(cluster.max_freq_khz, core.max_freq_khz);
+        }
+        topo.clusters.push_back(cluster);
+    }
+    std::stable_sort(topo.clusters.begin(), topo.clusters.end(), [](const cpu_cluster& a, const cpu_cluster& b) {
+        return a.capacity != b.capacity ? a.capacity < b.capacity : a.max_freq_khz < b.max_freq_khz;
+    });
+    for (size_t c = 0; c < topo.clusters.size(); c++) {
+        for (int id : topo.clusters[c].cpus) {
+            find_core(id).cluster = (int) c;
+        }
+    }
+    return true;
+}
+
+std::vector<int> placement_cpus(const cpu_topology& topo, placement_policy policy) {
+    std::vector<int> cpus;
+    if (topo.clusters.empty() || policy == PLACEMENT_OS) return cpus;
+
+    const size_t n_clusters = topo.clusters.size();
+    size_t first = 0;
+    size_t last = n_clusters;           // exclusive
+    switch (policy) {
+        case PLACEMENT_BIG:    first = n_clusters > 1 ? 1 : 0; break;
+        case PLACEMENT_PRIME:  first = n_clusters - 1; break;
+        case PLACEMENT_LITTLE: last = 1; break;
+        default: break;
+    }
+    for (size_t c = first; c < last; c++) {
+        cpus.insert(cpus.end(), topo.clusters[c].cpus.begin(), topo.clusters[c].cpus.end());
+    }
+    std::sort(cpus.begin(), cpus.end());
+    return cpus;
+}
+
+uint64_t cpu_mask_bits(const std::vector<int>& cpus) {
+    uint64_t bits = 0;
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < 64) bits |= 1ull << cpu;
+    }
+    return bits;
+}
+
+std::string describe_topology(const cpu_topology& topo) {
+    std::string out;
+    char line[128];
+    for (size_t c = 0; c < topo.clusters.size(); c++) {
+        const cpu_cluster& cluster = topo.clusters[c];
+        std::string cpus;
+        for (int id : cluster.cpus) {
+            cpus += (cpus.empty() ? "" : ",") + std::to_string(id);
+        }
+        std::snprintf(line, sizeof(line), "cluster %zu: cpus %s, capacity %d, max %lld MHz\n",
+                      c, cpus.c_str(), cluster.capacity, (long long) (cluster.max_freq_khz / 1000));
+        out += line;
+    }
+    return out;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// CPU topology read from sysfs, used to place ggml worker threads on heterogeneous
+// (big.LITTLE) SoCs. The sysfs root is a parameter so the parser and the placement
+// policies can be exercised on a host against a fake tree, e.g.
+//   <root>/online                              "0-7"
+//   <root>/cpu4/cpu_capacity                   "1024"
+//   <root>/cpu4/cpufreq/cpuinfo_max_freq       "2400000"
+//   <root>/cpu4/cpufreq/related_cpus           "4 5 6 7"
+
+struct cpu_core {
+    int id;
+    int capacity;                   // cpu_capacity (0..1024), or derived from max frequency
+    int64_t max_freq_khz;           // 0 if cpufreq is not exposed
+    int cluster;                    // index into cpu_topology::clusters
+};
+
+struct cpu_cluster {
+    std::vector<int> cpus;
+    int capacity;                   // highest capacity of the cluster's cores
+    int64_t max_freq_khz;
+};
+
+struct cpu_topology {
+    std::vector<cpu_core> cores;    // online cores by id
+    std::vector<cpu_cluster> clusters;  // ordered by capacity, slowest first
+};
+
+// Which cores a set of worker threads may run on. Values are shared with Kotlin
+// (ThreadPlacement) and recorded in the generation metrics.
+enum placement_policy {
+    PLACEMENT_OS = 0,               // no affinity, the scheduler decides
+    PLACEMENT_ALL = 1,              // every online core
+    PLACEMENT_BIG = 2,              // every cluster except the slowest one
+    PLACEMENT_PRIME = 3,            // only the fastest cluster
+    PLACEMENT_LITTLE = 4,           // only the slowest cluster
+    PLACEMENT_POLICY_COUNT
+};
+
+const char* placement_policy_name(placement_policy policy);
+bool parse_placement_policy(const std::string& name, placement_policy& policy);
+
+// Parses the topology below `sysfs_root`. Returns false if no online core is found.
+bool read_cpu_topology(cpu_topology& topo, const std::string& sysfs_root = "/sys/devices/system/cpu");
+
+// Cores selected by `policy`, ascending. Empty for PLACEMENT_OS. A homogeneous
+// system has one cluster, so every policy other than OS selects all cores.
+std::vector<int> placement_cpus(const cpu_topology& topo, placement_policy policy);
+
+// Bit i set for each cpu i < 64, for compact logging in metrics
+uint64_t cpu_mask_bits(const std::vector<int>& cpus);
+
+std::string describe_topology(const cpu_topology& topo);
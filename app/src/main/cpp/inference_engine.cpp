@@ -0,0 +1,212 @@
+#include "inference_engine.h"
+
+#include <algorithm>
+#include <utility>
+#include "chat_session.h"
+#include "native_log.h"
+
+inference_engine::inference_engine(llama_context_wrapper* wrapper) : wrapper_(wrapper) {
+    llama_set_abort_callback(wrapper_->ctx, &inference_engine::abort_requested, this);
+    thread_ = std::thread(&inference_engine::run, this);
+    LOGD("Inference engine started");
+}
+
+inference_engine::~inference_engine() {
+    cancel(-1);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    llama_set_abort_callback(wrapper_->ctx, nullptr, nullptr);
+}
+
+// Only a request the engine is running can be aborted; synchronous calls on the same
+// context between requests (warm_prefix, generate_batch, ...) always run to completion.
+// running_ is only set while the worker holds the context, so it never covers them.
+bool inference_engine::abort_requested(void* data) {
+    const auto* engine = static_cast<inference_engine*>(data);
+    return engine->running_.load(std::memory_order_relaxed) &&
+           engine->abort_current_.load(std::memory_order_relaxed);
+}
+
+int64_t inference_engine::submit(std::string prompt, int max_tokens, int flush_every) {
+    auto req = std::make_shared<request>();
+    req->prompt = std::move(prompt);
+    req->index = -1;
+    req->max_tokens = max_tokens;
+    req->flush_every = flush_every;
+    return enqueue(std::move(req));
+}
+
+int64_t inference_engine::submit_indexed(int index, int max_tokens, int flush_every) {
+    auto req = std::make_shared<request>();
+    req->index = index;
+    req->max_tokens = max_tokens;
+    req->flush_every = flush_every;
+    return enqueue(std::move(req));
+}
+
+int64_t inference_engine::submit_chat(chat_session* session, std::string user_text, int max_tokens, int flush_every) {
+    auto req = std::make_shared<request>();
+    req->prompt = std::move(user_text);
+    req->index = -1;
+    req->session = session;
+    req->max_tokens = max_tokens;
+    req->flush_every = flush_every;
+    return enqueue(std::move(req));
+}
+
+int64_t inference_engine::enqueue(std::shared_ptr<request> req) {
+    int64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        id = req->id = next_id_++;
+        requests_[id] = req;
+        queue_.push_back(std::move(req));
+    }
+    wake_.notify_one();
+    return id;
+}
+
+bool inference_engine::poll(int64_t id, std::string& text, request_progress& progress, generation_stats* stats) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = requests_.find(id);
+    if (it == requests_.end()) return false;
+
+    request& req = *it->second;
+    text.clear();
+    text.swap(req.text);
+    progress = req.progress;
+    if (req.progress.status == REQUEST_COMPLETED || req.progress.status == REQUEST_FAILED) {
+        if (stats) *stats = req.stats;
+        requests_.erase(it);
+    }
+    return true;
+}
+
+bool inference_engine::cancel(int64_t id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::shared_ptr<request> aborted;
+    bool any;
+    if (id < 0) {
+        any = !requests_.empty();
+        for (auto& entry : requests_) {
+            entry.second->cancelled = true;
+        }
+        requests_.clear();
+        queue_.clear();
+        aborted = current_;
+    } else {
+        auto it = requests_.find(id);
+        if (it == requests_.end()) return false;
+        it->second->cancelled = true;
+        if (it->second == current_) {
+            aborted = current_;
+        } else {
+            queue_.erase(std::remove(queue_.begin(), queue_.end(), it->second), queue_.end());
+        }
+        requests_.erase(it);
+        any = true;
+    }
+
+    // Wait for the running request to leave the context, like release_session
+    if (aborted) {
+        abort_current_.store(true, std::memory_order_relaxed);
+        done_.wait(lock, [this, &aborted] { return current_ != aborted; });
+    }
+    return any;
+}
+
+void inference_engine::release_session(const chat_session* session) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (auto it = requests_.begin(); it != requests_.end();) {
+        if (it->second->session == session) {
+            it->second->cancelled = true;
+            it = requests_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    queue_.erase(std::remove_if(queue_.begin(), queue_.end(),
+                                [session](const std::shared_ptr<request>& req) { return req->session == session; }),
+                 queue_.end());
+    if (current_ && current_->session == session) {
+        abort_current_.store(true, std::memory_order_relaxed);
+        done_.wait(lock, [this, session] { return !current_ || current_->session != session; });
+    }
+}
+
+// Worker loop: one request at a time, in submission order
+void inference_engine::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (stopping_) break;
+
+        current_ = std::move(queue_.front());
+        queue_.pop_front();
+        current_->progress.status = REQUEST_RUNNING;
+        abort_current_.store(false, std::memory_order_relaxed);
+
+        // Wait for a synchronous call on the context to finish; a request cancelled
+        // meanwhile is dropped without touching the context
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> busy(wrapper_->busy);
+            running_.store(true, std::memory_order_relaxed);
+            if (!abort_current_.load(std::memory_order_relaxed)) {
+                execute(*current_);
+            }
+            running_.store(false, std::memory_order_relaxed);
+        }
+        lock.lock();
+
+        abort_current_.store(false, std::memory_order_relaxed);
+
+        if (current_->cancelled) {
+            LOGD("Request %lld cancelled after %d tokens", (long long) current_->id, current_->progress.n_tokens);
+        }
+        current_.reset();
+        done_.notify_all();
+    }
+}
+
+void inference_engine::execute(request& req) {
+    // Collect pieces for the poller; returning false ends the generation at the next push
+    // when the request was cancelled between decodes
+    piece_callback on_piece = [this, &req](std::string_view text, int n_tokens, int64_t timestamp_ns) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        req.text.append(text);
+        if (req.progress.n_tokens == 0) {
+            req.progress.t_first_token_ns = timestamp_ns;
+        }
+        req.progress.n_tokens += n_tokens;
+        req.progress.t_last_token_ns = timestamp_ns;
+        return !req.cancelled;
+    };
+
+    std::string response;
+    bool ok;
+    if (req.session) {
+        ok = req.session->respond(req.prompt, req.max_tokens, req.flush_every, on_piece, response);
+    } else if (req.index >= 0) {
+        ok = generate_indexed(wrapper_, req.index, req.max_tokens, req.flush_every, on_piece, response);
+    } else {
+        ok = generate(wrapper_, req.prompt, req.max_tokens, req.flush_every, on_piece, response);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    req.stats = wrapper_->last_stats;
+    req.progress.status = ok ? REQUEST_COMPLETED : REQUEST_FAILED;
+}
+
+void fill_progress(const request_progress& progress, int64_t* out) {
+    out[REQ_PROGRESS_STATUS] = progress.status;
+    out[REQ_PROGRESS_N_TOKENS] = progress.n_tokens;
+    out[REQ_PROGRESS_T_FIRST_TOKEN_NS] = progress.t_first_token_ns;
+    out[REQ_PROGRESS_T_LAST_TOKEN_NS] = progress.t_last_token_ns;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "llm_core.h"
+
+class chat_session;
+
+// Asynchronous front end of one context: requests are queued, generated one at a time
+// on a worker thread owned by the engine, and their text is collected by polling. The
+// caller's thread never blocks on llama_decode, and a cancelled request stops inside
+// the current decode call through the context's abort callback (llama.cpp checks it
+// between micro-batches), instead of after up to max_tokens more decodes.
+//
+// The engine owns the abort callback of the context. The worker holds the context's
+// `busy` mutex for the whole of each request, so other calls on the same context
+// (warm_prefix, pretokenize_prompts, set_thread_placement, ...) that take it as well
+// wait for the running request instead of racing it, and are never aborted by it.
+
+// Lifecycle of a request; cancelled requests are forgotten instead of reaching a status
+enum request_status {
+    REQUEST_QUEUED = 0,
+    REQUEST_RUNNING,
+    REQUEST_COMPLETED,
+    REQUEST_FAILED,
+};
+
+// Layout of the long[] progress array returned to Kotlin (RequestProgress)
+enum request_progress_index {
+    REQ_PROGRESS_STATUS = 0,
+    REQ_PROGRESS_N_TOKENS,
+    REQ_PROGRESS_T_FIRST_TOKEN_NS,
+    REQ_PROGRESS_T_LAST_TOKEN_NS,
+    REQ_PROGRESS_COUNT
+};
+
+struct request_progress {
+    request_status status = REQUEST_QUEUED;
+    int n_tokens = 0;               // tokens streamed so far
+    int64_t t_first_token_ns = 0;   // steady clock of the first and latest pushed piece, 0 before it
+    int64_t t_last_token_ns = 0;
+};
+
+class inference_engine {
+public:
+    explicit inference_engine(llama_context_wrapper* wrapper);
+    ~inference_engine();
+    inference_engine(const inference_engine&) = delete;
+    inference_engine& operator=(const inference_engine&) = delete;
+
+    // Queue a generation; the id is positive and never reused by this engine
+    int64_t submit(std::string prompt, int max_tokens, int flush_every);
+    // Same for prompt `index` of the set passed to pretokenize_prompts
+    int64_t submit_indexed(int index, int max_tokens, int flush_every);
+    // Queue the next turn of a chat session; the poller receives the assistant turn
+    int64_t submit_chat(chat_session* session, std::string user_text, int max_tokens, int flush_every);
+
+    // Moves the text produced since the previous poll into `text` and copies the
+    // progress. Once the request is finished, `stats` (if set) receives its generation
+    // stats and the request is forgotten. False for unknown or cancelled ids.
+    bool poll(int64_t id, std::string& text, request_progress& progress, generation_stats* stats);
+
+    // Cancels a request, or every request when id < 0, and forgets it. A running request
+    // stops within one micro-batch, and the call returns once it has, so the context is
+    // free again. False if there was nothing to cancel.
+    bool cancel(int64_t id);
+
+    // Cancels the requests of a session and waits until none of them is running, after
+    // which the session may be deleted
+    void release_session(const chat_session* session);
+
+private:
+    struct request {
+        int64_t id;
+        std::string prompt;
+        int index;                  // pretokenized prompt, -1 to use `prompt`
+        chat_session* session = nullptr;    // if set, `prompt` is its next user turn
+        int max_tokens;
+        int flush_every;
+        bool cancelled = false;
+        std::string text;           // produced and not yet polled
+        request_progress progress;
+        generation_stats stats;
+    };
+
+    int64_t enqueue(std::shared_ptr<request> req);
+    void run();
+    void execute(request& req);
+    static bool abort_requested(void* data);
+
+    llama_context_wrapper* wrapper_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;  // a running request finished
+    std::deque<std::shared_ptr<request>> queue_;
+    std::unordered_map<int64_t, std::shared_ptr<request>> requests_;  // queued, running or unpolled
+    std::shared_ptr<request> current_;
+    std::atomic<bool> abort_current_{false};
+    std::atomic<bool> running_{false};  // current_ is executing; the abort callback is inert otherwise
+    int64_t next_id_ = 1;
+    bool stopping_ = false;
+};
+
+// Copies progress into out[REQ_PROGRESS_COUNT]
+void fill_progress(const request_progress& progress, int64_t* out);
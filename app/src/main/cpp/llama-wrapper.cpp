@@ -1,73 +1,169 @@
 #include <jni.h>
-#include <android/log.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include "llama.cpp/include/llama.h"
+#include "chat_session.h"
+#include "cpu_topology.h"
+#include "inference_engine.h"
+#include "llm_core.h"
+#include "memory_probe.h"
+#include "model_loader.h"
+#include "model_registry.h"
+#include "native_log.h"
+#include "power_sampler.h"
+#include "proc_sampler.h"
+#include "sampler.h"
+#include "state_cache.h"
+#include "sweep_runner.h"
+#include "thermal_governor.h"
+#include "utf8.h"
 
-#define TAG "LLamaJNI"
-#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+// JNI bindings for LLMService; the inference logic lives in llm_core.cpp
 
-struct llama_context_wrapper {
-    llama_model* model;
-    llama_context* ctx;
-};
-
-// Helper: Convert jstring to C++ string
+// Helper: Convert jstring to C++ string (standard UTF-8, unlike GetStringUTFChars)
 std::string jstring2string(JNIEnv* env, jstring jStr) {
-    if (!jStr) return "";
-    const char* chars = env->GetStringUTFChars(jStr, nullptr);
-    std::string str(chars);
-    env->ReleaseStringUTFChars(jStr, chars);
+    std::string str;
+    if (!jStr) return str;
+    const jsize length = env->GetStringLength(jStr);
+    const jchar* chars = env->GetStringCritical(jStr, nullptr);
+    utf16_to_utf8(reinterpret_cast<const char16_t*>(chars), length, str);
+    env->ReleaseStringCritical(jStr, chars);
     return str;
 }
 
-// Helper: Clear batch
-void batch_clear(llama_batch& batch) {
-    batch.n_tokens = 0;
+// Helper: Convert UTF-8 text to jstring. NewStringUTF expects modified UTF-8 and
+// mangles 4-byte characters such as emoji, so the text is decoded here instead.
+jstring string2jstring(JNIEnv* env, const char* text, size_t length) {
+    thread_local std::u16string utf16;
+    utf8_to_utf16(text, length, utf16);
+    return env->NewString(reinterpret_cast<const jchar*>(utf16.data()), utf16.size());
 }
 
-// Helper: Add token to batch
-void batch_add(llama_batch& batch, llama_token id, llama_pos pos, const std::vector<llama_seq_id>& seq_ids, bool logits) {
-    if (batch.n_tokens >= 512) {
-        LOGE("Batch size exceeded");
-        return;
-    }
-    batch.token[batch.n_tokens] = id;
-    batch.pos[batch.n_tokens] = pos;
-    batch.n_seq_id[batch.n_tokens] = seq_ids.size();
-    for (size_t i = 0; i < seq_ids.size(); i++) {
-        batch.seq_id[batch.n_tokens][i] = seq_ids[i];
+jstring string2jstring(JNIEnv* env, const std::string& str) {
+    return string2jstring(env, str.data(), str.size());
+}
+
+// Helper: Address and capacity of a direct ByteBuffer; null if the buffer is not direct
+char* direct_buffer(JNIEnv* env, jobject buffer, jlong& capacity) {
+    if (!buffer) return nullptr;
+    capacity = env->GetDirectBufferCapacity(buffer);
+    return static_cast<char*>(env->GetDirectBufferAddress(buffer));
+}
+
+// Helper: Copy stats into a caller-provided long[METRIC_COUNT] (ignored if null or too short)
+void fill_metrics(JNIEnv* env, jlongArray out, const generation_stats& stats) {
+    if (!out || env->GetArrayLength(out) < METRIC_COUNT) return;
+    
+    jlong values[METRIC_COUNT] = {};
+    fill_metrics(stats, values);
+    env->SetLongArrayRegion(out, 0, METRIC_COUNT, values);
+}
+
+// Helper: Copy load phases into a Java long array of LOAD_PHASE_COUNT entries (ignored if null)
+void fill_load_phases(JNIEnv* env, jlongArray out, const load_phases& phases) {
+    if (!out || env->GetArrayLength(out) < LOAD_PHASE_COUNT) return;
+    
+    jlong values[LOAD_PHASE_COUNT] = {};
+    fill_load_phases(phases, values);
+    env->SetLongArrayRegion(out, 0, LOAD_PHASE_COUNT, values);
+}
+
+// Helper: Topology of this device, read from sysfs once
+const cpu_topology& device_topology() {
+    static const cpu_topology topo = [] {
+        cpu_topology t;
+        if (!read_cpu_topology(t)) {
+            LOGW("CPU topology unavailable, thread placement limited to the OS policy");
+        }
+        return t;
+    }();
+    return topo;
+}
+
+// Helper: Battery power sampler shared by every context in the process
+power_sampler& device_power_sampler() {
+    static power_sampler sampler;
+    return sampler;
+}
+
+// Helper: CPU and per-thread usage sampler shared by every context in the process
+proc_sampler& device_proc_sampler() {
+    static proc_sampler sampler;
+    return sampler;
+}
+
+// Helper: Thermal governor shared by every context in the process
+thermal_governor& device_thermal_governor() {
+    static thermal_governor governor;
+    return governor;
+}
+
+// Helper: Context options from the nativeInit arguments
+context_options make_context_options(jint nThreads, jint nCtx, jint nBatch, jint nUbatch, jint nSeqMax,
+                                     jint kvTypeK, jint kvTypeV, jint flashAttn,
+                                     jboolean offloadKqv, jboolean opOffload) {
+    context_options options;
+    options.n_threads = nThreads;
+    options.n_ctx = nCtx;
+    options.n_batch = nBatch;
+    options.n_ubatch = nUbatch;
+    options.n_seq_max = nSeqMax;
+    options.type_k = (ggml_type) kvTypeK;
+    options.type_v = (ggml_type) kvTypeV;
+    options.flash_attn = (llama_flash_attn_type) flashAttn;
+    options.offload_kqv = offloadKqv == JNI_TRUE;
+    options.op_offload = opOffload == JNI_TRUE;
+    return options;
+}
+
+// Helper: Create the context for a loaded model, attributing energy and CPU time through
+// the device samplers and placing generations through the thermal governor. The first
+// decode is run here so `phases` includes the cost of paging the weights in.
+jlong init_context(llama_model* model, const context_options& options, load_phases& phases) {
+    llama_context_wrapper* wrapper = create_wrapper(model, options);
+    if (wrapper) {
+        measure_first_touch(wrapper, phases);
+        wrapper->power = &device_power_sampler();
+        wrapper->proc = &device_proc_sampler();
+        wrapper->governor = &device_thermal_governor();
     }
-    batch.logits[batch.n_tokens] = logits;
-    batch.n_tokens++;
+    return reinterpret_cast<jlong>(wrapper);
+}
+
+// Helper: Copy a Java int[] into a vector (empty if null)
+std::vector<int> jint_vector(JNIEnv* env, jintArray array) {
+    if (!array) return {};
+    std::vector<int> values(env->GetArrayLength(array));
+    env->GetIntArrayRegion(array, 0, values.size(), reinterpret_cast<jint*>(values.data()));
+    return values;
 }
 
-// Helper: Tokenize text
-std::vector<llama_token> tokenize(const llama_vocab* vocab, const std::string& text, bool add_special) {
-    int n_tokens = text.length() + 2 * add_special;
-    std::vector<llama_token> result(n_tokens);
-    n_tokens = llama_tokenize(vocab, text.data(), text.length(), result.data(), result.size(), add_special, false);
-    if (n_tokens < 0) {
-        result.resize(-n_tokens);
-        n_tokens = llama_tokenize(vocab, text.data(), text.length(), result.data(), result.size(), add_special, false);
+// Helper: Copy a Java String[] into a vector (empty if null)
+std::vector<std::string> jstring_vector(JNIEnv* env, jobjectArray array) {
+    if (!array) return {};
+    const jsize n = env->GetArrayLength(array);
+    std::vector<std::string> values(n);
+    for (jsize i = 0; i < n; i++) {
+        auto jValue = static_cast<jstring>(env->GetObjectArrayElement(array, i));
+        values[i] = jstring2string(env, jValue);
+        env->DeleteLocalRef(jValue);
     }
-    result.resize(n_tokens);
-    return result;
+    return values;
 }
 
-// Helper: Convert token to piece
-std::string token_to_piece(const llama_vocab* vocab, llama_token token) {
-    std::string piece;
-    piece.resize(256);
-    int n_chars = llama_token_to_piece(vocab, token, &piece[0], piece.size(), 0, false);
-    if (n_chars < 0) {
-        piece.resize(-n_chars);
-        n_chars = llama_token_to_piece(vocab, token, &piece[0], piece.size(), 0, false);
-    } else {
-        piece.resize(n_chars);
+// Helper: Request engine of a context, started on the first submit
+inference_engine* context_engine(llama_context_wrapper* wrapper) {
+    static std::mutex engine_mutex;
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    if (!wrapper->engine) {
+        wrapper->engine = new inference_engine(wrapper);
     }
-    return piece;
+    return wrapper->engine;
 }
 
 extern "C" {
@@ -79,57 +175,459 @@ Java_com_research_llmbattery_LLMService_nativeInit(
     jobject /* this */,
     jstring jModelPath,
     jint nThreads,
-    jint nCtx
+    jint nCtx,
+    jint nBatch,
+    jint nUbatch,
+    jint nSeqMax,
+    jint kvTypeK,
+    jint kvTypeV,
+    jint flashAttn,
+    jboolean offloadKqv,
+    jboolean opOffload,
+    jlongArray loadPhasesOut
 ) {
     std::string modelPath = jstring2string(env, jModelPath);
     LOGD("Initializing model: %s", modelPath.c_str());
     
-    // Initialize llama backend
-    llama_backend_init();
-    
-    // Load model (updated API)
-    llama_model_params model_params = llama_model_default_params();
-    llama_model* model = llama_model_load_from_file(modelPath.c_str(), model_params);
-    
+    // Get a resident model (the registry initializes the backend on first use)
+    load_phases phases;
+    llama_model* model = load_model_from_path(modelPath, llama_model_default_params(), phases);
     if (!model) {
+        fill_load_phases(env, loadPhasesOut, phases);
         LOGE("Failed to load model from %s", modelPath.c_str());
         return 0;
     }
     
     LOGD("Model loaded successfully");
     
-    // Create context (updated API)
-    llama_context_params ctx_params = llama_context_default_params();
-    ctx_params.n_ctx = nCtx;
-    ctx_params.n_threads = nThreads;
-    ctx_params.n_threads_batch = nThreads;
+    jlong contextPtr = init_context(model, make_context_options(nThreads, nCtx, nBatch, nUbatch, nSeqMax,
+                                                                kvTypeK, kvTypeV, flashAttn, offloadKqv, opOffload),
+                                    phases);
+    fill_load_phases(env, loadPhasesOut, phases);
+    return contextPtr;
+}
+
+// Initialize from a GGUF region of an open file, e.g. an uncompressed APK asset
+// (AssetFileDescriptor fd/startOffset/length). The caller may close fd afterwards.
+JNIEXPORT jlong JNICALL
+Java_com_research_llmbattery_LLMService_nativeInitFromFd(
+    JNIEnv* env,
+    jobject /* this */,
+    jint fd,
+    jlong offset,
+    jlong length,
+    jstring jCacheDir,
+    jint nThreads,
+    jint nCtx,
+    jint nBatch,
+    jint nUbatch,
+    jint nSeqMax,
+    jint kvTypeK,
+    jint kvTypeV,
+    jint flashAttn,
+    jboolean offloadKqv,
+    jboolean opOffload,
+    jlongArray loadPhasesOut
+) {
+    std::string cacheDir = jCacheDir ? jstring2string(env, jCacheDir) : std::string();
+    LOGD("Initializing model from fd %d at offset %lld (%lld bytes)", fd, (long long) offset, (long long) length);
+    
+    load_phases phases;
+    llama_model* model = load_model_from_fd(fd, offset, length, cacheDir, llama_model_default_params(), phases);
+    if (!model) {
+        fill_load_phases(env, loadPhasesOut, phases);
+        LOGE("Failed to load model from fd %d", fd);
+        return 0;
+    }
+    
+    jlong contextPtr = init_context(model, make_context_options(nThreads, nCtx, nBatch, nUbatch, nSeqMax,
+                                                                kvTypeK, kvTypeV, flashAttn, offloadKqv, opOffload),
+                                    phases);
+    fill_load_phases(env, loadPhasesOut, phases);
+    return contextPtr;
+}
+
+// Generate text through caller-owned direct ByteBuffers: the UTF-8 prompt is read in
+// place and the UTF-8 response is written into responseBuf, with no jstring conversion
+// either way. Returns the response length in bytes, or -1 on error. A response longer
+// than the buffer is cut at a character boundary; nativeMaxResponseBytes gives a size
+// that always fits.
+JNIEXPORT jint JNICALL
+Java_com_research_llmbattery_LLMService_nativeGenerateDirect(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong contextPtr,
+    jobject promptBuf,
+    jint promptLength,
+    jobject responseBuf,
+    jint maxTokens,
+    jlongArray metricsOut
+) {
+    if (contextPtr == 0) {
+        LOGE("Invalid context pointer");
+        return -1;
+    }
+    
+    jlong prompt_capacity = 0;
+    jlong response_capacity = 0;
+    const char* prompt = direct_buffer(env, promptBuf, prompt_capacity);
+    char* out = direct_buffer(env, responseBuf, response_capacity);
+    if (!prompt || !out || promptLength < 0 || promptLength > prompt_capacity) {
+        LOGE("Prompt and response must be direct buffers holding the prompt");
+        return -1;
+    }
+    
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    std::lock_guard<std::mutex> lock(wrapper->busy);
+    
+    // Pieces are decoded straight into the response buffer, with no intermediate string.
+    // One that does not fit is cut at a character boundary and ends the generation.
+    text_sink response(out, (size_t) response_capacity);
+    bool ok = generate(wrapper, std::string_view(prompt, promptLength), maxTokens, 1, nullptr, response);
+    fill_metrics(env, metricsOut, wrapper->last_stats);
+    if (!ok) {
+        return -1;
+    }
+    if (response.full()) {
+        LOGW("Response truncated to the %lld byte buffer", (long long) response_capacity);
+    }
+    
+    return (jint) response.size();
+}
+
+// Response buffer size that nativeGenerateDirect can never overflow for maxTokens
+JNIEXPORT jint JNICALL
+Java_com_research_llmbattery_LLMService_nativeMaxResponseBytes(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong contextPtr,
+    jint maxTokens
+) {
+    if (contextPtr == 0) return 0;
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    const int64_t bytes = (int64_t) std::max(maxTokens, 0) * (int64_t) wrapper->pieces.max_piece_bytes();
+    return (jint) std::min<int64_t>(bytes, INT32_MAX);
+}
+
+// Tokenize a prompt set once into the context's token arena, so nativeSubmitIndexed
+// can run any of them with no tokenization on the query path
+JNIEXPORT jboolean JNICALL
+Java_com_research_llmbattery_LLMService_nativePretokenize(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong contextPtr,
+    jobjectArray jPrompts
+) {
+    if (contextPtr == 0) {
+        LOGE("Invalid context pointer");
+        return JNI_FALSE;
+    }
+    
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    std::lock_guard<std::mutex> lock(wrapper->busy);
+    
+    const jsize n_prompts = env->GetArrayLength(jPrompts);
+    std::vector<std::string> prompts(n_prompts);
+    for (jsize i = 0; i < n_prompts; i++) {
+        auto jPrompt = static_cast<jstring>(env->GetObjectArrayElement(jPrompts, i));
+        prompts[i] = jstring2string(env, jPrompt);
+        env->DeleteLocalRef(jPrompt);
+    }
+    
+    return pretokenize_prompts(wrapper, prompts) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Queue a generation on the context's inference engine and return its request id
+// (-1 on error) without waiting for it; collect the text with nativePoll
+JNIEXPORT jlong JNICALL
+Java_com_research_llmbattery_LLMService_nativeSubmit(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong contextPtr,
+    jstring prompt,
+    jint maxTokens,
+    jint flushEvery
+) {
+    if (contextPtr == 0) {
+        LOGE("Invalid context pointer");
+        return -1;
+    }
     
-    llama_context* ctx = llama_init_from_model(model, ctx_params);
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
     
-    if (!ctx) {
-        LOGE("Failed to create context");
-        llama_model_free(model);
+    return context_engine(wrapper)->submit(jstring2string(env, prompt), maxTokens, flushEvery);
+}
+
+// Queue a generation for prompt `index` of the set passed to nativePretokenize
+JNIEXPORT jlong JNICALL
+Java_com_research_llmbattery_LLMService_nativeSubmitIndexed(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong contextPtr,
+    jint index,
+    jint maxTokens,
+    jint flushEvery
+) {
+    if (contextPtr == 0) {
+        LOGE("Invalid context pointer");
+        return -1;
+    }
+    
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    
+    return context_engine(wrapper)->submit_indexed(index, maxTokens, flushEvery);
+}
+
+// Text a request produced since the previous poll (empty if none), or null if the id is
+// unknown or was cancelled. progressOut receives long[REQ_PROGRESS_COUNT] (see
+// request_progress_index); metricsOut (may be null) is filled once the request is
+// finished, after which the id is forgotten.
+JNIEXPORT jstring JNICALL
+Java_com_research_llmbattery_LLMService_nativePoll(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong contextPtr,
+    jlong requestId,
+    jlongArray progressOut,
+    jlongArray metricsOut
+) {
+    if (contextPtr == 0) {
+        LOGE("Invalid context pointer");
+        return nullptr;
+    }
+    
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    if (!wrapper->engine || !progressOut || env->GetArrayLength(progressOut) < REQ_PROGRESS_COUNT) {
+        return nullptr;
+    }
+    
+    std::string text;
+    request_progress progress;
+    generation_stats stats;
+    if (!wrapper->engine->poll(requestId, text, progress, &stats)) {
+        return nullptr;
+    }
+    
+    jlong values[REQ_PROGRESS_COUNT] = {};
+    fill_progress(progress, values);
+    env->SetLongArrayRegion(progressOut, 0, REQ_PROGRESS_COUNT, values);
+    if (progress.status == REQUEST_COMPLETED || progress.status == REQUEST_FAILED) {
+        fill_metrics(env, metricsOut, stats);
+    }
+    
+    return string2jstring(env, text);
+}
+
+// Cancel a request, or every queued and running request when requestId < 0. A running
+// generation is aborted inside its current llama_decode call.
+JNIEXPORT jboolean JNICALL
+Java_com_research_llmbattery_LLMService_nativeCancel(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong contextPtr,
+    jlong requestId
+) {
+    if (contextPtr == 0) {
+        LOGE("Invalid context pointer");
+        return JNI_FALSE;
+    }
+    
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    if (!wrapper->engine) return JNI_FALSE;
+    
+    return wrapper->engine->cancel(requestId) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Create a multi-turn chat session on the context (0 on error); turns are formatted with
+// the model's chat template and only the new turn is prefilled
+JNIEXPORT jlong JNICALL
+Java_com_research_llmbattery_LLMService_nativeChatCreate(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong contextPtr,
+    jstring systemPrompt
+) {
+    if (contextPtr == 0) {
+        LOGE("Invalid context pointer");
         return 0;
     }
     
-    LOGD("Context created successfully");
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    std::string system = systemPrompt ? jstring2string(env, systemPrompt) : std::string();
     
-    // Create wrapper
-    auto* wrapper = new llama_context_wrapper();
-    wrapper->model = model;
-    wrapper->ctx = ctx;
+    return reinterpret_cast<jlong>(new chat_session(wrapper, std::move(system)));
+}
+
+// Queue the next user turn of a chat session and return its request id (-1 on error);
+// collect the assistant turn with nativePoll
+JNIEXPORT jlong JNICALL
+Java_com_research_llmbattery_LLMService_nativeSubmitChat(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong contextPtr,
+    jlong sessionPtr,
+    jstring userText,
+    jint maxTokens,
+    jint flushEvery
+) {
+    if (contextPtr == 0 || sessionPtr == 0) {
+        LOGE("Invalid context pointer");
+        return -1;
+    }
     
-    return reinterpret_cast<jlong>(wrapper);
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    auto* session = reinterpret_cast<chat_session*>(sessionPtr);
+    
+    return context_engine(wrapper)->submit_chat(session, jstring2string(env, userText), maxTokens, flushEvery);
+}
+
+// Forget every turn of a chat session except its system prompt; waits for a running
+// request on the context to finish first
+JNIEXPORT void JNICALL
+Java_com_research_llmbattery_LLMService_nativeChatReset(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong contextPtr,
+    jlong sessionPtr
+) {
+    if (contextPtr == 0 || sessionPtr == 0) {
+        LOGE("Invalid context pointer");
+        return;
+    }
+    
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    std::lock_guard<std::mutex> lock(wrapper->busy);
+    reinterpret_cast<chat_session*>(sessionPtr)->reset();
 }
 
-// Generate text
+// Cancel the requests of a chat session and free it
+JNIEXPORT void JNICALL
+Java_com_research_llmbattery_LLMService_nativeChatFree(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong contextPtr,
+    jlong sessionPtr
+) {
+    if (contextPtr == 0 || sessionPtr == 0) {
+        LOGE("Invalid context pointer");
+        return;
+    }
+    
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    auto* session = reinterpret_cast<chat_session*>(sessionPtr);
+    if (wrapper->engine) {
+        wrapper->engine->release_session(session);
+    }
+    delete session;
+}
+
+// Generate responses for up to n_seq_max prompts together. metricsOut (may be null) receives
+// the metrics of each prompt's sequence, METRIC_COUNT values per prompt in prompt order.
+JNIEXPORT jobjectArray JNICALL
+Java_com_research_llmbattery_LLMService_nativeGenerateBatch(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong contextPtr,
+    jobjectArray jPrompts,
+    jint maxTokens,
+    jlongArray metricsOut
+) {
+    if (contextPtr == 0) {
+        LOGE("Invalid context pointer");
+        return nullptr;
+    }
+    
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    std::lock_guard<std::mutex> lock(wrapper->busy);
+    
+    const jsize n_prompts = env->GetArrayLength(jPrompts);
+    std::vector<std::string> prompts(n_prompts);
+    for (jsize i = 0; i < n_prompts; i++) {
+        auto jPrompt = static_cast<jstring>(env->GetObjectArrayElement(jPrompts, i));
+        prompts[i] = jstring2string(env, jPrompt);
+        env->DeleteLocalRef(jPrompt);
+    }
+    
+    std::vector<std::string> responses;
+    std::vector<generation_stats> seq_stats;
+    if (!generate_batch(wrapper, prompts, maxTokens, responses, seq_stats)) {
+        return nullptr;
+    }
+    
+    jclass stringClass = env->FindClass("java/lang/String");
+    jobjectArray result = env->NewObjectArray(n_prompts, stringClass, nullptr);
+    for (jsize i = 0; i < n_prompts; i++) {
+        jstring jResponse = string2jstring(env, responses[i]);
+        env->SetObjectArrayElement(result, i, jResponse);
+        env->DeleteLocalRef(jResponse);
+    }
+    
+    if (metricsOut && env->GetArrayLength(metricsOut) >= n_prompts * METRIC_COUNT) {
+        jlong values[METRIC_COUNT];
+        for (jsize i = 0; i < n_prompts; i++) {
+            fill_metrics(seq_stats[i], values);
+            env->SetLongArrayRegion(metricsOut, i * METRIC_COUNT, METRIC_COUNT, values);
+        }
+    }
+    
+    return result;
+}
+
+// Load a draft model (same tokenizer as the main model) for speculative decoding
+JNIEXPORT jboolean JNICALL
+Java_com_research_llmbattery_LLMService_nativeAttachDraft(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong contextPtr,
+    jstring jDraftPath,
+    jint nDraft,
+    jint nThreads
+) {
+    if (contextPtr == 0) return JNI_FALSE;
+    
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    std::lock_guard<std::mutex> lock(wrapper->busy);
+    std::string draftPath = jstring2string(env, jDraftPath);
+    
+    return attach_draft(wrapper, draftPath, nDraft, nThreads) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Helper: Plain decode of a speculative comparison under the conditions generate_speculative
+// runs in: the current thread placement with no governor placement or pacing, and no stop
+// strings, deadline or energy budget. Both runs then end only on EOG, maxTokens or a full
+// context, so their per-token figures are comparable.
+bool generate_plain_baseline(llama_context_wrapper* wrapper, const std::string& prompt, int max_tokens) {
+    thermal_governor* governor = wrapper->governor;
+    generation_limits limits = std::move(wrapper->limits);
+    stop_matcher stops = std::move(wrapper->stops);
+    wrapper->governor = nullptr;
+    wrapper->limits = generation_limits();
+    wrapper->stops = stop_matcher();
+    
+    std::string response;
+    const bool ok = generate(wrapper, prompt, max_tokens, 1, nullptr, response);
+    
+    wrapper->governor = governor;
+    wrapper->limits = std::move(limits);
+    wrapper->stops = std::move(stops);
+    return ok;
+}
+
+// Generate with speculative decoding against the attached draft model. With measurePlain the
+// same prompt and maxTokens first run through plain decoding on the target model, as the
+// baseline the speedup and energy are compared against; see generate_plain_baseline for
+// the conditions both runs share. statsOut (may be null) receives SPEC_STATS_COUNT values
+// laid out by speculative_stats_index; energies are -1 without a running power sampler,
+// and the plain token count is 0 without measurePlain.
 JNIEXPORT jstring JNICALL
-Java_com_research_llmbattery_LLMService_nativeGenerate(
+Java_com_research_llmbattery_LLMService_nativeGenerateSpeculative(
     JNIEnv* env,
     jobject /* this */,
     jlong contextPtr,
     jstring jPrompt,
-    jint maxTokens
+    jint maxTokens,
+    jboolean measurePlain,
+    jlongArray statsOut
 ) {
     if (contextPtr == 0) {
         LOGE("Invalid context pointer");
@@ -137,82 +635,391 @@ Java_com_research_llmbattery_LLMService_nativeGenerate(
     }
     
     auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    std::lock_guard<std::mutex> lock(wrapper->busy);
+    if (!wrapper->draft) {
+        LOGE("No draft model attached");
+        return env->NewStringUTF("Error: No draft model");
+    }
     std::string prompt = jstring2string(env, jPrompt);
     
-    LOGD("Generating response for prompt: %s", prompt.c_str());
+    // The baseline leaves the prompt in the prefix cache, so the speculative run skips its
+    // prefill; both are compared on the decode phase only
+    generation_stats plain;
+    if (measurePlain) {
+        if (!generate_plain_baseline(wrapper, prompt, maxTokens)) {
+            return env->NewStringUTF("Error: Failed to decode");
+        }
+        plain = wrapper->last_stats;
+    }
     
-    // Get vocab
-    const llama_vocab* vocab = llama_model_get_vocab(wrapper->model);
+    std::string response;
+    bool ok = generate_speculative(wrapper, prompt, maxTokens, response);
     
-    // Tokenize prompt
-    std::vector<llama_token> tokens = tokenize(vocab, prompt, true);
-    int n_tokens = tokens.size();
+    if (statsOut && env->GetArrayLength(statsOut) >= SPEC_STATS_COUNT) {
+        jlong values[SPEC_STATS_COUNT];
+        fill_speculative_stats(wrapper, plain, values);
+        env->SetLongArrayRegion(statsOut, 0, SPEC_STATS_COUNT, values);
+    }
     
-    LOGD("Tokenized prompt: %d tokens", n_tokens);
+    if (!ok) {
+        return env->NewStringUTF("Error: Failed to decode");
+    }
+    return string2jstring(env, response);
+}
+
+// Configure sampling; temperature <= 0 selects greedy decoding
+JNIEXPORT void JNICALL
+Java_com_research_llmbattery_LLMService_nativeSetSampling(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong contextPtr,
+    jfloat temperature,
+    jint topK,
+    jfloat topP,
+    jfloat minP,
+    jint seed
+) {
+    if (contextPtr == 0) return;
     
-    // Generate response
-    std::string response;
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    std::lock_guard<std::mutex> lock(wrapper->busy);
+    sampler_params params;
+    params.temperature = temperature;
+    params.top_k = topK;
+    params.top_p = topP;
+    params.min_p = minP;
+    params.seed = (uint32_t) seed;
+    wrapper->sampler->set_params(params);
+}
+
+// Stop later generations at any of stopStrings (matched on the streamed text, which is cut
+// before the match), after deadlineMs of wall time, or once the power sampler has measured
+// energyBudgetMj millijoules; 0 disables a limit. The reason is recorded in the metrics.
+JNIEXPORT void JNICALL
+Java_com_research_llmbattery_LLMService_nativeSetStopConditions(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong contextPtr,
+    jobjectArray jStopStrings,
+    jlong deadlineMs,
+    jlong energyBudgetMj
+) {
+    if (contextPtr == 0) {
+        LOGE("Invalid context pointer");
+        return;
+    }
     
-    // Create batch
-    llama_batch batch = llama_batch_init(512, 0, 1);
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    std::lock_guard<std::mutex> lock(wrapper->busy);
+    generation_limits limits;
+    limits.stop_strings = jstring_vector(env, jStopStrings);
+    limits.deadline_us = deadlineMs > 0 ? deadlineMs * 1000 : 0;
+    limits.energy_budget_uj = energyBudgetMj > 0 ? energyBudgetMj * 1000 : 0;
+    set_generation_limits(wrapper, limits);
+}
+
+// Pin prefill and decode worker threads to core sets chosen by placement policy
+// (ThreadPlacement codes); a thread count <= 0 uses one thread per selected core
+JNIEXPORT jboolean JNICALL
+Java_com_research_llmbattery_LLMService_nativeSetThreadPlacement(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong contextPtr,
+    jint prefillPolicy,
+    jint nThreadsPrefill,
+    jint decodePolicy,
+    jint nThreadsDecode
+) {
+    if (contextPtr == 0) return JNI_FALSE;
+    if (prefillPolicy < 0 || prefillPolicy >= PLACEMENT_POLICY_COUNT ||
+        decodePolicy < 0 || decodePolicy >= PLACEMENT_POLICY_COUNT) {
+        LOGE("Invalid placement policy %d / %d", prefillPolicy, decodePolicy);
+        return JNI_FALSE;
+    }
     
-    // Add prompt tokens
-    for (int i = 0; i < n_tokens; i++) {
-        batch_add(batch, tokens[i], i, {0}, false);
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    std::lock_guard<std::mutex> lock(wrapper->busy);
+    bool ok = set_thread_placement(wrapper, device_topology(),
+                                   (placement_policy) prefillPolicy, nThreadsPrefill,
+                                   (placement_policy) decodePolicy, nThreadsDecode);
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+// Human-readable cluster layout of this device, for logs
+JNIEXPORT jstring JNICALL
+Java_com_research_llmbattery_LLMService_nativeDescribeCpuTopology(
+    JNIEnv* env,
+    jobject /* this */
+) {
+    return env->NewStringUTF(describe_topology(device_topology()).c_str());
+}
+
+// Start sampling battery power from a power_supply directory; generations then report
+// prefill and decode energy in their metrics. currentScale converts current_now to uA.
+JNIEXPORT jboolean JNICALL
+Java_com_research_llmbattery_LLMService_nativeStartPowerSampler(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jSupplyPath,
+    jint rateHz,
+    jlong currentScale
+) {
+    std::string supplyPath = jstring2string(env, jSupplyPath);
+    return device_power_sampler().start(supplyPath, rateHz, currentScale) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Stop the power sampler
+JNIEXPORT void JNICALL
+Java_com_research_llmbattery_LLMService_nativeStopPowerSampler(
+    JNIEnv* /* env */,
+    jobject /* this */
+) {
+    device_power_sampler().stop();
+}
+
+// Most recent battery power sample in microwatts, or -1 if the sampler is not running
+JNIEXPORT jlong JNICALL
+Java_com_research_llmbattery_LLMService_nativeGetPowerUw(
+    JNIEnv* /* env */,
+    jobject /* this */
+) {
+    power_sampler::sample latest;
+    if (!device_power_sampler().running() || !device_power_sampler().latest(latest)) return -1;
+    return latest.power_uw;
+}
+
+// Start sampling per-core utilization, core frequencies and per-thread CPU time;
+// generations then report CPU usage per phase in their metrics
+JNIEXPORT jboolean JNICALL
+Java_com_research_llmbattery_LLMService_nativeStartCpuSampler(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jint rateHz
+) {
+    return device_proc_sampler().start(rateHz) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Stop the CPU sampler
+JNIEXPORT void JNICALL
+Java_com_research_llmbattery_LLMService_nativeStopCpuSampler(
+    JNIEnv* /* env */,
+    jobject /* this */
+) {
+    device_proc_sampler().stop();
+}
+
+// Mean cost of one CPU sampler sample in nanoseconds, 0 before the first one
+JNIEXPORT jlong JNICALL
+Java_com_research_llmbattery_LLMService_nativeGetCpuSampleNs(
+    JNIEnv* /* env */,
+    jobject /* this */
+) {
+    return device_proc_sampler().mean_sample_ns();
+}
+
+// Overall CPU utilization in percent: over the last second while the CPU sampler runs,
+// otherwise since the previous call (the first call measures a 100 ms interval)
+JNIEXPORT jfloat JNICALL
+Java_com_research_llmbattery_LLMService_nativeGetCpuUsage(
+    JNIEnv* /* env */,
+    jobject /* this */
+) {
+    proc_sampler& sampler = device_proc_sampler();
+    proc_sampler::window w;
+    const int64_t now = now_ns();
+    if (sampler.running() && sampler.usage(now - 1000000000LL, now, w)) {
+        return w.util_mean_permille / 10.0f;
     }
-    batch.logits[batch.n_tokens - 1] = true;
     
-    // Decode prompt
-    if (llama_decode(wrapper->ctx, batch) != 0) {
-        LOGE("Failed to decode prompt");
-        llama_batch_free(batch);
-        return env->NewStringUTF("Error: Failed to decode");
+    static std::mutex mutex;
+    static proc_stat_reader reader;
+    static cpu_times last = {0, 0};
+    std::lock_guard<std::mutex> lock(mutex);
+    cpu_times all;
+    if (last.total == 0) {
+        if (!reader.open() || reader.read(last, nullptr, 0) < 0) return -1.0f;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (reader.read(all, nullptr, 0) < 0) return -1.0f;
+    const int64_t total = all.total - last.total;
+    const int64_t busy = all.busy - last.busy;
+    last = all;
+    return total > 0 ? busy * 100.0f / total : 0.0f;
+}
+
+// Start the thermal governor: while it runs, each generation's placement, thread count
+// and inter-token pacing are chosen to keep the hottest thermal zone (those whose type
+// contains zoneFilter, all if empty) below targetMc millidegrees
+JNIEXPORT jboolean JNICALL
+Java_com_research_llmbattery_LLMService_nativeStartThermalGovernor(
+    JNIEnv* env,
+    jobject /* this */,
+    jint targetMc,
+    jint hysteresisMc,
+    jstring zoneFilter,
+    jint rateHz
+) {
+    thermal_envelope envelope;
+    envelope.target_mc = targetMc;
+    envelope.hysteresis_mc = hysteresisMc;
+    envelope.zone_filter = jstring2string(env, zoneFilter);
+    return device_thermal_governor().start(envelope, rateHz) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Stop the thermal governor; the placement it chose last stays in effect
+JNIEXPORT void JNICALL
+Java_com_research_llmbattery_LLMService_nativeStopThermalGovernor(
+    JNIEnv* /* env */,
+    jobject /* this */
+) {
+    device_thermal_governor().stop();
+}
+
+// Hottest governed thermal zone in millidegrees, or -1 if the governor is not running
+JNIEXPORT jint JNICALL
+Java_com_research_llmbattery_LLMService_nativeGetSocTemperatureMc(
+    JNIEnv* /* env */,
+    jobject /* this */
+) {
+    thermal_governor& governor = device_thermal_governor();
+    return governor.running() ? governor.latest().temp_mc : -1;
+}
+
+// Make sequence 0 start with `prefix`, restoring its KV state from stateDir when a
+// previous process saved it, else prefilling and saving it. statsOut receives
+// long[STATE_IO_COUNT] (see state_io_index); an empty stateDir skips the file cache.
+JNIEXPORT jboolean JNICALL
+Java_com_research_llmbattery_LLMService_nativeWarmPrefix(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong contextPtr,
+    jstring jPrefix,
+    jstring jStateDir,
+    jlongArray statsOut
+) {
+    if (contextPtr == 0) return JNI_FALSE;
+    
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    std::lock_guard<std::mutex> lock(wrapper->busy);
+    state_io io;
+    bool ok = warm_prefix(wrapper, jstring2string(env, jStateDir), jstring2string(env, jPrefix), io);
+    
+    if (statsOut && env->GetArrayLength(statsOut) >= STATE_IO_COUNT) {
+        jlong values[STATE_IO_COUNT] = {};
+        fill_state_io(io, values);
+        env->SetLongArrayRegion(statsOut, 0, STATE_IO_COUNT, values);
     }
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+// Memory of the context (long[CTX_MEM_COUNT], see context_memory_index); false if out is too short
+JNIEXPORT jboolean JNICALL
+Java_com_research_llmbattery_LLMService_nativeGetContextMemory(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong contextPtr,
+    jlongArray out
+) {
+    if (contextPtr == 0 || !out || env->GetArrayLength(out) < CTX_MEM_COUNT) return JNI_FALSE;
     
-    // Generate tokens
-    int n_generated = 0;
-    int n_vocab = llama_vocab_n_tokens(vocab);
-    
-    while (n_generated < maxTokens) {
-        // Sample next token (greedy)
-        auto* logits = llama_get_logits_ith(wrapper->ctx, batch.n_tokens - 1);
-        
-        llama_token new_token_id = 0;
-        float max_logit = logits[0];
-        for (int i = 1; i < n_vocab; i++) {
-            if (logits[i] > max_logit) {
-                max_logit = logits[i];
-                new_token_id = i;
-            }
-        }
-        
-        // Check for EOS (updated API)
-        if (llama_vocab_is_eog(vocab, new_token_id)) {
-            break;
-        }
-        
-        // Decode token to text
-        std::string piece = token_to_piece(vocab, new_token_id);
-        response += piece;
-        
-        // Prepare next batch
-        batch_clear(batch);
-        batch_add(batch, new_token_id, n_tokens + n_generated, {0}, true);
-        
-        // Decode
-        if (llama_decode(wrapper->ctx, batch) != 0) {
-            LOGE("Failed to decode token");
-            break;
+    jlong values[CTX_MEM_COUNT] = {};
+    fill_context_memory(reinterpret_cast<llama_context_wrapper*>(contextPtr), values);
+    env->SetLongArrayRegion(out, 0, CTX_MEM_COUNT, values);
+    return JNI_TRUE;
+}
+
+// Process memory from /proc/self/status and smaps_rollup into out[MEM_FIELD_COUNT]
+// (memory_snapshot_index); works with or without a loaded context
+JNIEXPORT jboolean JNICALL
+Java_com_research_llmbattery_LLMService_nativeProbeMemory(
+    JNIEnv* env,
+    jobject /* this */,
+    jlongArray out
+) {
+    if (!out || env->GetArrayLength(out) < MEM_FIELD_COUNT) return JNI_FALSE;
+    
+    static std::mutex mutex;
+    static memory_probe probe;
+    memory_snapshot snapshot;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!probe.is_open() && !probe.open()) {
+            LOGE("Cannot read /proc/self/status");
+            return JNI_FALSE;
         }
-        
-        n_generated++;
+        if (!probe.read(snapshot)) return JNI_FALSE;
     }
     
-    llama_batch_free(batch);
+    jlong values[MEM_FIELD_COUNT] = {};
+    fill_memory_snapshot(snapshot, values);
+    env->SetLongArrayRegion(out, 0, MEM_FIELD_COUNT, values);
+    return JNI_TRUE;
+}
+
+// One-line summary of the context's weight, KV cache and compute buffer memory
+JNIEXPORT jstring JNICALL
+Java_com_research_llmbattery_LLMService_nativeDescribeContextMemory(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong contextPtr
+) {
+    if (contextPtr == 0) return env->NewStringUTF("");
+    return env->NewStringUTF(describe_context_memory(reinterpret_cast<llama_context_wrapper*>(contextPtr)).c_str());
+}
+
+// Per-core utilization and frequency plus the busiest threads over the prefill and
+// decode phases of the last generation
+JNIEXPORT jstring JNICALL
+Java_com_research_llmbattery_LLMService_nativeDescribeCpuProfile(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong contextPtr
+) {
+    if (contextPtr == 0) return env->NewStringUTF("");
     
-    LOGD("Generated %d tokens", n_generated);
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    std::lock_guard<std::mutex> lock(wrapper->busy);
+    const generation_stats& stats = wrapper->last_stats;
+    std::string text = "prefill: " + describe_cpu_window(stats.cpu_prefill) +
+                       "decode: " + describe_cpu_window(stats.cpu_decode);
+    return env->NewStringUTF(text.c_str());
+}
+
+// Per-core time series of the last generation, flattened as
+// [n_cpus, then per sample: t_us since prefill start, phase (0 prefill, 1 decode),
+//  n_cpus utilizations in permille, n_cpus frequencies in kHz]
+JNIEXPORT jlongArray JNICALL
+Java_com_research_llmbattery_LLMService_nativeGetCpuSeries(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong contextPtr
+) {
+    if (contextPtr == 0) return nullptr;
     
-    return env->NewStringUTF(response.c_str());
+    auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
+    std::lock_guard<std::mutex> lock(wrapper->busy);
+    const generation_stats& stats = wrapper->last_stats;
+    proc_sampler& sampler = device_proc_sampler();
+    const int n_cpus = sampler.n_cpus();
+    if (stats.cpu_decode.n_frames == 0 || n_cpus <= 0) return nullptr;
+    
+    const int64_t t_prefill_start = stats.t_decode_start_ns - stats.t_prefill_us * 1000;
+    std::vector<proc_sampler::point> points;
+    sampler.series(t_prefill_start, stats.t_decode_start_ns + stats.t_decode_us * 1000, points);
+    
+    std::vector<jlong> values;
+    values.reserve(1 + points.size() * (2 + 2 * n_cpus));
+    values.push_back(n_cpus);
+    for (const proc_sampler::point& pt : points) {
+        values.push_back((pt.t_ns - t_prefill_start) / 1000);
+        values.push_back(pt.t_ns > stats.t_decode_start_ns ? 1 : 0);
+        values.insert(values.end(), pt.util_permille, pt.util_permille + n_cpus);
+        values.insert(values.end(), pt.freq_khz, pt.freq_khz + n_cpus);
+    }
+    
+    jlongArray out = env->NewLongArray(values.size());
+    env->SetLongArrayRegion(out, 0, values.size(), values.data());
+    return out;
 }
 
 // Free resources
@@ -226,18 +1033,108 @@ Java_com_research_llmbattery_LLMService_nativeFree(
     
     auto* wrapper = reinterpret_cast<llama_context_wrapper*>(contextPtr);
     
-    if (wrapper->ctx) {
-        llama_free(wrapper->ctx);
-    }
-    if (wrapper->model) {
-        llama_model_free(wrapper->model);
-    }
-    
-    delete wrapper;
-    
-    llama_backend_free();
+    free_wrapper(wrapper);
     
     LOGD("Resources freed");
 }
 
+// Set the memory budget for resident models; least recently used idle models are evicted
+JNIEXPORT void JNICALL
+Java_com_research_llmbattery_LLMService_nativeSetModelBudget(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong budgetBytes
+) {
+    model_registry::instance().set_budget(budgetBytes > 0 ? (size_t) budgetBytes : 0);
+}
+
+// Total size of the model weights currently resident in the registry
+JNIEXPORT jlong JNICALL
+Java_com_research_llmbattery_LLMService_nativeGetResidentModelBytes(
+    JNIEnv* /* env */,
+    jobject /* this */
+) {
+    return (jlong) model_registry::instance().resident_bytes();
+}
+
+// Free every resident model that has no live context
+JNIEXPORT void JNICALL
+Java_com_research_llmbattery_LLMService_nativeEvictUnusedModels(
+    JNIEnv* /* env */,
+    jobject /* this */
+) {
+    model_registry::instance().evict_unused();
+}
+
+// Run an energy-efficiency sweep over every combination of model paths, thread counts,
+// context sizes, batch sizes and max tokens, with warmup generations and repetitions per
+// cell, and return the JSON report (see sweep_runner.h). Energy per token comes from the
+// battery power sampler while it runs. Blocks for the whole sweep; each cell loads its
+// model through the registry next to whatever the current context holds.
+JNIEXPORT jstring JNICALL
+Java_com_research_llmbattery_LLMService_nativeRunSweep(
+    JNIEnv* env,
+    jobject /* this */,
+    jobjectArray jModelPaths,
+    jintArray jThreads,
+    jintArray jContextSizes,
+    jintArray jBatchSizes,
+    jintArray jMaxTokens,
+    jobjectArray jPrompts,
+    jint warmup,
+    jint repetitions,
+    jint cooldownMs
+) {
+    sweep_matrix matrix;
+    matrix.models = jstring_vector(env, jModelPaths);
+    matrix.n_threads = jint_vector(env, jThreads);
+    matrix.n_ctx = jint_vector(env, jContextSizes);
+    matrix.n_batch = jint_vector(env, jBatchSizes);
+    matrix.max_tokens = jint_vector(env, jMaxTokens);
+    matrix.prompts = jstring_vector(env, jPrompts);
+    matrix.warmup = warmup;
+    matrix.repetitions = repetitions;
+    matrix.cooldown_ms = cooldownMs;
+    
+    sampler_meter meter(&device_power_sampler());
+    energy_meter* source = device_power_sampler().running() ? &meter : nullptr;
+    const std::vector<sweep_cell> cells = run_sweep(matrix, source, sweep_progress());
+    return string2jstring(env, sweep_report_json(matrix, source, cells));
+}
+
+// JniIoBenchmark: the two ways text crosses JNI, without inference in between
+
+// Round trip through the jstring path nativeGenerate used to take: GetStringUTFChars,
+// a std::string copy and NewStringUTF (modified UTF-8 on both sides)
+JNIEXPORT jstring JNICALL
+Java_com_research_llmbattery_JniIoBenchmark_nativeEchoString(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jText
+) {
+    const char* chars = env->GetStringUTFChars(jText, nullptr);
+    std::string text(chars);
+    env->ReleaseStringUTFChars(jText, chars);
+    return env->NewStringUTF(text.c_str());
+}
+
+// Round trip through direct buffers: the UTF-8 input is copied once into the output,
+// as nativeGenerateDirect writes a response. Returns the bytes written, -1 on error.
+JNIEXPORT jint JNICALL
+Java_com_research_llmbattery_JniIoBenchmark_nativeEchoDirect(
+    JNIEnv* env,
+    jobject /* this */,
+    jobject inputBuf,
+    jint length,
+    jobject outputBuf
+) {
+    jlong in_capacity = 0;
+    jlong out_capacity = 0;
+    const char* in = direct_buffer(env, inputBuf, in_capacity);
+    char* out = direct_buffer(env, outputBuf, out_capacity);
+    if (!in || !out || length < 0 || length > in_capacity || length > out_capacity) return -1;
+    memcpy(out, in, length);
+    return length;
+}
+
 } // extern "C"
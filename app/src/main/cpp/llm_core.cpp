@@ -0,0 +1,1363 @@
+#include "llm_core.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <sys/resource.h>
+#include "llama.cpp/ggml/include/ggml-cpu.h"
+#include "inference_engine.h"
+#include "model_loader.h"
+#include "model_registry.h"
+#include "native_log.h"
+
+// Helper: Monotonic timestamp in nanoseconds (same clock as System.nanoTime)
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Helper: Clear batch
+void batch_clear(llama_batch& batch) {
+    batch.n_tokens = 0;
+}
+
+// Helper: Add token to batch (capacity is the size the batch was allocated with)
+void batch_add(llama_batch& batch, int capacity, llama_token id, llama_pos pos, const std::vector<llama_seq_id>& seq_ids, bool logits) {
+    if (batch.n_tokens >= capacity) {
+        LOGE("Batch size exceeded");
+        return;
+    }
+    batch.token[batch.n_tokens] = id;
+    batch.pos[batch.n_tokens] = pos;
+    batch.n_seq_id[batch.n_tokens] = seq_ids.size();
+    for (size_t i = 0; i < seq_ids.size(); i++) {
+        batch.seq_id[batch.n_tokens][i] = seq_ids[i];
+    }
+    batch.logits[batch.n_tokens] = logits;
+    batch.n_tokens++;
+}
+
+// Helper: Tokenize text; `parse_special` turns control-token text such as chat template
+// markers into the special tokens themselves
+std::vector<llama_token> tokenize(const llama_vocab* vocab, std::string_view text, bool add_special, bool parse_special) {
+    int n_tokens = text.length() + 2 * add_special;
+    std::vector<llama_token> result(n_tokens);
+    n_tokens = llama_tokenize(vocab, text.data(), text.length(), result.data(), result.size(), add_special, parse_special);
+    if (n_tokens < 0) {
+        result.resize(-n_tokens);
+        n_tokens = llama_tokenize(vocab, text.data(), text.length(), result.data(), result.size(), add_special, parse_special);
+    }
+    result.resize(n_tokens);
+    return result;
+}
+
+// Helper: Convert token to piece
+std::string token_to_piece(const llama_vocab* vocab, llama_token token) {
+    std::string piece;
+    piece.resize(256);
+    int n_chars = llama_token_to_piece(vocab, token, &piece[0], piece.size(), 0, false);
+    if (n_chars < 0) {
+        piece.resize(-n_chars);
+        n_chars = llama_token_to_piece(vocab, token, &piece[0], piece.size(), 0, false);
+    } else {
+        piece.resize(n_chars);
+    }
+    return piece;
+}
+
+// Decode prompt tokens starting at position n_past in chunks of wrapper->n_batch.
+// Only the final token of the final chunk requests logits; llama.cpp further
+// splits each chunk into n_ubatch micro-batches internally. Returns 0, or the status of
+// the llama_decode call that failed.
+int32_t prefill(llama_context_wrapper* wrapper, llama_batch& batch, const llama_token* tokens, int n_tokens, int n_past) {
+    for (int start = 0; start < n_tokens; start += wrapper->n_batch) {
+        const int end = std::min(start + wrapper->n_batch, n_tokens);
+        batch_clear(batch);
+        for (int i = start; i < end; i++) {
+            batch_add(batch, wrapper->n_batch, tokens[i], n_past + i, {0}, i == n_tokens - 1);
+        }
+        const int32_t status = llama_decode(wrapper->ctx, batch);
+        if (status != 0) {
+            LOGE("Failed to decode prompt chunk [%d, %d)", start, end);
+            return status;
+        }
+    }
+    return 0;
+}
+
+// Helper: Stop reason of a failed llama_decode. Status 2 is an abort requested through
+// the abort callback (inference_engine::cancel).
+stop_reason decode_stop_reason(int32_t status) {
+    return status == 2 ? STOP_CANCELLED : STOP_ERROR;
+}
+
+// Helper: Drop the KV entries of sequence 0 from position n_keep on and return the
+// positions kept: n_keep, or 0 for memory types that cannot be trimmed partially
+int trim_cache(llama_context_wrapper* wrapper, int n_keep) {
+    llama_memory_t mem = llama_get_memory(wrapper->ctx);
+    if (!llama_memory_seq_rm(mem, 0, n_keep, -1)) {
+        // Memory types that cannot be trimmed partially must be rebuilt from scratch
+        llama_memory_clear(mem, true);
+        n_keep = 0;
+    }
+    wrapper->cached_tokens.resize(std::min((size_t) n_keep, wrapper->cached_tokens.size()));
+    return n_keep;
+}
+
+// Helper: Reuse the longest prefix of `tokens` already in the KV cache and drop
+// everything after it. Returns the number of positions kept; at least the last
+// prompt token is always left to decode so that fresh logits are produced.
+int reuse_prefix(llama_context_wrapper* wrapper, const llama_token* tokens, int n_tokens) {
+    std::vector<llama_token>& cached = wrapper->cached_tokens;
+    
+    size_t n_keep = 0;
+    while (n_keep < cached.size() && n_keep < (size_t) n_tokens && cached[n_keep] == tokens[n_keep]) {
+        n_keep++;
+    }
+    if (n_keep == (size_t) n_tokens && n_keep > 0) {
+        n_keep--;
+    }
+    
+    return trim_cache(wrapper, n_keep);
+}
+
+int reuse_prefix(llama_context_wrapper* wrapper, const std::vector<llama_token>& tokens) {
+    return reuse_prefix(wrapper, tokens.data(), tokens.size());
+}
+
+// Helper: Fill the latency percentiles and histogram of stats from per-token decode times.
+// Reorders `latencies` in place.
+void summarize_latencies(std::vector<int64_t>& latencies, generation_stats& stats) {
+    if (latencies.empty()) return;
+    
+    for (int64_t us : latencies) {
+        int bucket = 0;
+        while (bucket < DECODE_HIST_BUCKETS - 1 && us >= DECODE_HIST_BOUNDS_US[bucket]) {
+            bucket++;
+        }
+        stats.decode_hist[bucket]++;
+    }
+    
+    auto percentile = [&](double q) {
+        auto nth = latencies.begin() + (size_t) (q * (latencies.size() - 1));
+        std::nth_element(latencies.begin(), nth, latencies.end());
+        return *nth;
+    };
+    stats.decode_p50_us = percentile(0.50);
+    stats.decode_p90_us = percentile(0.90);
+    stats.decode_p99_us = percentile(0.99);
+    stats.decode_max_us = *std::max_element(latencies.begin(), latencies.end());
+}
+
+// Helper: Copy stats into the flat metrics layout
+void fill_metrics(const generation_stats& stats, int64_t* out) {
+    std::fill(out, out + METRIC_COUNT, 0);
+    out[METRIC_T_TOKENIZE_US] = stats.t_tokenize_us;
+    out[METRIC_N_PROMPT] = stats.n_prompt;
+    out[METRIC_N_REUSED] = stats.n_reused;
+    out[METRIC_T_PREFILL_US] = stats.t_prefill_us;
+    out[METRIC_N_GENERATED] = stats.n_generated;
+    out[METRIC_T_DECODE_US] = stats.t_decode_us;
+    out[METRIC_T_SAMPLE_US] = stats.t_sample_us;
+    out[METRIC_T_DETOKENIZE_US] = stats.t_detokenize_us;
+    out[METRIC_DECODE_P50_US] = stats.decode_p50_us;
+    out[METRIC_DECODE_P90_US] = stats.decode_p90_us;
+    out[METRIC_DECODE_P99_US] = stats.decode_p99_us;
+    out[METRIC_DECODE_MAX_US] = stats.decode_max_us;
+    out[METRIC_PERF_T_P_EVAL_US] = (int64_t) (stats.perf.t_p_eval_ms * 1000.0);
+    out[METRIC_PERF_T_EVAL_US] = (int64_t) (stats.perf.t_eval_ms * 1000.0);
+    out[METRIC_PERF_N_P_EVAL] = stats.perf.n_p_eval;
+    out[METRIC_PERF_N_EVAL] = stats.perf.n_eval;
+    for (int i = 0; i < DECODE_HIST_BUCKETS; i++) {
+        out[METRIC_DECODE_HIST + i] = stats.decode_hist[i];
+    }
+    out[METRIC_PREFILL_POLICY] = stats.placement.prefill_policy;
+    out[METRIC_PREFILL_THREADS] = stats.placement.n_threads_prefill;
+    out[METRIC_PREFILL_CPUS] = (int64_t) stats.placement.prefill_cpus;
+    out[METRIC_DECODE_POLICY] = stats.placement.decode_policy;
+    out[METRIC_DECODE_THREADS] = stats.placement.n_threads_decode;
+    out[METRIC_DECODE_CPUS] = (int64_t) stats.placement.decode_cpus;
+    out[METRIC_ENERGY_PREFILL_UJ] = stats.energy_prefill_uj;
+    out[METRIC_ENERGY_DECODE_UJ] = stats.energy_decode_uj;
+    out[METRIC_N_POWER_SAMPLES] = stats.n_power_samples;
+    const bool has_cpu = stats.cpu_decode.n_frames > 0;
+    out[METRIC_CPU_UTIL_PREFILL] = has_cpu ? stats.cpu_prefill.util_mean_permille : -1;
+    out[METRIC_CPU_UTIL_DECODE] = has_cpu ? stats.cpu_decode.util_mean_permille : -1;
+    out[METRIC_PROCESS_CPU_PREFILL_US] = has_cpu ? stats.cpu_prefill.process_cpu_us : -1;
+    out[METRIC_PROCESS_CPU_DECODE_US] = has_cpu ? stats.cpu_decode.process_cpu_us : -1;
+    const bool has_governor = stats.governor.level >= 0;
+    out[METRIC_GOVERNOR_LEVEL] = stats.governor.level;
+    out[METRIC_GOVERNOR_REASON] = has_governor ? stats.governor.reason : -1;
+    out[METRIC_THERMAL_MC] = has_governor ? stats.governor.reading.temp_mc : -1;
+    out[METRIC_FREQ_CAP_PERMILLE] = has_governor ? stats.governor.reading.cap_permille : -1;
+    out[METRIC_T_PACING_US] = stats.t_pacing_us;
+    out[METRIC_STOP_REASON] = stats.stop;
+    fill_memory_snapshot(stats.mem_prefill, out + METRIC_MEM_PREFILL);
+    fill_memory_snapshot(stats.mem_decode, out + METRIC_MEM_DECODE);
+    out[METRIC_KV_USED_BYTES] = stats.kv_used_bytes;
+    out[METRIC_STATE_BYTES] = stats.state_bytes;
+}
+
+// Helper: Copy the last speculative generation and its plain baseline into the flat
+// speculative stats layout
+void fill_speculative_stats(const llama_context_wrapper* wrapper, const generation_stats& plain, int64_t* out) {
+    const speculative_stats& stats = wrapper->last_spec_stats;
+    const generation_stats& gen = wrapper->last_stats;
+    out[SPEC_N_DRAFTED] = stats.n_drafted;
+    out[SPEC_N_ACCEPTED] = stats.n_accepted;
+    out[SPEC_N_STEPS] = stats.n_steps;
+    out[SPEC_N_GENERATED] = stats.n_generated;
+    out[SPEC_T_PREFILL_US] = stats.t_prefill_us;
+    out[SPEC_T_DRAFT_US] = stats.t_draft_us;
+    out[SPEC_T_VERIFY_US] = stats.t_verify_us;
+    out[SPEC_T_DECODE_US] = gen.t_decode_us;
+    out[SPEC_ENERGY_DECODE_UJ] = gen.energy_decode_uj;
+    out[SPEC_N_POWER_SAMPLES] = gen.n_power_samples;
+    out[SPEC_PLAIN_N_GENERATED] = plain.n_generated;
+    out[SPEC_PLAIN_T_DECODE_US] = plain.t_decode_us;
+    out[SPEC_PLAIN_ENERGY_DECODE_UJ] = plain.energy_decode_uj;
+}
+
+// Helper: Charge the prefill and decode windows (back to back around t_decode_start_ns,
+// with the lengths recorded in stats) for the energy the power sampler saw
+void measure_energy(const llama_context_wrapper* wrapper, generation_stats& stats) {
+    if (!wrapper->power || !wrapper->power->running()) return;
+    
+    const int64_t t_decode_start_ns = stats.t_decode_start_ns;
+    int n_prefill_samples = 0;
+    int n_decode_samples = 0;
+    stats.energy_prefill_uj = wrapper->power->energy_uj(
+        t_decode_start_ns - stats.t_prefill_us * 1000, t_decode_start_ns, &n_prefill_samples);
+    stats.energy_decode_uj = wrapper->power->energy_uj(
+        t_decode_start_ns, t_decode_start_ns + stats.t_decode_us * 1000, &n_decode_samples);
+    stats.n_power_samples = n_prefill_samples + n_decode_samples;
+}
+
+// Helper: Record per-core and per-thread CPU usage over the prefill and decode windows.
+// The decode window is closed with a sample taken now; the boundary between the two
+// phases is only as precise as the sampling period.
+void measure_cpu(const llama_context_wrapper* wrapper, generation_stats& stats) {
+    if (!wrapper->proc || !wrapper->proc->running()) return;
+    
+    const int64_t t_decode_start_ns = stats.t_decode_start_ns;
+    wrapper->proc->sample_now();
+    wrapper->proc->usage(t_decode_start_ns - stats.t_prefill_us * 1000, t_decode_start_ns, stats.cpu_prefill);
+    wrapper->proc->usage(t_decode_start_ns, t_decode_start_ns + stats.t_decode_us * 1000, stats.cpu_decode);
+}
+
+// Helper: Let the thermal governor pick the operating point of this generation, moving
+// both phases onto its cores when they differ from the current placement
+void apply_governor(llama_context_wrapper* wrapper, generation_stats& stats) {
+    thermal_governor* governor = wrapper->governor;
+    if (!governor || !governor->running()) return;
+    
+    stats.governor = governor->decide();
+    const operating_point& point = stats.governor.point;
+    const thread_placement& current = wrapper->placement;
+    const bool same_threads = point.n_threads <= 0 ||
+        (current.n_threads_prefill == point.n_threads && current.n_threads_decode == point.n_threads);
+    if (current.prefill_policy != point.policy || current.decode_policy != point.policy || !same_threads) {
+        set_thread_placement(wrapper, governor->topology(), point.policy, point.n_threads, point.policy, point.n_threads);
+    }
+}
+
+// Helper: Whether the deadline or energy budget of the generation is used up. Energy is
+// charged incrementally since the previous check so each check only reads a few samples.
+stop_reason check_budget(const llama_context_wrapper* wrapper, int64_t t_begin_ns, int64_t& t_charged_ns,
+                         int64_t& energy_uj) {
+    const generation_limits& limits = wrapper->limits;
+    const int64_t t = now_ns();
+    if (limits.deadline_us > 0 && t - t_begin_ns >= limits.deadline_us * 1000) {
+        return STOP_DEADLINE;
+    }
+    if (limits.energy_budget_uj > 0 && wrapper->power && wrapper->power->running()) {
+        energy_uj += wrapper->power->energy_uj(t_charged_ns, t);
+        t_charged_ns = t;
+        if (energy_uj >= limits.energy_budget_uj) return STOP_ENERGY_BUDGET;
+    }
+    return STOP_NONE;
+}
+
+// Prefill and decode for an already tokenized prompt; see generate
+bool generate_tokens(
+    llama_context_wrapper* wrapper,
+    const llama_token* tokens,
+    int n_tokens,
+    int64_t t_tokenize_us,
+    int max_tokens,
+    int flush_every,
+    const piece_callback& on_piece,
+    text_sink& response
+) {
+    // Get vocab
+    const llama_vocab* vocab = llama_model_get_vocab(wrapper->model);
+    
+    generation_stats& stats = wrapper->last_stats;
+    stats = generation_stats();
+    const int64_t t_begin = now_ns();
+    apply_governor(wrapper, stats);
+    stats.placement = wrapper->placement;
+    llama_perf_context_reset(wrapper->ctx);
+    
+    stats.t_tokenize_us = t_tokenize_us;
+    stats.n_prompt = n_tokens;
+    
+    LOGD("Tokenized prompt: %d tokens", n_tokens);
+    
+    const int n_ctx = llama_n_ctx(wrapper->ctx);
+    if (n_tokens == 0 || n_tokens >= n_ctx) {
+        LOGE("Prompt of %d tokens does not fit context of %d", n_tokens, n_ctx);
+        stats.stop = n_tokens == 0 ? STOP_ERROR : STOP_CONTEXT_FULL;
+        return false;
+    }
+    
+    // Create batch
+    llama_batch batch = llama_batch_init(wrapper->n_batch, 0, 1);
+    
+    // Decode only the part of the prompt that is not already cached
+    int64_t t_start = now_ns();
+    const int n_keep = reuse_prefix(wrapper, tokens, n_tokens);
+    stats.n_reused = n_keep;
+    const int32_t prefill_status = prefill(wrapper, batch, tokens + n_keep, n_tokens - n_keep, n_keep);
+    if (prefill_status != 0) {
+        // Keep the reused prefix (a warmed system prompt, say); only this prompt's part of
+        // the cache is incomplete, whether the decode failed or a cancel aborted it
+        stats.stop = decode_stop_reason(prefill_status);
+        trim_cache(wrapper, n_keep);
+        llama_batch_free(batch);
+        return false;
+    }
+    wrapper->cached_tokens.assign(tokens, tokens + n_tokens);
+    stats.t_prefill_us = (now_ns() - t_start) / 1000;
+    wrapper->mem_probe.read(stats.mem_prefill);
+    t_start = now_ns();
+    
+    // Generate tokens
+    int n_generated = 0;
+    flush_every = flush_every < 1 ? 1 : flush_every;
+    
+    // Pieces are copied from the vocabulary piece table straight into the response, sized
+    // up front, so the decode loop does not allocate per token. Streaming pushes views of
+    // the response from n_streamed on; text held back (a split UTF-8 character, the
+    // possible start of a stop string) is just the unpushed tail.
+    response.reserve(response.size() + (size_t) std::min(max_tokens, n_ctx - n_tokens) * 4);
+    size_t n_streamed = response.size();
+    int n_pending = 0;
+    bool pushed = false;
+    bool ok = true;
+    std::vector<int64_t>& latencies = wrapper->decode_latencies_us;
+    latencies.clear();
+    stop_matcher& stops = wrapper->stops;
+    stops.reset();
+    int64_t t_charged = t_begin;
+    int64_t energy_spent_uj = 0;
+    
+    while (n_generated < max_tokens && n_tokens + n_generated < n_ctx) {
+        // Stop before spending another decode once the time or energy is used up
+        stats.stop = check_budget(wrapper, t_begin, t_charged, energy_spent_uj);
+        if (stats.stop != STOP_NONE) {
+            break;
+        }
+        
+        // Sample next token
+        int64_t t_phase = now_ns();
+        const float* logits = llama_get_logits_ith(wrapper->ctx, -1);
+        llama_token new_token_id = wrapper->sampler->sample(logits);
+        stats.t_sample_us += (now_ns() - t_phase) / 1000;
+        
+        // Check for EOS (updated API)
+        if (llama_vocab_is_eog(vocab, new_token_id)) {
+            stats.stop = STOP_EOG;
+            break;
+        }
+        
+        // Decode token to text
+        t_phase = now_ns();
+        const size_t n_before = response.size();
+        const bool fits = wrapper->pieces.append(new_token_id, response);
+        stats.t_detokenize_us += (now_ns() - t_phase) / 1000;
+        n_pending++;
+        
+        // Match stop strings on the new bytes only; the match and anything after it are
+        // dropped. Streaming held back every byte that could start a match, so none of
+        // the stop string has been pushed and the unpushed text can be cut the same way.
+        int stop_string = -1;
+        const size_t n_matched = stops.feed(response.data() + n_before, response.size() - n_before, stop_string);
+        if (n_matched > 0) {
+            response.truncate(n_before + n_matched - stops.pattern(stop_string).size());
+            stats.stop = STOP_STRING;
+            stats.stop_string = stop_string;
+            n_generated++;
+            break;
+        }
+        
+        // A fixed response buffer took what fit of this piece; nothing decoded after it
+        // could be returned
+        if (!fits) {
+            stats.stop = STOP_BUFFER_FULL;
+            n_generated++;
+            break;
+        }
+        
+        // Push to the streaming callback, timestamped at the moment the piece is available.
+        // Only whole UTF-8 characters are pushed; a split one waits for its last byte, and
+        // a tail that may be the start of a stop string waits until it cannot be.
+        if (on_piece && (!pushed || n_pending >= flush_every)) {
+            const size_t n_unpushed = response.size() - n_streamed;
+            const size_t n_held = std::min(n_unpushed, (size_t) stops.partial());
+            const size_t n_ready = utf8_complete_prefix(response.data() + n_streamed, n_unpushed - n_held);
+            if (n_ready > 0) {
+                if (!on_piece(std::string_view(response.data() + n_streamed, n_ready), n_pending, now_ns())) {
+                    stats.stop = STOP_CANCELLED;
+                    ok = false;
+                    break;
+                }
+                n_streamed += n_ready;
+                n_pending = 0;
+                pushed = true;
+            }
+        }
+        
+        // Prepare next batch
+        batch_clear(batch);
+        batch_add(batch, wrapper->n_batch, new_token_id, n_tokens + n_generated, {0}, true);
+        
+        // Decode
+        t_phase = now_ns();
+        const int32_t decode_status = llama_decode(wrapper->ctx, batch);
+        if (decode_status != 0) {
+            stats.stop = decode_stop_reason(decode_status);
+            LOGE("Failed to decode token");
+            ok = false;
+            break;
+        }
+        latencies.push_back((now_ns() - t_phase) / 1000);
+        wrapper->cached_tokens.push_back(new_token_id);
+        
+        // Give the SoC time to shed heat when the governor asks for it
+        if (stats.governor.level >= 0) {
+            const int pacing_us = wrapper->governor->pacing_us();
+            if (pacing_us > 0) {
+                t_phase = now_ns();
+                std::this_thread::sleep_for(std::chrono::microseconds(pacing_us));
+                stats.t_pacing_us += (now_ns() - t_phase) / 1000;
+            }
+        }
+        
+        n_generated++;
+    }
+    if (stats.stop == STOP_NONE) {
+        stats.stop = n_generated >= max_tokens ? STOP_MAX_TOKENS : STOP_CONTEXT_FULL;
+    }
+    
+    // Flush whatever is left of the last batch, including a tail held back for the stop strings
+    if (ok && on_piece && response.size() > n_streamed) {
+        ok = on_piece(std::string_view(response.data() + n_streamed, response.size() - n_streamed),
+                      n_pending, now_ns());
+    }
+    
+    llama_batch_free(batch);
+    
+    stats.n_generated = n_generated;
+    stats.t_decode_us = (now_ns() - t_start) / 1000;
+    summarize_latencies(latencies, stats);
+    // The KV cache only grows during decode and the compute buffers are fixed, so the end
+    // of the loop is the memory peak of the generation
+    wrapper->mem_probe.read(stats.mem_decode);
+    const context_memory& memory = wrapper->memory;
+    stats.kv_used_bytes = memory.n_ctx > 0 ? memory.kv_bytes * (int64_t) wrapper->cached_tokens.size() / memory.n_ctx : -1;
+    stats.state_bytes = llama_state_seq_get_size(wrapper->ctx, 0);
+    stats.perf = llama_perf_context(wrapper->ctx);
+    stats.t_decode_start_ns = t_start;
+    measure_energy(wrapper, stats);
+    measure_cpu(wrapper, stats);
+    if (stats.governor.level >= 0) {
+        wrapper->governor->record(stats.governor.level, n_generated, stats.energy_decode_uj);
+    }
+    
+    LOGD("Generated %d tokens, stopped by %s", n_generated, stop_reason_name(stats.stop));
+    const int n_prefilled = stats.n_prompt - stats.n_reused;
+    LOGD("Prefill: %d tokens (%d reused) in %.1f ms (%.2f tok/s), decode: %d tokens in %.1f ms (%.2f tok/s)",
+         n_prefilled, stats.n_reused, stats.t_prefill_us / 1000.0,
+         stats.t_prefill_us > 0 ? n_prefilled * 1e6 / stats.t_prefill_us : 0.0,
+         stats.n_generated, stats.t_decode_us / 1000.0,
+         stats.t_decode_us > 0 ? stats.n_generated * 1e6 / stats.t_decode_us : 0.0);
+    if (stats.energy_decode_uj >= 0) {
+        LOGD("Energy: prefill %.3f J, decode %.3f J (%d power samples)",
+             stats.energy_prefill_uj / 1e6, stats.energy_decode_uj / 1e6, stats.n_power_samples);
+    }
+    if (stats.t_pacing_us > 0) {
+        LOGD("Thermal pacing: %.1f ms of the decode time", stats.t_pacing_us / 1000.0);
+    }
+    if (stats.cpu_decode.n_frames > 0) {
+        LOGD("CPU: prefill %.1f%% (%.1f ms process), decode %.1f%% (%.1f ms process)",
+             stats.cpu_prefill.util_mean_permille / 10.0, stats.cpu_prefill.process_cpu_us / 1000.0,
+             stats.cpu_decode.util_mean_permille / 10.0, stats.cpu_decode.process_cpu_us / 1000.0);
+    }
+    if (stats.mem_decode.rss >= 0) {
+        LOGD("Memory after decode: %s, KV in use %.2f MiB, sequence state %.2f MiB",
+             describe_memory_snapshot(stats.mem_decode).c_str(), stats.kv_used_bytes / 1048576.0,
+             stats.state_bytes / 1048576.0);
+    }
+    
+    return ok;
+}
+
+// Run prefill and greedy decode for a prompt. Decoded text is appended to `response`;
+// if `on_piece` is set, it also receives pieces in batches of `flush_every` tokens
+// (the first token is always pushed on its own so time-to-first-token is exact). Pieces
+// never end inside a UTF-8 character, except possibly the last one of a response. A
+// fixed-size response buffer ends the generation once a piece no longer fits.
+// Returns false if decoding fails or the callback asks to stop.
+bool generate(
+    llama_context_wrapper* wrapper,
+    std::string_view prompt,
+    int max_tokens,
+    int flush_every,
+    const piece_callback& on_piece,
+    text_sink& response
+) {
+    LOGD("Generating response for prompt: %.*s", (int) prompt.size(), prompt.data());
+    
+    // Tokenize prompt, unless it was seen recently
+    int64_t t_start = now_ns();
+    const std::vector<llama_token>& tokens =
+        wrapper->prompt_cache.get(llama_model_get_vocab(wrapper->model), prompt, true);
+    const int64_t t_tokenize_us = (now_ns() - t_start) / 1000;
+    
+    return generate_tokens(wrapper, tokens.data(), tokens.size(), t_tokenize_us,
+                           max_tokens, flush_every, on_piece, response);
+}
+
+bool generate(
+    llama_context_wrapper* wrapper,
+    std::string_view prompt,
+    int max_tokens,
+    int flush_every,
+    const piece_callback& on_piece,
+    std::string& response
+) {
+    text_sink sink(response);
+    return generate(wrapper, prompt, max_tokens, flush_every, on_piece, sink);
+}
+
+// Same as generate for prompt `index` of the set passed to pretokenize_prompts; no
+// tokenization happens at all
+bool generate_indexed(
+    llama_context_wrapper* wrapper,
+    int index,
+    int max_tokens,
+    int flush_every,
+    const piece_callback& on_piece,
+    std::string& response
+) {
+    const token_arena& arena = wrapper->prompt_arena;
+    if (index < 0 || index >= arena.size()) {
+        LOGE("Prompt index %d out of range, %d prompts pretokenized", index, arena.size());
+        wrapper->last_stats = generation_stats();
+        wrapper->last_stats.stop = STOP_ERROR;
+        return false;
+    }
+    LOGD("Generating response for pretokenized prompt %d", index);
+    
+    text_sink sink(response);
+    return generate_tokens(wrapper, arena.prompt(index), arena.prompt_size(index), 0,
+                           max_tokens, flush_every, on_piece, sink);
+}
+
+bool pretokenize_prompts(llama_context_wrapper* wrapper, const std::vector<std::string>& prompts) {
+    return pretokenize(llama_model_get_vocab(wrapper->model), prompts, true, wrapper->prompt_arena);
+}
+
+// Generate responses for several prompts at once. Each prompt gets its own sequence
+// id; prompts are prefilled packed into n_batch-sized batches, and every decode step
+// then advances all unfinished sequences with one llama_decode call. A sequence
+// leaves the batch (and its KV cells are released) as soon as it hits EOG or its
+// token budget. The prefix cache is invalidated because sequence 0 is reused here.
+//
+// last_stats sums the whole batch; seq_stats receives one entry per prompt with its own
+// tokenization time, prompt and generated tokens and stop reason. A sequence's prefill
+// time runs from the start of the batch to its first token and its decode time from
+// there to its last, so the two add up to its latency. The batch energy is split between
+// the sequences by their share of the tokens decoded in each phase, since every token of
+// a batched llama_decode costs about the same.
+bool generate_batch(
+    llama_context_wrapper* wrapper,
+    const std::vector<std::string>& prompts,
+    int max_tokens,
+    std::vector<std::string>& responses,
+    std::vector<generation_stats>& seq_stats
+) {
+    const int n_seq = prompts.size();
+    const llama_vocab* vocab = llama_model_get_vocab(wrapper->model);
+    const int n_ctx = llama_n_ctx(wrapper->ctx);
+    
+    responses.assign(n_seq, std::string());
+    seq_stats.assign(n_seq, generation_stats());
+    if (n_seq == 0) return true;
+    if (n_seq > wrapper->n_seq_max) {
+        LOGE("Batch of %d prompts exceeds n_seq_max=%d", n_seq, wrapper->n_seq_max);
+        return false;
+    }
+    
+    llama_memory_t mem = llama_get_memory(wrapper->ctx);
+    llama_memory_clear(mem, true);
+    wrapper->cached_tokens.clear();
+    
+    std::vector<std::vector<llama_token>> tokens(n_seq);
+    int n_prompt_total = 0;
+    for (int s = 0; s < n_seq; s++) {
+        const int64_t t_tokenize = now_ns();
+        tokens[s] = wrapper->prompt_cache.get(vocab, prompts[s], true);
+        seq_stats[s].t_tokenize_us = (now_ns() - t_tokenize) / 1000;
+        seq_stats[s].n_prompt = tokens[s].size();
+        if (tokens[s].empty()) {
+            LOGE("Prompt %d tokenized to nothing", s);
+            return false;
+        }
+        n_prompt_total += tokens[s].size();
+    }
+    
+    // All sequences share one KV cache; split what is left of it evenly between them
+    const int budget = std::min(max_tokens, (n_ctx - n_prompt_total) / n_seq);
+    if (budget <= 0) {
+        LOGE("Prompts of %d tokens do not fit context of %d", n_prompt_total, n_ctx);
+        for (generation_stats& seq_stat : seq_stats) {
+            seq_stat.stop = STOP_CONTEXT_FULL;
+        }
+        return false;
+    }
+    if (budget < max_tokens) {
+        LOGD("Capping batch generation at %d tokens per sequence", budget);
+    }
+    
+    generation_stats& stats = wrapper->last_stats;
+    stats = generation_stats();
+    stats.placement = wrapper->placement;
+    stats.n_prompt = n_prompt_total;
+    for (const generation_stats& seq_stat : seq_stats) {
+        stats.t_tokenize_us += seq_stat.t_tokenize_us;
+    }
+    
+    const int capacity = std::max(wrapper->n_batch, n_seq);
+    llama_batch batch = llama_batch_init(capacity, 0, 1);
+    
+    std::vector<llama_token> next(n_seq, 0);     // token sampled for each sequence
+    std::vector<int> n_past(n_seq, 0);
+    std::vector<int> n_generated(n_seq, 0);
+    std::vector<int> i_logits(n_seq, -1);        // row of each sequence's logits in the last batch
+    std::vector<bool> active(n_seq, true);
+    
+    const int64_t t_start = now_ns();
+    auto elapsed_us = [&]() { return (now_ns() - t_start) / 1000; };
+    
+    // Sample from the logits just produced; retire the sequence on EOG or budget
+    auto advance = [&](int s) {
+        llama_token id = wrapper->sampler->sample(llama_get_logits_ith(wrapper->ctx, i_logits[s]));
+        i_logits[s] = -1;
+        if (n_generated[s] == 0) {
+            seq_stats[s].t_prefill_us = elapsed_us();
+        }
+        const bool eog = llama_vocab_is_eog(vocab, id);
+        if (eog || n_generated[s] >= budget) {
+            active[s] = false;
+            seq_stats[s].stop = eog ? STOP_EOG : n_generated[s] >= max_tokens ? STOP_MAX_TOKENS : STOP_CONTEXT_FULL;
+            seq_stats[s].t_decode_us = elapsed_us() - seq_stats[s].t_prefill_us;
+            llama_memory_seq_rm(mem, s, -1, -1);
+            return;
+        }
+        wrapper->pieces.append(id, responses[s]);
+        next[s] = id;
+    };
+    
+    // Prefill: pack prompt tokens of all sequences, sampling each sequence's first
+    // token right after the chunk holding its last prompt token is decoded
+    bool ok = true;
+    int seq = 0;
+    size_t pos = 0;
+    while (ok && seq < n_seq) {
+        batch_clear(batch);
+        std::vector<int> completed;
+        while (seq < n_seq && batch.n_tokens < wrapper->n_batch) {
+            const bool last = pos == tokens[seq].size() - 1;
+            if (last) {
+                i_logits[seq] = batch.n_tokens;
+                completed.push_back(seq);
+            }
+            batch_add(batch, capacity, tokens[seq][pos], pos, {seq}, last);
+            if (++pos == tokens[seq].size()) {
+                n_past[seq] = pos;
+                seq++;
+                pos = 0;
+            }
+        }
+        if (llama_decode(wrapper->ctx, batch) != 0) {
+            LOGE("Failed to decode batched prompt");
+            ok = false;
+            break;
+        }
+        for (int c : completed) {
+            advance(c);
+        }
+    }
+    stats.t_prefill_us = elapsed_us();
+    
+    // Decode: one llama_decode per step for every sequence still running
+    while (ok) {
+        batch_clear(batch);
+        for (int s = 0; s < n_seq; s++) {
+            if (!active[s]) continue;
+            i_logits[s] = batch.n_tokens;
+            batch_add(batch, capacity, next[s], n_past[s]++, {s}, true);
+            n_generated[s]++;
+        }
+        if (batch.n_tokens == 0) break;
+        
+        if (llama_decode(wrapper->ctx, batch) != 0) {
+            LOGE("Failed to decode batched step");
+            ok = false;
+            break;
+        }
+        for (int s = 0; s < n_seq; s++) {
+            if (active[s]) advance(s);
+        }
+    }
+    
+    llama_batch_free(batch);
+    llama_memory_clear(mem, true);
+    
+    for (int s = 0; s < n_seq; s++) {
+        stats.n_generated += n_generated[s];
+    }
+    stats.t_decode_us = elapsed_us() - stats.t_prefill_us;
+    stats.t_decode_start_ns = t_start + stats.t_prefill_us * 1000;
+    measure_energy(wrapper, stats);
+    measure_cpu(wrapper, stats);
+    
+    for (int s = 0; s < n_seq; s++) {
+        generation_stats& seq_stat = seq_stats[s];
+        seq_stat.placement = stats.placement;
+        seq_stat.n_generated = n_generated[s];
+        if (active[s]) {
+            // Still running when a decode failed
+            seq_stat.stop = STOP_ERROR;
+            if (n_generated[s] == 0) seq_stat.t_prefill_us = elapsed_us();
+            seq_stat.t_decode_us = elapsed_us() - seq_stat.t_prefill_us;
+        }
+        seq_stat.t_decode_start_ns = t_start + seq_stat.t_prefill_us * 1000;
+        if (stats.energy_decode_uj >= 0) {
+            seq_stat.energy_prefill_uj = n_prompt_total > 0 ? stats.energy_prefill_uj * seq_stat.n_prompt / n_prompt_total : 0;
+            seq_stat.energy_decode_uj = stats.n_generated > 0 ? stats.energy_decode_uj * seq_stat.n_generated / stats.n_generated : 0;
+            seq_stat.n_power_samples = stats.n_power_samples;
+        }
+    }
+    
+    LOGD("Batch of %d: prefill %d tokens in %.1f ms, decode %d tokens in %.1f ms (%.2f tok/s aggregate)",
+         n_seq, stats.n_prompt, stats.t_prefill_us / 1000.0,
+         stats.n_generated, stats.t_decode_us / 1000.0,
+         stats.t_decode_us > 0 ? stats.n_generated * 1e6 / stats.t_decode_us : 0.0);
+    
+    return ok;
+}
+
+// Speculative decoding: the draft model proposes up to n_draft tokens greedily,
+// the target model scores [last, d1..dK] in a single llama_decode, and the longest
+// prefix on which the target's own choice agrees with the draft is accepted along
+// with the target's token at the first disagreement. Both contexts then drop the
+// rejected positions; the draft catches up through reuse_prefix on the next step.
+// last_stats covers the whole run like generate's, with drafting and verification as
+// the decode phase, so energy and CPU use are measured over the speculative window.
+bool generate_speculative(
+    llama_context_wrapper* wrapper,
+    const std::string& prompt,
+    int max_tokens,
+    std::string& response
+) {
+    llama_context_wrapper* draft = wrapper->draft;
+    const llama_vocab* vocab = llama_model_get_vocab(wrapper->model);
+    const int n_ctx = llama_n_ctx(wrapper->ctx);
+    
+    speculative_stats& stats = wrapper->last_spec_stats;
+    stats = speculative_stats();
+    generation_stats& gen = wrapper->last_stats;
+    gen = generation_stats();
+    gen.placement = wrapper->placement;
+    
+    int64_t t_start = now_ns();
+    const std::vector<llama_token> tokens = wrapper->prompt_cache.get(vocab, prompt, true);
+    const int n_tokens = tokens.size();
+    gen.t_tokenize_us = (now_ns() - t_start) / 1000;
+    gen.n_prompt = n_tokens;
+    if (n_tokens == 0 || n_tokens >= n_ctx) {
+        LOGE("Prompt of %d tokens does not fit context of %d", n_tokens, n_ctx);
+        gen.stop = n_tokens == 0 ? STOP_ERROR : STOP_CONTEXT_FULL;
+        return false;
+    }
+    
+    const int capacity = std::max(wrapper->n_batch, wrapper->n_draft + 1);
+    llama_batch batch = llama_batch_init(capacity, 0, 1);
+    
+    t_start = now_ns();
+    const int n_keep = reuse_prefix(wrapper, tokens);
+    gen.n_reused = n_keep;
+    int32_t status = prefill(wrapper, batch, tokens.data() + n_keep, n_tokens - n_keep, n_keep);
+    if (status != 0) {
+        gen.stop = decode_stop_reason(status);
+        trim_cache(wrapper, n_keep);
+        llama_batch_free(batch);
+        return false;
+    }
+    wrapper->cached_tokens = tokens;
+    stats.t_prefill_us = (now_ns() - t_start) / 1000;
+    gen.t_prefill_us = stats.t_prefill_us;
+    gen.t_decode_start_ns = now_ns();
+    
+    // id_last is committed output that neither context has decoded yet
+    llama_token id_last = wrapper->sampler->sample(llama_get_logits_ith(wrapper->ctx, -1));
+    std::vector<llama_token> drafts;
+    std::vector<llama_token> seq;
+    bool ok = true;
+    
+    while (ok && !llama_vocab_is_eog(vocab, id_last) && stats.n_generated < max_tokens) {
+        wrapper->pieces.append(id_last, response);
+        stats.n_generated++;
+        
+        const int n_past = wrapper->cached_tokens.size();
+        const int n_draft = std::min({wrapper->n_draft, max_tokens - stats.n_generated, n_ctx - n_past - 1});
+        if (stats.n_generated >= max_tokens || n_draft < 0) break;
+        
+        // Draft: bring the draft context up to date, then propose n_draft tokens
+        t_start = now_ns();
+        seq = wrapper->cached_tokens;
+        seq.push_back(id_last);
+        const int n_draft_keep = reuse_prefix(draft, seq);
+        status = prefill(draft, batch, seq.data() + n_draft_keep, seq.size() - n_draft_keep, n_draft_keep);
+        if (status != 0) {
+            trim_cache(draft, n_draft_keep);
+            ok = false;
+            break;
+        }
+        draft->cached_tokens = seq;
+        
+        drafts.clear();
+        for (int k = 0; k < n_draft; k++) {
+            llama_token d = draft->sampler->sample(llama_get_logits_ith(draft->ctx, -1));
+            drafts.push_back(d);
+            if (llama_vocab_is_eog(vocab, d) || k == n_draft - 1) break;
+            
+            batch_clear(batch);
+            batch_add(batch, capacity, d, draft->cached_tokens.size(), {0}, true);
+            if (llama_decode(draft->ctx, batch) != 0) break;
+            draft->cached_tokens.push_back(d);
+        }
+        stats.t_draft_us += (now_ns() - t_start) / 1000;
+        stats.n_drafted += drafts.size();
+        
+        // Verify: score the committed token plus all drafts in one target decode
+        t_start = now_ns();
+        batch_clear(batch);
+        batch_add(batch, capacity, id_last, n_past, {0}, true);
+        for (size_t k = 0; k < drafts.size(); k++) {
+            batch_add(batch, capacity, drafts[k], n_past + 1 + k, {0}, true);
+        }
+        status = llama_decode(wrapper->ctx, batch);
+        if (status != 0) {
+            LOGE("Failed to decode verification batch");
+            ok = false;
+            break;
+        }
+        stats.n_steps++;
+        wrapper->cached_tokens.push_back(id_last);
+        
+        size_t n_accepted = 0;
+        llama_token id_target = wrapper->sampler->sample(llama_get_logits_ith(wrapper->ctx, 0));
+        while (n_accepted < drafts.size() && id_target == drafts[n_accepted]
+               && stats.n_generated < max_tokens && !llama_vocab_is_eog(vocab, id_target)) {
+            wrapper->pieces.append(id_target, response);
+            stats.n_generated++;
+            wrapper->cached_tokens.push_back(id_target);
+            n_accepted++;
+            id_target = wrapper->sampler->sample(llama_get_logits_ith(wrapper->ctx, n_accepted));
+        }
+        stats.n_accepted += n_accepted;
+        id_last = id_target;
+        
+        // Forget the target positions of rejected drafts
+        llama_memory_seq_rm(llama_get_memory(wrapper->ctx), 0, wrapper->cached_tokens.size(), -1);
+        stats.t_verify_us += (now_ns() - t_start) / 1000;
+    }
+    
+    llama_batch_free(batch);
+    
+    if (!ok) {
+        gen.stop = decode_stop_reason(status);
+    } else if (llama_vocab_is_eog(vocab, id_last)) {
+        gen.stop = STOP_EOG;
+    } else {
+        gen.stop = stats.n_generated >= max_tokens ? STOP_MAX_TOKENS : STOP_CONTEXT_FULL;
+    }
+    gen.n_generated = stats.n_generated;
+    gen.t_decode_us = (now_ns() - gen.t_decode_start_ns) / 1000;
+    measure_energy(wrapper, gen);
+    measure_cpu(wrapper, gen);
+    
+    const int64_t t_decode_us = stats.t_draft_us + stats.t_verify_us;
+    LOGD("Speculative: %d tokens, %d/%d drafts accepted (%.1f%%), %.2f tokens per target decode, %.2f tok/s",
+         stats.n_generated, stats.n_accepted, stats.n_drafted,
+         stats.n_drafted > 0 ? 100.0 * stats.n_accepted / stats.n_drafted : 0.0,
+         stats.n_steps > 0 ? (double) stats.n_generated / stats.n_steps : 0.0,
+         t_decode_us > 0 ? stats.n_generated * 1e6 / t_decode_us : 0.0);
+    if (gen.energy_decode_uj >= 0) {
+        LOGD("Speculative energy: prefill %.3f J, draft and verify %.3f J (%d power samples)",
+             gen.energy_prefill_uj / 1e6, gen.energy_decode_uj / 1e6, gen.n_power_samples);
+    }
+    
+    return ok;
+}
+
+// Helper: Free the worker thread pools of a wrapper whose context no longer uses them
+void free_threadpools(llama_context_wrapper* wrapper) {
+    if (wrapper->threadpool_prefill && wrapper->threadpool_prefill != wrapper->threadpool_decode) {
+        ggml_threadpool_free(wrapper->threadpool_prefill);
+    }
+    if (wrapper->threadpool_decode) {
+        ggml_threadpool_free(wrapper->threadpool_decode);
+    }
+    wrapper->threadpool_prefill = nullptr;
+    wrapper->threadpool_decode = nullptr;
+}
+
+// Helper: Thread pool restricted to `cpus`; an empty set leaves placement to the scheduler.
+// One worker per core is pinned strictly, oversubscribed pools may float within the set.
+ggml_threadpool_t make_threadpool(const std::vector<int>& cpus, int n_threads) {
+    ggml_threadpool_params params = ggml_threadpool_params_default(n_threads);
+    for (int cpu : cpus) {
+        if (cpu < GGML_MAX_N_THREADS) params.cpumask[cpu] = true;
+    }
+    params.strict_cpu = !cpus.empty() && n_threads <= (int) cpus.size();
+    return ggml_threadpool_new(&params);
+}
+
+// Helper: Free a context wrapper and its draft, handing their models back to the registry
+void free_wrapper(llama_context_wrapper* wrapper) {
+    // Stops a running request before the context goes away
+    delete wrapper->engine;
+    if (wrapper->draft) {
+        free_wrapper(wrapper->draft);
+    }
+    if (wrapper->ctx) {
+        llama_free(wrapper->ctx);
+    }
+    free_threadpools(wrapper);
+    if (wrapper->model) {
+        model_registry::instance().release(wrapper->model);
+    }
+    delete wrapper->sampler;
+    delete wrapper;
+}
+
+void set_generation_limits(llama_context_wrapper* wrapper, const generation_limits& limits) {
+    wrapper->limits = limits;
+    wrapper->stops.set_patterns(limits.stop_strings);
+    LOGD("Generation limits: %zu stop strings, deadline %lld ms, energy budget %.3f J",
+         limits.stop_strings.size(), (long long) (limits.deadline_us / 1000), limits.energy_budget_uj / 1e6);
+}
+
+namespace {
+
+// Buffer sizes llama.cpp reports while it creates a context. Its public API has no
+// query for the compute buffers (they belong to the scheduler inside llama_context), so
+// the log lines are the only source; the figure is best-effort and depends on their
+// wording staying "<name> buffer size = N MiB".
+struct context_log_capture {
+    std::string line;
+    double kv_mib = 0.0;
+    double compute_mib = 0.0;
+    bool has_kv = false;
+    bool has_compute = false;
+};
+
+thread_local context_log_capture* log_capture = nullptr;
+std::once_flag log_sink_once;
+ggml_log_callback previous_log_callback = nullptr;   // installed before llama_log_sink
+void* previous_log_user_data = nullptr;
+
+// Helper: Pick "<name> buffer size = N MiB" out of one complete log line
+void capture_buffer_size(context_log_capture& capture, const std::string& line) {
+    const char* size = strstr(line.c_str(), " buffer size =");
+    if (!size) return;
+    const double mib = strtod(size + strlen(" buffer size ="), nullptr);
+    if (line.find(" KV buffer") != std::string::npos) {
+        capture.kv_mib += mib;
+        capture.has_kv = true;
+    } else if (line.find(" compute buffer") != std::string::npos || line.find(" output buffer") != std::string::npos) {
+        capture.compute_mib += mib;
+        capture.has_compute = true;
+    }
+}
+
+// Helper: llama.cpp log sink; hands every message on to the callback it replaced (or
+// prints like the default one) and, while a context is being created on this thread,
+// records the buffer sizes it reports
+void llama_log_sink(ggml_log_level level, const char* text, void* /* user_data */) {
+    if (previous_log_callback) {
+        previous_log_callback(level, text, previous_log_user_data);
+    } else {
+        fputs(text, stderr);
+        fflush(stderr);
+    }
+    
+    context_log_capture* capture = log_capture;
+    if (!capture) return;
+    capture->line += text;
+    size_t end;
+    while ((end = capture->line.find('\n')) != std::string::npos) {
+        capture_buffer_size(*capture, capture->line.substr(0, end));
+        capture->line.erase(0, end + 1);
+    }
+}
+
+// Helper: Integer GGUF metadata value, or `fallback` if the key is missing
+int64_t model_meta_int(const llama_model* model, const std::string& key, int64_t fallback) {
+    char buf[64];
+    if (llama_model_meta_val_str(model, key.c_str(), buf, sizeof(buf)) <= 0) return fallback;
+    return strtoll(buf, nullptr, 10);
+}
+
+// Helper: Size of a KV cache with n_ctx cells in every layer. Exact for the
+// transformer layouts that give every layer the same attention heads.
+int64_t kv_cache_bytes(const llama_model* model, int n_ctx, ggml_type type_k, ggml_type type_v) {
+    char arch[64] = "";
+    llama_model_meta_val_str(model, "general.architecture", arch, sizeof(arch));
+    const int64_t n_head = std::max(1, llama_model_n_head(model));
+    const int64_t n_head_kv = llama_model_n_head_kv(model);
+    const int64_t head_dim = llama_model_n_embd(model) / n_head;
+    const int64_t k_dim = n_head_kv * model_meta_int(model, std::string(arch) + ".attention.key_length", head_dim);
+    const int64_t v_dim = n_head_kv * model_meta_int(model, std::string(arch) + ".attention.value_length", head_dim);
+    const int64_t cell_bytes = ggml_row_size(type_k, k_dim) + ggml_row_size(type_v, v_dim);
+    return (int64_t) llama_model_n_layer(model) * n_ctx * cell_bytes;
+}
+
+// Helper: Memory of a newly created context. The KV size is computed from the model
+// shape; llama.cpp's own figure (rounded to 0.01 MiB) wins when the two disagree, as
+// for sliding-window or recurrent layers the formula does not cover.
+context_memory measure_context_memory(const llama_model* model, llama_context* ctx,
+                                      const context_options& options, const context_log_capture& capture) {
+    context_memory memory;
+    memory.weights_bytes = llama_model_size(model);
+    memory.n_ctx = llama_n_ctx(ctx);
+    memory.kv_bytes = kv_cache_bytes(model, memory.n_ctx, options.type_k, options.type_v);
+    if (capture.has_kv) {
+        const int64_t reported = (int64_t) (capture.kv_mib * 1048576.0);
+        if (std::llabs(reported - memory.kv_bytes) > 64 * 1024) {
+            LOGD("KV cache reported as %lld bytes, computed %lld", (long long) reported, (long long) memory.kv_bytes);
+            memory.kv_bytes = reported;
+        }
+    }
+    if (capture.has_compute) {
+        memory.compute_bytes = (int64_t) (capture.compute_mib * 1048576.0);
+    }
+    return memory;
+}
+
+struct kv_cache_type_name {
+    const char* name;
+    ggml_type type;
+};
+
+const kv_cache_type_name KV_CACHE_TYPES[] = {
+    {"f32", GGML_TYPE_F32},
+    {"f16", GGML_TYPE_F16},
+    {"bf16", GGML_TYPE_BF16},
+    {"q8_0", GGML_TYPE_Q8_0},
+    {"q4_0", GGML_TYPE_Q4_0},
+    {"q4_1", GGML_TYPE_Q4_1},
+    {"q5_0", GGML_TYPE_Q5_0},
+    {"q5_1", GGML_TYPE_Q5_1},
+};
+
+} // namespace
+
+bool is_kv_cache_type(int type) {
+    for (const kv_cache_type_name& entry : KV_CACHE_TYPES) {
+        if (entry.type == type) return true;
+    }
+    return false;
+}
+
+bool parse_kv_cache_type(const std::string& name, ggml_type& out) {
+    for (const kv_cache_type_name& entry : KV_CACHE_TYPES) {
+        if (name == entry.name) {
+            out = entry.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_flash_attn_type(const std::string& name, llama_flash_attn_type& out) {
+    if (name == "auto") {
+        out = LLAMA_FLASH_ATTN_TYPE_AUTO;
+    } else if (name == "on") {
+        out = LLAMA_FLASH_ATTN_TYPE_ENABLED;
+    } else if (name == "off") {
+        out = LLAMA_FLASH_ATTN_TYPE_DISABLED;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* flash_attn_type_name(llama_flash_attn_type type) {
+    switch (type) {
+        case LLAMA_FLASH_ATTN_TYPE_ENABLED: return "on";
+        case LLAMA_FLASH_ATTN_TYPE_DISABLED: return "off";
+        default: return "auto";
+    }
+}
+
+// Helper: Create the context for a model acquired from the registry; releases the model on failure
+llama_context_wrapper* create_wrapper(llama_model* model, const context_options& options) {
+    if (!is_kv_cache_type(options.type_k) || !is_kv_cache_type(options.type_v)) {
+        LOGE("Unsupported KV cache type k=%d v=%d", (int) options.type_k, (int) options.type_v);
+        model_registry::instance().release(model);
+        return nullptr;
+    }
+    // llama.cpp stores V transposed without flash attention, which block quantization cannot do
+    if (ggml_is_quantized(options.type_v) && options.flash_attn == LLAMA_FLASH_ATTN_TYPE_DISABLED) {
+        LOGE("A %s V cache requires flash attention", ggml_type_name(options.type_v));
+        model_registry::instance().release(model);
+        return nullptr;
+    }
+    
+    // Create context (updated API)
+    llama_context_params ctx_params = llama_context_default_params();
+    ctx_params.n_ctx = options.n_ctx;
+    ctx_params.n_batch = options.n_batch > 0 ? options.n_batch : 512;
+    ctx_params.n_ubatch = options.n_ubatch > 0 ? std::min(options.n_ubatch, (int) ctx_params.n_batch) : ctx_params.n_batch;
+    ctx_params.n_seq_max = options.n_seq_max > 0 ? options.n_seq_max : 1;
+    ctx_params.kv_unified = true;   // sequences share the whole n_ctx instead of n_ctx / n_seq_max each
+    ctx_params.n_threads = options.n_threads;
+    ctx_params.n_threads_batch = options.n_threads;
+    ctx_params.type_k = options.type_k;
+    ctx_params.type_v = options.type_v;
+    ctx_params.flash_attn_type = options.flash_attn;
+    ctx_params.offload_kqv = options.offload_kqv;
+    ctx_params.op_offload = options.op_offload;
+    ctx_params.no_perf = false;     // keep llama_perf_context counters for generation metrics
+    
+    std::call_once(log_sink_once, [] {
+        llama_log_get(&previous_log_callback, &previous_log_user_data);
+        llama_log_set(llama_log_sink, nullptr);
+    });
+    context_log_capture capture;
+    log_capture = &capture;
+    llama_context* ctx = llama_init_from_model(model, ctx_params);
+    log_capture = nullptr;
+    
+    if (!ctx) {
+        LOGE("Failed to create context");
+        model_registry::instance().release(model);
+        return nullptr;
+    }
+    
+    LOGD("Context created successfully");
+    
+    // Create wrapper
+    auto* wrapper = new llama_context_wrapper();
+    wrapper->model = model;
+    wrapper->ctx = ctx;
+    wrapper->options = options;
+    wrapper->memory = measure_context_memory(model, ctx, options, capture);
+    wrapper->n_batch = llama_n_batch(ctx);
+    wrapper->n_seq_max = llama_n_seq_max(ctx);
+    wrapper->sampler = new token_sampler(llama_vocab_n_tokens(llama_model_get_vocab(model)), sampler_params());
+    wrapper->placement.n_threads_prefill = options.n_threads;
+    wrapper->placement.n_threads_decode = options.n_threads;
+    
+    const int64_t t_pieces = now_ns();
+    wrapper->pieces.build(llama_model_get_vocab(model));
+    LOGD("Piece table: %u tokens, %zu bytes in %.1f ms", wrapper->pieces.size(), wrapper->pieces.bytes(),
+         (now_ns() - t_pieces) / 1e6);
+    
+    LOGD("n_batch=%d n_ubatch=%d n_seq_max=%d", wrapper->n_batch, (int) llama_n_ubatch(ctx), wrapper->n_seq_max);
+    LOGD("Context memory: %s", describe_context_memory(wrapper).c_str());
+    
+    if (wrapper->mem_probe.open()) {
+        wrapper->mem_probe.read(wrapper->memory.at_load);
+        LOGD("Process memory at load: %s", describe_memory_snapshot(wrapper->memory.at_load).c_str());
+    }
+    
+    return wrapper;
+}
+
+// Helper: Major page faults of the process so far
+int64_t major_faults() {
+    struct rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_majflt;
+}
+
+// The decode reads every weight once (the output projection too, since it asks for
+// logits), so its faults are the cost of paging the model in: high for a cold load,
+// close to zero when the weights are still in the page cache
+void measure_first_touch(llama_context_wrapper* wrapper, load_phases& phases) {
+    const llama_vocab* vocab = llama_model_get_vocab(wrapper->model);
+    const llama_token bos = llama_vocab_bos(vocab);
+    llama_batch batch = llama_batch_init(1, 0, 1);
+    batch_add(batch, 1, bos != LLAMA_TOKEN_NULL ? bos : 0, 0, {0}, true);
+    
+    const int64_t majflt_start = major_faults();
+    const int64_t t_start = now_ns();
+    const int32_t status = llama_decode(wrapper->ctx, batch);
+    phases.t_first_touch_us = (now_ns() - t_start) / 1000;
+    phases.first_touch_majflt = major_faults() - majflt_start;
+    llama_batch_free(batch);
+    
+    llama_memory_clear(llama_get_memory(wrapper->ctx), true);
+    wrapper->cached_tokens.clear();
+    if (status != 0) {
+        LOGW("First decode failed with status %d", status);
+        return;
+    }
+    LOGD("First touch: %.1f ms, %lld major faults", phases.t_first_touch_us / 1000.0,
+         (long long) phases.first_touch_majflt);
+}
+
+void fill_context_memory(const llama_context_wrapper* wrapper, int64_t* out) {
+    const context_memory& memory = wrapper->memory;
+    out[CTX_MEM_WEIGHTS_BYTES] = memory.weights_bytes;
+    out[CTX_MEM_KV_BYTES] = memory.kv_bytes;
+    out[CTX_MEM_COMPUTE_BYTES] = memory.compute_bytes;
+    out[CTX_MEM_N_CTX] = memory.n_ctx;
+    out[CTX_MEM_TYPE_K] = wrapper->options.type_k;
+    out[CTX_MEM_TYPE_V] = wrapper->options.type_v;
+    out[CTX_MEM_FLASH_ATTN] = wrapper->options.flash_attn;
+    fill_memory_snapshot(memory.at_load, out + CTX_MEM_LOAD);
+}
+
+std::string describe_context_memory(const llama_context_wrapper* wrapper) {
+    const context_memory& memory = wrapper->memory;
+    char compute[32] = "unknown";
+    if (memory.compute_bytes >= 0) {
+        snprintf(compute, sizeof(compute), "%.2f MiB", memory.compute_bytes / 1048576.0);
+    }
+    char text[192];
+    snprintf(text, sizeof(text), "weights %.2f MiB, KV %.2f MiB (%d cells, K %s, V %s), compute %s, flash attention %s",
+             memory.weights_bytes / 1048576.0, memory.kv_bytes / 1048576.0, memory.n_ctx,
+             ggml_type_name(wrapper->options.type_k), ggml_type_name(wrapper->options.type_v),
+             compute, flash_attn_type_name(wrapper->options.flash_attn));
+    return text;
+}
+
+bool set_thread_placement(llama_context_wrapper* wrapper, const cpu_topology& topo,
+                          placement_policy prefill_policy, int n_threads_prefill,
+                          placement_policy decode_policy, int n_threads_decode) {
+    const std::vector<int> prefill_cpus = placement_cpus(topo, prefill_policy);
+    const std::vector<int> decode_cpus = placement_cpus(topo, decode_policy);
+    if ((prefill_policy != PLACEMENT_OS && prefill_cpus.empty()) ||
+        (decode_policy != PLACEMENT_OS && decode_cpus.empty())) {
+        LOGE("No cores for placement prefill=%s decode=%s",
+             placement_policy_name(prefill_policy), placement_policy_name(decode_policy));
+        return false;
+    }
+    
+    thread_placement placement;
+    placement.prefill_policy = prefill_policy;
+    placement.decode_policy = decode_policy;
+    placement.n_threads_prefill = n_threads_prefill > 0 ? n_threads_prefill
+        : (!prefill_cpus.empty() ? (int) prefill_cpus.size() : wrapper->placement.n_threads_prefill);
+    placement.n_threads_decode = n_threads_decode > 0 ? n_threads_decode
+        : (!decode_cpus.empty() ? (int) decode_cpus.size() : wrapper->placement.n_threads_decode);
+    placement.prefill_cpus = cpu_mask_bits(prefill_cpus);
+    placement.decode_cpus = cpu_mask_bits(decode_cpus);
+    
+    llama_detach_threadpool(wrapper->ctx);
+    free_threadpools(wrapper);
+    
+    // With both phases unpinned llama.cpp manages its own workers
+    if (prefill_policy != PLACEMENT_OS || decode_policy != PLACEMENT_OS) {
+        wrapper->threadpool_decode = make_threadpool(decode_cpus, placement.n_threads_decode);
+        wrapper->threadpool_prefill = prefill_cpus == decode_cpus && placement.n_threads_prefill == placement.n_threads_decode
+            ? wrapper->threadpool_decode : make_threadpool(prefill_cpus, placement.n_threads_prefill);
+        if (!wrapper->threadpool_decode || !wrapper->threadpool_prefill) {
+            LOGE("Failed to create thread pools");
+            free_threadpools(wrapper);
+            wrapper->placement = thread_placement();
+            wrapper->placement.n_threads_prefill = placement.n_threads_prefill;
+            wrapper->placement.n_threads_decode = placement.n_threads_decode;
+            llama_set_n_threads(wrapper->ctx, placement.n_threads_decode, placement.n_threads_prefill);
+            return false;
+        }
+        llama_attach_threadpool(wrapper->ctx, wrapper->threadpool_decode, wrapper->threadpool_prefill);
+    }
+    llama_set_n_threads(wrapper->ctx, placement.n_threads_decode, placement.n_threads_prefill);
+    wrapper->placement = placement;
+    
+    LOGD("Thread placement: prefill %s x%d (cpus 0x%llx), decode %s x%d (cpus 0x%llx)",
+         placement_policy_name(prefill_policy), placement.n_threads_prefill, (unsigned long long) placement.prefill_cpus,
+         placement_policy_name(decode_policy), placement.n_threads_decode, (unsigned long long) placement.decode_cpus);
+    return true;
+}
+
+// Load a draft model (same tokenizer as the main model) for speculative decoding,
+// replacing any draft already attached
+bool attach_draft(llama_context_wrapper* wrapper, const std::string& draft_path, int n_draft, int n_threads) {
+    LOGD("Attaching draft model: %s", draft_path.c_str());
+    
+    if (wrapper->draft) {
+        free_wrapper(wrapper->draft);
+        wrapper->draft = nullptr;
+    }
+    
+    load_phases phases;
+    llama_model* model = load_model_from_path(draft_path, llama_model_default_params(), phases);
+    if (!model) {
+        LOGE("Failed to load draft model from %s", draft_path.c_str());
+        return false;
+    }
+    
+    const int n_vocab = llama_vocab_n_tokens(llama_model_get_vocab(model));
+    if (n_vocab != llama_vocab_n_tokens(llama_model_get_vocab(wrapper->model))) {
+        LOGE("Draft vocabulary (%d tokens) does not match the target model", n_vocab);
+        model_registry::instance().release(model);
+        return false;
+    }
+    
+    // Same window as the target so the draft can follow any sequence the target holds
+    llama_context_params ctx_params = llama_context_default_params();
+    ctx_params.n_ctx = llama_n_ctx(wrapper->ctx);
+    ctx_params.n_batch = wrapper->n_batch;
+    ctx_params.n_ubatch = llama_n_ubatch(wrapper->ctx);
+    ctx_params.n_threads = n_threads;
+    ctx_params.n_threads_batch = n_threads;
+    ctx_params.type_k = wrapper->options.type_k;
+    ctx_params.type_v = wrapper->options.type_v;
+    ctx_params.flash_attn_type = wrapper->options.flash_attn;
+    
+    llama_context* ctx = llama_init_from_model(model, ctx_params);
+    if (!ctx) {
+        LOGE("Failed to create draft context");
+        model_registry::instance().release(model);
+        return false;
+    }
+    
+    auto* draft = new llama_context_wrapper();
+    draft->model = model;
+    draft->ctx = ctx;
+    draft->options = wrapper->options;
+    draft->options.n_threads = n_threads;
+    draft->n_batch = llama_n_batch(ctx);
+    draft->n_seq_max = 1;
+    draft->sampler = new token_sampler(n_vocab, sampler_params());
+    
+    wrapper->draft = draft;
+    wrapper->n_draft = n_draft > 0 ? n_draft : 4;
+    
+    LOGD("Draft model attached, n_draft=%d", wrapper->n_draft);
+    return true;
+}
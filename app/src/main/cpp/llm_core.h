@@ -0,0 +1,233 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "llama.cpp/include/llama.h"
+#include "cpu_topology.h"
+#include "memory_probe.h"
+#include "metrics_layout.h"
+#include "piece_table.h"
+#include "power_sampler.h"
+#include "proc_sampler.h"
+#include "sampler.h"
+#include "stop_conditions.h"
+#include "thermal_governor.h"
+#include "token_cache.h"
+
+// JNI-free inference core: context setup, prefix-cached generation, batched and
+// speculative generation, and per-phase metrics. llama-wrapper.cpp exposes it to
+// Kotlin; bench/llm_bench.cpp drives the same code on a Linux host.
+
+// Where the ggml worker threads of each phase run; prefill (batch) and decode use
+// separate thread pools so each can be pinned to its own cluster
+struct thread_placement {
+    placement_policy prefill_policy = PLACEMENT_OS;
+    placement_policy decode_policy = PLACEMENT_OS;
+    int n_threads_prefill = 0;
+    int n_threads_decode = 0;
+    uint64_t prefill_cpus = 0;      // cpu_mask_bits of the cores used, 0 for PLACEMENT_OS
+    uint64_t decode_cpus = 0;
+};
+
+// Context creation settings; defaults mirror ModelConfig
+struct context_options {
+    int n_threads = 4;
+    int n_ctx = 2048;
+    int n_batch = 512;              // max tokens per llama_decode call during prefill
+    int n_ubatch = 512;             // micro-batch llama.cpp splits each batch into
+    int n_seq_max = 1;
+    ggml_type type_k = GGML_TYPE_F16;   // KV cache precision (see is_kv_cache_type)
+    ggml_type type_v = GGML_TYPE_F16;   // a quantized V cache requires flash attention
+    llama_flash_attn_type flash_attn = LLAMA_FLASH_ATTN_TYPE_AUTO;
+    bool offload_kqv = true;        // keep the KV cache and attention on the offload device, if any
+    bool op_offload = true;         // run ops on host-resident weights on the offload device, if any
+};
+
+// Memory held by one context, measured when it is created
+struct context_memory {
+    int64_t weights_bytes = 0;      // tensor data of the model (shared with other contexts on it)
+    int64_t kv_bytes = 0;           // K and V cache for every cell of every layer
+    int64_t compute_bytes = -1;     // compute buffers of all backends, best-effort from llama.cpp's log; -1 if not found
+    int n_ctx = 0;                  // KV cells, as rounded up by llama.cpp
+    memory_snapshot at_load;        // process memory once the model and context were set up
+};
+
+// Layout of the long[] context memory array returned to Kotlin (ContextMemory)
+enum context_memory_index {
+    CTX_MEM_WEIGHTS_BYTES = 0,
+    CTX_MEM_KV_BYTES,
+    CTX_MEM_COMPUTE_BYTES,
+    CTX_MEM_N_CTX,
+    CTX_MEM_TYPE_K,
+    CTX_MEM_TYPE_V,
+    CTX_MEM_FLASH_ATTN,
+    CTX_MEM_LOAD,                   // memory_snapshot at load; MEM_FIELD_COUNT values follow
+    CTX_MEM_COUNT = CTX_MEM_LOAD + MEM_FIELD_COUNT
+};
+
+// Timing of the last generation, split by phase
+struct generation_stats {
+    int64_t t_tokenize_us = 0;
+    int n_prompt = 0;
+    int n_reused = 0;               // prompt tokens served from the KV prefix cache
+    int64_t t_prefill_us = 0;
+    int n_generated = 0;
+    int64_t t_decode_us = 0;        // whole decode loop, including sampling and detokenization
+    int64_t t_sample_us = 0;
+    int64_t t_detokenize_us = 0;
+    int64_t decode_p50_us = 0;      // percentiles of the llama_decode call per generated token
+    int64_t decode_p90_us = 0;
+    int64_t decode_p99_us = 0;
+    int64_t decode_max_us = 0;
+    int64_t decode_hist[DECODE_HIST_BUCKETS] = {};
+    llama_perf_context_data perf = {};
+    thread_placement placement;     // placement in effect during the generation
+    int64_t energy_prefill_uj = -1; // battery energy over each phase, -1 without a power sampler
+    int64_t energy_decode_uj = -1;
+    int n_power_samples = 0;        // power samples that fell inside the generation
+    int64_t t_decode_start_ns = 0;  // steady clock; prefill ends and decode begins here
+    proc_sampler::window cpu_prefill;   // per-core and per-thread usage, n_frames 0 without a CPU sampler
+    proc_sampler::window cpu_decode;
+    governor_decision governor;     // level -1 without a running thermal governor
+    int64_t t_pacing_us = 0;        // part of t_decode_us slept between tokens by the governor
+    stop_reason stop = STOP_NONE;
+    int stop_string = -1;           // index into generation_limits::stop_strings for STOP_STRING
+    memory_snapshot mem_prefill;    // process memory after prefill and when decoding ended; all -1
+    memory_snapshot mem_decode;     // for batched and speculative generation
+    int64_t kv_used_bytes = -1;     // share of memory.kv_bytes holding the sequence at the end
+    int64_t state_bytes = -1;       // size of the sequence state as state_cache would save it
+};
+
+// Counters of the last speculative generation
+struct speculative_stats {
+    int n_drafted = 0;              // tokens proposed by the draft model
+    int n_accepted = 0;             // drafted tokens confirmed by the target model
+    int n_steps = 0;                // target verification decodes
+    int n_generated = 0;
+    int64_t t_prefill_us = 0;
+    int64_t t_draft_us = 0;
+    int64_t t_verify_us = 0;
+};
+
+// Layout of the long[] speculative stats array returned to Kotlin (SpeculativeStats): the
+// speculative counters, its decode window from last_stats and the plain baseline's
+enum speculative_stats_index {
+    SPEC_N_DRAFTED = 0,
+    SPEC_N_ACCEPTED,
+    SPEC_N_STEPS,
+    SPEC_N_GENERATED,
+    SPEC_T_PREFILL_US,
+    SPEC_T_DRAFT_US,
+    SPEC_T_VERIFY_US,
+    SPEC_T_DECODE_US,               // drafting and verification, as timed by last_stats
+    SPEC_ENERGY_DECODE_UJ,          // -1 without a running power sampler
+    SPEC_N_POWER_SAMPLES,
+    SPEC_PLAIN_N_GENERATED,         // 0 when the baseline was not run
+    SPEC_PLAIN_T_DECODE_US,
+    SPEC_PLAIN_ENERGY_DECODE_UJ,
+    SPEC_STATS_COUNT
+};
+
+class inference_engine;
+struct load_phases;
+
+struct llama_context_wrapper {
+    llama_model* model;
+    llama_context* ctx;
+    token_sampler* sampler;
+    piece_table pieces;             // detokenization table; left empty for draft contexts
+    context_options options;        // settings the context was created with
+    context_memory memory;
+    int n_batch;                    // max tokens per llama_decode call during prefill
+    int n_seq_max;                  // sequences that can be decoded together by generate_batch
+    generation_stats last_stats;
+    std::vector<int64_t> decode_latencies_us;  // per-token scratch, reused across generations
+    std::vector<llama_token> cached_tokens;  // tokens whose KV entries are in sequence 0, by position
+    token_cache prompt_cache;       // recent prompt tokenizations
+    token_arena prompt_arena;       // prompt set tokenized once by pretokenize_prompts
+    llama_context_wrapper* draft;   // smaller model sharing the vocabulary, used by generate_speculative
+    int n_draft;                    // tokens drafted per verification step
+    speculative_stats last_spec_stats;
+    thread_placement placement;
+    ggml_threadpool_t threadpool_decode;   // null while the placement is PLACEMENT_OS for both phases
+    ggml_threadpool_t threadpool_prefill;  // may alias threadpool_decode
+    const power_sampler* power;     // not owned; energy is attributed while it is running
+    proc_sampler* proc;             // not owned; CPU usage is attributed while it is running
+    thermal_governor* governor;     // not owned; picks placement and pacing of each generation while running
+    inference_engine* engine;       // asynchronous request queue, null until first used
+    std::mutex busy;                // held for every use of ctx: by the engine worker for a whole
+                                    // request, by JNI calls for theirs
+    generation_limits limits;       // stop conditions of generate and generate_indexed
+    stop_matcher stops;             // compiled limits.stop_strings
+    memory_probe mem_probe;         // process memory at the phase boundaries of generate
+};
+
+// Callback invoked with each batch of decoded text and the native time it was produced.
+// The text points into the response and is only valid during the call.
+using piece_callback = std::function<bool(std::string_view text, int n_tokens, int64_t timestamp_ns)>;
+
+// Context setup and teardown. Models come from the model registry (model_loader.h);
+// create_wrapper takes over the caller's model reference and releases it on failure.
+llama_context_wrapper* create_wrapper(llama_model* model, const context_options& options);
+bool attach_draft(llama_context_wrapper* wrapper, const std::string& draft_path, int n_draft, int n_threads);
+// Runs the first decode of a new context, one token that is dropped again, and records
+// its time and the major page faults it caused as the first-touch phase of the load
+void measure_first_touch(llama_context_wrapper* wrapper, load_phases& phases);
+
+// Moves the prefill and decode worker threads onto the cores `topo` selects for each
+// policy. A thread count <= 0 means one thread per selected core.
+bool set_thread_placement(llama_context_wrapper* wrapper, const cpu_topology& topo,
+                          placement_policy prefill_policy, int n_threads_prefill,
+                          placement_policy decode_policy, int n_threads_decode);
+void free_wrapper(llama_context_wrapper* wrapper);
+
+// Replaces the stop strings, deadline and energy budget of later generations
+void set_generation_limits(llama_context_wrapper* wrapper, const generation_limits& limits);
+
+// KV cache types llama.cpp can store: f32, f16, bf16, q8_0, q4_0, q4_1, q5_0 and q5_1
+bool is_kv_cache_type(int type);
+bool parse_kv_cache_type(const std::string& name, ggml_type& out);
+bool parse_flash_attn_type(const std::string& name, llama_flash_attn_type& out);
+const char* flash_attn_type_name(llama_flash_attn_type type);
+void fill_context_memory(const llama_context_wrapper* wrapper, int64_t* out);
+std::string describe_context_memory(const llama_context_wrapper* wrapper);
+
+// Generation entry points; see llm_core.cpp for the details of each strategy
+bool generate(llama_context_wrapper* wrapper, std::string_view prompt, int max_tokens, int flush_every,
+              const piece_callback& on_piece, std::string& response);
+// Same writing into `response` in place, e.g. a direct ByteBuffer; a full buffer ends the generation
+bool generate(llama_context_wrapper* wrapper, std::string_view prompt, int max_tokens, int flush_every,
+              const piece_callback& on_piece, text_sink& response);
+bool generate_batch(llama_context_wrapper* wrapper, const std::vector<std::string>& prompts, int max_tokens,
+                    std::vector<std::string>& responses, std::vector<generation_stats>& seq_stats);
+bool generate_speculative(llama_context_wrapper* wrapper, const std::string& prompt, int max_tokens, std::string& response);
+
+// Tokenizes a fixed prompt set into the context's arena, replacing the previous one,
+// so generate_indexed can run any of them without touching the tokenizer
+bool pretokenize_prompts(llama_context_wrapper* wrapper, const std::vector<std::string>& prompts);
+bool generate_indexed(llama_context_wrapper* wrapper, int index, int max_tokens, int flush_every,
+                      const piece_callback& on_piece, std::string& response);
+// Same as generate for a prompt the caller tokenized (chat_session); the prefix cache
+// still applies, so only tokens past the cached ones are prefilled
+bool generate_tokens(llama_context_wrapper* wrapper, const llama_token* tokens, int n_tokens, int64_t t_tokenize_us,
+                     int max_tokens, int flush_every, const piece_callback& on_piece, text_sink& response);
+
+// Copies stats into out[METRIC_COUNT]
+void fill_metrics(const generation_stats& stats, int64_t* out);
+// Copies the last speculative generation and its plain baseline into out[SPEC_STATS_COUNT]
+void fill_speculative_stats(const llama_context_wrapper* wrapper, const generation_stats& plain, int64_t* out);
+
+// Building blocks shared by the generation strategies
+int64_t now_ns();
+void batch_clear(llama_batch& batch);
+void batch_add(llama_batch& batch, int capacity, llama_token id, llama_pos pos, const std::vector<llama_seq_id>& seq_ids, bool logits);
+std::vector<llama_token> tokenize(const llama_vocab* vocab, std::string_view text, bool add_special,
+                                  bool parse_special = false);
+std::string token_to_piece(const llama_vocab* vocab, llama_token token);
+int32_t prefill(llama_context_wrapper* wrapper, llama_batch& batch, const llama_token* tokens, int n_tokens, int n_past);
+int reuse_prefix(llama_context_wrapper* wrapper, const llama_token* tokens, int n_tokens);
+int reuse_prefix(llama_context_wrapper* wrapper, const std::vector<llama_token>& tokens);
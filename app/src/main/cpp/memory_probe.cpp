@@ -0,0 +1,111 @@
+#include "memory_probe.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// A "Key:   123 kB" line of status or smaps_rollup
+struct kb_field {
+    const char* key;
+    int64_t memory_snapshot::* field;
+};
+
+const kb_field STATUS_FIELDS[] = {
+    {"VmHWM:", &memory_snapshot::rss_peak},
+    {"VmRSS:", &memory_snapshot::rss},
+    {"RssAnon:", &memory_snapshot::rss_anon},
+    {"RssFile:", &memory_snapshot::rss_file},
+    {"VmSwap:", &memory_snapshot::swap},
+};
+
+const kb_field ROLLUP_FIELDS[] = {
+    {"Pss:", &memory_snapshot::pss},
+    {"Pss_Anon:", &memory_snapshot::pss_anon},
+    {"Pss_File:", &memory_snapshot::pss_file},
+};
+
+// Sets the fields whose key starts a line of text; values are in kB
+template <size_t N>
+void parse_kb_fields(const char* text, const kb_field (&fields)[N], memory_snapshot& out) {
+    for (const char* p = text; *p; ) {
+        for (const kb_field& f : fields) {
+            const size_t n = std::strlen(f.key);
+            if (std::strncmp(p, f.key, n) != 0) continue;
+            const char* v = p + n;
+            while (*v == ' ' || *v == '\t') v++;
+            int64_t kb = 0;
+            while (*v >= '0' && *v <= '9') {
+                kb = kb * 10 + (*v++ - '0');
+            }
+            out.*f.field = kb * 1024;
+            break;
+        }
+        const char* eol = std::strchr(p, '\n');
+        if (!eol) break;
+        p = eol + 1;
+    }
+}
+
+} // namespace
+
+memory_probe::~memory_probe() {
+    close();
+}
+
+bool memory_probe::open(const std::string& proc_root) {
+    close();
+    status_fd_ = ::open((proc_root + "/self/status").c_str(), O_RDONLY | O_CLOEXEC);
+    rollup_fd_ = ::open((proc_root + "/self/smaps_rollup").c_str(), O_RDONLY | O_CLOEXEC);
+    return status_fd_ >= 0;
+}
+
+void memory_probe::close() {
+    if (status_fd_ >= 0) ::close(status_fd_);
+    if (rollup_fd_ >= 0) ::close(rollup_fd_);
+    status_fd_ = rollup_fd_ = -1;
+}
+
+bool memory_probe::read_status(memory_snapshot& out) {
+    if (status_fd_ < 0) return false;
+    const ssize_t n = pread(status_fd_, buf_, sizeof(buf_) - 1, 0);
+    if (n <= 0) return false;
+    buf_[n] = '\0';
+    parse_kb_fields(buf_, STATUS_FIELDS, out);
+    return true;
+}
+
+bool memory_probe::read(memory_snapshot& out) {
+    out = memory_snapshot();
+    if (!read_status(out)) return false;
+    if (rollup_fd_ >= 0) {
+        const ssize_t n = pread(rollup_fd_, buf_, sizeof(buf_) - 1, 0);
+        if (n > 0) {
+            buf_[n] = '\0';
+            parse_kb_fields(buf_, ROLLUP_FIELDS, out);
+        }
+    }
+    return true;
+}
+
+void fill_memory_snapshot(const memory_snapshot& snapshot, int64_t* out) {
+    out[MEM_RSS] = snapshot.rss;
+    out[MEM_RSS_ANON] = snapshot.rss_anon;
+    out[MEM_RSS_FILE] = snapshot.rss_file;
+    out[MEM_PSS] = snapshot.pss;
+    out[MEM_PSS_ANON] = snapshot.pss_anon;
+    out[MEM_PSS_FILE] = snapshot.pss_file;
+    out[MEM_SWAP] = snapshot.swap;
+    out[MEM_RSS_PEAK] = snapshot.rss_peak;
+}
+
+std::string describe_memory_snapshot(const memory_snapshot& snapshot) {
+    auto mib = [](int64_t bytes) { return bytes >= 0 ? bytes / 1048576.0 : -1.0; };
+    char text[160];
+    snprintf(text, sizeof(text), "rss %.1f MiB (anon %.1f, file %.1f), pss %.1f MiB (anon %.1f, file %.1f), peak %.1f MiB",
+             mib(snapshot.rss), mib(snapshot.rss_anon), mib(snapshot.rss_file),
+             mib(snapshot.pss), mib(snapshot.pss_anon), mib(snapshot.pss_file), mib(snapshot.rss_peak));
+    return text;
+}
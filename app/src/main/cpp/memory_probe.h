@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Memory of this process at one instant, in bytes; -1 where the kernel does not report
+// a field. Anonymous pages hold the KV cache, compute buffers and heap, file-backed
+// pages mostly the mmapped model weights.
+struct memory_snapshot {
+    int64_t rss = -1;               // VmRSS
+    int64_t rss_anon = -1;          // RssAnon
+    int64_t rss_file = -1;          // RssFile
+    int64_t pss = -1;               // Pss of smaps_rollup: shared pages split between their users
+    int64_t pss_anon = -1;          // Pss_Anon and Pss_File, kernel 5.9+
+    int64_t pss_file = -1;
+    int64_t swap = -1;              // VmSwap (zram on Android)
+    int64_t rss_peak = -1;          // VmHWM, highest rss since the process started
+};
+
+// Layout of the long[] memory snapshot blocks returned to Kotlin (MemorySnapshot)
+enum memory_snapshot_index {
+    MEM_RSS = 0,
+    MEM_RSS_ANON,
+    MEM_RSS_FILE,
+    MEM_PSS,
+    MEM_PSS_ANON,
+    MEM_PSS_FILE,
+    MEM_SWAP,
+    MEM_RSS_PEAK,
+    MEM_FIELD_COUNT
+};
+
+// Reads <proc_root>/self/status and <proc_root>/self/smaps_rollup. The files stay open
+// and are re-read with pread into a fixed buffer, so a reading allocates nothing and
+// costs a fraction of ActivityManager.getProcessMemoryInfo, which also parses every
+// mapping and is rate-limited on recent Android. The root is injectable so the parser
+// can run on a host against a fake tree.
+class memory_probe {
+public:
+    memory_probe() = default;
+    ~memory_probe();
+    memory_probe(const memory_probe&) = delete;
+    memory_probe& operator=(const memory_probe&) = delete;
+
+    // Needs status; smaps_rollup (kernel 4.14+) is optional and leaves the Pss fields at -1
+    bool open(const std::string& proc_root = "/proc");
+    void close();
+    bool is_open() const { return status_fd_ >= 0; }
+
+    // Fills every field. The rollup walks the page tables of all mappings, which takes
+    // in the order of a millisecond per GB mapped, so it is not meant for every token.
+    bool read(memory_snapshot& out);
+    // Only the status fields (rss, anon, file, swap, peak); Pss fields are left as they are
+    bool read_status(memory_snapshot& out);
+
+private:
+    int status_fd_ = -1;
+    int rollup_fd_ = -1;
+    char buf_[4096];                // status is ~1.5 KB, smaps_rollup ~1 KB
+};
+
+// Copies snapshot into out[MEM_FIELD_COUNT]
+void fill_memory_snapshot(const memory_snapshot& snapshot, int64_t* out);
+std::string describe_memory_snapshot(const memory_snapshot& snapshot);
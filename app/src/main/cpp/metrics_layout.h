@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include "memory_probe.h"
+
+// Generation metrics layout, kept free of llama.h so the telemetry library can
+// format stored metrics without linking the inference core
+
+// Upper bounds (us) of the per-token decode latency histogram; the last bucket is open
+constexpr int64_t DECODE_HIST_BOUNDS_US[] = {2500, 5000, 10000, 20000, 40000, 80000, 160000};
+constexpr int DECODE_HIST_BUCKETS = sizeof(DECODE_HIST_BOUNDS_US) / sizeof(DECODE_HIST_BOUNDS_US[0]) + 1;
+
+// Layout of the metrics array shared with Kotlin (NativeMetrics), llm-bench and the
+// telemetry log's CSV export
+enum metrics_index {
+    METRIC_T_TOKENIZE_US = 0,
+    METRIC_N_PROMPT,
+    METRIC_N_REUSED,
+    METRIC_T_PREFILL_US,
+    METRIC_N_GENERATED,
+    METRIC_T_DECODE_US,
+    METRIC_T_SAMPLE_US,
+    METRIC_T_DETOKENIZE_US,
+    METRIC_DECODE_P50_US,
+    METRIC_DECODE_P90_US,
+    METRIC_DECODE_P99_US,
+    METRIC_DECODE_MAX_US,
+    METRIC_PERF_T_P_EVAL_US,
+    METRIC_PERF_T_EVAL_US,
+    METRIC_PERF_N_P_EVAL,
+    METRIC_PERF_N_EVAL,
+    METRIC_DECODE_HIST,             // DECODE_HIST_BUCKETS counts follow
+    METRIC_PREFILL_POLICY = METRIC_DECODE_HIST + DECODE_HIST_BUCKETS,
+    METRIC_PREFILL_THREADS,
+    METRIC_PREFILL_CPUS,
+    METRIC_DECODE_POLICY,
+    METRIC_DECODE_THREADS,
+    METRIC_DECODE_CPUS,
+    METRIC_ENERGY_PREFILL_UJ,
+    METRIC_ENERGY_DECODE_UJ,
+    METRIC_N_POWER_SAMPLES,
+    METRIC_CPU_UTIL_PREFILL,        // mean core utilization in permille, -1 without a CPU sampler
+    METRIC_CPU_UTIL_DECODE,
+    METRIC_PROCESS_CPU_PREFILL_US,  // CPU time of all threads of the process
+    METRIC_PROCESS_CPU_DECODE_US,
+    METRIC_GOVERNOR_LEVEL,          // thermal governor operating point, -1 without a running governor
+    METRIC_GOVERNOR_REASON,         // governor_reason of the decision
+    METRIC_THERMAL_MC,              // hottest thermal zone when the generation started, -1 if unknown
+    METRIC_FREQ_CAP_PERMILLE,       // lowest cpufreq cap relative to the maximum, -1 if unknown
+    METRIC_T_PACING_US,             // time slept between tokens to hold the thermal envelope
+    METRIC_STOP_REASON,             // stop_reason of the generation (stop_conditions.h)
+    METRIC_MEM_PREFILL,             // memory_snapshot after prefill; MEM_FIELD_COUNT values follow
+    METRIC_MEM_DECODE = METRIC_MEM_PREFILL + MEM_FIELD_COUNT,   // snapshot when decoding ended
+    METRIC_KV_USED_BYTES = METRIC_MEM_DECODE + MEM_FIELD_COUNT, // KV cells holding the sequence, -1 if not measured
+    METRIC_STATE_BYTES,             // llama_state_seq_get_size of the sequence, -1 if not measured
+    METRIC_COUNT,
+};
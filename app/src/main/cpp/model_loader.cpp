@@ -0,0 +1,202 @@
+#include "model_loader.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include "model_registry.h"
+#include "native_log.h"
+
+namespace {
+
+int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Copy [offset, offset + length) of `fd` to `dst` in the kernel, via a temporary file
+// so an interrupted copy is never mistaken for a complete one.
+bool extract_region(int fd, int64_t offset, int64_t length, const std::string& dst) {
+    const std::string tmp = dst + ".tmp";
+    int out = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (out < 0) {
+        LOGE("Cannot create %s: %s", tmp.c_str(), strerror(errno));
+        return false;
+    }
+
+    off_t in_off = (off_t) offset;
+    int64_t remaining = length;
+    while (remaining > 0) {
+        ssize_t n = sendfile(out, fd, &in_off, (size_t) std::min<int64_t>(remaining, 1 << 30));
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            LOGE("Extracting model region failed: %s", n < 0 ? strerror(errno) : "short read");
+            close(out);
+            unlink(tmp.c_str());
+            return false;
+        }
+        remaining -= n;
+    }
+
+    close(out);
+    if (rename(tmp.c_str(), dst.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Delete extracted copies in `cache_dir` other than `keep`, plus unfinished .tmp files.
+// A copy is as large as its model, so only the active model's is kept; models from an
+// earlier APK or other assets are extracted again when they are loaded. Deleting a copy
+// a resident model still maps is safe, the mapping keeps the file's pages.
+void remove_stale_copies(const std::string& cache_dir, const std::string& keep) {
+    DIR* dir = opendir(cache_dir.c_str());
+    if (!dir) return;
+    while (dirent* entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        const std::string path = cache_dir + "/" + name;
+        if (name.compare(0, 6, "model-") != 0 || path == keep) continue;
+        const bool tmp = name.size() > 9 && name.compare(name.size() - 9, 9, ".gguf.tmp") == 0;
+        const bool gguf = name.size() > 5 && name.compare(name.size() - 5, 5, ".gguf") == 0;
+        if (tmp || gguf) {
+            if (unlink(path.c_str()) == 0) {
+                LOGD("Removed stale model copy %s", path.c_str());
+            }
+        }
+    }
+    closedir(dir);
+}
+
+// Times of llama.cpp's first and last load progress report, passed on to the caller's
+// own progress callback if it set one
+struct load_progress {
+    int64_t t_first_us = 0;
+    int64_t t_last_us = 0;
+    llama_progress_callback chained = nullptr;
+    void* chained_data = nullptr;
+};
+
+bool on_load_progress(float progress, void* user_data) {
+    auto* p = static_cast<load_progress*>(user_data);
+    const int64_t t = now_us();
+    if (p->t_first_us == 0) p->t_first_us = t;
+    p->t_last_us = t;
+    return p->chained ? p->chained(progress, p->chained_data) : true;
+}
+
+// `path` is the file to hand to llama.cpp when the region covers the whole file;
+// empty means the fd is reached through /proc/self/fd.
+llama_model* load_region(int fd, int64_t offset, int64_t length, const std::string& path,
+                         const std::string& cache_dir, const llama_model_params& params,
+                         load_phases& phases) {
+    phases = load_phases();
+
+    // Open: resolve the region to a file llama.cpp can load by path
+    int64_t t_start = now_us();
+    struct stat st = {};
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        LOGE("Model fd %d is not a regular file", fd);
+        return nullptr;
+    }
+    if (length <= 0) length = st.st_size - offset;
+    if (offset < 0 || length <= 0 || offset + length > st.st_size) {
+        LOGE("Model region [%lld, +%lld) outside file of %lld bytes",
+             (long long) offset, (long long) length, (long long) st.st_size);
+        return nullptr;
+    }
+    char magic[4] = {};
+    if (pread(fd, magic, sizeof(magic), (off_t) offset) != (ssize_t) sizeof(magic) ||
+        memcmp(magic, "GGUF", sizeof(magic)) != 0) {
+        LOGE("Model region does not start with a GGUF header");
+        return nullptr;
+    }
+    phases.bytes = length;
+
+    // The same region reached through any path or fd shares one registry entry
+    const std::string key = "gguf:" + std::to_string((unsigned long long) st.st_dev) + ":" +
+        std::to_string((unsigned long long) st.st_ino) + ":" +
+        std::to_string(offset) + ":" + std::to_string(length);
+
+    std::string load_path;
+    if (offset == 0 && length == st.st_size) {
+        load_path = path.empty() ? "/proc/self/fd/" + std::to_string(fd) : path;
+    } else {
+        if (cache_dir.empty()) {
+            LOGE("Model region at offset %lld needs a cache directory", (long long) offset);
+            return nullptr;
+        }
+        load_path = cache_dir + "/model-" + std::to_string((unsigned long long) st.st_ino) + "-" +
+            std::to_string(offset) + "-" + std::to_string(length) + ".gguf";
+        remove_stale_copies(cache_dir, load_path);
+        struct stat cached = {};
+        if (stat(load_path.c_str(), &cached) != 0 || cached.st_size != length) {
+            if (!extract_region(fd, offset, length, load_path)) return nullptr;
+            phases.extracted = true;
+        }
+    }
+    phases.t_open_us = now_us() - t_start;
+
+    // Tensor setup and mmap: llama.cpp parses the metadata, creates the tensors and maps
+    // the file, then binds the tensors to the mapping while reporting progress. A resident
+    // model reports none and counts as tensor setup only.
+    t_start = now_us();
+    load_progress progress;
+    progress.chained = params.progress_callback;
+    progress.chained_data = params.progress_callback_user_data;
+    llama_model_params load_params = params;
+    load_params.progress_callback = on_load_progress;
+    load_params.progress_callback_user_data = &progress;
+    bool loaded = false;
+    llama_model* model = model_registry::instance().acquire(key, load_path, load_params, &loaded);
+    if (!model) return nullptr;
+    const int64_t t_end = now_us();
+    phases.resident = !loaded;
+    const int64_t t_mapped = progress.t_first_us > 0 ? progress.t_first_us : t_end;
+    phases.t_tensor_setup_us = t_mapped - t_start;
+    phases.t_mmap_us = (progress.t_last_us > 0 ? progress.t_last_us : t_end) - t_mapped;
+
+    LOGD("Model load phases (us): open=%lld tensors=%lld mmap=%lld%s%s",
+         (long long) phases.t_open_us, (long long) phases.t_tensor_setup_us, (long long) phases.t_mmap_us,
+         phases.resident ? " [resident]" : "", phases.extracted ? " [extracted]" : "");
+    return model;
+}
+
+} // namespace
+
+llama_model* load_model_from_fd(int fd, int64_t offset, int64_t length,
+                                const std::string& cache_dir,
+                                const llama_model_params& params,
+                                load_phases& phases) {
+    return load_region(fd, offset, length, "", cache_dir, params, phases);
+}
+
+llama_model* load_model_from_path(const std::string& path,
+                                  const llama_model_params& params,
+                                  load_phases& phases) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOGE("Cannot open %s: %s", path.c_str(), strerror(errno));
+        phases = load_phases();
+        return nullptr;
+    }
+    llama_model* model = load_region(fd, 0, 0, path, "", params, phases);
+    close(fd);
+    return model;
+}
+
+void fill_load_phases(const load_phases& phases, int64_t* out) {
+    out[LOAD_T_OPEN_US] = phases.t_open_us;
+    out[LOAD_T_TENSOR_SETUP_US] = phases.t_tensor_setup_us;
+    out[LOAD_T_MMAP_US] = phases.t_mmap_us;
+    out[LOAD_T_FIRST_TOUCH_US] = phases.t_first_touch_us;
+    out[LOAD_FIRST_TOUCH_MAJFLT] = phases.first_touch_majflt;
+    out[LOAD_BYTES] = phases.bytes;
+    out[LOAD_RESIDENT] = phases.resident ? 1 : 0;
+    out[LOAD_EXTRACTED] = phases.extracted ? 1 : 0;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "llama.cpp/include/llama.h"
+
+// Loads GGUF models through the model registry from an (fd, offset, length) region,
+// e.g. an uncompressed APK asset from AssetFileDescriptor or a plain file on a host.
+//
+// A region covering the whole file is loaded in place through /proc/self/fd, so the
+// weights are mmapped straight from the file without a copy. llama.cpp only loads
+// from a path, so a region embedded at an offset (APK assets) is extracted once to
+// the cache directory and loaded from there on every later run. Only the copy of the
+// model being loaded is kept; loading another asset extracts that one in its place.
+
+// Wall time of each load phase, so cold and warm loads can be compared. Mapping and
+// paging in the weights happen inside llama.cpp, so its load progress reports split
+// tensor setup from the mapping, and the first decode on the new context (see
+// measure_first_touch) is what pages the weights in.
+struct load_phases {
+    int64_t t_open_us = 0;          // resolve the region to a loadable file (incl. extraction)
+    int64_t t_tensor_setup_us = 0;  // llama.cpp metadata parse, tensor creation and mmap of the
+                                    // file, up to its first load progress report
+    int64_t t_mmap_us = 0;          // tensors bound to that mapping (mlocked or copied to offload
+                                    // buffers as configured), up to its last progress report
+    int64_t t_first_touch_us = 0;   // first decode, which faults the weights in
+    int64_t first_touch_majflt = 0; // major page faults of the process during that decode
+    int64_t bytes = 0;              // size of the GGUF region
+    bool resident = false;          // model was already resident in the registry
+    bool extracted = false;         // region was copied out of its container on this load
+};
+
+// Layout of the long[] load phases array returned to Kotlin (ModelLoadMetrics)
+enum load_phase_index {
+    LOAD_T_OPEN_US = 0,
+    LOAD_T_TENSOR_SETUP_US,
+    LOAD_T_MMAP_US,
+    LOAD_T_FIRST_TOUCH_US,
+    LOAD_FIRST_TOUCH_MAJFLT,
+    LOAD_BYTES,
+    LOAD_RESIDENT,
+    LOAD_EXTRACTED,
+    LOAD_PHASE_COUNT
+};
+
+// Loads the GGUF stored at [offset, offset + length) of `fd`. A length <= 0 means up
+// to the end of the file. `cache_dir` receives extracted copies of embedded regions.
+// The caller keeps ownership of `fd`; the returned model is released via the registry.
+llama_model* load_model_from_fd(int fd, int64_t offset, int64_t length,
+                                const std::string& cache_dir,
+                                const llama_model_params& params,
+                                load_phases& phases);
+
+// Loads a model file by path with the same phase accounting
+llama_model* load_model_from_path(const std::string& path,
+                                  const llama_model_params& params,
+                                  load_phases& phases);
+
+void fill_load_phases(const load_phases& phases, int64_t* out);
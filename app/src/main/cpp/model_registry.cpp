@@ -0,0 +1,163 @@
+#include "model_registry.h"
+
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include "native_log.h"
+
+namespace {
+
+// Load parameters a resident model was created with that a caller cannot override
+// afterwards: where its layers live, whether its weights are mapped and whether they are locked
+std::string params_key(const llama_model_params& params) {
+    return "|ngl=" + std::to_string(params.n_gpu_layers) +
+        "|mmap=" + (params.use_mmap ? "1" : "0") +
+        "|mlock=" + (params.use_mlock ? "1" : "0");
+}
+
+} // namespace
+
+model_registry& model_registry::instance() {
+    static model_registry registry;
+    return registry;
+}
+
+void model_registry::backend_acquire() {
+    std::lock_guard<std::mutex> lock(mutex);
+    backend_acquire_locked();
+}
+
+void model_registry::backend_release() {
+    std::lock_guard<std::mutex> lock(mutex);
+    backend_release_locked();
+}
+
+void model_registry::backend_acquire_locked() {
+    if (backend_refs++ == 0) {
+        llama_backend_init();
+        LOGD("llama backend initialized");
+    }
+}
+
+void model_registry::backend_release_locked() {
+    if (backend_refs > 0 && --backend_refs == 0) {
+        llama_backend_free();
+        LOGD("llama backend freed");
+    }
+}
+
+llama_model* model_registry::acquire(const std::string& path, const llama_model_params& params) {
+    return acquire(path, path, params, nullptr);
+}
+
+llama_model* model_registry::acquire(const std::string& key, const std::string& path,
+                                     const llama_model_params& params, bool* loaded) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (loaded) *loaded = false;
+
+    const std::string full_key = key + params_key(params);
+    for (entry& e : entries) {
+        if (e.key == full_key) {
+            e.refs++;
+            e.last_used = ++use_clock;
+            LOGD("Model already resident: %s (%zu MB)", e.path.c_str(), e.bytes >> 20);
+            return e.model;
+        }
+        if (e.key.compare(0, key.size() + 1, key + "|") == 0) {
+            LOGW("Model %s is resident with other load params (%s), loading it again with %s",
+                 path.c_str(), e.key.c_str() + key.size() + 1, full_key.c_str() + key.size() + 1);
+        }
+    }
+
+    // Make room using the file size as the estimate until the real size is known
+    struct stat st = {};
+    size_t estimate = stat(path.c_str(), &st) == 0 ? (size_t) st.st_size : 0;
+    if (budget_bytes > 0) evict_locked(estimate, budget_bytes);
+
+    backend_acquire_locked();
+    auto t_start = std::chrono::steady_clock::now();
+    llama_model* model = llama_model_load_from_file(path.c_str(), params);
+    if (!model) {
+        backend_release_locked();
+        return nullptr;
+    }
+    auto t_load = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - t_start).count();
+
+    entry e;
+    e.key = full_key;
+    e.path = path;
+    e.model = model;
+    e.bytes = llama_model_size(model);
+    e.refs = 1;
+    e.last_used = ++use_clock;
+    entries.push_back(e);
+
+    LOGD("Loaded model %s (%zu MB) in %lld ms, %zu models resident",
+         path.c_str(), e.bytes >> 20, (long long) t_load, entries.size());
+    if (loaded) *loaded = true;
+    return model;
+}
+
+void model_registry::release(llama_model* model) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (entry& e : entries) {
+        if (e.model == model) {
+            if (e.refs > 0) e.refs--;
+            e.last_used = ++use_clock;
+            break;
+        }
+    }
+    if (budget_bytes > 0) evict_locked(0, budget_bytes);
+}
+
+void model_registry::set_budget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budget_bytes = bytes;
+    if (budget_bytes > 0) evict_locked(0, budget_bytes);
+}
+
+size_t model_registry::get_budget() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return budget_bytes;
+}
+
+size_t model_registry::resident_bytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t total = 0;
+    for (const entry& e : entries) {
+        total += e.bytes;
+    }
+    return total;
+}
+
+void model_registry::evict_unused() {
+    std::lock_guard<std::mutex> lock(mutex);
+    evict_locked(0, 0);
+}
+
+// Free unreferenced models, oldest first, until resident + incoming fits the limit.
+// Models with live contexts are never evicted, so the limit can be exceeded by them.
+void model_registry::evict_locked(size_t incoming_bytes, size_t limit_bytes) {
+    size_t total = incoming_bytes;
+    for (const entry& e : entries) {
+        total += e.bytes;
+    }
+
+    while (total > limit_bytes) {
+        auto victim = entries.end();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->refs == 0 && (victim == entries.end() || it->last_used < victim->last_used)) {
+                victim = it;
+            }
+        }
+        if (victim == entries.end()) break;
+
+        LOGD("Evicting model %s (%zu MB)", victim->path.c_str(), victim->bytes >> 20);
+        total -= victim->bytes;
+        llama_model_free(victim->model);
+        entries.erase(victim);
+        backend_release_locked();
+    }
+}
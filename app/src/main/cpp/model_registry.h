@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "llama.cpp/include/llama.h"
+
+// Process-wide owner of the llama backend and of loaded models.
+//
+// The backend is initialized on the first acquire and freed when nothing holds it
+// any more; each resident model holds one reference. Models are keyed by path and
+// by the load parameters that change what is resident (n_gpu_layers, use_mmap,
+// use_mlock), and stay resident after their last context is freed, so switching back
+// to a recently used quantization does not reload it from flash. Unreferenced
+// models are evicted least-recently-used first whenever the resident total would
+// exceed the memory budget.
+class model_registry {
+public:
+    static model_registry& instance();
+
+    // Refcounted llama_backend_init / llama_backend_free
+    void backend_acquire();
+    void backend_release();
+
+    // Returns a resident model for `path`, loading it if needed. Each successful
+    // acquire must be paired with release(). Returns nullptr if loading fails.
+    llama_model* acquire(const std::string& path, const llama_model_params& params);
+
+    // Same, but resident models are looked up by `key` so one file reached through
+    // different paths (fd links, extracted copies) is loaded once. `loaded` is set
+    // to whether this call had to load the model.
+    llama_model* acquire(const std::string& key, const std::string& path,
+                         const llama_model_params& params, bool* loaded);
+    void release(llama_model* model);
+
+    // Budget for resident model weights in bytes; 0 disables eviction
+    void set_budget(size_t bytes);
+    size_t get_budget();
+    size_t resident_bytes();
+
+    // Frees every resident model that has no context attached
+    void evict_unused();
+
+private:
+    struct entry {
+        std::string key;
+        std::string path;
+        llama_model* model;
+        size_t bytes;
+        int refs;
+        uint64_t last_used;
+    };
+
+    model_registry() = default;
+
+    void evict_locked(size_t incoming_bytes, size_t limit_bytes);
+    void backend_acquire_locked();
+    void backend_release_locked();
+
+    std::mutex mutex;
+    std::vector<entry> entries;
+    int backend_refs = 0;
+    size_t budget_bytes = 1024ull * 1024 * 1024;
+    uint64_t use_clock = 0;
+};
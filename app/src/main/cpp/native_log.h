@@ -0,0 +1,38 @@
+#pragma once
+
+// Logging shared by the native sources: logcat under one tag on Android, stderr on
+// a host build. Host debug logging is compiled in but disabled unless the build
+// defines LLM_LOG_DEBUG=1, so llm-bench output stays readable.
+#if defined(__ANDROID__)
+
+#include <android/log.h>
+
+#define TAG "LLamaJNI"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+#else
+
+#include <cstdarg>
+#include <cstdio>
+
+#ifndef LLM_LOG_DEBUG
+#define LLM_LOG_DEBUG 0
+#endif
+
+inline void native_log_host(const char* level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+inline void native_log_host(const char* level, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "[%s] ", level);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+#define LOGD(...) do { if (LLM_LOG_DEBUG) native_log_host("D", __VA_ARGS__); } while (0)
+#define LOGW(...) native_log_host("W", __VA_ARGS__)
+#define LOGE(...) native_log_host("E", __VA_ARGS__)
+
+#endif
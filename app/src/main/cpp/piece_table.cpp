@@ -0,0 +1,47 @@
+#include "piece_table.h"
+
+#include <algorithm>
+
+void piece_table::build(const llama_vocab* vocab) {
+    const int32_t n_vocab = llama_vocab_n_tokens(vocab);
+    chars.clear();
+    offsets.clear();
+    max_piece = 0;
+    // Most pieces are a few bytes; the arena grows past this only for long vocabularies
+    chars.reserve((size_t) n_vocab * 8);
+    offsets.reserve(n_vocab + 1);
+    offsets.push_back(0);
+
+    char buf[256];
+    std::vector<char> large;
+    for (llama_token token = 0; token < n_vocab; token++) {
+        int n = llama_token_to_piece(vocab, token, buf, sizeof(buf), 0, false);
+        const char* piece = buf;
+        if (n < 0) {
+            large.resize(-n);
+            n = llama_token_to_piece(vocab, token, large.data(), large.size(), 0, false);
+            piece = large.data();
+        }
+        if (n > 0) {
+            chars.insert(chars.end(), piece, piece + n);
+            max_piece = std::max(max_piece, (size_t) n);
+        }
+        offsets.push_back(chars.size());
+    }
+    chars.shrink_to_fit();
+    n_tokens = n_vocab;
+}
+
+size_t utf8_complete_prefix(const char* text, size_t n) {
+    // Walk back over continuation bytes (10xxxxxx) to the last lead byte
+    size_t i = n;
+    while (i > 0 && n - i < 4) {
+        const unsigned char c = text[i - 1];
+        if ((c & 0xC0) != 0x80) {
+            const size_t len = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+            return n - (i - 1) < len ? i - 1 : n;
+        }
+        i--;
+    }
+    return n;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "llama.cpp/include/llama.h"
+
+// Length of the longest prefix of text[0, n) that does not end inside a UTF-8
+// sequence. Byte-level BPE vocabularies split multibyte characters across tokens,
+// so streamed chunks are cut here and the remainder goes out with the next one.
+// Malformed input is passed through rather than held back.
+size_t utf8_complete_prefix(const char* text, size_t n);
+
+// Destination of generated text: a std::string that grows as needed, or a fixed
+// caller-owned buffer (a direct ByteBuffer) that pieces are written into in place
+class text_sink {
+public:
+    explicit text_sink(std::string& str) : str_(&str) {}
+    text_sink(char* data, size_t capacity) : data_(data), capacity_(capacity) {}
+
+    const char* data() const { return str_ ? str_->data() : data_; }
+    size_t size() const { return str_ ? str_->size() : size_; }
+    bool full() const { return full_; }
+    void reserve(size_t n) { if (str_) str_->reserve(n); }
+    // Drops the text from byte n on
+    void truncate(size_t n) { if (str_) str_->resize(n); else size_ = n; }
+
+    // Appends text[0, n). A fixed buffer without room for all of it takes the whole
+    // UTF-8 characters that fit, becomes full and returns false.
+    bool append(const char* text, size_t n) {
+        if (str_) {
+            str_->append(text, n);
+            return true;
+        }
+        if (n > capacity_ - size_) {
+            n = utf8_complete_prefix(text, capacity_ - size_);
+            full_ = true;
+        }
+        memcpy(data_ + size_, text, n);
+        size_ += n;
+        return !full_;
+    }
+
+private:
+    std::string* str_ = nullptr;
+    char* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+    bool full_ = false;
+};
+
+// Text of every vocabulary token, rendered once when the context is created and kept
+// back to back in one char arena. Detokenizing a generated token is then a bounds
+// check and a memcpy into the caller's buffer instead of a llama_token_to_piece call
+// into a freshly allocated string.
+class piece_table {
+public:
+    // Renders all tokens of `vocab` the way token_to_piece does (no special tokens,
+    // no leading space stripping)
+    void build(const llama_vocab* vocab);
+
+    // Appends the text of `token` to `out`; unknown ids append nothing
+    void append(llama_token token, std::string& out) const {
+        if ((uint32_t) token >= n_tokens) return;
+        out.append(chars.data() + offsets[token], offsets[token + 1] - offsets[token]);
+    }
+
+    // Same into a text sink; false once a fixed buffer is full
+    bool append(llama_token token, text_sink& out) const {
+        if ((uint32_t) token >= n_tokens) return true;
+        return out.append(chars.data() + offsets[token], offsets[token + 1] - offsets[token]);
+    }
+
+    bool empty() const { return n_tokens == 0; }
+    uint32_t size() const { return n_tokens; }
+    size_t bytes() const { return chars.capacity() + offsets.capacity() * sizeof(uint32_t); }
+    size_t max_piece_bytes() const { return max_piece; }
+
+private:
+    uint32_t n_tokens = 0;
+    size_t max_piece = 0;
+    std::vector<char> chars;
+    std::vector<uint32_t> offsets;  // token i spans chars[offsets[i], offsets[i + 1])
+};
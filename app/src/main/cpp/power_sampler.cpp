@@ -0,0 +1,154 @@
+#include "power_sampler.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+#include "native_log.h"
+
+namespace {
+
+int64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// sysfs attributes regenerate their contents on every read at offset 0
+bool read_int_fd(int fd, int64_t& value) {
+    char buf[32];
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return false;
+    buf[n] = '\0';
+    value = std::strtoll(buf, nullptr, 10);
+    return true;
+}
+
+} // namespace
+
+power_sampler::~power_sampler() {
+    stop();
+}
+
+bool power_sampler::start(const std::string& supply_dir, int rate_hz, int64_t current_scale) {
+    stop();
+
+    fd_current_ = open((supply_dir + "/current_now").c_str(), O_RDONLY | O_CLOEXEC);
+    fd_voltage_ = open((supply_dir + "/voltage_now").c_str(), O_RDONLY | O_CLOEXEC);
+    current_scale_ = current_scale > 0 ? current_scale : 1;
+    int64_t probe;
+    if (fd_current_ < 0 || fd_voltage_ < 0 || !read_power(probe)) {
+        LOGE("Cannot read current_now/voltage_now in %s", supply_dir.c_str());
+        stop();
+        return false;
+    }
+
+    rate_hz = std::max(1, std::min(rate_hz, 1000));
+    head_.store(0, std::memory_order_relaxed);
+    running_.store(true, std::memory_order_release);
+    thread_ = std::thread(&power_sampler::run, this, 1000000000LL / rate_hz);
+
+    LOGD("Power sampler started on %s at %d Hz", supply_dir.c_str(), rate_hz);
+    return true;
+}
+
+void power_sampler::stop() {
+    running_.store(false, std::memory_order_release);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (fd_current_ >= 0) close(fd_current_);
+    if (fd_voltage_ >= 0) close(fd_voltage_);
+    fd_current_ = -1;
+    fd_voltage_ = -1;
+}
+
+bool power_sampler::read_power(int64_t& power_uw) {
+    int64_t current, voltage;
+    if (!read_int_fd(fd_current_, current) || !read_int_fd(fd_voltage_, voltage)) return false;
+    // uA * uV = pW; discharge current is negative on many devices
+    power_uw = std::llabs(current * current_scale_) * voltage / 1000000;
+    return true;
+}
+
+void power_sampler::run(int64_t period_ns) {
+    auto next = std::chrono::steady_clock::now();
+    while (running_.load(std::memory_order_acquire)) {
+        int64_t power_uw;
+        const int64_t t = steady_ns();
+        if (read_power(power_uw)) {
+            const uint64_t h = head_.load(std::memory_order_relaxed);
+            slot& s = ring_[h % RING_CAPACITY];
+            s.t_ns.store(t, std::memory_order_relaxed);
+            s.power_uw.store(power_uw, std::memory_order_relaxed);
+            head_.store(h + 1, std::memory_order_release);
+        }
+        next += std::chrono::nanoseconds(period_ns);
+        std::this_thread::sleep_until(next);
+    }
+}
+
+bool power_sampler::latest(sample& out) const {
+    const uint64_t h = head_.load(std::memory_order_acquire);
+    if (h == 0) return false;
+    const slot& s = ring_[(h - 1) % RING_CAPACITY];
+    out.t_ns = s.t_ns.load(std::memory_order_relaxed);
+    out.power_uw = s.power_uw.load(std::memory_order_relaxed);
+    return true;
+}
+
+int64_t power_sampler::energy_uj(int64_t t0_ns, int64_t t1_ns, int* n_samples) const {
+    if (n_samples) *n_samples = 0;
+    if (t1_ns <= t0_ns) return 0;
+
+    // Copy the samples covering the window, newest first, plus one on each side of it
+    const uint64_t h = head_.load(std::memory_order_acquire);
+    const uint64_t oldest = h > RING_CAPACITY ? h - RING_CAPACITY : 0;
+    std::vector<sample> window;
+    for (uint64_t i = h; i > oldest; i--) {
+        const slot& s = ring_[(i - 1) % RING_CAPACITY];
+        sample smp = {s.t_ns.load(std::memory_order_relaxed), s.power_uw.load(std::memory_order_relaxed)};
+        window.push_back(smp);
+        if (smp.t_ns < t0_ns) break;
+    }
+
+    // Slots the writer lapped while we were copying hold newer data; drop them
+    const uint64_t h_after = head_.load(std::memory_order_acquire);
+    const uint64_t overwritten = h_after - h;
+    if (overwritten > 0) {
+        const size_t valid = (size_t) std::max<int64_t>(0, (int64_t) (RING_CAPACITY - overwritten));
+        if (window.size() > valid) window.resize(valid);
+    }
+    if (window.empty()) return 0;
+    std::reverse(window.begin(), window.end());
+
+    // Power at any time: linear between samples, flat beyond the first and last one
+    auto power_at = [&](int64_t t) -> double {
+        if (t <= window.front().t_ns) return (double) window.front().power_uw;
+        if (t >= window.back().t_ns) return (double) window.back().power_uw;
+        auto it = std::upper_bound(window.begin(), window.end(), t,
+                                   [](int64_t v, const sample& s) { return v < s.t_ns; });
+        const sample& b = *it;
+        const sample& a = *(it - 1);
+        const double f = (double) (t - a.t_ns) / (double) (b.t_ns - a.t_ns);
+        return a.power_uw + f * (b.power_uw - a.power_uw);
+    };
+
+    double energy = 0.0;                // uW * ns
+    int64_t t_prev = t0_ns;
+    double p_prev = power_at(t0_ns);
+    int inside = 0;
+    for (const sample& s : window) {
+        if (s.t_ns <= t0_ns) continue;
+        if (s.t_ns >= t1_ns) break;
+        energy += 0.5 * (p_prev + s.power_uw) * (double) (s.t_ns - t_prev);
+        t_prev = s.t_ns;
+        p_prev = (double) s.power_uw;
+        inside++;
+    }
+    energy += 0.5 * (p_prev + power_at(t1_ns)) * (double) (t1_ns - t_prev);
+
+    if (n_samples) *n_samples = inside;
+    return (int64_t) (energy / 1e9);    // uW * s = uJ
+}
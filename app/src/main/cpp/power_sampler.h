@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+// Samples battery power from a power_supply sysfs directory on a background thread
+// and integrates energy over arbitrary time windows, so each generation can be
+// charged for the joules it drew. The directory is injectable: on a host it can be
+// /sys/class/power_supply/BAT0 or a directory holding synthetic files.
+//
+// Each sample reads <dir>/current_now (uA, sign ignored) and <dir>/voltage_now (uV).
+// Samples go into a single-producer ring buffer that readers scan without locking;
+// a window older than the ring (capacity / rate seconds) only sees what is left.
+class power_sampler {
+public:
+    struct sample {
+        int64_t t_ns;               // steady clock, same timebase as now_ns()
+        int64_t power_uw;
+    };
+
+    static constexpr int RING_CAPACITY = 8192;  // 82 s at 100 Hz
+
+    power_sampler() = default;
+    ~power_sampler();
+    power_sampler(const power_sampler&) = delete;
+    power_sampler& operator=(const power_sampler&) = delete;
+
+    // Starts sampling `supply_dir` at `rate_hz` (clamped to 1..1000); restarts if
+    // already running. `current_scale` converts current_now to uA for drivers that
+    // report other units (e.g. 1000 for mA). Returns false if the files cannot be read.
+    bool start(const std::string& supply_dir, int rate_hz, int64_t current_scale = 1);
+    void stop();
+    bool running() const { return running_.load(std::memory_order_acquire); }
+
+    // Energy drawn between t0_ns and t1_ns in microjoules, integrating the piecewise
+    // linear power curve through the samples and holding the edge samples flat.
+    // n_samples (optional) receives the number of samples inside the window.
+    int64_t energy_uj(int64_t t0_ns, int64_t t1_ns, int* n_samples = nullptr) const;
+
+    // Most recent sample; false if none was taken yet
+    bool latest(sample& out) const;
+
+private:
+    struct slot {
+        std::atomic<int64_t> t_ns{0};
+        std::atomic<int64_t> power_uw{0};
+    };
+
+    void run(int64_t period_ns);
+    bool read_power(int64_t& power_uw);
+
+    slot ring_[RING_CAPACITY];
+    std::atomic<uint64_t> head_{0};     // samples written so far
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    int fd_current_ = -1;
+    int fd_voltage_ = -1;
+    int64_t current_scale_ = 1;
+};
@@ -0,0 +1,411 @@
+#include "proc_sampler.h"
+
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "native_log.h"
+
+namespace {
+
+int64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Reads a whole (small) proc or sysfs file from offset 0; both regenerate on every read
+ssize_t pread_text(int fd, char* buf, size_t size) {
+    const ssize_t n = pread(fd, buf, size - 1, 0);
+    buf[n > 0 ? n : 0] = '\0';
+    return n;
+}
+
+// Parses an unsigned decimal at p, skipping leading blanks, and advances p past it
+int64_t parse_uint(const char*& p) {
+    while (*p == ' ' || *p == '\t') p++;
+    int64_t v = 0;
+    while (*p >= '0' && *p <= '9') {
+        v = v * 10 + (*p++ - '0');
+    }
+    return v;
+}
+
+// Layout of the records getdents64 fills in
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+} // namespace
+
+proc_stat_reader::~proc_stat_reader() {
+    close();
+}
+
+bool proc_stat_reader::open(const std::string& proc_root) {
+    close();
+    fd_ = ::open((proc_root + "/stat").c_str(), O_RDONLY | O_CLOEXEC);
+    return fd_ >= 0;
+}
+
+void proc_stat_reader::close() {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+}
+
+int proc_stat_reader::read(cpu_times& all, cpu_times* cores, int max_cores) {
+    if (fd_ < 0 || pread_text(fd_, buf_, sizeof(buf_)) <= 0) return -1;
+
+    // "cpu[N] user nice system idle iowait irq softirq steal guest guest_nice"
+    int n_cores = 0;
+    const char* p = buf_;
+    while (std::strncmp(p, "cpu", 3) == 0) {
+        p += 3;
+        const bool aggregate = *p == ' ';
+        const int id = aggregate ? -1 : (int) parse_uint(p);
+        int64_t v[8] = {};
+        for (int k = 0; k < 8; k++) {
+            v[k] = parse_uint(p);
+        }
+        // guest time is already part of user time, so it is not added again
+        int64_t total = 0;
+        for (int64_t x : v) total += x;
+        const cpu_times t = {total - v[3] - v[4], total};
+        if (aggregate) {
+            all = t;
+        } else if (id < max_cores) {
+            cores[id] = t;
+            n_cores = std::max(n_cores, id + 1);
+        }
+        const char* eol = std::strchr(p, '\n');
+        if (!eol) break;
+        p = eol + 1;
+    }
+    return n_cores;
+}
+
+proc_sampler::~proc_sampler() {
+    stop();
+}
+
+bool proc_sampler::start(int rate_hz, const std::string& proc_root, const std::string& cpu_root) {
+    stop();
+
+    cpu_times all;
+    cpu_times cores[MAX_CPUS];
+    if (!stat_.open(proc_root) || (n_cpus_ = stat_.read(all, cores, MAX_CPUS)) <= 0) {
+        LOGE("Cannot read %s/stat", proc_root.c_str());
+        close_files();
+        n_cpus_ = 0;
+        return false;
+    }
+
+    proc_root_ = proc_root;
+    char path[256];
+    for (int c = 0; c < MAX_CPUS; c++) {
+        freq_fd_[c] = -1;
+        if (c >= n_cpus_) continue;
+        std::snprintf(path, sizeof(path), "%s/cpu%d/cpufreq/scaling_cur_freq", cpu_root.c_str(), c);
+        freq_fd_[c] = ::open(path, O_RDONLY | O_CLOEXEC);
+    }
+    task_fd_ = ::open((proc_root + "/self/task").c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    const long ticks = sysconf(_SC_CLK_TCK);
+    ns_per_tick_ = ticks > 0 ? 1000000000LL / ticks : 10000000;
+
+    {
+        std::lock_guard<std::mutex> lock(ring_mutex_);
+        ring_.assign(RING_CAPACITY, frame());
+        head_ = 0;
+    }
+    sample_ns_total_.store(0);
+    n_samples_.store(0);
+
+    rate_hz = std::max(1, std::min(rate_hz, 1000));
+    running_.store(true, std::memory_order_release);
+    sample_now();
+    thread_ = std::thread(&proc_sampler::run, this, 1000000000LL / rate_hz);
+
+    LOGD("CPU sampler started: %d cores, %s at %d Hz", n_cpus_,
+         task_fd_ >= 0 ? "per-thread times" : "no per-thread times", rate_hz);
+    return true;
+}
+
+void proc_sampler::stop() {
+    running_.store(false, std::memory_order_release);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    std::lock_guard<std::mutex> lock(collect_mutex_);
+    close_files();
+}
+
+void proc_sampler::close_files() {
+    stat_.close();
+    for (int c = 0; c < n_cpus_; c++) {
+        if (freq_fd_[c] >= 0) ::close(freq_fd_[c]);
+    }
+    std::fill(freq_fd_, freq_fd_ + MAX_CPUS, -1);
+    for (thread_slot& slot : threads_) {
+        if (slot.fd >= 0) ::close(slot.fd);
+        slot = thread_slot();
+    }
+    if (task_fd_ >= 0) ::close(task_fd_);
+    task_fd_ = -1;
+}
+
+void proc_sampler::run(int64_t period_ns) {
+    auto next = std::chrono::steady_clock::now();
+    while (running_.load(std::memory_order_acquire)) {
+        next += std::chrono::nanoseconds(period_ns);
+        std::this_thread::sleep_until(next);
+        sample_now();
+    }
+}
+
+void proc_sampler::sample_now() {
+    if (!running()) return;
+    std::lock_guard<std::mutex> collect_lock(collect_mutex_);
+
+    const int64_t t_begin = steady_ns();
+    collect(scratch_);
+    {
+        std::lock_guard<std::mutex> lock(ring_mutex_);
+        ring_[head_ % RING_CAPACITY] = scratch_;
+        head_++;
+    }
+    sample_ns_total_.fetch_add(steady_ns() - t_begin, std::memory_order_relaxed);
+    n_samples_.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Registers new threads of the process and closes the files of the ones that exited
+void proc_sampler::scan_threads() {
+    for (thread_slot& slot : threads_) {
+        slot.seen = false;
+    }
+
+    lseek(task_fd_, 0, SEEK_SET);
+    char path[64];
+    long n;
+    while ((n = syscall(SYS_getdents64, task_fd_, dirents_, sizeof(dirents_))) > 0) {
+        for (long off = 0; off < n;) {
+            const linux_dirent64* entry = (const linux_dirent64*) (dirents_ + off);
+            off += entry->d_reclen;
+            const char* name = entry->d_name;
+            if (*name < '0' || *name > '9') continue;
+            const int tid = (int) parse_uint(name);
+
+            thread_slot* free_slot = nullptr;
+            thread_slot* match = nullptr;
+            for (thread_slot& slot : threads_) {
+                if (slot.tid == tid) {
+                    match = &slot;
+                    break;
+                }
+                if (!free_slot && slot.tid == 0) free_slot = &slot;
+            }
+            if (!match && free_slot) {
+                std::snprintf(path, sizeof(path), "%d/schedstat", tid);
+                free_slot->fd = openat(task_fd_, path, O_RDONLY | O_CLOEXEC);
+                free_slot->schedstat = free_slot->fd >= 0;
+                if (free_slot->fd < 0) {
+                    std::snprintf(path, sizeof(path), "%d/stat", tid);
+                    free_slot->fd = openat(task_fd_, path, O_RDONLY | O_CLOEXEC);
+                }
+                if (free_slot->fd >= 0) {
+                    free_slot->tid = tid;
+                    match = free_slot;
+                }
+            }
+            if (match) match->seen = true;
+        }
+    }
+
+    for (thread_slot& slot : threads_) {
+        if (slot.tid != 0 && !slot.seen) {
+            ::close(slot.fd);
+            slot = thread_slot();
+        }
+    }
+}
+
+void proc_sampler::collect(frame& f) {
+    f.t_ns = steady_ns();
+
+    cpu_times all;
+    std::fill(f.cpu, f.cpu + MAX_CPUS, cpu_times{0, 0});
+    stat_.read(all, f.cpu, n_cpus_);
+
+    char buf[512];
+    for (int c = 0; c < MAX_CPUS; c++) {
+        f.freq_khz[c] = freq_fd_[c] >= 0 && pread_text(freq_fd_[c], buf, sizeof(buf)) > 0
+            ? std::strtoll(buf, nullptr, 10) : 0;
+    }
+
+    if (task_fd_ >= 0) scan_threads();
+    for (int i = 0; i < MAX_THREADS; i++) {
+        const thread_slot& slot = threads_[i];
+        f.tid[i] = 0;
+        f.thread_ns[i] = 0;
+        if (slot.tid == 0 || pread_text(slot.fd, buf, sizeof(buf)) <= 0) continue;
+
+        f.tid[i] = slot.tid;
+        if (slot.schedstat) {
+            // "<runtime ns> <wait ns> <timeslices>"
+            const char* p = buf;
+            f.thread_ns[i] = parse_uint(p);
+        } else {
+            // utime and stime are fields 14 and 15; comm (field 2) may contain spaces
+            const char* p = std::strrchr(buf, ')');
+            if (!p) continue;
+            p += 2;
+            for (int field = 3; field < 14 && *p; field++) {
+                p = std::strchr(p, ' ');
+                if (!p) break;
+                p++;
+            }
+            if (!p) continue;
+            const int64_t utime = parse_uint(p);
+            const int64_t stime = parse_uint(p);
+            f.thread_ns[i] = (utime + stime) * ns_per_tick_;
+        }
+    }
+}
+
+void proc_sampler::read_comm(int tid, char* name, size_t size) const {
+    name[0] = '\0';
+    char path[256];
+    std::snprintf(path, sizeof(path), "%s/self/task/%d/comm", proc_root_.c_str(), tid);
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    const ssize_t n = pread_text(fd, name, size);
+    ::close(fd);
+    if (n > 0 && name[n - 1] == '\n') name[n - 1] = '\0';
+}
+
+bool proc_sampler::usage(int64_t t0_ns, int64_t t1_ns, window& out) const {
+    out = window();
+    {
+        std::lock_guard<std::mutex> lock(ring_mutex_);
+        if (head_ < 2) return false;
+        const uint64_t oldest = head_ > RING_CAPACITY ? head_ - RING_CAPACITY : 0;
+
+        uint64_t ia = oldest;
+        uint64_t ib = head_ - 1;
+        for (uint64_t i = head_; i > oldest; i--) {
+            if (ring_[(i - 1) % RING_CAPACITY].t_ns <= t0_ns) {
+                ia = i - 1;
+                break;
+            }
+        }
+        for (uint64_t i = ia; i < head_; i++) {
+            if (ring_[i % RING_CAPACITY].t_ns >= t1_ns) {
+                ib = i;
+                break;
+            }
+        }
+        if (ib <= ia) return false;
+
+        const frame& a = ring_[ia % RING_CAPACITY];
+        const frame& b = ring_[ib % RING_CAPACITY];
+        out.n_frames = (int) (ib - ia + 1);
+        out.n_cpus = n_cpus_;
+
+        int n_online = 0;
+        int64_t util_sum = 0;
+        for (int c = 0; c < n_cpus_; c++) {
+            const int64_t total = b.cpu[c].total - a.cpu[c].total;
+            const int64_t busy = b.cpu[c].busy - a.cpu[c].busy;
+            if (total > 0) {
+                out.util_permille[c] = (int) (busy * 1000 / total);
+                util_sum += out.util_permille[c];
+                n_online++;
+            }
+            int64_t freq_sum = 0;
+            for (uint64_t i = ia; i <= ib; i++) {
+                freq_sum += ring_[i % RING_CAPACITY].freq_khz[c];
+            }
+            out.freq_khz[c] = freq_sum / out.n_frames;
+        }
+        out.util_mean_permille = n_online > 0 ? (int) (util_sum / n_online) : 0;
+
+        // A slot keeps its tid until the thread exits, so a different tid in `a`
+        // means the thread started inside the window and all its time counts
+        for (int i = 0; i < MAX_THREADS; i++) {
+            if (b.tid[i] == 0) continue;
+            const int64_t before = a.tid[i] == b.tid[i] ? a.thread_ns[i] : 0;
+            const int64_t cpu_us = (b.thread_ns[i] - before) / 1000;
+            if (cpu_us <= 0) continue;
+            out.process_cpu_us += cpu_us;
+            out.n_active_threads++;
+
+            // Insertion into the descending top list
+            int pos = std::min(out.n_top, TOP_THREADS);
+            while (pos > 0 && out.top[pos - 1].cpu_us < cpu_us) {
+                if (pos < TOP_THREADS) out.top[pos] = out.top[pos - 1];
+                pos--;
+            }
+            if (pos < TOP_THREADS) {
+                out.top[pos] = thread_usage{b.tid[i], cpu_us, {}};
+                out.n_top = std::min(out.n_top + 1, TOP_THREADS);
+            }
+        }
+    }
+
+    for (int i = 0; i < out.n_top; i++) {
+        read_comm(out.top[i].tid, out.top[i].name, sizeof(out.top[i].name));
+    }
+    return true;
+}
+
+void proc_sampler::series(int64_t t0_ns, int64_t t1_ns, std::vector<point>& out) const {
+    out.clear();
+    std::lock_guard<std::mutex> lock(ring_mutex_);
+    const uint64_t oldest = head_ > RING_CAPACITY ? head_ - RING_CAPACITY : 0;
+    for (uint64_t i = oldest + 1; i < head_; i++) {
+        const frame& prev = ring_[(i - 1) % RING_CAPACITY];
+        const frame& f = ring_[i % RING_CAPACITY];
+        if (f.t_ns < t0_ns) continue;
+        if (f.t_ns > t1_ns) break;
+
+        point pt = {};
+        pt.t_ns = f.t_ns;
+        for (int c = 0; c < n_cpus_; c++) {
+            const int64_t total = f.cpu[c].total - prev.cpu[c].total;
+            pt.util_permille[c] = total > 0 ? (int) ((f.cpu[c].busy - prev.cpu[c].busy) * 1000 / total) : 0;
+            pt.freq_khz[c] = f.freq_khz[c];
+        }
+        out.push_back(pt);
+    }
+}
+
+int64_t proc_sampler::mean_sample_ns() const {
+    const int64_t n = n_samples_.load(std::memory_order_relaxed);
+    return n > 0 ? sample_ns_total_.load(std::memory_order_relaxed) / n : 0;
+}
+
+std::string describe_cpu_window(const proc_sampler::window& w) {
+    if (w.n_frames == 0) return "no samples\n";
+
+    std::string out;
+    char line[160];
+    std::snprintf(line, sizeof(line), "cpu %.1f%% mean, process %.1f ms on %d threads (%d samples)\n",
+                  w.util_mean_permille / 10.0, w.process_cpu_us / 1000.0, w.n_active_threads, w.n_frames);
+    out += line;
+    for (int c = 0; c < w.n_cpus; c++) {
+        std::snprintf(line, sizeof(line), "  cpu%-2d %5.1f%% %6lld MHz\n",
+                      c, w.util_permille[c] / 10.0, (long long) (w.freq_khz[c] / 1000));
+        out += line;
+    }
+    for (int i = 0; i < w.n_top; i++) {
+        std::snprintf(line, sizeof(line), "  tid %-6d %-15s %8.1f ms\n",
+                      w.top[i].tid, w.top[i].name[0] ? w.top[i].name : "?", w.top[i].cpu_us / 1000.0);
+        out += line;
+    }
+    return out;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Per-core busy/total jiffies read from <proc_root>/stat. The file stays open and is
+// re-read with pread into a fixed buffer, so a reading allocates nothing.
+struct cpu_times {
+    int64_t busy;
+    int64_t total;
+};
+
+class proc_stat_reader {
+public:
+    proc_stat_reader() = default;
+    ~proc_stat_reader();
+    proc_stat_reader(const proc_stat_reader&) = delete;
+    proc_stat_reader& operator=(const proc_stat_reader&) = delete;
+
+    bool open(const std::string& proc_root = "/proc");
+    void close();
+
+    // Fills `all` with the aggregate line and cores[id] for each "cpuN" line with
+    // N < max_cores (offline cores are left untouched). Returns the highest core id
+    // seen plus one, or -1 if the file cannot be read.
+    int read(cpu_times& all, cpu_times* cores, int max_cores);
+
+private:
+    int fd_ = -1;
+    char buf_[4096];                // the cpu lines come first; the rest is not needed
+};
+
+// Samples per-core utilization, per-core frequency (cpufreq/scaling_cur_freq) and the
+// CPU time of every thread of this process (/proc/self/task/*/schedstat, or stat on
+// kernels without schedstats) on a background thread. Files stay open, threads are
+// enumerated with getdents64 into a fixed buffer and samples land in a preallocated
+// ring, so taking a sample does no heap allocation and no parsing beyond integers.
+//
+// Both roots are injectable so the parser can run on a host against a fake tree.
+// A window older than the ring (capacity / rate seconds) only sees what is left.
+class proc_sampler {
+public:
+    static constexpr int MAX_CPUS = 16;
+    static constexpr int MAX_THREADS = 64;  // threads beyond this are not attributed
+    static constexpr int RING_CAPACITY = 512;   // 51 s at 10 Hz
+    static constexpr int TOP_THREADS = 8;
+
+    struct thread_usage {
+        int tid;
+        int64_t cpu_us;
+        char name[16];              // comm, empty if the thread is gone
+    };
+
+    // CPU usage over a time window
+    struct window {
+        int n_frames = 0;           // samples spanning the window, 0 if none
+        int n_cpus = 0;
+        int util_permille[MAX_CPUS] = {};   // busy share of each core
+        int64_t freq_khz[MAX_CPUS] = {};    // mean scaling_cur_freq, 0 if not exposed
+        int util_mean_permille = 0;         // average over the cores that were online
+        int64_t process_cpu_us = 0;         // CPU time of the threads alive at the end of the window
+        int n_active_threads = 0;           // threads that ran during the window
+        int n_top = 0;
+        thread_usage top[TOP_THREADS] = {}; // busiest threads, descending
+    };
+
+    // One step of the per-core time series: usage since the previous sample
+    struct point {
+        int64_t t_ns;
+        int util_permille[MAX_CPUS];
+        int64_t freq_khz[MAX_CPUS];
+    };
+
+    proc_sampler() = default;
+    ~proc_sampler();
+    proc_sampler(const proc_sampler&) = delete;
+    proc_sampler& operator=(const proc_sampler&) = delete;
+
+    // Starts sampling at `rate_hz` (clamped to 1..1000); restarts if already running.
+    // Returns false if <proc_root>/stat cannot be read.
+    bool start(int rate_hz, const std::string& proc_root = "/proc",
+               const std::string& cpu_root = "/sys/devices/system/cpu");
+    void stop();
+    bool running() const { return running_.load(std::memory_order_acquire); }
+    int n_cpus() const { return n_cpus_; }
+
+    // Takes a sample on the calling thread, e.g. to close a window exactly
+    void sample_now();
+
+    // Usage between the last sample at or before t0_ns and the first one at or
+    // after t1_ns (the nearest available ones at the edges of the ring)
+    bool usage(int64_t t0_ns, int64_t t1_ns, window& out) const;
+
+    // Per-core series of the samples inside [t0_ns, t1_ns]
+    void series(int64_t t0_ns, int64_t t1_ns, std::vector<point>& out) const;
+
+    // Average cost of one sample in nanoseconds, to keep the sampler's own overhead in view
+    int64_t mean_sample_ns() const;
+
+private:
+    struct frame {
+        int64_t t_ns;
+        cpu_times cpu[MAX_CPUS];
+        int64_t freq_khz[MAX_CPUS];
+        int tid[MAX_THREADS];       // 0 for an empty slot
+        int64_t thread_ns[MAX_THREADS];
+    };
+
+    struct thread_slot {
+        int tid = 0;
+        int fd = -1;
+        bool schedstat = true;      // false: fd is <tid>/stat, times in clock ticks
+        bool seen = false;
+    };
+
+    void run(int64_t period_ns);
+    void collect(frame& f);
+    void scan_threads();
+    void close_files();
+    void read_comm(int tid, char* name, size_t size) const;
+
+    proc_stat_reader stat_;
+    std::string proc_root_;
+    int freq_fd_[MAX_CPUS];         // -1 where cpufreq is not exposed
+    int task_fd_ = -1;
+    int n_cpus_ = 0;
+    int64_t ns_per_tick_ = 10000000;
+    thread_slot threads_[MAX_THREADS];
+    char dirents_[4096];
+    frame scratch_;
+    std::mutex collect_mutex_;      // serializes sample_now with the sampling thread
+
+    mutable std::mutex ring_mutex_;
+    std::vector<frame> ring_;       // allocated once in start()
+    uint64_t head_ = 0;             // samples written so far
+
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    std::atomic<int64_t> sample_ns_total_{0};
+    std::atomic<int64_t> n_samples_{0};
+};
+
+std::string describe_cpu_window(const proc_sampler::window& w);
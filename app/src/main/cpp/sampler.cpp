@@ -0,0 +1,203 @@
+#include "sampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+int32_t argmax_f32_ref(const float* values, int32_t n) {
+    int32_t best = 0;
+    for (int32_t i = 1; i < n; i++) {
+        if (values[i] > values[best]) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+// Each SIMD path keeps a running max and the index where it was seen per lane.
+// A strict greater-than keeps the first index per lane; the lane reduction then
+// prefers the lower index on ties, which matches argmax_f32_ref exactly.
+int32_t argmax_f32(const float* values, int32_t n) {
+    if (n <= 0) return 0;
+
+    int32_t i = 0;
+    float best_val = values[0];
+    int32_t best_idx = 0;
+
+#if defined(__ARM_NEON)
+    if (n >= 4) {
+        float32x4_t vmax = vld1q_f32(values);
+        uint32x4_t vidx = {0, 1, 2, 3};
+        uint32x4_t cur = vidx;
+        const uint32x4_t step = vdupq_n_u32(4);
+        for (i = 4; i + 4 <= n; i += 4) {
+            cur = vaddq_u32(cur, step);
+            float32x4_t v = vld1q_f32(values + i);
+            uint32x4_t gt = vcgtq_f32(v, vmax);
+            vmax = vbslq_f32(gt, v, vmax);
+            vidx = vbslq_u32(gt, cur, vidx);
+        }
+        float lane_val[4];
+        uint32_t lane_idx[4];
+        vst1q_f32(lane_val, vmax);
+        vst1q_u32(lane_idx, vidx);
+        best_val = lane_val[0];
+        best_idx = lane_idx[0];
+        for (int l = 1; l < 4; l++) {
+            if (lane_val[l] > best_val || (lane_val[l] == best_val && (int32_t) lane_idx[l] < best_idx)) {
+                best_val = lane_val[l];
+                best_idx = lane_idx[l];
+            }
+        }
+    }
+#elif defined(__AVX__)
+    if (n >= 8) {
+        // Indices are tracked as floats, exact for any vocabulary below 2^24
+        __m256 vmax = _mm256_loadu_ps(values);
+        __m256 vidx = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+        __m256 cur = vidx;
+        const __m256 step = _mm256_set1_ps(8.0f);
+        for (i = 8; i + 8 <= n; i += 8) {
+            cur = _mm256_add_ps(cur, step);
+            __m256 v = _mm256_loadu_ps(values + i);
+            __m256 gt = _mm256_cmp_ps(v, vmax, _CMP_GT_OQ);
+            vmax = _mm256_blendv_ps(vmax, v, gt);
+            vidx = _mm256_blendv_ps(vidx, cur, gt);
+        }
+        float lane_val[8];
+        float lane_idx[8];
+        _mm256_storeu_ps(lane_val, vmax);
+        _mm256_storeu_ps(lane_idx, vidx);
+        best_val = lane_val[0];
+        best_idx = (int32_t) lane_idx[0];
+        for (int l = 1; l < 8; l++) {
+            if (lane_val[l] > best_val || (lane_val[l] == best_val && (int32_t) lane_idx[l] < best_idx)) {
+                best_val = lane_val[l];
+                best_idx = (int32_t) lane_idx[l];
+            }
+        }
+    }
+#elif defined(__SSE2__)
+    if (n >= 4) {
+        __m128 vmax = _mm_loadu_ps(values);
+        __m128i vidx = _mm_setr_epi32(0, 1, 2, 3);
+        __m128i cur = vidx;
+        const __m128i step = _mm_set1_epi32(4);
+        for (i = 4; i + 4 <= n; i += 4) {
+            cur = _mm_add_epi32(cur, step);
+            __m128 v = _mm_loadu_ps(values + i);
+            __m128 gt = _mm_cmpgt_ps(v, vmax);
+            __m128i gti = _mm_castps_si128(gt);
+            vmax = _mm_or_ps(_mm_and_ps(gt, v), _mm_andnot_ps(gt, vmax));
+            vidx = _mm_or_si128(_mm_and_si128(gti, cur), _mm_andnot_si128(gti, vidx));
+        }
+        float lane_val[4];
+        int32_t lane_idx[4];
+        _mm_storeu_ps(lane_val, vmax);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lane_idx), vidx);
+        best_val = lane_val[0];
+        best_idx = lane_idx[0];
+        for (int l = 1; l < 4; l++) {
+            if (lane_val[l] > best_val || (lane_val[l] == best_val && lane_idx[l] < best_idx)) {
+                best_val = lane_val[l];
+                best_idx = lane_idx[l];
+            }
+        }
+    }
+#endif
+
+    // Scalar tail (or the whole array when no SIMD path applies)
+    for (; i < n; i++) {
+        if (values[i] > best_val) {
+            best_val = values[i];
+            best_idx = i;
+        }
+    }
+    return best_idx;
+}
+
+token_sampler::token_sampler(int32_t n_vocab, const sampler_params& params)
+    : n_vocab(n_vocab) {
+    candidates.resize(n_vocab);
+    set_params(params);
+}
+
+void token_sampler::set_params(const sampler_params& new_params) {
+    params = new_params;
+    rng.seed(params.seed == LLAMA_DEFAULT_SEED ? std::random_device()() : params.seed);
+}
+
+llama_token token_sampler::sample(const float* logits) {
+    if (params.temperature <= 0.0f) {
+        return argmax_f32(logits, n_vocab);
+    }
+    return sample_stochastic(logits);
+}
+
+// top-k -> temperature softmax -> min-p -> top-p, then draw from what is left.
+// top-k uses partial_sort, so only the k best candidates are ever ordered.
+llama_token token_sampler::sample_stochastic(const float* logits) {
+    for (int32_t i = 0; i < n_vocab; i++) {
+        candidates[i].id = i;
+        candidates[i].logit = logits[i];
+        candidates[i].p = 0.0f;
+    }
+
+    const int32_t k = params.top_k > 0 ? std::min(params.top_k, n_vocab) : n_vocab;
+    auto by_logit = [](const llama_token_data& a, const llama_token_data& b) { return a.logit > b.logit; };
+    if (k < n_vocab) {
+        std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end(), by_logit);
+    } else {
+        std::sort(candidates.begin(), candidates.end(), by_logit);
+    }
+
+    const float max_logit = candidates[0].logit;
+    const float inv_temp = 1.0f / params.temperature;
+    float sum = 0.0f;
+    for (int32_t i = 0; i < k; i++) {
+        candidates[i].p = std::exp((candidates[i].logit - max_logit) * inv_temp);
+        sum += candidates[i].p;
+    }
+
+    // Candidates are sorted, so both cutoffs only shrink the kept count
+    int32_t n_keep = k;
+    if (params.min_p > 0.0f) {
+        const float threshold = params.min_p * candidates[0].p;
+        for (int32_t i = 1; i < n_keep; i++) {
+            if (candidates[i].p < threshold) {
+                n_keep = i;
+                break;
+            }
+        }
+    }
+    if (params.top_p < 1.0f) {
+        float cum = 0.0f;
+        for (int32_t i = 0; i < n_keep; i++) {
+            cum += candidates[i].p / sum;
+            if (cum >= params.top_p) {
+                n_keep = i + 1;
+                break;
+            }
+        }
+    }
+
+    float kept_sum = 0.0f;
+    for (int32_t i = 0; i < n_keep; i++) {
+        kept_sum += candidates[i].p;
+    }
+
+    std::uniform_real_distribution<float> dist(0.0f, kept_sum);
+    float r = dist(rng);
+    for (int32_t i = 0; i < n_keep; i++) {
+        r -= candidates[i].p;
+        if (r <= 0.0f) {
+            return candidates[i].id;
+        }
+    }
+    return candidates[n_keep - 1].id;
+}
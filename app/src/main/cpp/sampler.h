@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "llama.cpp/include/llama.h"
+
+// Sampling configuration. temperature <= 0 selects greedy argmax and ignores the rest.
+struct sampler_params {
+    float temperature = 0.0f;
+    int32_t top_k = 40;             // <= 0 keeps the whole vocabulary
+    float top_p = 1.0f;             // nucleus cutoff on cumulative probability
+    float min_p = 0.0f;             // drop tokens below min_p * p(best)
+    uint32_t seed = LLAMA_DEFAULT_SEED;
+};
+
+// Index of the largest value (first one on ties). Uses NEON on arm64 and AVX/SSE2 on x86.
+int32_t argmax_f32(const float* values, int32_t n);
+
+// Plain scalar argmax, kept as the reference for benchmarks.
+int32_t argmax_f32_ref(const float* values, int32_t n);
+
+// Picks the next token from a logits row. The candidate buffer is allocated once
+// per context and reused for every token, so sampling does not touch the heap.
+class token_sampler {
+public:
+    token_sampler(int32_t n_vocab, const sampler_params& params);
+
+    void set_params(const sampler_params& params);
+    const sampler_params& get_params() const { return params; }
+
+    llama_token sample(const float* logits);
+
+private:
+    llama_token sample_stochastic(const float* logits);
+
+    int32_t n_vocab;
+    sampler_params params;
+    std::vector<llama_token_data> candidates;
+    std::mt19937 rng;
+};
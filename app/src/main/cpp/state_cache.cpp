@@ -0,0 +1,240 @@
+#include "state_cache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include "native_log.h"
+
+namespace {
+
+constexpr char STATE_MAGIC[8] = {'L', 'L', 'M', 'K', 'V', 'S', 'T', '1'};
+
+struct state_header {
+    char magic[8];
+    uint64_t fingerprint;
+    uint32_t n_tokens;
+    uint32_t reserved;
+    uint64_t state_bytes;
+};
+
+uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ p[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+template <typename T>
+uint64_t fnv1a(uint64_t hash, const T& value) {
+    return fnv1a(hash, &value, sizeof(value));
+}
+
+std::string state_path(const std::string& dir, uint64_t fingerprint, const std::vector<llama_token>& tokens) {
+    uint64_t key = fnv1a(fingerprint, tokens.data(), tokens.size() * sizeof(llama_token));
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.kvstate", (unsigned long long) key);
+    return dir + name;
+}
+
+bool write_all(int fd, const void* data, size_t size) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Drops sequence 0 entirely, falling back to a full clear for memory that cannot be trimmed
+void clear_sequence(llama_context_wrapper* wrapper) {
+    llama_memory_t mem = llama_get_memory(wrapper->ctx);
+    if (!llama_memory_seq_rm(mem, 0, -1, -1)) {
+        llama_memory_clear(mem, true);
+    }
+    wrapper->cached_tokens.clear();
+}
+
+} // namespace
+
+uint64_t state_fingerprint(const llama_context_wrapper* wrapper) {
+    const llama_model* model = wrapper->model;
+    char desc[256] = "";
+    llama_model_desc(model, desc, sizeof(desc));
+    char name[256] = "";
+    llama_model_meta_val_str(model, "general.name", name, sizeof(name));
+
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = fnv1a(hash, desc, strlen(desc));
+    hash = fnv1a(hash, name, strlen(name));
+    hash = fnv1a(hash, llama_model_size(model));
+    hash = fnv1a(hash, llama_model_n_params(model));
+    hash = fnv1a(hash, llama_vocab_n_tokens(llama_model_get_vocab(model)));
+    hash = fnv1a(hash, llama_model_n_layer(model));
+    hash = fnv1a(hash, llama_model_n_embd(model));
+    // The KV image stores cells in the cache types, with V transposed unless flash attention is on
+    hash = fnv1a(hash, (int32_t) wrapper->options.type_k);
+    hash = fnv1a(hash, (int32_t) wrapper->options.type_v);
+    hash = fnv1a(hash, (int32_t) wrapper->options.flash_attn);
+    return hash;
+}
+
+bool save_prefix_state(llama_context_wrapper* wrapper, const std::string& dir,
+                       const std::vector<llama_token>& tokens, state_io& io) {
+    const int64_t t_start = now_ns();
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        LOGE("Cannot create state directory %s", dir.c_str());
+        return false;
+    }
+
+    std::vector<uint8_t> state(llama_state_seq_get_size(wrapper->ctx, 0));
+    const size_t n_state = llama_state_seq_get_data(wrapper->ctx, state.data(), state.size(), 0);
+    if (n_state == 0) {
+        LOGE("Failed to read sequence state");
+        return false;
+    }
+
+    state_header header = {};
+    memcpy(header.magic, STATE_MAGIC, sizeof(header.magic));
+    header.fingerprint = state_fingerprint(wrapper);
+    header.n_tokens = tokens.size();
+    header.state_bytes = n_state;
+
+    const std::string path = state_path(dir, header.fingerprint, tokens);
+    const std::string tmp_path = path + ".tmp";
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOGE("Cannot create %s: %s", tmp_path.c_str(), strerror(errno));
+        return false;
+    }
+    bool ok = write_all(fd, &header, sizeof(header)) &&
+              write_all(fd, tokens.data(), tokens.size() * sizeof(llama_token)) &&
+              write_all(fd, state.data(), n_state) &&
+              fdatasync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        LOGE("Failed to write %s: %s", path.c_str(), strerror(errno));
+        unlink(tmp_path.c_str());
+        return false;
+    }
+
+    io.bytes = sizeof(header) + tokens.size() * sizeof(llama_token) + n_state;
+    io.t_save_us = (now_ns() - t_start) / 1000;
+    LOGD("Saved %d-token prefix state (%lld bytes) in %lld us", (int) tokens.size(),
+         (long long) io.bytes, (long long) io.t_save_us);
+    return true;
+}
+
+bool restore_prefix_state(llama_context_wrapper* wrapper, const std::string& dir,
+                          const std::vector<llama_token>& tokens, state_io& io) {
+    const int64_t t_start = now_ns();
+    const uint64_t fingerprint = state_fingerprint(wrapper);
+    const std::string path = state_path(dir, fingerprint, tokens);
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        io.t_restore_us = (now_ns() - t_start) / 1000;
+        return false;
+    }
+    struct stat st;
+    const size_t tokens_bytes = tokens.size() * sizeof(llama_token);
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(state_header) + tokens_bytes) {
+        close(fd);
+        io.t_restore_us = (now_ns() - t_start) / 1000;
+        return false;
+    }
+    void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        io.t_restore_us = (now_ns() - t_start) / 1000;
+        return false;
+    }
+    madvise(base, st.st_size, MADV_SEQUENTIAL);
+
+    const auto* data = static_cast<const uint8_t*>(base);
+    const auto* header = reinterpret_cast<const state_header*>(data);
+    bool ok = memcmp(header->magic, STATE_MAGIC, sizeof(STATE_MAGIC)) == 0 &&
+              header->fingerprint == fingerprint &&
+              header->n_tokens == tokens.size() &&
+              header->state_bytes == st.st_size - sizeof(state_header) - tokens_bytes &&
+              memcmp(data + sizeof(state_header), tokens.data(), tokens_bytes) == 0;
+    if (ok) {
+        clear_sequence(wrapper);
+        ok = llama_state_seq_set_data(wrapper->ctx, data + sizeof(state_header) + tokens_bytes,
+                                      header->state_bytes, 0) != 0;
+        if (ok) {
+            wrapper->cached_tokens = tokens;
+        } else {
+            clear_sequence(wrapper);
+        }
+    }
+    munmap(base, st.st_size);
+
+    io.t_restore_us = (now_ns() - t_start) / 1000;
+    if (!ok) {
+        // Written by another build or for another context layout; prefill will replace it
+        LOGW("Discarding unusable state file %s", path.c_str());
+        unlink(path.c_str());
+        return false;
+    }
+    io.bytes = st.st_size;
+    LOGD("Restored %d-token prefix state (%lld bytes) in %lld us", (int) tokens.size(),
+         (long long) io.bytes, (long long) io.t_restore_us);
+    return true;
+}
+
+bool warm_prefix(llama_context_wrapper* wrapper, const std::string& dir, const std::string& prefix, state_io& io) {
+    io = state_io();
+    const std::vector<llama_token> tokens = wrapper->prompt_cache.get(llama_model_get_vocab(wrapper->model), prefix, true);
+    io.n_tokens = tokens.size();
+    if (tokens.empty() || tokens.size() >= llama_n_ctx(wrapper->ctx)) {
+        LOGE("Prefix of %d tokens does not fit context of %d", io.n_tokens, (int) llama_n_ctx(wrapper->ctx));
+        return false;
+    }
+
+    const std::vector<llama_token>& cached = wrapper->cached_tokens;
+    if (cached.size() >= tokens.size() && std::equal(tokens.begin(), tokens.end(), cached.begin())) {
+        io.source = PREFIX_RESIDENT;
+        return true;
+    }
+
+    if (!dir.empty() && restore_prefix_state(wrapper, dir, tokens, io)) {
+        io.source = PREFIX_RESTORED;
+        return true;
+    }
+
+    const int64_t t_start = now_ns();
+    clear_sequence(wrapper);
+    llama_batch batch = llama_batch_init(wrapper->n_batch, 0, 1);
+    const bool ok = prefill(wrapper, batch, tokens.data(), tokens.size(), 0) == 0;
+    llama_batch_free(batch);
+    if (!ok) {
+        clear_sequence(wrapper);
+        return false;
+    }
+    wrapper->cached_tokens = tokens;
+    io.source = PREFIX_PREFILLED;
+    io.t_prefill_us = (now_ns() - t_start) / 1000;
+
+    if (!dir.empty()) {
+        save_prefix_state(wrapper, dir, tokens, io);
+    }
+    return true;
+}
+
+void fill_state_io(const state_io& io, int64_t* out) {
+    out[STATE_IO_SOURCE] = io.source;
+    out[STATE_IO_N_TOKENS] = io.n_tokens;
+    out[STATE_IO_BYTES] = io.bytes;
+    out[STATE_IO_T_RESTORE_US] = io.t_restore_us;
+    out[STATE_IO_T_PREFILL_US] = io.t_prefill_us;
+    out[STATE_IO_T_SAVE_US] = io.t_save_us;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "llm_core.h"
+
+// On-disk cache of warmed KV prefixes, so a fresh process (e.g. a new WorkManager
+// run) can restore a prefilled system prompt in milliseconds instead of recomputing it.
+//
+// Each file holds the llama_state_seq_get_data image of sequence 0 after the prefix
+// tokens, named by a hash of the model fingerprint, the KV layout options and the
+// tokens. Files are written to a temporary name, synced and renamed, so a process
+// killed mid-save never leaves a truncated state behind.
+
+// Where the warmed prefix came from
+enum prefix_source {
+    PREFIX_RESIDENT = 0,            // already in the KV cache of this context
+    PREFIX_RESTORED = 1,            // loaded from a state file
+    PREFIX_PREFILLED = 2,           // decoded from scratch (and saved if a directory was given)
+};
+
+// Cost of warming one prefix
+struct state_io {
+    prefix_source source = PREFIX_RESIDENT;
+    int n_tokens = 0;
+    int64_t bytes = 0;              // state file size read or written, 0 if neither happened
+    int64_t t_restore_us = 0;       // restore attempt, including a miss
+    int64_t t_prefill_us = 0;
+    int64_t t_save_us = 0;
+};
+
+// Layout of the long[] state stats array returned to Kotlin (PrefixState)
+enum state_io_index {
+    STATE_IO_SOURCE = 0,
+    STATE_IO_N_TOKENS,
+    STATE_IO_BYTES,
+    STATE_IO_T_RESTORE_US,
+    STATE_IO_T_PREFILL_US,
+    STATE_IO_T_SAVE_US,
+    STATE_IO_COUNT
+};
+
+// Identifies the weights and KV layout a state image is valid for; cheap to compute
+// (metadata and sizes only, the weights are not read)
+uint64_t state_fingerprint(const llama_context_wrapper* wrapper);
+
+// Writes the state of sequence 0, which must hold exactly `tokens`, to `dir`
+bool save_prefix_state(llama_context_wrapper* wrapper, const std::string& dir,
+                       const std::vector<llama_token>& tokens, state_io& io);
+
+// Replaces sequence 0 with the saved state for `tokens`; false if there is no valid file
+bool restore_prefix_state(llama_context_wrapper* wrapper, const std::string& dir,
+                          const std::vector<llama_token>& tokens, state_io& io);
+
+// Makes sequence 0 start with the tokens of `prefix`, restoring them from `dir` or
+// prefilling and saving them there. An empty `dir` disables the file cache. Prompts
+// passed to generate() afterwards reuse the prefix, provided they start with the same
+// text and the prefix ends on a token boundary (e.g. a newline).
+bool warm_prefix(llama_context_wrapper* wrapper, const std::string& dir, const std::string& prefix, state_io& io);
+
+void fill_state_io(const state_io& io, int64_t* out);
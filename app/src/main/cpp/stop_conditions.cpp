@@ -0,0 +1,91 @@
+#include "stop_conditions.h"
+
+#include <deque>
+
+const char* stop_reason_name(stop_reason reason) {
+    switch (reason) {
+        case STOP_NONE: return "none";
+        case STOP_EOG: return "eog";
+        case STOP_MAX_TOKENS: return "max_tokens";
+        case STOP_CONTEXT_FULL: return "context_full";
+        case STOP_STRING: return "stop_string";
+        case STOP_DEADLINE: return "deadline";
+        case STOP_ENERGY_BUDGET: return "energy_budget";
+        case STOP_CANCELLED: return "cancelled";
+        case STOP_ERROR: return "error";
+        case STOP_BUFFER_FULL: return "buffer_full";
+        default: return "unknown";
+    }
+}
+
+void stop_matcher::set_patterns(const std::vector<std::string>& patterns) {
+    patterns_.clear();
+    for (const std::string& p : patterns) {
+        if (!p.empty()) patterns_.push_back(p);
+    }
+    next_.assign(256, -1);
+    depth_.assign(1, 0);
+    output_.assign(1, -1);
+    state_ = 0;
+    if (patterns_.empty()) {
+        next_.clear();
+        depth_.clear();
+        output_.clear();
+        return;
+    }
+
+    // Trie of the patterns
+    for (size_t i = 0; i < patterns_.size(); i++) {
+        int32_t s = 0;
+        for (unsigned char c : patterns_[i]) {
+            if (next_[s * 256 + c] < 0) {
+                next_[s * 256 + c] = (int32_t) depth_.size();
+                next_.resize(next_.size() + 256, -1);
+                depth_.push_back(depth_[s] + 1);
+                output_.push_back(-1);
+            }
+            s = next_[s * 256 + c];
+        }
+        output_[s] = (int32_t) i;
+    }
+
+    // Breadth-first over the trie: fold each state's failure transitions into its
+    // missing ones and inherit the output of its failure state when it has none
+    std::vector<int32_t> fail(depth_.size(), 0);
+    std::deque<int32_t> queue;
+    for (int c = 0; c < 256; c++) {
+        int32_t& t = next_[c];
+        if (t < 0) {
+            t = 0;
+        } else {
+            queue.push_back(t);
+        }
+    }
+    while (!queue.empty()) {
+        const int32_t s = queue.front();
+        queue.pop_front();
+        if (output_[s] < 0) output_[s] = output_[fail[s]];
+        for (int c = 0; c < 256; c++) {
+            const int32_t t = next_[s * 256 + c];
+            const int32_t via_fail = next_[fail[s] * 256 + c];
+            if (t < 0) {
+                next_[s * 256 + c] = via_fail;
+            } else {
+                fail[t] = via_fail;
+                queue.push_back(t);
+            }
+        }
+    }
+}
+
+size_t stop_matcher::feed(const char* text, size_t n, int& pattern) {
+    if (patterns_.empty()) return 0;
+    for (size_t i = 0; i < n; i++) {
+        state_ = next_[state_ * 256 + (unsigned char) text[i]];
+        if (output_[state_] >= 0) {
+            pattern = output_[state_];
+            return i + 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Native stop conditions of a generation: stop strings matched on the decoded text as
+// it streams, a wall-clock deadline and an energy budget. No llama.cpp dependency, so
+// telemetry tools can name stop reasons too.
+
+// Why a generation ended; values are recorded in the generation metrics
+enum stop_reason {
+    STOP_NONE = 0,                  // not recorded (batch totals; each sequence has its own)
+    STOP_EOG,                       // the model produced an end-of-generation token
+    STOP_MAX_TOKENS,                // max_tokens reached
+    STOP_CONTEXT_FULL,              // the KV cache has no room for another token
+    STOP_STRING,                    // a stop string appeared in the text
+    STOP_DEADLINE,                  // the wall-clock deadline passed
+    STOP_ENERGY_BUDGET,             // the power sampler measured the energy budget spent
+    STOP_CANCELLED,                 // the piece callback or an abort asked to stop
+    STOP_ERROR,                     // llama_decode failed
+    STOP_BUFFER_FULL,               // a fixed response buffer had no room for the next piece
+    STOP_REASON_COUNT
+};
+
+const char* stop_reason_name(stop_reason reason);
+
+// Limits applied to every generation of a context; zero disables each one
+struct generation_limits {
+    std::vector<std::string> stop_strings;  // the match and anything after it are dropped
+    int64_t deadline_us = 0;        // from the start of the generation, checked before each token
+    int64_t energy_budget_uj = 0;   // prefill and decode energy, needs a running power sampler
+};
+
+// Aho-Corasick automaton over the stop strings, compiled to a byte-indexed transition
+// table so each streamed byte costs one lookup and the response is never rescanned.
+// The matcher also knows how many trailing bytes could still become a match, which is
+// what streaming holds back so a stop string is never shown in part.
+class stop_matcher {
+public:
+    // Builds the automaton; empty strings are ignored. Resets the stream.
+    void set_patterns(const std::vector<std::string>& patterns);
+    bool empty() const { return patterns_.empty(); }
+    const std::string& pattern(int index) const { return patterns_[index]; }
+
+    // Starts a new stream
+    void reset() { state_ = 0; }
+
+    // Advances over the next `n` bytes of the stream. Returns how many of them were
+    // consumed up to the end of the first completed stop string, with `pattern` set to
+    // the longest string ending there, or 0 if none completed.
+    size_t feed(const char* text, size_t n, int& pattern);
+
+    // Trailing bytes of the stream that are the start of some stop string
+    int partial() const { return depth_.empty() ? 0 : depth_[state_]; }
+
+private:
+    std::vector<std::string> patterns_;
+    std::vector<int32_t> next_;     // 256 transitions per state, failure links folded in
+    std::vector<int32_t> depth_;    // length of the prefix each state stands for
+    std::vector<int32_t> output_;   // longest pattern ending in each state, -1 if none
+    int32_t state_ = 0;
+};
@@ -0,0 +1,347 @@
+#include "sweep_runner.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+#include <utility>
+#include "model_loader.h"
+#include "native_log.h"
+
+namespace {
+
+// Reads a small sysfs integer from offset 0
+bool pread_int(int fd, int64_t& value) {
+    char buf[32];
+    const ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return false;
+    buf[n] = '\0';
+    value = std::strtoll(buf, nullptr, 10);
+    return true;
+}
+
+std::string read_first_line(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+// Top-level powercap zones are "<type>:<n>"; subzones add another ":<n>"
+bool is_top_level_zone(const std::string& entry) {
+    const size_t colon = entry.find(':');
+    return colon != std::string::npos && colon > 0 && entry.find(':', colon + 1) == std::string::npos;
+}
+
+double median(std::vector<double> values) {
+    if (values.empty()) return 0.0;
+    auto mid = values.begin() + values.size() / 2;
+    std::nth_element(values.begin(), mid, values.end());
+    return *mid;
+}
+
+std::string json_string(const std::string& s) {
+    std::string out = "\"";
+    for (unsigned char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char esc[8];
+                    snprintf(esc, sizeof(esc), "\\u%04x", c);
+                    out += esc;
+                } else {
+                    out += (char) c;
+                }
+        }
+    }
+    return out + "\"";
+}
+
+std::string json_number(double value) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.6g", value);
+    return buf;
+}
+
+std::string json_ints(const std::vector<int>& values) {
+    std::string out = "[";
+    for (size_t i = 0; i < values.size(); i++) {
+        out += (i ? "," : "") + std::to_string(values[i]);
+    }
+    return out + "]";
+}
+
+// Runs one prompt on a clean KV cache, reading the meter before the call, at the
+// first streamed piece and after the call
+bool run_once(llama_context_wrapper* wrapper, const std::string& prompt, int max_tokens,
+              energy_meter* meter, sweep_run& run) {
+    wrapper->cached_tokens.clear();
+
+    int64_t e_start = 0, e_first = 0, e_end = 0;
+    bool metered = meter && meter->read_uj(e_start);
+    int64_t t_first_ns = 0;
+    piece_callback on_piece = [&](std::string_view, int, int64_t timestamp_ns) {
+        if (t_first_ns == 0) {
+            t_first_ns = timestamp_ns;
+            metered = metered && meter->read_uj(e_first);
+        }
+        return true;
+    };
+
+    std::string response;
+    const int64_t t_start = now_ns();
+    const bool ok = generate(wrapper, prompt, max_tokens, 1, on_piece, response);
+    metered = metered && t_first_ns > 0 && meter->read_uj(e_end);
+    if (!ok) return false;
+
+    const generation_stats& stats = wrapper->last_stats;
+    run.n_prompt = stats.n_prompt;
+    run.n_generated = stats.n_generated;
+    run.t_ttft_us = t_first_ns > 0 ? (t_first_ns - t_start) / 1000 : 0;
+    run.t_prefill_us = stats.t_prefill_us;
+    run.t_decode_us = stats.t_decode_us;
+    run.pss_decode_bytes = stats.mem_decode.pss;
+    if (metered) {
+        run.energy_prefill_uj = e_first - e_start;
+        run.energy_decode_uj = e_end - e_first;
+    }
+    return true;
+}
+
+void run_cell(const sweep_matrix& matrix, energy_meter* meter, sweep_cell& cell) {
+    load_phases phases;
+    const int64_t t_load = now_ns();
+    llama_model* model = load_model_from_path(cell.model, llama_model_default_params(), phases);
+    if (!model) {
+        cell.error = "model load failed";
+        return;
+    }
+    cell.model_bytes = phases.bytes;
+    cell.t_load_us = phases.resident ? 0 : (now_ns() - t_load) / 1000;
+
+    context_options options = matrix.base;
+    options.n_threads = cell.n_threads;
+    options.n_ctx = cell.n_ctx;
+    options.n_batch = cell.n_batch;
+    options.n_ubatch = cell.n_batch;
+    options.n_seq_max = 1;
+    llama_context_wrapper* wrapper = create_wrapper(model, options);
+    if (!wrapper) {
+        cell.error = "context creation failed";
+        return;
+    }
+    cell.memory = wrapper->memory;
+
+    const int n_prompts = (int) matrix.prompts.size();
+    sweep_run discard;
+    for (int w = 0; w < matrix.warmup; w++) {
+        if (!run_once(wrapper, matrix.prompts[w % n_prompts], cell.max_tokens, nullptr, discard)) {
+            cell.error = "warmup generation failed";
+            free_wrapper(wrapper);
+            return;
+        }
+    }
+    cell.ok = true;
+
+    for (int rep = 0; rep < matrix.repetitions; rep++) {
+        for (int p = 0; p < n_prompts; p++) {
+            sweep_run run;
+            run.prompt = p;
+            if (run_once(wrapper, matrix.prompts[p], cell.max_tokens, meter, run)) {
+                cell.runs.push_back(run);
+            } else {
+                cell.failures++;
+            }
+        }
+    }
+    free_wrapper(wrapper);
+}
+
+} // namespace
+
+rapl_meter::rapl_meter(std::string sysfs_root, std::string domain)
+    : root_(std::move(sysfs_root)), domain_(std::move(domain)) {}
+
+rapl_meter::~rapl_meter() {
+    for (const zone& z : zones_) {
+        close(z.fd);
+    }
+}
+
+bool rapl_meter::open() {
+    const std::string base = root_ + "/class/powercap";
+    DIR* dir = opendir(base.c_str());
+    if (!dir) {
+        LOGE("No powercap class under %s", root_.c_str());
+        return false;
+    }
+    std::vector<std::string> entries;
+    while (dirent* entry = readdir(dir)) {
+        if (is_top_level_zone(entry->d_name)) entries.push_back(entry->d_name);
+    }
+    closedir(dir);
+    std::sort(entries.begin(), entries.end());
+
+    for (const std::string& entry : entries) {
+        const std::string zone_dir = base + "/" + entry;
+        const std::string zone_name = read_first_line(zone_dir + "/name");
+        if (zone_name.compare(0, domain_.size(), domain_) != 0) continue;
+
+        const int fd = ::open((zone_dir + "/energy_uj").c_str(), O_RDONLY | O_CLOEXEC);
+        int64_t energy = 0;
+        if (fd < 0 || !pread_int(fd, energy)) {
+            LOGE("Cannot read %s/energy_uj (root only on most kernels)", zone_dir.c_str());
+            if (fd >= 0) close(fd);
+            continue;
+        }
+        const int64_t max_range = std::strtoll(read_first_line(zone_dir + "/max_energy_range_uj").c_str(), nullptr, 10);
+        zones_.push_back({fd, max_range, energy});
+        zone_names_.push_back(zone_name);
+    }
+
+    LOGD("RAPL meter on %zu %s zone(s)", zones_.size(), domain_.c_str());
+    return !zones_.empty();
+}
+
+bool rapl_meter::read_uj(int64_t& energy_uj) {
+    if (zones_.empty()) return false;
+    for (zone& z : zones_) {
+        int64_t value;
+        if (!pread_int(z.fd, value)) return false;
+        int64_t delta = value - z.last_uj;
+        if (delta < 0 && z.max_range_uj > 0) {
+            delta += z.max_range_uj;
+        }
+        total_uj_ += std::max<int64_t>(0, delta);
+        z.last_uj = value;
+    }
+    energy_uj = total_uj_;
+    return true;
+}
+
+bool sampler_meter::read_uj(int64_t& energy_uj) {
+    if (!sampler_ || !sampler_->running()) return false;
+    const int64_t t = now_ns();
+    if (last_ns_ > 0) {
+        total_uj_ += sampler_->energy_uj(last_ns_, t);
+    }
+    last_ns_ = t;
+    energy_uj = total_uj_;
+    return true;
+}
+
+std::vector<sweep_cell> run_sweep(const sweep_matrix& matrix, energy_meter* meter, const sweep_progress& on_cell) {
+    std::vector<sweep_cell> cells;
+    for (const std::string& model : matrix.models)
+    for (int n_threads : matrix.n_threads)
+    for (int n_ctx : matrix.n_ctx)
+    for (int n_batch : matrix.n_batch)
+    for (int max_tokens : matrix.max_tokens) {
+        sweep_cell cell;
+        cell.model = model;
+        cell.n_threads = n_threads;
+        cell.n_ctx = n_ctx;
+        cell.n_batch = n_batch;
+        cell.max_tokens = max_tokens;
+        cells.push_back(std::move(cell));
+    }
+    if (matrix.prompts.empty()) {
+        LOGE("Sweep has no prompts");
+        return cells;
+    }
+
+    for (size_t i = 0; i < cells.size(); i++) {
+        if (matrix.cooldown_ms > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(matrix.cooldown_ms));
+        }
+        run_cell(matrix, meter, cells[i]);
+        LOGD("Sweep cell %zu/%zu: %s, %d threads, n_ctx %d, n_batch %d, max_tokens %d: %s",
+             i + 1, cells.size(), cells[i].model.c_str(), cells[i].n_threads, cells[i].n_ctx,
+             cells[i].n_batch, cells[i].max_tokens, cells[i].ok ? "ok" : cells[i].error.c_str());
+        if (on_cell) on_cell(cells[i], i, cells.size());
+    }
+    return cells;
+}
+
+std::string sweep_report_json(const sweep_matrix& matrix, const energy_meter* meter,
+                              const std::vector<sweep_cell>& cells) {
+    std::string out = "{\n";
+    out += "  \"energy_source\": " + (meter ? json_string(meter->name()) : std::string("null")) + ",\n";
+    out += "  \"warmup\": " + std::to_string(matrix.warmup) + ",\n";
+    out += "  \"repetitions\": " + std::to_string(matrix.repetitions) + ",\n";
+    out += "  \"prompts\": " + std::to_string(matrix.prompts.size()) + ",\n";
+    out += "  \"matrix\": {\"models\": [";
+    for (size_t i = 0; i < matrix.models.size(); i++) {
+        out += (i ? ", " : "") + json_string(matrix.models[i]);
+    }
+    out += "], \"n_threads\": " + json_ints(matrix.n_threads) + ", \"n_ctx\": " + json_ints(matrix.n_ctx) +
+           ", \"n_batch\": " + json_ints(matrix.n_batch) + ", \"max_tokens\": " + json_ints(matrix.max_tokens) + "},\n";
+    out += "  \"cells\": [";
+
+    for (size_t c = 0; c < cells.size(); c++) {
+        const sweep_cell& cell = cells[c];
+        std::vector<double> ttft_ms, prefill_tps, decode_tps;
+        int64_t n_generated = 0, t_total_us = 0, energy_uj = 0, energy_decode_uj = 0, pss_peak = -1;
+        bool metered = !cell.runs.empty();
+        for (const sweep_run& run : cell.runs) {
+            ttft_ms.push_back(run.t_ttft_us / 1000.0);
+            if (run.t_prefill_us > 0) prefill_tps.push_back(run.n_prompt * 1e6 / run.t_prefill_us);
+            if (run.t_decode_us > 0) decode_tps.push_back(run.n_generated * 1e6 / run.t_decode_us);
+            n_generated += run.n_generated;
+            t_total_us += run.t_prefill_us + run.t_decode_us;
+            metered = metered && run.energy_prefill_uj >= 0;
+            energy_uj += run.energy_prefill_uj + run.energy_decode_uj;
+            energy_decode_uj += run.energy_decode_uj;
+            pss_peak = std::max(pss_peak, run.pss_decode_bytes);
+        }
+        metered = metered && n_generated > 0;
+
+        out += c ? ",\n    {" : "\n    {";
+        out += "\"model\": " + json_string(cell.model);
+        out += ", \"n_threads\": " + std::to_string(cell.n_threads);
+        out += ", \"n_ctx\": " + std::to_string(cell.n_ctx);
+        out += ", \"n_batch\": " + std::to_string(cell.n_batch);
+        out += ", \"max_tokens\": " + std::to_string(cell.max_tokens);
+        out += ", \"ok\": " + std::string(cell.ok ? "true" : "false");
+        if (!cell.ok) {
+            out += ", \"error\": " + json_string(cell.error) + "}";
+            continue;
+        }
+        out += ", \"model_bytes\": " + std::to_string(cell.model_bytes);
+        out += ", \"load_ms\": " + json_number(cell.t_load_us / 1000.0);
+        out += ", \"kv_bytes\": " + std::to_string(cell.memory.kv_bytes);
+        out += ", \"load_pss_bytes\": " + (cell.memory.at_load.pss >= 0 ? std::to_string(cell.memory.at_load.pss) : "null");
+        out += ", \"peak_pss_bytes\": " + (pss_peak >= 0 ? std::to_string(pss_peak) : "null");
+        out += ", \"runs\": " + std::to_string(cell.runs.size());
+        out += ", \"failures\": " + std::to_string(cell.failures);
+        out += ", \"generated_tokens\": " + std::to_string(n_generated);
+        out += ", \"ttft_ms\": " + json_number(median(ttft_ms));
+        out += ", \"prefill_tok_s\": " + json_number(median(prefill_tps));
+        out += ", \"decode_tok_s\": " + json_number(median(decode_tps));
+        out += ", \"tok_s\": " + json_number(t_total_us > 0 ? n_generated * 1e6 / t_total_us : 0.0);
+        out += ", \"joules_per_token\": " + (metered ? json_number(energy_uj / 1e6 / n_generated) : "null");
+        out += ", \"decode_joules_per_token\": " + (metered ? json_number(energy_decode_uj / 1e6 / n_generated) : "null");
+
+        // Raw runs as [prompt, n_prompt, n_generated, ttft_us, prefill_us, decode_us, prefill_uj, decode_uj]
+        out += ", \"raw\": [";
+        for (size_t r = 0; r < cell.runs.size(); r++) {
+            const sweep_run& run = cell.runs[r];
+            out += (r ? ", [" : "[") + std::to_string(run.prompt) + "," + std::to_string(run.n_prompt) + "," +
+                   std::to_string(run.n_generated) + "," + std::to_string(run.t_ttft_us) + "," +
+                   std::to_string(run.t_prefill_us) + "," + std::to_string(run.t_decode_us) + "," +
+                   std::to_string(run.energy_prefill_uj) + "," + std::to_string(run.energy_decode_uj) + "]";
+        }
+        out += "]}";
+    }
+    out += cells.empty() ? "]\n}\n" : "\n  ]\n}\n";
+    return out;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "llm_core.h"
+
+// Energy-efficiency sweep: runs every cell of a model x threads x n_ctx x n_batch x
+// max_tokens matrix with warmup and repetitions and reports tokens per second, TTFT
+// and joules per token of each cell as one JSON document. Each cell gets a fresh
+// context and an empty KV prefix cache before every run, so runs are independent.
+//
+// Energy comes from a pluggable energy_meter: RAPL through the powercap class on a
+// Linux host, or the battery power_sampler on a device.
+
+// Cumulative energy counter read around each phase of a run
+class energy_meter {
+public:
+    virtual ~energy_meter() = default;
+    virtual const char* name() const = 0;
+
+    // Energy drawn since the meter was opened, in microjoules; false if it cannot be read
+    virtual bool read_uj(int64_t& energy_uj) = 0;
+};
+
+// RAPL energy counters under <root>/class/powercap. Sums the top-level zones whose
+// name starts with `domain` ("package" for every CPU package, "psys" for the
+// platform on parts that expose it), unwrapping each counter at max_energy_range_uj.
+// energy_uj is readable by root only on most kernels.
+class rapl_meter : public energy_meter {
+public:
+    explicit rapl_meter(std::string sysfs_root = "/sys", std::string domain = "package");
+    ~rapl_meter() override;
+    rapl_meter(const rapl_meter&) = delete;
+    rapl_meter& operator=(const rapl_meter&) = delete;
+
+    // Opens the matching zones; false if none can be read
+    bool open();
+    const char* name() const override { return "rapl"; }
+    bool read_uj(int64_t& energy_uj) override;
+
+    // Names of the opened zones, e.g. "package-0"
+    const std::vector<std::string>& zones() const { return zone_names_; }
+
+private:
+    struct zone {
+        int fd;
+        int64_t max_range_uj;       // counter wraps back to 0 here
+        int64_t last_uj;
+    };
+
+    std::string root_;
+    std::string domain_;
+    std::vector<zone> zones_;
+    std::vector<std::string> zone_names_;
+    int64_t total_uj_ = 0;
+};
+
+// Integrates a running power_sampler between reads. Reads must come less than the
+// sampler's ring span apart, which holds for any single generation phase.
+class sampler_meter : public energy_meter {
+public:
+    explicit sampler_meter(const power_sampler* sampler) : sampler_(sampler) {}
+
+    const char* name() const override { return "power_supply"; }
+    bool read_uj(int64_t& energy_uj) override;
+
+private:
+    const power_sampler* sampler_;
+    int64_t last_ns_ = 0;
+    int64_t total_uj_ = 0;
+};
+
+// Axes of the sweep; every combination is one cell, models outermost
+struct sweep_matrix {
+    std::vector<std::string> models;    // GGUF paths, typically one per quantization
+    std::vector<int> n_threads;
+    std::vector<int> n_ctx;
+    std::vector<int> n_batch;           // n_ubatch follows n_batch
+    std::vector<int> max_tokens;
+    std::vector<std::string> prompts;   // every repetition runs each of them once
+    int warmup = 1;                     // unrecorded generations at the start of each cell
+    int repetitions = 3;                // recorded passes over the prompts
+    int cooldown_ms = 0;                // idle before each cell so heat from the last one settles
+    context_options base;               // remaining context settings
+};
+
+// One recorded generation
+struct sweep_run {
+    int prompt = 0;                     // index into sweep_matrix::prompts
+    int n_prompt = 0;
+    int n_generated = 0;
+    int64_t t_ttft_us = 0;              // from the generate call to the first streamed piece
+    int64_t t_prefill_us = 0;
+    int64_t t_decode_us = 0;
+    int64_t energy_prefill_uj = -1;     // up to the first piece, -1 without a meter
+    int64_t energy_decode_uj = -1;      // from the first piece to the end of the generation
+    int64_t pss_decode_bytes = -1;      // process Pss when decoding ended, -1 without smaps_rollup
+};
+
+struct sweep_cell {
+    std::string model;
+    int n_threads = 0;
+    int n_ctx = 0;
+    int n_batch = 0;
+    int max_tokens = 0;
+    bool ok = false;                    // context created and warmup succeeded
+    std::string error;
+    int64_t model_bytes = 0;
+    int64_t t_load_us = 0;              // model load, 0 when it was already resident
+    context_memory memory;
+    std::vector<sweep_run> runs;
+    int failures = 0;                   // generations that failed after warmup
+};
+
+// Called after each cell with its position in the sweep
+using sweep_progress = std::function<void(const sweep_cell& cell, size_t index, size_t total)>;
+
+// Runs every cell in order. `meter` may be null to skip energy; `on_cell` may be empty.
+std::vector<sweep_cell> run_sweep(const sweep_matrix& matrix, energy_meter* meter, const sweep_progress& on_cell);
+
+// Report with the matrix, per-cell medians and joules per token, and the raw runs
+std::string sweep_report_json(const sweep_matrix& matrix, const energy_meter* meter,
+                              const std::vector<sweep_cell>& cells);
@@ -0,0 +1,187 @@
+#include <jni.h>
+#include <string>
+#include "native_log.h"
+#include "telemetry_log.h"
+
+// JNI bindings for TelemetryLog. Built as its own library without llama.cpp, so
+// results are logged even when the inference library cannot be loaded.
+
+// Helper: Convert jstring to C++ string
+static std::string jstring2string(JNIEnv* env, jstring jStr) {
+    if (!jStr) return "";
+    const char* chars = env->GetStringUTFChars(jStr, nullptr);
+    std::string str(chars);
+    env->ReleaseStringUTFChars(jStr, chars);
+    return str;
+}
+
+extern "C" {
+
+// Open (or recover) the log in a directory; returns a handle, 0 on failure
+JNIEXPORT jlong JNICALL
+Java_com_research_llmbattery_TelemetryLog_nativeOpen(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jDir,
+    jint syncEvery,
+    jlong syncIntervalMs
+) {
+    auto* log = new telemetry_log();
+    if (!log->open(jstring2string(env, jDir), syncEvery, syncIntervalMs)) {
+        delete log;
+        return 0;
+    }
+    return reinterpret_cast<jlong>(log);
+}
+
+// Sync and close the log
+JNIEXPORT void JNICALL
+Java_com_research_llmbattery_TelemetryLog_nativeClose(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong handle
+) {
+    if (handle == 0) return;
+    delete reinterpret_cast<telemetry_log*>(handle);
+}
+
+// Append a query result; metrics is the NativeMetrics array, or null
+JNIEXPORT jboolean JNICALL
+Java_com_research_llmbattery_TelemetryLog_nativeAppendQuery(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong handle,
+    jlong timestampMs,
+    jstring jQuery,
+    jstring jResponse,
+    jlong inferenceTimeMs,
+    jint batteryLevel,
+    jstring jQuantization,
+    jstring jModelName,
+    jlongArray jMetrics
+) {
+    if (handle == 0) return JNI_FALSE;
+    
+    telemetry_record record = {};
+    record.type = TELEMETRY_QUERY;
+    record.timestamp_ms = timestampMs;
+    record.inference_time_ms = inferenceTimeMs;
+    record.battery_level = batteryLevel;
+    if (jMetrics) {
+        jsize n = env->GetArrayLength(jMetrics);
+        n = n < TELEMETRY_MAX_METRICS ? n : TELEMETRY_MAX_METRICS;
+        env->GetLongArrayRegion(jMetrics, 0, n, reinterpret_cast<jlong*>(record.metrics));
+        record.n_metrics = n;
+    }
+    
+    auto* log = reinterpret_cast<telemetry_log*>(handle);
+    bool ok = log->append(record, jstring2string(env, jQuery), jstring2string(env, jResponse),
+                          jstring2string(env, jQuantization), jstring2string(env, jModelName));
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+// Append a battery sample
+JNIEXPORT jboolean JNICALL
+Java_com_research_llmbattery_TelemetryLog_nativeAppendBattery(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong handle,
+    jlong timestampMs,
+    jint batteryLevel,
+    jfloat batteryDrainRate,
+    jfloat cpuUsage,
+    jlong memoryUsage,
+    jfloat temperature
+) {
+    if (handle == 0) return JNI_FALSE;
+    
+    telemetry_record record = {};
+    record.type = TELEMETRY_BATTERY;
+    record.timestamp_ms = timestampMs;
+    record.battery_level = batteryLevel;
+    record.battery_drain_rate = batteryDrainRate;
+    record.cpu_usage = cpuUsage;
+    record.memory_usage = memoryUsage;
+    record.temperature = temperature;
+    
+    auto* log = reinterpret_cast<telemetry_log*>(handle);
+    return log->append(record, "", "", "", "") ? JNI_TRUE : JNI_FALSE;
+}
+
+// Force everything appended so far to disk
+JNIEXPORT void JNICALL
+Java_com_research_llmbattery_TelemetryLog_nativeSync(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong handle
+) {
+    if (handle == 0) return;
+    reinterpret_cast<telemetry_log*>(handle)->sync();
+}
+
+// Delete all records and start an empty log
+JNIEXPORT jboolean JNICALL
+Java_com_research_llmbattery_TelemetryLog_nativeClear(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong handle
+) {
+    if (handle == 0) return JNI_FALSE;
+    return reinterpret_cast<telemetry_log*>(handle)->clear() ? JNI_TRUE : JNI_FALSE;
+}
+
+// Number of records of a type (1 query, 2 battery)
+JNIEXPORT jlong JNICALL
+Java_com_research_llmbattery_TelemetryLog_nativeCount(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong handle,
+    jint type
+) {
+    if (handle == 0) return 0;
+    return reinterpret_cast<telemetry_log*>(handle)->count((telemetry_record_type) type);
+}
+
+// Sum of inferenceTimeMs over all query records
+JNIEXPORT jlong JNICALL
+Java_com_research_llmbattery_TelemetryLog_nativeInferenceTimeTotalMs(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong handle
+) {
+    if (handle == 0) return 0;
+    return reinterpret_cast<telemetry_log*>(handle)->inference_time_total_ms();
+}
+
+// Stream the log into separate query and battery CSV files; returns records written or -1
+JNIEXPORT jlong JNICALL
+Java_com_research_llmbattery_TelemetryLog_nativeExportCsv(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong handle,
+    jstring jQueryPath,
+    jstring jBatteryPath
+) {
+    if (handle == 0) return -1;
+    
+    auto* log = reinterpret_cast<telemetry_log*>(handle);
+    log->sync();
+    return export_csv(log->dir(), jstring2string(env, jQueryPath), jstring2string(env, jBatteryPath));
+}
+
+// Stream the log into one CSV file with query and battery rows interleaved
+JNIEXPORT jlong JNICALL
+Java_com_research_llmbattery_TelemetryLog_nativeExportCombinedCsv(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong handle,
+    jstring jPath
+) {
+    if (handle == 0) return -1;
+    
+    auto* log = reinterpret_cast<telemetry_log*>(handle);
+    log->sync();
+    return export_combined_csv(log->dir(), jstring2string(env, jPath));
+}
+
+} // extern "C"
@@ -0,0 +1,614 @@
+#include "telemetry_log.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include "cpu_topology.h"
+#include "metrics_layout.h"
+#include "native_log.h"
+#include "stop_conditions.h"
+#include "thermal_governor.h"
+
+namespace {
+
+constexpr char SEGMENT_MAGIC[8] = {'L', 'L', 'M', 'T', 'L', 'O', 'G', '1'};
+constexpr uint32_t SEGMENT_VERSION = 1;
+constexpr size_t RECORD_SIZE = sizeof(telemetry_record);
+constexpr size_t CHECKSUMMED_BYTES = offsetof(telemetry_record, checksum);
+constexpr size_t STRINGS_START = 64;
+
+struct segment_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t strings;               // 0: records segment, 1: strings segment
+    uint32_t index;
+    uint32_t record_size;
+    int64_t created_ms;
+};
+
+// Precedes every text blob in a strings segment; a zero length ends the segment
+struct blob_header {
+    uint32_t length;
+    uint32_t crc;
+};
+
+uint32_t crc32(const void* data, size_t size) {
+    static const auto table = [] {
+        struct { uint32_t v[256]; } t;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t.v[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        crc = table.v[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+int64_t steady_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t wall_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string segment_path(const std::string& dir, bool strings, uint32_t index) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%s-%06u.seg", strings ? "strings" : "records", index);
+    return dir + "/" + name;
+}
+
+bool file_exists(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+size_t align8(size_t n) {
+    return (n + 7) & ~size_t(7);
+}
+
+bool record_valid(const telemetry_record* rec) {
+    return (rec->type == TELEMETRY_QUERY || rec->type == TELEMETRY_BATTERY) &&
+           rec->n_metrics <= TELEMETRY_MAX_METRICS &&
+           crc32(rec, CHECKSUMMED_BYTES) == rec->checksum;
+}
+
+// Offset just past the last intact blob of a strings segment
+size_t scan_strings(const uint8_t* base, size_t size) {
+    size_t pos = STRINGS_START;
+    while (pos + sizeof(blob_header) <= size) {
+        blob_header h;
+        std::memcpy(&h, base + pos, sizeof(h));
+        if (h.length == 0 || h.length > size - pos - sizeof(h)) break;
+        if (crc32(base + pos + sizeof(h), h.length) != h.crc) break;
+        pos += align8(sizeof(h) + h.length);
+    }
+    return pos;
+}
+
+} // namespace
+
+telemetry_log::~telemetry_log() {
+    close();
+}
+
+bool telemetry_log::open_segment(segment& seg, bool strings, uint32_t index) {
+    const std::string path = segment_path(dir_, strings, index);
+    const size_t size = strings ? STRING_SEGMENT_BYTES : RECORD_SEGMENT_BYTES;
+    seg.fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (seg.fd < 0) {
+        LOGE("Cannot open telemetry segment %s", path.c_str());
+        return false;
+    }
+
+    // Reserve the blocks up front so a full disk fails here instead of as SIGBUS on a store
+    struct stat st;
+    if (fstat(seg.fd, &st) != 0 ||
+        ((size_t) st.st_size < size && posix_fallocate(seg.fd, 0, size) != 0 && ftruncate(seg.fd, size) != 0)) {
+        LOGE("Cannot size telemetry segment %s", path.c_str());
+        close_segment(seg);
+        return false;
+    }
+
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, seg.fd, 0);
+    if (base == MAP_FAILED) {
+        LOGE("Cannot map telemetry segment %s", path.c_str());
+        close_segment(seg);
+        return false;
+    }
+    seg.base = static_cast<uint8_t*>(base);
+    seg.size = size;
+    seg.index = index;
+
+    segment_header header;
+    std::memcpy(&header, seg.base, sizeof(header));
+    if (std::memcmp(header.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0) {
+        header = segment_header();
+        std::memcpy(header.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+        header.version = SEGMENT_VERSION;
+        header.strings = strings ? 1 : 0;
+        header.index = index;
+        header.record_size = RECORD_SIZE;
+        header.created_ms = wall_ms();
+        std::memcpy(seg.base, &header, sizeof(header));
+        msync(seg.base, sizeof(header), MS_SYNC);
+    }
+    seg.pos = strings ? STRINGS_START : RECORD_SIZE;
+    seg.synced = 0;
+    return true;
+}
+
+void telemetry_log::close_segment(segment& seg) {
+    if (seg.base) {
+        sync_segment(seg);
+        munmap(seg.base, seg.size);
+    }
+    if (seg.fd >= 0) ::close(seg.fd);
+    seg = segment();
+}
+
+void telemetry_log::sync_segment(segment& seg) {
+    if (!seg.base || seg.pos <= seg.synced) return;
+    const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    const size_t start = seg.synced / page * page;
+    msync(seg.base + start, seg.pos - start, MS_SYNC);
+    seg.synced = seg.pos;
+}
+
+bool telemetry_log::open(const std::string& dir, int sync_every, int64_t sync_interval_ms) {
+    close();
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        LOGE("Cannot create telemetry directory %s", dir.c_str());
+        return false;
+    }
+    dir_ = dir;
+    sync_every_ = sync_every > 0 ? sync_every : 1;
+    sync_interval_ms_ = sync_interval_ms;
+    return recover();
+}
+
+// Counts the committed records and positions both segments after the last intact entry
+bool telemetry_log::recover() {
+    n_queries_ = 0;
+    n_battery_ = 0;
+    inference_ms_total_ = 0;
+    next_seq_ = 0;
+
+    {
+        telemetry_reader reader;
+        if (reader.open(dir_)) {
+            while (const telemetry_record* rec = reader.next()) {
+                if (rec->type == TELEMETRY_QUERY) {
+                    n_queries_++;
+                    inference_ms_total_ += rec->inference_time_ms;
+                } else {
+                    n_battery_++;
+                }
+                next_seq_ = rec->seq + 1;
+            }
+        }
+    }
+
+    // The newest records segment may hold no valid record yet (created just before a crash)
+    uint32_t records_index = 0;
+    while (file_exists(segment_path(dir_, false, records_index + 1))) records_index++;
+    if (!open_segment(records_, false, records_index)) return false;
+    while (records_.pos + RECORD_SIZE <= records_.size &&
+           record_valid(reinterpret_cast<const telemetry_record*>(records_.base + records_.pos))) {
+        records_.pos += RECORD_SIZE;
+    }
+    records_.synced = records_.pos;
+
+    uint32_t strings_index = 0;
+    while (file_exists(segment_path(dir_, true, strings_index + 1))) strings_index++;
+    if (!open_segment(strings_, true, strings_index)) {
+        close_segment(records_);
+        return false;
+    }
+    strings_.pos = scan_strings(strings_.base, strings_.size);
+    strings_.synced = strings_.pos;
+
+    unsynced_records_ = 0;
+    last_sync_ms_ = steady_ms();
+    LOGD("Telemetry log %s: %lld queries, %lld battery samples, writing records segment %u",
+         dir_.c_str(), (long long) n_queries_, (long long) n_battery_, records_index);
+    return true;
+}
+
+void telemetry_log::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    close_segment(records_);
+    close_segment(strings_);
+}
+
+bool telemetry_log::write_string(const std::string& text, telemetry_string& ref) {
+    ref = {strings_.index, 0, 0};
+    if (text.empty()) return true;
+
+    const size_t capacity = STRING_SEGMENT_BYTES - STRINGS_START - sizeof(blob_header);
+    const size_t length = text.size() < capacity ? text.size() : capacity;
+    if (strings_.pos + sizeof(blob_header) + length > strings_.size) {
+        const uint32_t next = strings_.index + 1;
+        close_segment(strings_);
+        if (!open_segment(strings_, true, next)) return false;
+    }
+
+    // Text first, header last: a blob torn mid-copy still reads as the end of the segment
+    uint8_t* dst = strings_.base + strings_.pos;
+    std::memcpy(dst + sizeof(blob_header), text.data(), length);
+    const blob_header header = {(uint32_t) length, crc32(text.data(), length)};
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(dst, &header, sizeof(header));
+
+    ref = {strings_.index, (uint32_t) (strings_.pos + sizeof(blob_header)), (uint32_t) length};
+    strings_.pos += align8(sizeof(blob_header) + length);
+    return true;
+}
+
+bool telemetry_log::append(telemetry_record& record, const std::string& query, const std::string& response,
+                           const std::string& quantization, const std::string& model_name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!records_.base || !strings_.base) return false;
+
+    if (!write_string(query, record.query) || !write_string(response, record.response) ||
+        !write_string(quantization, record.quantization) || !write_string(model_name, record.model_name)) {
+        return false;
+    }
+
+    if (records_.pos + RECORD_SIZE > records_.size) {
+        const uint32_t next = records_.index + 1;
+        close_segment(records_);
+        if (!open_segment(records_, false, next)) return false;
+    }
+
+    record.seq = next_seq_++;
+    record.checksum = crc32(&record, CHECKSUMMED_BYTES);
+    uint8_t* dst = records_.base + records_.pos;
+    std::memcpy(dst, &record, CHECKSUMMED_BYTES);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(dst + CHECKSUMMED_BYTES, &record.checksum, sizeof(record.checksum));
+    records_.pos += RECORD_SIZE;
+
+    if (record.type == TELEMETRY_QUERY) {
+        n_queries_++;
+        inference_ms_total_ += record.inference_time_ms;
+    } else {
+        n_battery_++;
+    }
+
+    const int64_t now = steady_ms();
+    if (++unsynced_records_ >= sync_every_ || now - last_sync_ms_ >= sync_interval_ms_) {
+        sync_segment(strings_);
+        sync_segment(records_);
+        unsynced_records_ = 0;
+        last_sync_ms_ = now;
+    }
+    return true;
+}
+
+void telemetry_log::sync() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sync_segment(strings_);
+    sync_segment(records_);
+    unsynced_records_ = 0;
+    last_sync_ms_ = steady_ms();
+}
+
+bool telemetry_log::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    close_segment(records_);
+    close_segment(strings_);
+    for (int strings = 0; strings < 2; strings++) {
+        for (uint32_t index = 0; file_exists(segment_path(dir_, strings, index)); index++) {
+            unlink(segment_path(dir_, strings, index).c_str());
+        }
+    }
+    return recover();
+}
+
+int64_t telemetry_log::count(telemetry_record_type type) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return type == TELEMETRY_QUERY ? n_queries_ : n_battery_;
+}
+
+int64_t telemetry_log::inference_time_total_ms() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return inference_ms_total_;
+}
+
+telemetry_reader::~telemetry_reader() {
+    unmap(records_);
+    unmap(strings_);
+}
+
+bool telemetry_reader::open(const std::string& dir) {
+    unmap(records_);
+    unmap(strings_);
+    dir_ = dir;
+    slot_ = 1;
+    return map(records_, false, 0);
+}
+
+bool telemetry_reader::map(mapping& m, bool strings, uint32_t index) {
+    unmap(m);
+    const int fd = ::open(segment_path(dir_, strings, index).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    void* base = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (base == MAP_FAILED) return false;
+    m.base = static_cast<uint8_t*>(base);
+    m.size = st.st_size;
+    m.index = index;
+    return true;
+}
+
+void telemetry_reader::unmap(mapping& m) {
+    if (m.base) munmap(m.base, m.size);
+    m = mapping();
+}
+
+const telemetry_record* telemetry_reader::next() {
+    while (records_.base) {
+        if ((slot_ + 1) * RECORD_SIZE <= records_.size) {
+            const auto* rec = reinterpret_cast<const telemetry_record*>(records_.base + slot_ * RECORD_SIZE);
+            if (record_valid(rec)) {
+                slot_++;
+                return rec;
+            }
+        }
+        // End of this segment's records: continue in the next one if it exists
+        const uint32_t next_index = records_.index + 1;
+        if (!file_exists(segment_path(dir_, false, next_index))) return nullptr;
+        map(records_, false, next_index);
+        slot_ = 1;
+    }
+    return nullptr;
+}
+
+std::string telemetry_reader::text(const telemetry_string& ref) {
+    if (ref.length == 0) return std::string();
+    if (strings_.index != (int64_t) ref.segment && !map(strings_, true, ref.segment)) return std::string();
+    if ((size_t) ref.offset + ref.length > strings_.size) return std::string();
+    return std::string(reinterpret_cast<const char*>(strings_.base + ref.offset), ref.length);
+}
+
+namespace {
+
+// CSV writer matching DataLogger's formatting: fields quoted only when they contain a
+// delimiter, quote or newline; floats printed the way Kotlin's toString prints them
+class csv_writer {
+public:
+    explicit csv_writer(const std::string& path) : file_(std::fopen(path.c_str(), "w")) {
+        if (file_) std::setvbuf(file_, buffer_, _IOFBF, sizeof(buffer_));
+    }
+    ~csv_writer() {
+        if (file_) std::fclose(file_);
+    }
+    bool ok() const { return file_ != nullptr; }
+    bool close() {
+        const bool closed = file_ && std::fclose(file_) == 0;
+        file_ = nullptr;
+        return closed;
+    }
+
+    void line(const std::string& text) {
+        std::fwrite(text.data(), 1, text.size(), file_);
+        std::fputc('\n', file_);
+    }
+
+private:
+    FILE* file_;
+    char buffer_[1 << 16];
+};
+
+// One CSV line, reused across records
+struct csv_row {
+    std::string text;
+    int n_fields = 0;
+
+    void clear() {
+        text.clear();
+        n_fields = 0;
+    }
+
+    void add(const std::string& field) {
+        if (n_fields++ > 0) text += ',';
+        if (field.find_first_of(",\"\n") == std::string::npos) {
+            text += field;
+            return;
+        }
+        text += '"';
+        for (char c : field) {
+            if (c == '"') text += '"';
+            text += c;
+        }
+        text += '"';
+    }
+};
+
+std::string int_text(int64_t v) {
+    return std::to_string(v);
+}
+
+std::string float_text(double v, int digits) {
+    char buf[48];
+    std::snprintf(buf, sizeof(buf), "%.*g", digits, v);
+    std::string s = buf;
+    if (s.find_first_of(".en") == std::string::npos) s += ".0";
+    return s;
+}
+
+std::string timestamp_text(int64_t ms) {
+    const time_t seconds = (time_t) (ms / 1000);
+    struct tm local;
+    localtime_r(&seconds, &local);
+    char buf[40];
+    const size_t n = std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &local);
+    std::snprintf(buf + n, sizeof(buf) - n, ".%03d", (int) (ms % 1000));
+    return buf;
+}
+
+const char QUERY_HEADER[] =
+    "timestamp,queryText,responseText,inferenceTimeMs,batteryLevel,quantization,modelName,"
+    "tokenizeUs,promptTokens,reusedPromptTokens,prefillUs,generatedTokens,decodeUs,sampleUs,detokenizeUs,"
+    "decodeP50Us,decodeP90Us,decodeP99Us,decodeMaxUs,prefillPlacement,prefillThreads,decodePlacement,decodeThreads,"
+    "prefillEnergyJ,decodeEnergyJ,prefillCpuUtil,decodeCpuUtil,prefillProcessCpuMs,decodeProcessCpuMs,"
+    "governorLevel,governorReason,socTempC,freqCapPct,pacingMs,stopReason,"
+    "prefillRssMiB,prefillPssMiB,decodeRssMiB,decodePssMiB,kvUsedMiB,stateMiB";
+const char BATTERY_HEADER[] = "timestamp,batteryLevel,batteryDrainRate,cpuUsage,memoryUsage,temperature";
+const char COMBINED_HEADER[] =
+    "type,timestamp,queryText,responseText,inferenceTimeMs,batteryLevel,quantization,modelName,"
+    "batteryDrainRate,cpuUsage,memoryUsage,temperature";
+constexpr int NATIVE_METRIC_COLUMNS = 34;
+constexpr int GOVERNOR_METRIC_COLUMNS = 5;
+
+// Native phase columns of QUERY_HEADER; empty when the query did not run natively
+void append_native_metrics(csv_row& out, const telemetry_record& rec) {
+    if (rec.n_metrics < METRIC_GOVERNOR_LEVEL) {
+        for (int i = 0; i < NATIVE_METRIC_COLUMNS; i++) {
+            out.add("");
+        }
+        return;
+    }
+    const int64_t* m = rec.metrics;
+    for (int i = METRIC_T_TOKENIZE_US; i <= METRIC_DECODE_MAX_US; i++) {
+        out.add(int_text(m[i]));
+    }
+    auto policy = [](int64_t code) {
+        return code >= 0 && code < PLACEMENT_POLICY_COUNT ? placement_policy_name((placement_policy) code) : "os";
+    };
+    out.add(policy(m[METRIC_PREFILL_POLICY]));
+    out.add(int_text(m[METRIC_PREFILL_THREADS]));
+    out.add(policy(m[METRIC_DECODE_POLICY]));
+    out.add(int_text(m[METRIC_DECODE_THREADS]));
+    for (int i : {METRIC_ENERGY_PREFILL_UJ, METRIC_ENERGY_DECODE_UJ}) {
+        out.add(m[i] >= 0 ? float_text(m[i] / 1e6, 17) : "");
+    }
+    const bool has_cpu = m[METRIC_CPU_UTIL_DECODE] >= 0;
+    for (int i : {METRIC_CPU_UTIL_PREFILL, METRIC_CPU_UTIL_DECODE}) {
+        out.add(has_cpu ? float_text(m[i] / 10.0, 7) : "");
+    }
+    for (int i : {METRIC_PROCESS_CPU_PREFILL_US, METRIC_PROCESS_CPU_DECODE_US}) {
+        out.add(has_cpu ? float_text(m[i] / 1000.0, 7) : "");
+    }
+    // Records written before the governor, stop reason or memory metrics existed have none
+    if (rec.n_metrics <= METRIC_T_PACING_US || m[METRIC_GOVERNOR_LEVEL] < 0) {
+        for (int i = 0; i < GOVERNOR_METRIC_COLUMNS; i++) {
+            out.add("");
+        }
+    } else {
+        out.add(int_text(m[METRIC_GOVERNOR_LEVEL]));
+        out.add(governor_reason_name((governor_reason) m[METRIC_GOVERNOR_REASON]));
+        out.add(m[METRIC_THERMAL_MC] >= 0 ? float_text(m[METRIC_THERMAL_MC] / 1000.0, 7) : "");
+        out.add(float_text(m[METRIC_FREQ_CAP_PERMILLE] / 10.0, 7));
+        out.add(float_text(m[METRIC_T_PACING_US] / 1000.0, 7));
+    }
+    const bool has_stop = rec.n_metrics > METRIC_STOP_REASON && m[METRIC_STOP_REASON] != STOP_NONE;
+    out.add(has_stop ? stop_reason_name((stop_reason) m[METRIC_STOP_REASON]) : "");
+    const bool has_memory = rec.n_metrics > METRIC_STATE_BYTES;
+    const int memory_metrics[] = {METRIC_MEM_PREFILL + MEM_RSS, METRIC_MEM_PREFILL + MEM_PSS,
+                                  METRIC_MEM_DECODE + MEM_RSS, METRIC_MEM_DECODE + MEM_PSS,
+                                  METRIC_KV_USED_BYTES, METRIC_STATE_BYTES};
+    for (int i : memory_metrics) {
+        out.add(has_memory && m[i] >= 0 ? float_text(m[i] / 1048576.0, 7) : "");
+    }
+}
+
+} // namespace
+
+int64_t export_csv(const std::string& dir, const std::string& query_csv, const std::string& battery_csv) {
+    telemetry_reader reader;
+    csv_writer queries(query_csv);
+    csv_writer battery(battery_csv);
+    if (!queries.ok() || !battery.ok()) {
+        LOGE("Cannot create %s / %s", query_csv.c_str(), battery_csv.c_str());
+        return -1;
+    }
+    queries.line(QUERY_HEADER);
+    battery.line(BATTERY_HEADER);
+
+    int64_t n = 0;
+    csv_row row;
+    if (reader.open(dir)) {
+        while (const telemetry_record* rec = reader.next()) {
+            row.clear();
+            row.add(timestamp_text(rec->timestamp_ms));
+            if (rec->type == TELEMETRY_QUERY) {
+                row.add(reader.text(rec->query));
+                row.add(reader.text(rec->response));
+                row.add(int_text(rec->inference_time_ms));
+                row.add(int_text(rec->battery_level));
+                row.add(reader.text(rec->quantization));
+                row.add(reader.text(rec->model_name));
+                append_native_metrics(row, *rec);
+                queries.line(row.text);
+            } else {
+                row.add(int_text(rec->battery_level));
+                row.add(float_text(rec->battery_drain_rate, 7));
+                row.add(float_text(rec->cpu_usage, 7));
+                row.add(int_text(rec->memory_usage));
+                row.add(float_text(rec->temperature, 7));
+                battery.line(row.text);
+            }
+            n++;
+        }
+    }
+    return queries.close() && battery.close() ? n : -1;
+}
+
+int64_t export_combined_csv(const std::string& dir, const std::string& combined_csv) {
+    telemetry_reader reader;
+    csv_writer out(combined_csv);
+    if (!out.ok()) {
+        LOGE("Cannot create %s", combined_csv.c_str());
+        return -1;
+    }
+    out.line(COMBINED_HEADER);
+
+    int64_t n = 0;
+    csv_row row;
+    if (reader.open(dir)) {
+        while (const telemetry_record* rec = reader.next()) {
+            row.clear();
+            const bool query = rec->type == TELEMETRY_QUERY;
+            row.add(query ? "query" : "battery");
+            row.add(timestamp_text(rec->timestamp_ms));
+            row.add(query ? reader.text(rec->query) : "");
+            row.add(query ? reader.text(rec->response) : "");
+            row.add(query ? int_text(rec->inference_time_ms) : "");
+            row.add(int_text(rec->battery_level));
+            row.add(query ? reader.text(rec->quantization) : "");
+            row.add(query ? reader.text(rec->model_name) : "");
+            row.add(query ? "" : float_text(rec->battery_drain_rate, 7));
+            row.add(query ? "" : float_text(rec->cpu_usage, 7));
+            row.add(query ? "" : int_text(rec->memory_usage));
+            row.add(query ? "" : float_text(rec->temperature, 7));
+            out.line(row.text);
+            n++;
+        }
+    }
+    return out.close() ? n : -1;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Crash-safe, append-only log of benchmark records (query results and battery samples).
+//
+// A log directory holds two kinds of fixed-size, mmap'd segment files:
+//   records-NNNNNN.seg   fixed-size telemetry_record slots
+//   strings-NNNNNN.seg   length-prefixed, checksummed text blobs (prompts, responses)
+// Text is appended first and a record is committed by writing its checksum last, so a
+// record torn by process death fails validation and is overwritten on the next open.
+// Writes land in the page cache as soon as they are made, which survives the process
+// being killed; msync runs every few records (and on close) to survive power loss too.
+// Segments are only ever appended to, so memory use does not grow with the run length.
+
+enum telemetry_record_type : uint16_t {
+    TELEMETRY_QUERY = 1,
+    TELEMETRY_BATTERY = 2,
+};
+
+// Location of a text blob: strings segment index, byte offset of the text, length
+struct telemetry_string {
+    uint32_t segment;
+    uint32_t offset;
+    uint32_t length;
+};
+
+constexpr int TELEMETRY_MAX_METRICS = 96;   // room for the native metrics array to grow
+
+struct telemetry_record {
+    uint16_t type;                  // telemetry_record_type
+    uint16_t n_metrics;             // valid entries in metrics, 0 if the query did not run natively
+    uint32_t reserved0;
+    uint64_t seq;                   // position in the log, from 0
+    int64_t timestamp_ms;
+    telemetry_string query;
+    telemetry_string response;
+    telemetry_string quantization;
+    telemetry_string model_name;
+    int64_t inference_time_ms;
+    int32_t battery_level;
+    float battery_drain_rate;
+    float cpu_usage;
+    float temperature;
+    int64_t memory_usage;
+    int64_t metrics[TELEMETRY_MAX_METRICS]; // metrics_index layout
+    uint8_t reserved[148];
+    uint32_t checksum;              // crc32 of the bytes above; written last
+};
+static_assert(sizeof(telemetry_record) == 1024, "telemetry_record must stay 1 KiB");
+
+class telemetry_log {
+public:
+    static constexpr size_t RECORD_SEGMENT_BYTES = 4 << 20;    // 4095 records
+    static constexpr size_t STRING_SEGMENT_BYTES = 16 << 20;
+
+    telemetry_log() = default;
+    ~telemetry_log();
+    telemetry_log(const telemetry_log&) = delete;
+    telemetry_log& operator=(const telemetry_log&) = delete;
+
+    // Opens (creating if needed) the log in `dir` and recovers the write position after
+    // the last valid record. msync runs after every `sync_every` records or once
+    // `sync_interval_ms` has passed since the last sync, whichever comes first.
+    bool open(const std::string& dir, int sync_every = 16, int64_t sync_interval_ms = 5000);
+    void close();
+    const std::string& dir() const { return dir_; }
+
+    // `record` supplies the fixed fields; its strings, seq and checksum are filled in here.
+    // Text longer than a strings segment is truncated.
+    bool append(telemetry_record& record, const std::string& query, const std::string& response,
+                const std::string& quantization, const std::string& model_name);
+    void sync();
+
+    // Deletes every segment and starts an empty log in the same directory
+    bool clear();
+
+    int64_t count(telemetry_record_type type) const;
+    int64_t inference_time_total_ms() const;
+
+private:
+    struct segment {
+        int fd = -1;
+        uint8_t* base = nullptr;
+        size_t size = 0;
+        uint32_t index = 0;
+        size_t pos = 0;             // next write offset
+        size_t synced = 0;          // bytes before this offset are on disk
+    };
+
+    bool open_segment(segment& seg, bool strings, uint32_t index);
+    void close_segment(segment& seg);
+    void sync_segment(segment& seg);
+    bool recover();
+    bool write_string(const std::string& text, telemetry_string& ref);
+
+    mutable std::mutex mutex_;
+    std::string dir_;
+    segment records_;
+    segment strings_;
+    uint64_t next_seq_ = 0;
+    int64_t n_queries_ = 0;
+    int64_t n_battery_ = 0;
+    int64_t inference_ms_total_ = 0;
+    int sync_every_ = 16;
+    int64_t sync_interval_ms_ = 5000;
+    int unsynced_records_ = 0;
+    int64_t last_sync_ms_ = 0;
+};
+
+// Sequential reader over a log directory; maps one records and one strings segment at
+// a time, so memory use is constant however long the log is. Records torn by a crash
+// end the iteration.
+class telemetry_reader {
+public:
+    telemetry_reader() = default;
+    ~telemetry_reader();
+    telemetry_reader(const telemetry_reader&) = delete;
+    telemetry_reader& operator=(const telemetry_reader&) = delete;
+
+    bool open(const std::string& dir);
+    // Next committed record, or nullptr at the end; valid until the following call
+    const telemetry_record* next();
+    // Text of a blob referenced by the current record (empty if it cannot be read)
+    std::string text(const telemetry_string& ref);
+
+private:
+    struct mapping {
+        uint8_t* base = nullptr;
+        size_t size = 0;
+        int64_t index = -1;
+    };
+
+    bool map(mapping& m, bool strings, uint32_t index);
+    void unmap(mapping& m);
+
+    std::string dir_;
+    mapping records_;
+    mapping strings_;
+    size_t slot_ = 1;               // slot 0 holds the segment header
+};
+
+// Streaming CSV export in the column layout DataLogger has always produced. The query
+// and battery files are written side by side; the combined file interleaves both kinds
+// in log order. Returns the number of records written, or -1 on error.
+int64_t export_csv(const std::string& dir, const std::string& query_csv, const std::string& battery_csv);
+int64_t export_combined_csv(const std::string& dir, const std::string& combined_csv);
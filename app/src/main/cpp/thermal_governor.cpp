@@ -0,0 +1,305 @@
+#include "thermal_governor.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include "native_log.h"
+
+namespace {
+
+constexpr int PACING_STEP_US = 5000;        // added per sample while above the envelope
+constexpr double EFFICIENCY_MARGIN = 0.05;  // a cooler point must beat the floor by this share
+constexpr double EFFICIENCY_ALPHA = 0.3;    // weight of the newest tokens-per-joule sample
+
+int64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Reads a small sysfs integer from offset 0; fallback if the read fails
+int64_t pread_int(int fd, int64_t fallback) {
+    char buf[32];
+    const ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return fallback;
+    buf[n] = '\0';
+    return std::strtoll(buf, nullptr, 10);
+}
+
+std::string read_first_line(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+} // namespace
+
+const char* governor_reason_name(governor_reason reason) {
+    switch (reason) {
+        case GOVERNOR_HOLD: return "hold";
+        case GOVERNOR_HOT: return "hot";
+        case GOVERNOR_THROTTLED: return "throttled";
+        case GOVERNOR_COOL: return "cool";
+        case GOVERNOR_EFFICIENT: return "efficient";
+        case GOVERNOR_EXPLORE: return "explore";
+        default: return "unknown";
+    }
+}
+
+thermal_governor::~thermal_governor() {
+    stop();
+}
+
+bool thermal_governor::start(const thermal_envelope& envelope, int rate_hz) {
+    stop();
+    envelope_ = envelope;
+
+    // Thermal zones in numeric order, filtered by type
+    const std::string thermal_dir = root_ + "/class/thermal";
+    std::vector<int> zones;
+    if (DIR* dir = opendir(thermal_dir.c_str())) {
+        while (dirent* entry = readdir(dir)) {
+            int id;
+            char extra;
+            if (std::sscanf(entry->d_name, "thermal_zone%d%c", &id, &extra) == 1) {
+                zones.push_back(id);
+            }
+        }
+        closedir(dir);
+    }
+    std::sort(zones.begin(), zones.end());
+    for (int id : zones) {
+        if (n_zones_ == MAX_ZONES) break;
+        const std::string zone = thermal_dir + "/thermal_zone" + std::to_string(id);
+        if (!envelope_.zone_filter.empty() &&
+            read_first_line(zone + "/type").find(envelope_.zone_filter) == std::string::npos) {
+            continue;
+        }
+        const int fd = ::open((zone + "/temp").c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            zone_fd_[n_zones_++] = fd;
+        }
+    }
+    if (n_zones_ == 0) {
+        LOGW("No thermal zone matching \"%s\" under %s", envelope_.zone_filter.c_str(), thermal_dir.c_str());
+        return false;
+    }
+
+    // Frequency caps of every core the topology knows
+    const std::string cpu_root = root_ + "/devices/system/cpu";
+    if (!read_cpu_topology(topo_, cpu_root)) {
+        LOGW("CPU topology unavailable under %s, governing pacing only", cpu_root.c_str());
+    }
+    n_cpus_ = 0;
+    for (const cpu_core& core : topo_.cores) {
+        if (core.id >= MAX_CPUS) break;
+        const std::string freq = cpu_root + "/cpu" + std::to_string(core.id) + "/cpufreq";
+        cap_fd_[core.id] = ::open((freq + "/scaling_max_freq").c_str(), O_RDONLY | O_CLOEXEC);
+        max_freq_khz_[core.id] = std::strtoll(read_first_line(freq + "/cpuinfo_max_freq").c_str(), nullptr, 10);
+        n_cpus_ = core.id + 1;
+    }
+    for (int c = 0; c < n_cpus_; c++) {
+        // Offline cores in the middle of the range have no files
+        if (std::none_of(topo_.cores.begin(), topo_.cores.end(), [c](const cpu_core& core) { return core.id == c; })) {
+            cap_fd_[c] = -1;
+        }
+    }
+
+    build_ladder();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.assign(ladder_.size(), level_stats());
+        floor_ = 0;
+        n_decisions_ = 0;
+    }
+    base_pacing_us_.store(0);
+    extra_pacing_us_.store(0);
+    const thermal_reading reading = sample();
+
+    running_.store(true, std::memory_order_release);
+    if (rate_hz > 0) {
+        rate_hz = std::min(rate_hz, 100);
+        thread_ = std::thread(&thermal_governor::run, this, 1000000000LL / rate_hz);
+    }
+
+    LOGD("Thermal governor started: %d zones at %.1f C, target %.1f C, %zu operating points",
+         n_zones_, reading.temp_mc / 1000.0, envelope_.target_mc / 1000.0, ladder_.size());
+    return true;
+}
+
+void thermal_governor::stop() {
+    running_.store(false, std::memory_order_release);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    close_files();
+    base_pacing_us_.store(0);
+    extra_pacing_us_.store(0);
+}
+
+void thermal_governor::close_files() {
+    for (int i = 0; i < n_zones_; i++) {
+        ::close(zone_fd_[i]);
+    }
+    n_zones_ = 0;
+    for (int c = 0; c < n_cpus_; c++) {
+        if (cap_fd_[c] >= 0) ::close(cap_fd_[c]);
+    }
+    n_cpus_ = 0;
+}
+
+void thermal_governor::run(int64_t period_ns) {
+    auto next = std::chrono::steady_clock::now();
+    while (running_.load(std::memory_order_acquire)) {
+        next += std::chrono::nanoseconds(period_ns);
+        std::this_thread::sleep_until(next);
+        sample();
+    }
+}
+
+// Fastest first: the big clusters with all and half of their cores, then the little
+// cluster, then the little cluster at half width with growing inter-token pacing.
+// Points selecting the same cores with the same threads and pacing are merged, so a
+// homogeneous SoC gets full width, half width and the paced rungs.
+void thermal_governor::build_ladder() {
+    ladder_.clear();
+    auto add = [this](placement_policy policy, int n_threads, int pacing_us) {
+        const std::vector<int> cpus = placement_cpus(topo_, policy);
+        for (const operating_point& p : ladder_) {
+            if (p.n_threads == n_threads && p.pacing_us == pacing_us && placement_cpus(topo_, p.policy) == cpus) {
+                return;
+            }
+        }
+        ladder_.push_back({policy, n_threads, pacing_us});
+    };
+
+    placement_policy coolest = PLACEMENT_OS;
+    int coolest_threads = 0;        // 0 keeps the context's thread count
+    if (!topo_.cores.empty()) {
+        const int n_big = placement_cpus(topo_, PLACEMENT_BIG).size();
+        const int n_prime = placement_cpus(topo_, PLACEMENT_PRIME).size();
+        const int n_little = placement_cpus(topo_, PLACEMENT_LITTLE).size();
+        add(PLACEMENT_BIG, n_big, 0);
+        add(PLACEMENT_PRIME, n_prime, 0);
+        add(PLACEMENT_BIG, std::max(1, n_big / 2), 0);
+        add(PLACEMENT_LITTLE, n_little, 0);
+        coolest = PLACEMENT_LITTLE;
+        coolest_threads = std::max(1, n_little / 2);
+    }
+    add(coolest, coolest_threads, 0);
+    for (int pacing_us : {10000, 25000, 50000}) {
+        add(coolest, coolest_threads, std::min(pacing_us, envelope_.max_pacing_us));
+    }
+}
+
+thermal_reading thermal_governor::sample() {
+    thermal_reading r;
+    r.t_ns = steady_ns();
+    for (int i = 0; i < n_zones_; i++) {
+        const int64_t temp = pread_int(zone_fd_[i], -1);
+        // Some zones report -1 or absurd values while their sensor is off
+        if (temp > -40000 && temp < 200000) {
+            r.temp_mc = std::max(r.temp_mc, (int) temp);
+        }
+    }
+    for (int c = 0; c < n_cpus_; c++) {
+        if (cap_fd_[c] < 0 || max_freq_khz_[c] <= 0) continue;
+        const int64_t cap = pread_int(cap_fd_[c], max_freq_khz_[c]);
+        r.cap_permille = std::min(r.cap_permille, (int) std::min<int64_t>(1000, cap * 1000 / max_freq_khz_[c]));
+    }
+
+    // Within a generation the point is fixed, so pacing absorbs heat past the envelope:
+    // one step per sample above target + hysteresis, halved per sample below target
+    if (r.temp_mc >= envelope_.target_mc + envelope_.hysteresis_mc) {
+        const int extra = extra_pacing_us_.load(std::memory_order_relaxed);
+        const int limit = std::max(0, envelope_.max_pacing_us - base_pacing_us_.load(std::memory_order_relaxed));
+        extra_pacing_us_.store(std::min(extra + PACING_STEP_US, limit), std::memory_order_relaxed);
+    } else if (r.temp_mc >= 0 && r.temp_mc < envelope_.target_mc) {
+        extra_pacing_us_.store(extra_pacing_us_.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    latest_ = r;
+    return r;
+}
+
+thermal_reading thermal_governor::latest() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return latest_;
+}
+
+governor_decision thermal_governor::decide() {
+    governor_decision d;
+    d.reading = sample();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ladder_.empty()) return d;
+    const int n_levels = ladder_.size();
+    n_decisions_++;
+
+    const thermal_reading& r = d.reading;
+    if (r.temp_mc >= envelope_.target_mc || r.cap_permille < envelope_.throttle_permille) {
+        floor_ = std::min(floor_ + 1, n_levels - 1);
+        d.reason = r.temp_mc >= envelope_.target_mc ? GOVERNOR_HOT : GOVERNOR_THROTTLED;
+    } else if (r.temp_mc >= 0 && r.temp_mc < envelope_.target_mc - envelope_.hysteresis_mc && floor_ > 0) {
+        floor_--;
+        d.reason = GOVERNOR_COOL;
+    }
+
+    int level = floor_;
+    if (d.reason == GOVERNOR_HOLD) {
+        // Cooler points are allowed too; take one that measured clearly more tokens per
+        // joule. Paced points are left out, idle time between tokens only adds energy.
+        double best = stats_[floor_].tokens_per_joule * (1.0 + EFFICIENCY_MARGIN);
+        for (int l = floor_ + 1; l < n_levels && best > 0.0; l++) {
+            if (ladder_[l].pacing_us == 0 && stats_[l].tokens_per_joule > best) {
+                best = stats_[l].tokens_per_joule;
+                level = l;
+                d.reason = GOVERNOR_EFFICIENT;
+            }
+        }
+        // Now and then measure the next unpaced point that has no sample yet
+        if (level == floor_ && stats_[floor_].n_samples > 0 && n_decisions_ % EXPLORE_EVERY == 0) {
+            for (int l = floor_ + 1; l < n_levels && ladder_[l].pacing_us == 0; l++) {
+                if (stats_[l].n_samples == 0) {
+                    level = l;
+                    d.reason = GOVERNOR_EXPLORE;
+                    break;
+                }
+            }
+        }
+    }
+
+    d.level = level;
+    d.point = ladder_[level];
+    base_pacing_us_.store(d.point.pacing_us, std::memory_order_relaxed);
+    extra_pacing_us_.store(0, std::memory_order_relaxed);
+    LOGD("%s", describe(d).c_str());
+    return d;
+}
+
+void thermal_governor::record(int level, int n_tokens, int64_t energy_uj) {
+    if (n_tokens <= 0 || energy_uj <= 0) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (level < 0 || level >= (int) stats_.size()) return;
+    const double tokens_per_joule = n_tokens * 1e6 / energy_uj;
+    level_stats& s = stats_[level];
+    s.tokens_per_joule = s.n_samples == 0 ? tokens_per_joule
+        : s.tokens_per_joule + EFFICIENCY_ALPHA * (tokens_per_joule - s.tokens_per_joule);
+    s.n_samples++;
+}
+
+std::string thermal_governor::describe(const governor_decision& decision) const {
+    char buf[192];
+    std::snprintf(buf, sizeof(buf), "Governor: level %d (%s x%d, pacing %.0f ms) at %.1f C, cap %d%%: %s",
+                  decision.level, placement_policy_name(decision.point.policy), decision.point.n_threads,
+                  decision.point.pacing_us / 1000.0, decision.reading.temp_mc / 1000.0,
+                  decision.reading.cap_permille / 10, governor_reason_name(decision.reason));
+    return buf;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "cpu_topology.h"
+
+// Holds generation inside a thermal envelope. A background thread samples the thermal
+// zones and the cpufreq caps; before each generation the governor picks an operating
+// point (core placement, thread count and inter-token pacing) from a ladder built from
+// the CPU topology. It steps towards cooler points while the hottest zone is above the
+// target or the kernel has capped frequencies, steps back once the zones cool below
+// target - hysteresis, and among the points the envelope allows prefers the one with
+// the best measured tokens per joule. Pacing also reacts within a generation.
+//
+// The sysfs root is injectable so scripted temperature traces can be replayed against a
+// fake tree on a host (bench/thermal_replay.cpp):
+//   <root>/class/thermal/thermal_zone0/type                            "cpu-thermal"
+//   <root>/class/thermal/thermal_zone0/temp                            "45200" (mC)
+//   <root>/devices/system/cpu/cpu4/cpufreq/scaling_max_freq            "1804800"
+//   <root>/devices/system/cpu/cpu4/cpufreq/cpuinfo_max_freq            "2400000"
+
+struct thermal_envelope {
+    int target_mc = 45000;          // hottest zone temperature to hold, millidegrees Celsius
+    int hysteresis_mc = 3000;       // cool this far below the target before stepping back
+    int throttle_permille = 900;    // a cpufreq cap below this share of the maximum counts as throttling
+    int max_pacing_us = 100000;     // ceiling of the pacing added within a generation
+    std::string zone_filter;        // only zones whose type contains this, e.g. "cpu"; empty for all
+};
+
+struct thermal_reading {
+    int64_t t_ns = 0;               // steady clock, same timebase as now_ns()
+    int temp_mc = -1;               // hottest matching zone, -1 if none could be read
+    int cap_permille = 1000;        // lowest scaling_max_freq / cpuinfo_max_freq over the cores
+};
+
+// One rung of the ladder, fastest first
+struct operating_point {
+    placement_policy policy;
+    int n_threads;
+    int pacing_us;                  // sleep after each decoded token
+};
+
+// Why decide() picked its level; values are recorded in the generation metrics
+enum governor_reason {
+    GOVERNOR_HOLD = 0,              // inside the envelope, nothing better measured
+    GOVERNOR_HOT,                   // above the target temperature, stepped down
+    GOVERNOR_THROTTLED,             // frequencies capped by the kernel, stepped down
+    GOVERNOR_COOL,                  // below target - hysteresis, stepped back up
+    GOVERNOR_EFFICIENT,             // a cooler allowed point measured more tokens per joule
+    GOVERNOR_EXPLORE,               // measuring an allowed point that has no sample yet
+};
+
+struct governor_decision {
+    int level = -1;
+    operating_point point = {PLACEMENT_OS, 0, 0};
+    thermal_reading reading;
+    governor_reason reason = GOVERNOR_HOLD;
+};
+
+class thermal_governor {
+public:
+    static constexpr int MAX_ZONES = 32;
+    static constexpr int MAX_CPUS = 16;
+    static constexpr int EXPLORE_EVERY = 8;     // decisions between explorations of unmeasured points
+
+    explicit thermal_governor(std::string sysfs_root = "/sys") : root_(std::move(sysfs_root)) {}
+    ~thermal_governor();
+    thermal_governor(const thermal_governor&) = delete;
+    thermal_governor& operator=(const thermal_governor&) = delete;
+
+    // Opens the matching thermal zones and the cpufreq files, builds the ladder for the
+    // topology found below the root and samples at `rate_hz` (clamped to 1..100; 0 takes
+    // no thread, the caller drives sample()). Restarts if running. False if no zone matches.
+    bool start(const thermal_envelope& envelope, int rate_hz);
+    void stop();
+    bool running() const { return running_.load(std::memory_order_acquire); }
+
+    // Reads the zones and caps now and adjusts the pacing of the current generation
+    thermal_reading sample();
+    thermal_reading latest() const;
+
+    // Operating point for the next generation, logged with its reason
+    governor_decision decide();
+
+    // Feedback from a generation run at `level`; energy_uj < 0 (no power sampler)
+    // leaves the efficiency estimate untouched
+    void record(int level, int n_tokens, int64_t energy_uj);
+
+    // Sleep after each decoded token: the pacing of the decided point plus whatever
+    // sample() added while the zones were above the envelope
+    int pacing_us() const {
+        return base_pacing_us_.load(std::memory_order_relaxed) + extra_pacing_us_.load(std::memory_order_relaxed);
+    }
+
+    const cpu_topology& topology() const { return topo_; }
+    const std::vector<operating_point>& ladder() const { return ladder_; }
+
+    std::string describe(const governor_decision& decision) const;
+
+private:
+    struct level_stats {
+        double tokens_per_joule = 0.0;  // moving average, 0 until measured
+        int n_samples = 0;
+    };
+
+    void run(int64_t period_ns);
+    void build_ladder();
+    void close_files();
+
+    std::string root_;
+    thermal_envelope envelope_;
+    cpu_topology topo_;
+    std::vector<operating_point> ladder_;
+    int zone_fd_[MAX_ZONES];
+    int n_zones_ = 0;
+    int cap_fd_[MAX_CPUS];          // scaling_max_freq, -1 where cpufreq is not exposed
+    int64_t max_freq_khz_[MAX_CPUS] = {};
+    int n_cpus_ = 0;
+
+    mutable std::mutex mutex_;
+    thermal_reading latest_;
+    std::vector<level_stats> stats_;
+    int floor_ = 0;                 // fastest level the envelope currently allows
+    int n_decisions_ = 0;
+
+    std::atomic<int> base_pacing_us_{0};
+    std::atomic<int> extra_pacing_us_{0};
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+};
+
+const char* governor_reason_name(governor_reason reason);
@@ -0,0 +1,84 @@
+#include "token_cache.h"
+
+#include "llm_core.h"
+#include "native_log.h"
+
+namespace {
+
+uint64_t cache_key(const llama_vocab* vocab, std::string_view text, bool add_special) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 0x100000001b3ull;
+    }
+    hash ^= (uint64_t) (uintptr_t) vocab * 0x9e3779b97f4a7c15ull;
+    return add_special ? ~hash : hash;
+}
+
+} // namespace
+
+const std::vector<llama_token>& token_cache::get(const llama_vocab* vocab, std::string_view text, bool add_special) {
+    const uint64_t key = cache_key(vocab, text, add_special);
+    auto it = index.find(key);
+    if (it != index.end()) {
+        entry& e = *it->second;
+        if (e.vocab == vocab && e.add_special == add_special && e.text == text) {
+            n_hits++;
+            entries.splice(entries.begin(), entries, it->second);
+            return e.tokens;
+        }
+        // Collision: the slot goes to the new text
+        entries.erase(it->second);
+        index.erase(it);
+    }
+
+    n_misses++;
+    if (entries.size() >= capacity && !entries.empty()) {
+        index.erase(entries.back().key);
+        entries.pop_back();
+    }
+    entries.push_front(entry{key, vocab, add_special, std::string(text), tokenize(vocab, text, add_special)});
+    index[key] = entries.begin();
+    return entries.front().tokens;
+}
+
+void token_cache::clear() {
+    entries.clear();
+    index.clear();
+}
+
+bool pretokenize(const llama_vocab* vocab, const std::vector<std::string>& prompts, bool add_special,
+                 token_arena& arena) {
+    size_t n_bytes = 0;
+    for (const std::string& prompt : prompts) {
+        n_bytes += prompt.size() + 2;
+    }
+    // A token covers at least one byte, so this is enough unless specials are added
+    arena.tokens.resize(n_bytes);
+    arena.offsets.assign(1, 0);
+    arena.offsets.reserve(prompts.size() + 1);
+
+    size_t used = 0;
+    for (size_t i = 0; i < prompts.size(); i++) {
+        const std::string& text = prompts[i];
+        int n = llama_tokenize(vocab, text.data(), text.size(), arena.tokens.data() + used,
+                               arena.tokens.size() - used, add_special, false);
+        if (n < 0) {
+            arena.tokens.resize(used - n);
+            n = llama_tokenize(vocab, text.data(), text.size(), arena.tokens.data() + used,
+                               arena.tokens.size() - used, add_special, false);
+        }
+        if (n <= 0) {
+            LOGE("Prompt %zu tokenized to nothing", i);
+            arena.tokens.clear();
+            arena.offsets.clear();
+            return false;
+        }
+        used += n;
+        arena.offsets.push_back(used);
+    }
+    arena.tokens.resize(used);
+    arena.tokens.shrink_to_fit();
+
+    LOGD("Pretokenized %zu prompts into %zu tokens", prompts.size(), used);
+    return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "llama.cpp/include/llama.h"
+
+// Tokenization reuse for prompts that repeat. QueryScheduler cycles through the same
+// test queries forever, so after the first pass every prompt is either found in the
+// per-context LRU cache or was tokenized once at load time into the prompt arena.
+
+// LRU cache of tokenizations keyed by (vocab, text, add_special). The text is kept
+// with each entry so a hash collision is a miss, never a wrong prompt.
+class token_cache {
+public:
+    explicit token_cache(size_t capacity = 64) : capacity(capacity) {}
+
+    // Tokens of `text`, tokenized on a miss. The reference stays valid until the next
+    // call that inserts an entry.
+    const std::vector<llama_token>& get(const llama_vocab* vocab, std::string_view text, bool add_special);
+
+    void clear();
+    size_t size() const { return entries.size(); }
+    int64_t hits() const { return n_hits; }
+    int64_t misses() const { return n_misses; }
+
+private:
+    struct entry {
+        uint64_t key;
+        const llama_vocab* vocab;
+        bool add_special;
+        std::string text;
+        std::vector<llama_token> tokens;
+    };
+
+    size_t capacity;
+    std::list<entry> entries;       // most recently used first
+    std::unordered_map<uint64_t, std::list<entry>::iterator> index;
+    int64_t n_hits = 0;
+    int64_t n_misses = 0;
+};
+
+// A fixed prompt set tokenized back to back into one buffer. Prompt i occupies
+// tokens[offsets[i], offsets[i + 1]).
+struct token_arena {
+    std::vector<llama_token> tokens;
+    std::vector<uint32_t> offsets;
+
+    int size() const { return offsets.empty() ? 0 : (int) offsets.size() - 1; }
+    const llama_token* prompt(int i) const { return tokens.data() + offsets[i]; }
+    int prompt_size(int i) const { return offsets[i + 1] - offsets[i]; }
+};
+
+// Replaces the contents of `arena` with the tokens of `prompts`, writing each one
+// directly at the end of the buffer. False (and an empty arena) if any prompt
+// tokenizes to nothing.
+bool pretokenize(const llama_vocab* vocab, const std::vector<std::string>& prompts, bool add_special,
+                 token_arena& arena);
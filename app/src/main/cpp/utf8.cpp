@@ -0,0 +1,97 @@
+#include "utf8.h"
+
+#include <cstdint>
+
+namespace {
+
+constexpr char16_t REPLACEMENT = 0xFFFD;
+
+void append_utf8(uint32_t cp, std::string& out) {
+    if (cp < 0x80) {
+        out.push_back((char) cp);
+    } else if (cp < 0x800) {
+        out.push_back((char) (0xC0 | (cp >> 6)));
+        out.push_back((char) (0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back((char) (0xE0 | (cp >> 12)));
+        out.push_back((char) (0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back((char) (0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back((char) (0xF0 | (cp >> 18)));
+        out.push_back((char) (0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back((char) (0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back((char) (0x80 | (cp & 0x3F)));
+    }
+}
+
+} // namespace
+
+void utf8_to_utf16(const char* text, size_t n, std::u16string& out) {
+    static constexpr uint32_t MIN_CODE_POINT[5] = {0, 0, 0x80, 0x800, 0x10000};
+
+    out.clear();
+    out.reserve(n);
+    const auto* s = reinterpret_cast<const unsigned char*>(text);
+    size_t i = 0;
+    while (i < n) {
+        const unsigned char c = s[i];
+        if (c < 0x80) {
+            out.push_back(c);
+            i++;
+            continue;
+        }
+
+        size_t len;
+        uint32_t cp;
+        if ((c & 0xE0) == 0xC0) {
+            len = 2;
+            cp = c & 0x1F;
+        } else if ((c & 0xF0) == 0xE0) {
+            len = 3;
+            cp = c & 0x0F;
+        } else if ((c & 0xF8) == 0xF0) {
+            len = 4;
+            cp = c & 0x07;
+        } else {
+            out.push_back(REPLACEMENT);
+            i++;
+            continue;
+        }
+
+        size_t k = 1;
+        while (k < len && i + k < n && (s[i + k] & 0xC0) == 0x80) {
+            cp = (cp << 6) | (s[i + k] & 0x3F);
+            k++;
+        }
+        if (k < len || cp < MIN_CODE_POINT[len] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            // Truncated, overlong or not a scalar value: replace what was consumed
+            out.push_back(REPLACEMENT);
+            i += k;
+            continue;
+        }
+
+        if (cp >= 0x10000) {
+            cp -= 0x10000;
+            out.push_back((char16_t) (0xD800 + (cp >> 10)));
+            out.push_back((char16_t) (0xDC00 + (cp & 0x3FF)));
+        } else {
+            out.push_back((char16_t) cp);
+        }
+        i += len;
+    }
+}
+
+void utf16_to_utf8(const char16_t* text, size_t n, std::string& out) {
+    out.clear();
+    out.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t cp = text[i];
+        if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < n && text[i + 1] >= 0xDC00 && text[i + 1] <= 0xDFFF) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (text[i + 1] - 0xDC00);
+            i++;
+        } else if (cp >= 0xD800 && cp <= 0xDFFF) {
+            cp = REPLACEMENT;
+        }
+        append_utf8(cp, out);
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Conversions between standard UTF-8, which llama.cpp reads and writes, and the UTF-16
+// of Java strings. JNI's *StringUTF* functions use modified UTF-8 instead, which
+// encodes characters outside the BMP (emoji, rarer CJK) as two 3-byte surrogates, so
+// text crossing the boundary as a jstring goes through these.
+
+// Malformed or truncated sequences become U+FFFD
+void utf8_to_utf16(const char* text, size_t n, std::u16string& out);
+
+// Unpaired surrogates become U+FFFD
+void utf16_to_utf8(const char16_t* text, size_t n, std::string& out);
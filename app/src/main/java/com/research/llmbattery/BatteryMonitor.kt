@@ -19,6 +19,7 @@ import kotlinx.coroutines.flow.asStateFlow
 import java.io.BufferedReader
 import java.io.FileReader
 import java.io.IOException
+import java.util.concurrent.atomic.AtomicLong
 import kotlin.math.max
 import kotlin.math.roundToInt
 
@@ -50,6 +51,22 @@ class BatteryMonitor(
     private var monitoringJob: Job? = null
     private val monitoringScope = CoroutineScope(Dispatchers.IO + SupervisorJob())
     
+    /**
+     * Optional native CPU usage reader (LLMService.getCpuUsage). When set and it returns a
+     * non-negative value, it replaces the /proc/stat parsing below.
+     */
+    var nativeCpuUsage: (() -> Float)? = null
+    
+    // Cost of the Kotlin /proc/stat reads, kept like proc_sampler::mean_sample_ns
+    private val cpuSampleNsTotal = AtomicLong(0)
+    private val cpuSamples = AtomicLong(0)
+    
+    /**
+     * Optional native memory reader (LLMService.getMemoryUsage). When set and it returns a
+     * non-negative value, it replaces the slow, rate-limited ActivityManager query below.
+     */
+    var nativeMemoryUsage: (() -> Long)? = null
+    
     // Battery state tracking
     private val _batteryLevelFlow = MutableStateFlow(0)
     val batteryLevelFlow: StateFlow<Int> = _batteryLevelFlow.asStateFlow()
@@ -203,20 +220,17 @@ class BatteryMonitor(
      * @return CPU usage percentage (0.0-100.0), or 0.0 if unable to read
      */
     fun getCPUUsage(): Float {
+        val nativeUsage = nativeCpuUsage?.invoke() ?: -1f
+        if (nativeUsage >= 0f) {
+            return minOf(100.0f, nativeUsage)
+        }
         return try {
-            val reader1 = BufferedReader(FileReader("/proc/stat"))
-            val line1 = reader1.readLine()
-            reader1.close()
+            val values1 = readCpuTimes()
             
             // Wait 100ms for more accurate reading
             Thread.sleep(100)
             
-            val reader2 = BufferedReader(FileReader("/proc/stat"))
-            val line2 = reader2.readLine()
-            reader2.close()
-            
-            val values1 = line1.split("\\s+".toRegex()).drop(1).mapNotNull { it.toLongOrNull() }
-            val values2 = line2.split("\\s+".toRegex()).drop(1).mapNotNull { it.toLongOrNull() }
+            val values2 = readCpuTimes()
             
             if (values1.size >= 4 && values2.size >= 4) {
                 val idle1 = values1[3]
@@ -243,12 +257,60 @@ class BatteryMonitor(
     }
     
     /**
-     * Gets the current memory usage of the application in bytes.
-     * Uses ActivityManager to get detailed memory information for the current process.
+     * Reads and parses the aggregate CPU line of /proc/stat: one sample of the Kotlin CPU
+     * usage path. Its wall time is accumulated the way the native CPU sampler accounts
+     * for its own samples, so the two costs can be compared.
+     * 
+     * @return Jiffies per CPU state (user, nice, system, idle, ...)
+     */
+    private fun readCpuTimes(): List<Long> {
+        val start = System.nanoTime()
+        val line = BufferedReader(FileReader("/proc/stat")).use { it.readLine() }
+        val values = line.split("\\s+".toRegex()).drop(1).mapNotNull { it.toLongOrNull() }
+        cpuSampleNsTotal.addAndGet(System.nanoTime() - start)
+        cpuSamples.incrementAndGet()
+        return values
+    }
+    
+    /**
+     * Average cost of one Kotlin /proc/stat sample so far, the counterpart of the native
+     * sampler's [LLMService.getCpuSampleUs]. getCPUUsage takes two samples per call
+     * when it does not use the native reader.
+     * 
+     * @return Mean microseconds per sample, or 0 before the first sample
+     */
+    fun getCpuSampleUs(): Float {
+        val n = cpuSamples.get()
+        return if (n > 0) cpuSampleNsTotal.get() / 1000f / n else 0f
+    }
+    
+    /**
+     * Takes Kotlin /proc/stat samples back to back to measure their cost, e.g. while the
+     * native reader serves getCPUUsage and the Kotlin path is otherwise never taken.
+     * 
+     * @param iterations Samples to take
+     * @return Mean microseconds per sample over all Kotlin samples so far
+     */
+    fun measureCpuSampleUs(iterations: Int = 200): Float {
+        try {
+            repeat(iterations) { readCpuTimes() }
+        } catch (e: Exception) {
+            e.printStackTrace()
+        }
+        return getCpuSampleUs()
+    }
+    
+    /**
+     * Gets the current memory usage (PSS) of the application in bytes.
+     * Uses the native /proc reader when available, otherwise ActivityManager.
      * 
      * @return Memory usage in bytes, or 0 if unable to read
      */
     fun getMemoryUsage(): Long {
+        val nativeUsage = nativeMemoryUsage?.invoke() ?: -1L
+        if (nativeUsage >= 0L) {
+            return nativeUsage
+        }
         return try {
             val activityManager = context.getSystemService(Context.ACTIVITY_SERVICE) as ActivityManager
             val memoryInfo = ActivityManager.MemoryInfo()
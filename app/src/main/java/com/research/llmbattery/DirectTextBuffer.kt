@@ -0,0 +1,60 @@
+package com.research.llmbattery
+
+import java.nio.ByteBuffer
+import java.nio.CharBuffer
+import java.nio.charset.CodingErrorAction
+import java.nio.charset.StandardCharsets
+
+/**
+ * Reusable direct ByteBuffer holding standard UTF-8 text for native code. Native code
+ * reads and writes it in place through GetDirectBufferAddress, so text passed this way
+ * skips the modified UTF-8 conversion and copies of the jstring JNI functions, and
+ * 4-byte characters such as emoji survive. The buffer grows on demand and is not
+ * thread-safe.
+ *
+ * @param initialCapacity Starting size in bytes
+ */
+class DirectTextBuffer(initialCapacity: Int = DEFAULT_CAPACITY) {
+
+    var buffer: ByteBuffer = ByteBuffer.allocateDirect(initialCapacity)
+        private set
+    
+    private val encoder = StandardCharsets.UTF_8.newEncoder()
+        .onMalformedInput(CodingErrorAction.REPLACE)
+        .onUnmappableCharacter(CodingErrorAction.REPLACE)
+    
+    /** Makes sure the buffer holds at least [bytes] bytes; the contents are discarded. */
+    fun ensureCapacity(bytes: Int): ByteBuffer {
+        if (buffer.capacity() < bytes) {
+            buffer = ByteBuffer.allocateDirect(bytes)
+        }
+        return buffer
+    }
+    
+    /**
+     * Encodes [text] as UTF-8 directly into the buffer.
+     *
+     * @return Number of bytes written, starting at position 0
+     */
+    fun encode(text: String): Int {
+        // A UTF-16 unit never takes more than 3 UTF-8 bytes (a surrogate pair takes 4)
+        val target = ensureCapacity(text.length * 3)
+        target.clear()
+        encoder.reset()
+        encoder.encode(CharBuffer.wrap(text), target, true)
+        encoder.flush(target)
+        return target.position()
+    }
+    
+    /** Decodes the first [length] bytes of the buffer as UTF-8. */
+    fun decode(length: Int): String {
+        val view = buffer.duplicate()
+        view.clear()
+        view.limit(length)
+        return StandardCharsets.UTF_8.decode(view).toString()
+    }
+    
+    companion object {
+        private const val DEFAULT_CAPACITY = 4096
+    }
+}
@@ -0,0 +1,115 @@
+package com.research.llmbattery
+
+import android.util.Log
+import java.nio.ByteBuffer
+
+/**
+ * Microbenchmark of the two ways generated text can cross JNI, with no inference in
+ * between:
+ * - String: GetStringUTFChars, a std::string copy and NewStringUTF, the path
+ *   nativeGenerate used to take
+ * - Direct: UTF-8 encoded into a [DirectTextBuffer], one native copy into a second
+ *   buffer and one UTF-8 decode, the path of [LLMService.generateResponseDirect]
+ *
+ * Each length is measured as a full round trip from a Kotlin String back to a Kotlin
+ * String. The text mixes ASCII, accented, CJK and emoji characters like model output.
+ */
+object JniIoBenchmark {
+
+    private const val TAG = "JniIoBenchmark"
+    private val DEFAULT_LENGTHS = listOf(64, 512, 4096, 32768, 262144)
+    private const val DEFAULT_ITERATIONS = 200
+    private const val SAMPLE_TEXT = "The model answered: café, naïve, 機械学習 and 人工知能 🙂🚀\n"
+    
+    /**
+     * Round trip cost of one text length.
+     *
+     * @property bytes UTF-8 length of the text
+     * @property stringUs Mean microseconds per jstring round trip
+     * @property directUs Mean microseconds per direct buffer round trip
+     */
+    data class Result(
+        val bytes: Int,
+        val stringUs: Float,
+        val directUs: Float
+    ) {
+        val speedup: Float
+            get() = if (directUs > 0f) stringUs / directUs else 0f
+    }
+    
+    private val nativeLibraryLoaded: Boolean = try {
+        System.loadLibrary("llama-jni")
+        true
+    } catch (e: UnsatisfiedLinkError) {
+        Log.w(TAG, "llama-jni not available: ${e.message}")
+        false
+    }
+    
+    /**
+     * Runs the benchmark.
+     *
+     * @param lengths UTF-8 text lengths in bytes
+     * @param iterations Round trips timed per length and path
+     * @return One result per length, empty if the native library is missing
+     */
+    fun run(lengths: List<Int> = DEFAULT_LENGTHS, iterations: Int = DEFAULT_ITERATIONS): List<Result> {
+        if (!nativeLibraryLoaded) return emptyList()
+        
+        val input = DirectTextBuffer()
+        val output = DirectTextBuffer()
+        return lengths.map { length ->
+            val text = sampleText(length)
+            val bytes = input.encode(text)
+            output.ensureCapacity(bytes)
+            
+            // Warm up both paths and check the direct one returns the text unchanged
+            nativeEchoString(text)
+            val echoed = nativeEchoDirect(input.buffer, bytes, output.buffer)
+            if (echoed != bytes || output.decode(echoed) != text) {
+                Log.w(TAG, "Direct round trip of $bytes bytes changed the text")
+            }
+            
+            var start = System.nanoTime()
+            repeat(iterations) {
+                nativeEchoString(text)
+            }
+            val stringUs = (System.nanoTime() - start) / 1000f / iterations
+            
+            start = System.nanoTime()
+            repeat(iterations) {
+                val n = nativeEchoDirect(input.buffer, input.encode(text), output.buffer)
+                output.decode(n)
+            }
+            val directUs = (System.nanoTime() - start) / 1000f / iterations
+            
+            Result(bytes, stringUs, directUs)
+        }
+    }
+    
+    /**
+     * Runs the benchmark and formats the results as a table, also written to the log.
+     */
+    fun report(lengths: List<Int> = DEFAULT_LENGTHS, iterations: Int = DEFAULT_ITERATIONS): String {
+        val results = run(lengths, iterations)
+        if (results.isEmpty()) return "JNI I/O benchmark unavailable"
+        
+        val table = buildString {
+            appendLine(String.format("%10s %12s %12s %8s", "bytes", "string_us", "direct_us", "speedup"))
+            for (r in results) {
+                appendLine(String.format("%10d %12.1f %12.1f %7.2fx", r.bytes, r.stringUs, r.directUs, r.speedup))
+            }
+        }
+        table.lineSequence().filter { it.isNotEmpty() }.forEach { Log.i(TAG, it) }
+        return table
+    }
+    
+    // Sample text repeated to at least `bytes` UTF-8 bytes
+    private fun sampleText(bytes: Int): String {
+        val unitBytes = SAMPLE_TEXT.toByteArray(Charsets.UTF_8).size
+        return SAMPLE_TEXT.repeat((bytes + unitBytes - 1) / unitBytes)
+    }
+    
+    // Native bindings (llama-wrapper.cpp)
+    private external fun nativeEchoString(text: String): String
+    private external fun nativeEchoDirect(input: ByteBuffer, length: Int, output: ByteBuffer): Int
+}
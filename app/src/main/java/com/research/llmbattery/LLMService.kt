@@ -1,9 +1,26 @@
 package com.research.llmbattery
 
 import android.content.Context
+import android.content.res.AssetFileDescriptor
 import android.util.Log
+import com.research.llmbattery.models.ContextMemory
+import com.research.llmbattery.models.CpuSeries
+import com.research.llmbattery.models.MemorySnapshot
+import com.research.llmbattery.models.ModelConfig
+import com.research.llmbattery.models.ModelLoadMetrics
+import com.research.llmbattery.models.NativeMetrics
+import com.research.llmbattery.models.PrefixState
+import com.research.llmbattery.models.RequestProgress
+import com.research.llmbattery.models.SpeculativeStats
+import com.research.llmbattery.models.SweepConfig
+import com.research.llmbattery.models.ThreadPlacement
 import java.io.File
+import java.io.IOException
+import java.nio.ByteBuffer
+import kotlinx.coroutines.CancellationException
+import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.delay
+import kotlinx.coroutines.withContext
 
 /**
  * LLMService class that uses MLC-LLM for Android LLM inference.
@@ -13,51 +30,153 @@ import kotlinx.coroutines.delay
  * Features:
  * - MLC-LLM model loading from assets/models/ directory
  * - Pre-built Android library integration
- * - Async inference execution with coroutines
+ * - Async inference execution with coroutines; native requests are queued on an engine
+ *   thread and awaited by polling, and cancelling the coroutine aborts the generation
  * - Memory usage tracking and inference time measurement
+ * - Streaming token delivery from llama.cpp with time-to-first-token and inter-token latency
  * - Thread-safe operations with proper state management
  * - Comprehensive error handling and logging
  */
 class LLMService(private val context: Context) {
     
     private var engine: MockMLCEngine? = null
+    private var nativeContext: Long = 0L
     private var modelPath: String? = null
     var isModelLoaded: Boolean = false
         private set
     var quantizationType: String = ""
         private set
     private var lastInferenceTimeMs: Long = 0
+    private var lastTimeToFirstTokenMs: Long = 0
+    private var lastInterTokenLatencyMs: Float = 0f
+    private var lastMetrics: NativeMetrics? = null
+    private var lastLoadMetrics: ModelLoadMetrics? = null
+    private var contextMemory: ContextMemory? = null
+    private var memoryAfterFree: MemorySnapshot? = null
+    private var lastDecodeTokensPerSecond: Float = 0f
+    private val promptBuffer = DirectTextBuffer()
+    private val responseBuffer = DirectTextBuffer()
+    private val chatSessions = mutableSetOf<ChatSession>()
+    /** Prompts passed to the last successful [pretokenize], empty after a model change. */
+    var pretokenizedPrompts: List<String> = emptyList()
+        private set
     
     /**
-     * Loads a model from external storage using MLC-LLM.
+     * Loads a model. The native engine maps the GGUF packaged under assets/models straight
+     * from the APK and falls back to a copy in /sdcard/Download; the mock engine needs the
+     * /sdcard/Download copy.
      * 
      * @param modelFileName Name of the model file (e.g., "qwen2.5-0.5b-instruct-q2_k.gguf")
      * @return True if model loaded successfully, false otherwise
      */
     fun loadModel(modelFileName: String): Boolean {
+        return loadModel(ModelConfig.create(modelFileName, modelFileName, detectQuantizationType(modelFileName), 0f))
+    }
+    
+    /**
+     * Loads the model file named by config.modelPath and creates its native context with
+     * the config's context size, batch sizes, KV cache precision, flash attention and
+     * offload settings. The mock engine ignores the context settings.
+     * 
+     * @param config Model and context configuration
+     * @return True if model loaded successfully, false otherwise
+     */
+    fun loadModel(config: ModelConfig): Boolean {
+        val modelFileName = config.modelPath
         return try {
             Log.i(TAG, "Loading model: $modelFileName")
             
-            // Look for model in external storage first
             val externalModelFile = File("/sdcard/Download", modelFileName)
+            val loadedPath: String
             
-            if (!externalModelFile.exists()) {
-                Log.e(TAG, "Model not found in /sdcard/Download/: $modelFileName")
-                Log.e(TAG, "Please copy the model file to /sdcard/Download/ directory")
-                return false
+            if (nativeLibraryLoaded) {
+                // Switching models frees the old context; its weights stay resident in the
+                // native registry until the memory budget needs the space
+                if (nativeContext != 0L) {
+                    closeChatSessions()
+                    nativeFree(nativeContext)
+                    nativeContext = 0L
+                    pretokenizedPrompts = emptyList()
+                    memoryAfterFree = probeMemory()
+                }
+                val phases = ModelLoadMetrics.newArray()
+                val assetPath = "$ASSET_MODEL_DIR/$modelFileName"
+                val asset = openModelAsset(assetPath)
+                if (asset != null) {
+                    nativeContext = asset.use { afd ->
+                        nativeInitFromFd(
+                            afd.parcelFileDescriptor.fd,
+                            afd.startOffset,
+                            afd.length,
+                            context.noBackupFilesDir.absolutePath,
+                            DEFAULT_THREADS,
+                            config.contextSize,
+                            config.batchSize,
+                            config.microBatchSize,
+                            MAX_PARALLEL_SEQUENCES,
+                            config.kvCacheTypeK.code,
+                            config.kvCacheTypeV.code,
+                            config.flashAttention.code,
+                            config.offloadKqv,
+                            config.opOffload,
+                            phases
+                        )
+                    }
+                    loadedPath = "asset:$assetPath"
+                } else if (externalModelFile.exists()) {
+                    nativeContext = nativeInit(
+                        externalModelFile.absolutePath,
+                        DEFAULT_THREADS,
+                        config.contextSize,
+                        config.batchSize,
+                        config.microBatchSize,
+                        MAX_PARALLEL_SEQUENCES,
+                        config.kvCacheTypeK.code,
+                        config.kvCacheTypeV.code,
+                        config.flashAttention.code,
+                        config.offloadKqv,
+                        config.opOffload,
+                        phases
+                    )
+                    loadedPath = externalModelFile.absolutePath
+                } else {
+                    Log.e(TAG, "Model not found in assets/$ASSET_MODEL_DIR or /sdcard/Download/: $modelFileName")
+                    return false
+                }
+                if (nativeContext == 0L) {
+                    Log.e(TAG, "llama.cpp failed to load model: $modelFileName")
+                    return false
+                }
+                lastLoadMetrics = ModelLoadMetrics.fromArray(phases)
+                Log.i(TAG, "Load phases: $lastLoadMetrics")
+                val memory = ContextMemory.newArray()
+                contextMemory = if (nativeGetContextMemory(nativeContext, memory)) ContextMemory.fromArray(memory) else null
+                Log.i(TAG, "Context memory: ${nativeDescribeContextMemory(nativeContext)}")
+                contextMemory?.let { Log.i(TAG, "Process memory at load: ${it.loadMemory}") }
+                startPowerSampling()
+                startCpuSampling()
+                if (config.thermalTargetCelsius > 0f) {
+                    startThermalGovernor(config.thermalTargetCelsius)
+                }
+            } else {
+                if (!externalModelFile.exists()) {
+                    Log.e(TAG, "Model not found in /sdcard/Download/: $modelFileName")
+                    Log.e(TAG, "Please copy the model file to /sdcard/Download/ directory")
+                    return false
+                }
+                // Mock MLC engine initialization
+                engine = MockMLCEngine(externalModelFile.absolutePath)
+                loadedPath = externalModelFile.absolutePath
             }
             
-            // Mock MLC engine initialization
-            engine = MockMLCEngine(externalModelFile.absolutePath)
-            
-            modelPath = externalModelFile.absolutePath
+            modelPath = loadedPath
             isModelLoaded = true
             
             // Detect quantization type from model name
             quantizationType = detectQuantizationType(modelFileName)
             
             Log.i(TAG, "Model loaded successfully")
-            Log.i(TAG, "Model path: ${externalModelFile.absolutePath}")
+            Log.i(TAG, "Model path: $loadedPath")
             Log.i(TAG, "Quantization: $quantizationType")
             true
         } catch (e: Exception) {
@@ -69,39 +188,792 @@ class LLMService(private val context: Context) {
     
     /**
      * Generates a response for the given prompt using the loaded model.
+     * When the native library is available, the prompt is submitted to the native
+     * inference engine and awaited without blocking a thread; time-to-first-token and
+     * mean inter-token latency are recorded from native timestamps. Cancelling the
+     * calling coroutine cancels the generation.
      * 
      * @param prompt The input prompt for the LLM
+     * @param onPartial Optional listener receiving each streamed chunk of text
      * @return Generated response string, or error message if failed
      */
-    suspend fun generateResponse(prompt: String): String {
-        if (!isModelLoaded || engine == null) {
+    suspend fun generateResponse(prompt: String, onPartial: ((String) -> Unit)? = null): String {
+        if (!isModelLoaded || (engine == null && nativeContext == 0L)) {
             return "Error: Model not loaded"
         }
         
         return try {
             val startTime = System.currentTimeMillis()
+            lastMetrics = null
             
-            // Simulate inference delay
-            delay(1000) // 1 second delay to simulate real inference
+            val response = if (nativeContext != 0L) {
+                val startNs = System.nanoTime()
+                val requestId = nativeSubmit(nativeContext, prompt, DEFAULT_MAX_TOKENS, STREAM_FLUSH_TOKENS)
+                awaitRequest(requestId, startNs, onPartial)
+            } else {
+                // Simulate inference delay
+                delay(1000) // 1 second delay to simulate real inference
+                engine!!.chat(prompt, maxTokens = DEFAULT_MAX_TOKENS)
+            }
             
-            val response = engine!!.chat(prompt, maxTokens = 512)
+            lastInferenceTimeMs = System.currentTimeMillis() - startTime
+            Log.i(TAG, "Inference completed in ${lastInferenceTimeMs}ms " +
+                    "(TTFT ${lastTimeToFirstTokenMs}ms, ITL ${lastInterTokenLatencyMs}ms)")
+            
+            response
+        } catch (e: CancellationException) {
+            throw e
+        } catch (e: Exception) {
+            Log.e(TAG, "Inference failed: ${e.message}", e)
+            "Error: ${e.message}"
+        }
+    }
+    
+    /**
+     * Tokenizes a fixed prompt set once, so [generateResponseByIndex] can run any of them
+     * without tokenizing on the query path. Replaces the previously pretokenized set.
+     * 
+     * @param prompts Prompts in the order they will be addressed by index
+     * @return True if every prompt was tokenized
+     */
+    suspend fun pretokenize(prompts: List<String>): Boolean {
+        if (!isModelLoaded || nativeContext == 0L) {
+            return false
+        }
+        
+        return withContext(Dispatchers.IO) {
+            val startNs = System.nanoTime()
+            if (nativePretokenize(nativeContext, prompts.toTypedArray())) {
+                pretokenizedPrompts = prompts.toList()
+                Log.i(TAG, "Pretokenized ${prompts.size} prompts in ${(System.nanoTime() - startNs) / 1000}us")
+                true
+            } else {
+                pretokenizedPrompts = emptyList()
+                Log.e(TAG, "Failed to pretokenize prompts")
+                false
+            }
+        }
+    }
+    
+    /**
+     * Generates a response for a prompt passed to [pretokenize], identified by its index.
+     * Behaves like [generateResponse] but skips tokenization entirely.
+     * 
+     * @param index Position of the prompt in the pretokenized set
+     * @param onPartial Optional listener receiving each streamed chunk of text
+     * @return Generated response string, or error message if failed
+     */
+    suspend fun generateResponseByIndex(index: Int, onPartial: ((String) -> Unit)? = null): String {
+        if (!isModelLoaded || nativeContext == 0L || index !in pretokenizedPrompts.indices) {
+            return "Error: Prompt $index not pretokenized"
+        }
+        
+        return try {
+            val startTime = System.currentTimeMillis()
+            lastMetrics = null
+            
+            val startNs = System.nanoTime()
+            val requestId = nativeSubmitIndexed(nativeContext, index, DEFAULT_MAX_TOKENS, STREAM_FLUSH_TOKENS)
+            val response = awaitRequest(requestId, startNs, onPartial)
             
             lastInferenceTimeMs = System.currentTimeMillis() - startTime
-            Log.i(TAG, "Inference completed in ${lastInferenceTimeMs}ms")
+            Log.i(TAG, "Inference for prompt $index completed in ${lastInferenceTimeMs}ms " +
+                    "(TTFT ${lastTimeToFirstTokenMs}ms, ITL ${lastInterTokenLatencyMs}ms)")
             
             response
+        } catch (e: CancellationException) {
+            throw e
         } catch (e: Exception) {
             Log.e(TAG, "Inference failed: ${e.message}", e)
             "Error: ${e.message}"
         }
     }
     
+    /**
+     * Starts a multi-turn conversation on the loaded model. Turns are formatted natively
+     * with the model's chat template, and each turn prefills only its own tokens on top
+     * of the conversation already in the KV cache, so a turn costs the same whether it
+     * is the first or the fiftieth. Sessions share the context: generating anything else
+     * in between evicts the conversation, which the next turn then prefills again.
+     * 
+     * @param systemPrompt System message placed before the first turn, or empty for none
+     * @return Session handle, or null if no native model is loaded
+     */
+    fun createChatSession(systemPrompt: String = ""): ChatSession? {
+        if (!isModelLoaded || nativeContext == 0L) {
+            return null
+        }
+        
+        val handle = nativeChatCreate(nativeContext, systemPrompt)
+        if (handle == 0L) {
+            Log.e(TAG, "Failed to create chat session")
+            return null
+        }
+        return ChatSession(handle, systemPrompt).also {
+            synchronized(chatSessions) { chatSessions.add(it) }
+        }
+    }
+    
+    /**
+     * Appends a user turn to a chat session and generates the assistant turn, which
+     * becomes part of the conversation. Streaming, metrics and cancellation behave as in
+     * [generateResponse]; a failed or cancelled turn is not kept.
+     * 
+     * @param session Session from [createChatSession]
+     * @param userText Content of the user turn, without any template markup
+     * @param maxTokens Upper bound on the length of the assistant turn
+     * @param onPartial Optional listener receiving each streamed chunk of text
+     * @return Assistant turn, or error message if failed
+     */
+    suspend fun chat(
+        session: ChatSession,
+        userText: String,
+        maxTokens: Int = DEFAULT_MAX_TOKENS,
+        onPartial: ((String) -> Unit)? = null
+    ): String {
+        if (!isModelLoaded || nativeContext == 0L || session.handle == 0L) {
+            return "Error: Chat session closed"
+        }
+        
+        return try {
+            val startTime = System.currentTimeMillis()
+            lastMetrics = null
+            
+            val startNs = System.nanoTime()
+            val requestId = nativeSubmitChat(nativeContext, session.handle, userText, maxTokens, STREAM_FLUSH_TOKENS)
+            val response = awaitRequest(requestId, startNs, onPartial)
+            
+            lastInferenceTimeMs = System.currentTimeMillis() - startTime
+            lastMetrics?.let {
+                Log.i(TAG, "Chat turn completed in ${lastInferenceTimeMs}ms: prefilled " +
+                        "${it.promptTokens - it.reusedPromptTokens} of ${it.promptTokens} tokens " +
+                        "(TTFT ${lastTimeToFirstTokenMs}ms)")
+            }
+            
+            response
+        } catch (e: CancellationException) {
+            throw e
+        } catch (e: Exception) {
+            Log.e(TAG, "Chat turn failed: ${e.message}", e)
+            "Error: ${e.message}"
+        }
+    }
+    
+    /**
+     * Forgets every turn of a chat session but its system prompt, which stays cached.
+     * Blocks until a generation running on the context has finished.
+     */
+    fun resetChatSession(session: ChatSession) {
+        if (nativeContext != 0L && session.handle != 0L) {
+            nativeChatReset(nativeContext, session.handle)
+        }
+    }
+    
+    /**
+     * Cancels any turn of a chat session still generating and frees it. Sessions left
+     * open are closed when the model is unloaded.
+     */
+    fun closeChatSession(session: ChatSession) {
+        val removed = synchronized(chatSessions) { chatSessions.remove(session) }
+        if (removed && session.handle != 0L && nativeContext != 0L) {
+            nativeChatFree(nativeContext, session.handle)
+        }
+        session.handle = 0L
+    }
+    
+    private fun closeChatSessions() {
+        val open = synchronized(chatSessions) { chatSessions.toList() }
+        open.forEach { closeChatSession(it) }
+    }
+    
+    /**
+     * Generates a response without streaming, passing text through reusable direct
+     * ByteBuffers instead of jstrings. The prompt is encoded as UTF-8 straight into
+     * native-visible memory and the response is decoded once from the UTF-8 the model
+     * produced, so long responses are not re-encoded and copied on the way out.
+     * 
+     * @param prompt The input prompt for the LLM
+     * @return Generated response string, or error message if failed
+     */
+    suspend fun generateResponseDirect(prompt: String): String {
+        if (!isModelLoaded || nativeContext == 0L) {
+            return "Error: Model not loaded"
+        }
+        
+        return withContext(Dispatchers.IO) {
+            try {
+                val startTime = System.currentTimeMillis()
+                lastMetrics = null
+                
+                val promptLength = promptBuffer.encode(prompt)
+                val output = responseBuffer.ensureCapacity(nativeMaxResponseBytes(nativeContext, DEFAULT_MAX_TOKENS))
+                val metrics = NativeMetrics.newArray()
+                val length = nativeGenerateDirect(
+                    nativeContext,
+                    promptBuffer.buffer,
+                    promptLength,
+                    output,
+                    DEFAULT_MAX_TOKENS,
+                    metrics
+                )
+                if (length < 0) {
+                    return@withContext "Error: Failed to decode"
+                }
+                
+                lastMetrics = NativeMetrics.fromArray(metrics).also {
+                    lastDecodeTokensPerSecond = it.decodeTokensPerSecond
+                }
+                lastInferenceTimeMs = System.currentTimeMillis() - startTime
+                Log.i(TAG, "Inference completed in ${lastInferenceTimeMs}ms ($length bytes)")
+                
+                responseBuffer.decode(length)
+            } catch (e: Exception) {
+                Log.e(TAG, "Inference failed: ${e.message}", e)
+                "Error: ${e.message}"
+            }
+        }
+    }
+    
+    /**
+     * Waits for a request submitted to the native inference engine by polling it every
+     * [POLL_INTERVAL_MS], so no thread is held while it generates, and derives latency
+     * metrics from the native timestamps of its streamed pieces (same clock as
+     * System.nanoTime). If the calling coroutine is cancelled, the request is cancelled
+     * natively; its llama_decode call aborts within one micro-batch and this returns only
+     * once it has, so the next call on the context never overlaps it.
+     * 
+     * @param requestId Id returned by nativeSubmit, nativeSubmitIndexed or nativeSubmitChat, -1 on error
+     * @param startNs System.nanoTime just before the request was submitted
+     * @param onPartial Optional listener receiving the text of each poll that produced some
+     * @return Generated response string, or error message if it failed or was cancelled
+     */
+    private suspend fun awaitRequest(requestId: Long, startNs: Long, onPartial: ((String) -> Unit)?): String {
+        if (requestId < 0) {
+            return "Error: Failed to submit request"
+        }
+        
+        val response = StringBuilder()
+        val progressValues = RequestProgress.newArray()
+        val metrics = NativeMetrics.newArray()
+        var finished = false
+        try {
+            while (true) {
+                // Null once the request has been cancelled, possibly by cancelRequests
+                val text = nativePoll(nativeContext, requestId, progressValues, metrics)
+                if (text == null) {
+                    finished = true
+                    return "Error: Request cancelled"
+                }
+                if (text.isNotEmpty()) {
+                    response.append(text)
+                    onPartial?.invoke(text)
+                }
+                
+                val progress = RequestProgress.fromArray(progressValues)
+                if (progress.status.isFinished) {
+                    finished = true
+                    lastTimeToFirstTokenMs = if (progress.tokens > 0) (progress.firstTokenNs - startNs) / 1_000_000 else 0L
+                    lastInterTokenLatencyMs = if (progress.tokens > 1) {
+                        (progress.lastTokenNs - progress.firstTokenNs) / 1_000_000f / (progress.tokens - 1)
+                    } else {
+                        0f
+                    }
+                    lastMetrics = NativeMetrics.fromArray(metrics).also {
+                        lastDecodeTokensPerSecond = it.decodeTokensPerSecond
+                    }
+                    return if (progress.status == RequestProgress.Status.COMPLETED) {
+                        response.toString()
+                    } else {
+                        "Error: Failed to decode"
+                    }
+                }
+                delay(POLL_INTERVAL_MS)
+            }
+        } finally {
+            if (!finished) {
+                nativeCancel(nativeContext, requestId)
+            }
+        }
+    }
+    
+    /**
+     * Cancels every queued and running native generation. Coroutines awaiting them
+     * return an error string on their next poll.
+     * 
+     * @return True if anything was cancelled
+     */
+    fun cancelRequests(): Boolean {
+        if (!nativeLibraryLoaded || nativeContext == 0L) return false
+        return nativeCancel(nativeContext, -1L)
+    }
+    
+    /**
+     * Generates responses for several prompts at once, decoding them as parallel
+     * sequences so each llama_decode step advances every unfinished prompt.
+     * Prompts are processed in groups of [MAX_PARALLEL_SEQUENCES].
+     * 
+     * @param prompts The input prompts for the LLM
+     * @return One response per prompt with its own completion latency and metrics, or
+     *         null if batched generation is unavailable or failed
+     */
+    suspend fun generateResponses(prompts: List<String>): List<BatchResponse>? {
+        if (!isModelLoaded || nativeContext == 0L) {
+            return null
+        }
+        
+        return withContext(Dispatchers.IO) {
+            try {
+                val results = mutableListOf<BatchResponse>()
+                for (group in prompts.chunked(MAX_PARALLEL_SEQUENCES)) {
+                    val metrics = LongArray(group.size * NativeMetrics.METRIC_COUNT)
+                    val responses = nativeGenerateBatch(
+                        nativeContext,
+                        group.toTypedArray(),
+                        DEFAULT_MAX_TOKENS,
+                        metrics
+                    ) ?: return@withContext null
+                    
+                    responses.forEachIndexed { i, text ->
+                        val start = i * NativeMetrics.METRIC_COUNT
+                        val sequenceMetrics = NativeMetrics.fromArray(
+                            metrics.copyOfRange(start, start + NativeMetrics.METRIC_COUNT)
+                        )
+                        val latencyMs = (sequenceMetrics.prefillUs + sequenceMetrics.decodeUs) / 1000
+                        results.add(BatchResponse(text, latencyMs, sequenceMetrics))
+                    }
+                }
+                
+                lastInferenceTimeMs = results.maxOfOrNull { it.latencyMs } ?: 0L
+                Log.i(TAG, "Batched inference of ${prompts.size} prompts completed")
+                results
+            } catch (e: Exception) {
+                Log.e(TAG, "Batched inference failed: ${e.message}", e)
+                null
+            }
+        }
+    }
+    
+    /**
+     * Checks whether [generateResponses] can be used with the loaded model.
+     * 
+     * @return True if a native model is loaded
+     */
+    fun supportsBatchGeneration(): Boolean = isModelLoaded && nativeContext != 0L
+    
+    /**
+     * Puts a prompt prefix shared by later queries (e.g. a system prompt) into the KV
+     * cache. The prefix state is saved under the cache directory keyed by model and
+     * tokens, so a new process, such as the next WorkManager run, restores it from
+     * disk instead of prefilling it again. Prompts must start with the same text for
+     * generateResponse to reuse it; the prefix should end on a token boundary such as
+     * a newline.
+     * 
+     * @param prefix Text every following prompt starts with
+     * @return How the prefix was warmed, or null if it could not be
+     */
+    suspend fun warmPrefix(prefix: String): PrefixState? {
+        if (!isModelLoaded || nativeContext == 0L) {
+            return null
+        }
+        
+        return withContext(Dispatchers.IO) {
+            val stats = PrefixState.newArray()
+            val stateDir = File(context.cacheDir, STATE_CACHE_DIR)
+            stateDir.mkdirs()
+            if (nativeWarmPrefix(nativeContext, prefix, stateDir.absolutePath, stats)) {
+                PrefixState.fromArray(stats).also {
+                    Log.i(TAG, "Prefix of ${it.tokens} tokens ${it.source.name.lowercase()} in ${it.warmupTimeMs}ms " +
+                            "(${it.stateBytes} bytes, save ${it.saveUs / 1000f}ms)")
+                }
+            } else {
+                Log.e(TAG, "Failed to warm prefix")
+                null
+            }
+        }
+    }
+    
+    /**
+     * Loads a draft model for speculative decoding. The draft must share the loaded
+     * model's tokenizer, e.g. the q2_k build drafting for q4_k_m.
+     * 
+     * @param draftFileName Name of the draft model file in /sdcard/Download
+     * @param nDraft Number of tokens drafted per verification step
+     * @return True if the draft model was attached
+     */
+    fun attachDraftModel(draftFileName: String, nDraft: Int = DEFAULT_DRAFT_TOKENS): Boolean {
+        if (nativeContext == 0L) {
+            Log.e(TAG, "Speculative decoding requires a native model")
+            return false
+        }
+        val draftFile = File("/sdcard/Download", draftFileName)
+        if (!draftFile.exists()) {
+            Log.e(TAG, "Draft model not found in /sdcard/Download/: $draftFileName")
+            return false
+        }
+        val attached = nativeAttachDraft(nativeContext, draftFile.absolutePath, nDraft, DEFAULT_THREADS)
+        Log.i(TAG, "Draft model $draftFileName attached: $attached")
+        return attached
+    }
+    
+    /**
+     * Generates a response with speculative decoding using the attached draft model.
+     * Energy comes from the native power sampler (see [startPowerSampling]) over the
+     * draft and verify phase, so it is NaN while the sampler is stopped.
+     * 
+     * @param prompt The input prompt for the LLM
+     * @param measurePlain Whether to first run plain decoding on the same prompt and token
+     *        cap as the baseline for the speedup and energy comparison. Like the speculative
+     *        run, the baseline ignores the thermal governor and the stop conditions.
+     * @return Response and speculative decoding statistics, or null if unavailable
+     */
+    suspend fun generateSpeculative(prompt: String, measurePlain: Boolean = true): SpeculativeResult? {
+        if (!isModelLoaded || nativeContext == 0L) {
+            return null
+        }
+        
+        return withContext(Dispatchers.IO) {
+            try {
+                val startTime = System.currentTimeMillis()
+                
+                val values = SpeculativeStats.newArray()
+                val response = nativeGenerateSpeculative(nativeContext, prompt, DEFAULT_MAX_TOKENS, measurePlain, values)
+                lastInferenceTimeMs = System.currentTimeMillis() - startTime
+                val stats = SpeculativeStats.fromArray(values)
+                
+                fun tokensPerSecond(tokens: Int, us: Long) = if (us > 0) tokens * 1_000_000f / us else 0f
+                fun joulesPer(energyUj: Long, tokens: Int) =
+                    if (energyUj >= 0 && tokens > 0) energyUj / 1e6 / tokens else Double.NaN
+                val decodeTokensPerSecond = tokensPerSecond(stats.generatedTokens, stats.decodeUs)
+                val plainTokensPerSecond = tokensPerSecond(stats.plainGeneratedTokens, stats.plainDecodeUs)
+                SpeculativeResult(
+                    text = response,
+                    draftedTokens = stats.draftedTokens,
+                    acceptedTokens = stats.acceptedTokens,
+                    verifySteps = stats.verifySteps,
+                    generatedTokens = stats.generatedTokens,
+                    acceptanceRate = if (stats.draftedTokens > 0) stats.acceptedTokens.toFloat() / stats.draftedTokens else 0f,
+                    tokensPerTargetDecode = if (stats.verifySteps > 0) stats.generatedTokens.toFloat() / stats.verifySteps else 0f,
+                    decodeTokensPerSecond = decodeTokensPerSecond,
+                    plainDecodeTokensPerSecond = plainTokensPerSecond,
+                    speedupVsPlain = if (plainTokensPerSecond > 0f) decodeTokensPerSecond / plainTokensPerSecond else 0f,
+                    energyPerAcceptedTokenJ = joulesPer(stats.decodeEnergyUj, stats.acceptedTokens),
+                    energyPerTokenJ = joulesPer(stats.decodeEnergyUj, stats.generatedTokens),
+                    plainEnergyPerTokenJ = joulesPer(stats.plainDecodeEnergyUj, stats.plainGeneratedTokens)
+                ).also {
+                    Log.i(TAG, "Speculative: acceptance ${it.acceptanceRate}, " +
+                            "${it.tokensPerTargetDecode} tokens/verify, speedup ${it.speedupVsPlain}x, " +
+                            "${it.energyPerTokenJ} J/token vs ${it.plainEnergyPerTokenJ} J/token plain")
+                }
+            } catch (e: Exception) {
+                Log.e(TAG, "Speculative inference failed: ${e.message}", e)
+                null
+            }
+        }
+    }
+    
+    /**
+     * Configures token sampling for the loaded native model.
+     * A temperature of 0 (the default) selects greedy decoding.
+     * 
+     * @param temperature Softmax temperature, or 0 for greedy argmax
+     * @param topK Number of best candidates kept, or 0 for the whole vocabulary
+     * @param topP Nucleus cutoff on cumulative probability
+     * @param minP Minimum probability relative to the best candidate
+     * @param seed RNG seed, or -1 for a random seed
+     */
+    fun setSampling(temperature: Float, topK: Int = 40, topP: Float = 1.0f, minP: Float = 0.0f, seed: Int = -1) {
+        if (nativeContext != 0L) {
+            nativeSetSampling(nativeContext, temperature, topK, topP, minP, seed)
+        }
+    }
+    
+    /**
+     * Sets native stop conditions for later generations, so rambling responses stop
+     * before the token cap. Stop strings are matched on the text as it streams and the
+     * response ends right before the first match; streamed pieces never contain part
+     * of a stop string. Which condition ended a generation is reported in
+     * NativeMetrics.stopReason.
+     * 
+     * @param stopStrings Strings that end the response, e.g. "\nUser:"
+     * @param deadlineMs Wall time per generation in milliseconds, or 0 for no deadline
+     * @param energyBudgetJ Prefill and decode energy per generation in joules, or 0 for no
+     *        budget; only enforced while the power sampler is running
+     */
+    fun setStopConditions(stopStrings: List<String>, deadlineMs: Long = 0L, energyBudgetJ: Double = 0.0) {
+        if (nativeContext != 0L) {
+            nativeSetStopConditions(nativeContext, stopStrings.toTypedArray(), deadlineMs, (energyBudgetJ * 1000).toLong())
+        }
+    }
+    
+    /**
+     * Pins the native worker threads of prompt prefill and token decode to core sets
+     * chosen from the device's CPU topology. The placement in effect is recorded in
+     * every generation's NativeMetrics.
+     * 
+     * @param prefill Cores used for prompt prefill
+     * @param prefillThreads Prefill threads, or 0 for one per selected core
+     * @param decode Cores used for token decode
+     * @param decodeThreads Decode threads, or 0 for one per selected core
+     * @return True if the placement was applied
+     */
+    fun setThreadPlacement(
+        prefill: ThreadPlacement,
+        prefillThreads: Int,
+        decode: ThreadPlacement,
+        decodeThreads: Int
+    ): Boolean {
+        if (nativeContext == 0L) {
+            Log.e(TAG, "Thread placement requires a native model")
+            return false
+        }
+        val applied = nativeSetThreadPlacement(nativeContext, prefill.code, prefillThreads, decode.code, decodeThreads)
+        Log.i(TAG, "Thread placement prefill=$prefill x$prefillThreads decode=$decode x$decodeThreads: $applied")
+        return applied
+    }
+    
+    /**
+     * Describes the CPU clusters detected from sysfs.
+     * 
+     * @return One line per cluster, or an empty string if the native library is unavailable
+     */
+    fun describeCpuTopology(): String = if (nativeLibraryLoaded) nativeDescribeCpuTopology() else ""
+    
+    /**
+     * Starts the native power sampler, which reads current and voltage from a power_supply
+     * directory on a background thread. While it runs, every generation's NativeMetrics
+     * carries the energy drawn during prefill and decode.
+     * 
+     * @param supplyPath power_supply directory exposing current_now and voltage_now
+     * @param rateHz Samples per second
+     * @param currentScale Factor converting current_now to microamps (1000 for drivers reporting mA)
+     * @return True if the sampler is running
+     */
+    fun startPowerSampling(
+        supplyPath: String = DEFAULT_POWER_SUPPLY_PATH,
+        rateHz: Int = DEFAULT_POWER_SAMPLE_HZ,
+        currentScale: Long = 1L
+    ): Boolean {
+        if (!nativeLibraryLoaded) {
+            return false
+        }
+        val started = nativeStartPowerSampler(supplyPath, rateHz, currentScale)
+        Log.i(TAG, "Power sampler on $supplyPath at $rateHz Hz: $started")
+        return started
+    }
+    
+    /**
+     * Stops the native power sampler; later generations report no energy.
+     */
+    fun stopPowerSampling() {
+        if (nativeLibraryLoaded) {
+            nativeStopPowerSampler()
+        }
+    }
+    
+    /**
+     * Gets the most recent power sample.
+     * 
+     * @return Instantaneous battery power in microwatts, or -1 if the sampler is not running
+     */
+    fun getCurrentPowerUw(): Long = if (nativeLibraryLoaded) nativeGetPowerUw() else -1L
+    
+    /**
+     * Starts the native CPU sampler, which records per-core utilization and frequency and
+     * the CPU time of every thread of the process from /proc and sysfs. While it runs,
+     * every generation's NativeMetrics carries CPU usage for prefill and decode.
+     * 
+     * @param rateHz Samples per second
+     * @return True if the sampler is running
+     */
+    fun startCpuSampling(rateHz: Int = DEFAULT_CPU_SAMPLE_HZ): Boolean {
+        if (!nativeLibraryLoaded) {
+            return false
+        }
+        val started = nativeStartCpuSampler(rateHz)
+        Log.i(TAG, "CPU sampler at $rateHz Hz: $started")
+        return started
+    }
+    
+    /**
+     * Stops the native CPU sampler; later generations report no CPU usage.
+     */
+    fun stopCpuSampling() {
+        if (nativeLibraryLoaded) {
+            nativeStopCpuSampler()
+        }
+    }
+    
+    /**
+     * Gets the overall CPU utilization from the native /proc reader, which avoids the
+     * per-sample allocation and regex parsing of BatteryMonitor's Kotlin implementation.
+     * 
+     * @return CPU usage percentage (0.0-100.0), or -1 if the native library is unavailable
+     */
+    fun getCpuUsage(): Float = if (nativeLibraryLoaded) nativeGetCpuUsage() else -1f
+    
+    /**
+     * Average cost of one native CPU sampler sample (proc_sampler::mean_sample_ns) since
+     * it was started, the counterpart of [BatteryMonitor.getCpuSampleUs].
+     * 
+     * @return Mean microseconds per sample, or 0 if the sampler has taken none
+     */
+    fun getCpuSampleUs(): Float = if (nativeLibraryLoaded) nativeGetCpuSampleNs() / 1000f else 0f
+    
+    /**
+     * Describes per-core utilization and frequency and the busiest threads during the
+     * prefill and decode phases of the last native generation.
+     * 
+     * @return Multi-line profile, or an empty string without a native model
+     */
+    fun describeLastCpuProfile(): String =
+        if (nativeContext != 0L) nativeDescribeCpuProfile(nativeContext) else ""
+    
+    /**
+     * Gets the per-core CPU time series of the last native generation.
+     * 
+     * @return The series, or null if the CPU sampler was not running
+     */
+    fun getLastCpuSeries(): CpuSeries? {
+        if (nativeContext == 0L) return null
+        return nativeGetCpuSeries(nativeContext)?.let { CpuSeries.fromArray(it) }
+    }
+    
+    /**
+     * Starts the native thermal governor. While it runs, every generation gets the core
+     * placement, thread count and inter-token pacing that keep the hottest thermal zone
+     * below [targetCelsius], preferring among the allowed operating points the one with
+     * the best measured tokens per joule. Each decision is recorded in NativeMetrics.
+     * 
+     * @param targetCelsius Hottest zone temperature to hold
+     * @param hysteresisCelsius How far below the target the zones must cool before a faster point is used again
+     * @param zoneFilter Govern only zones whose type contains this (e.g. "cpu"); empty for all
+     * @param rateHz Thermal samples per second
+     * @return True if the governor is running
+     */
+    fun startThermalGovernor(
+        targetCelsius: Float,
+        hysteresisCelsius: Float = DEFAULT_THERMAL_HYSTERESIS_C,
+        zoneFilter: String = "",
+        rateHz: Int = DEFAULT_THERMAL_SAMPLE_HZ
+    ): Boolean {
+        if (!nativeLibraryLoaded) {
+            return false
+        }
+        val started = nativeStartThermalGovernor(
+            (targetCelsius * 1000).toInt(),
+            (hysteresisCelsius * 1000).toInt(),
+            zoneFilter,
+            rateHz
+        )
+        Log.i(TAG, "Thermal governor targeting ${targetCelsius}C at $rateHz Hz: $started")
+        return started
+    }
+    
+    /**
+     * Stops the native thermal governor; the placement it chose last stays in effect.
+     */
+    fun stopThermalGovernor() {
+        if (nativeLibraryLoaded) {
+            nativeStopThermalGovernor()
+        }
+    }
+    
+    /**
+     * Gets the hottest governed SoC thermal zone, unlike the battery temperature
+     * BatteryMonitor reports.
+     * 
+     * @return Temperature in degrees Celsius, or NaN if the thermal governor is not running
+     */
+    fun getSocTemperatureC(): Float {
+        val milliC = if (nativeLibraryLoaded) nativeGetSocTemperatureMc() else -1
+        return if (milliC >= 0) milliC / 1000f else Float.NaN
+    }
+    
+    /**
+     * Sets the memory budget for models kept resident between loads. Models without a
+     * live context are evicted least recently used first once the budget is exceeded.
+     * 
+     * @param budgetBytes Budget in bytes, or 0 for no limit
+     */
+    fun setModelMemoryBudget(budgetBytes: Long) {
+        if (nativeLibraryLoaded) {
+            nativeSetModelBudget(budgetBytes)
+        }
+    }
+    
+    /**
+     * Gets the total size of the model weights resident in native memory.
+     * 
+     * @return Resident model bytes, or 0 if the native library is unavailable
+     */
+    fun getResidentModelBytes(): Long = if (nativeLibraryLoaded) nativeGetResidentModelBytes() else 0L
+    
+    /**
+     * Frees every resident model that is not backing the current context.
+     */
+    fun evictUnusedModels() {
+        if (nativeLibraryLoaded) {
+            nativeEvictUnusedModels()
+        }
+    }
+    
+    /**
+     * Runs an energy-efficiency sweep over every combination in the config and returns
+     * its JSON report, with median tokens per second, TTFT and joules per token per
+     * cell plus the raw runs. Joules come from the power sampler, so start it with
+     * [startPowerSampling] first; without it the energy fields are null. Each cell
+     * loads its model next to the current one, so the memory budget must leave room.
+     * 
+     * @param config Sweep matrix, prompts, warmup and repetitions
+     * @param reportFile Where to also write the report, or null to only return it
+     * @return The JSON report, or null if the native library is unavailable or the sweep failed
+     */
+    suspend fun runSweep(config: SweepConfig, reportFile: File? = null): String? {
+        if (!nativeLibraryLoaded) {
+            return null
+        }
+        
+        return withContext(Dispatchers.IO) {
+            try {
+                Log.i(TAG, "Sweep of ${config.cellCount} cells, ${config.prompts.size} prompts x ${config.repetitions}")
+                val report = nativeRunSweep(
+                    config.modelPaths.toTypedArray(),
+                    config.threadCounts.toIntArray(),
+                    config.contextSizes.toIntArray(),
+                    config.batchSizes.toIntArray(),
+                    config.maxTokens.toIntArray(),
+                    config.prompts.toTypedArray(),
+                    config.warmup,
+                    config.repetitions,
+                    config.cooldownMs
+                )
+                reportFile?.writeText(report)
+                report
+            } catch (e: CancellationException) {
+                throw e
+            } catch (e: Exception) {
+                Log.e(TAG, "Sweep failed: ${e.message}", e)
+                null
+            }
+        }
+    }
+    
     /**
      * Unloads the current model and frees resources.
      */
     fun unloadModel() {
         engine?.close()
         engine = null
+        if (nativeContext != 0L) {
+            closeChatSessions()
+            nativeFree(nativeContext)
+            nativeContext = 0L
+            pretokenizedPrompts = emptyList()
+            memoryAfterFree = probeMemory()?.also { Log.i(TAG, "Process memory after free: $it") }
+            stopPowerSampling()
+            stopCpuSampling()
+            stopThermalGovernor()
+        }
         isModelLoaded = false
         modelPath = null
         Log.i(TAG, "Model unloaded")
@@ -114,6 +986,105 @@ class LLMService(private val context: Context) {
      */
     fun getInferenceTime(): Long = lastInferenceTimeMs
     
+    /**
+     * Gets the time to first token of the last streamed generation in milliseconds.
+     * 
+     * @return Time to first token in milliseconds, or 0 if not measured
+     */
+    fun getTimeToFirstTokenMs(): Long = lastTimeToFirstTokenMs
+    
+    /**
+     * Gets the mean inter-token latency of the last streamed generation in milliseconds.
+     * 
+     * @return Mean inter-token latency in milliseconds, or 0 if not measured
+     */
+    fun getInterTokenLatencyMs(): Float = lastInterTokenLatencyMs
+    
+    /**
+     * Gets the prompt prefill throughput of the last native generation.
+     * 
+     * @return Prefill throughput in tokens per second, or 0 if not measured
+     */
+    fun getPrefillTokensPerSecond(): Float = lastMetrics?.prefillTokensPerSecond ?: 0f
+    
+    /**
+     * Gets the decode throughput of the last native generation.
+     * 
+     * @return Decode throughput in tokens per second, or 0 if not measured
+     */
+    fun getDecodeTokensPerSecond(): Float = lastDecodeTokensPerSecond
+    
+    /**
+     * Gets how many prompt tokens of the last native generation were served from
+     * the KV prefix cache instead of being prefilled.
+     * 
+     * @return Number of reused prompt tokens
+     */
+    fun getPromptTokensReused(): Int = lastMetrics?.reusedPromptTokens ?: 0
+    
+    /**
+     * Gets the phase-level native metrics of the last streamed generation.
+     * 
+     * @return Native metrics, or null if the last generation did not run natively
+     */
+    fun getLastMetrics(): NativeMetrics? = lastMetrics
+    
+    /**
+     * Gets the phase timings of the last native model load.
+     * 
+     * @return Load metrics, or null if no model has been loaded natively
+     */
+    fun getLastLoadMetrics(): ModelLoadMetrics? = lastLoadMetrics
+    
+    /**
+     * Gets the weight, KV cache and compute buffer memory of the current native context.
+     * 
+     * @return Context memory, or null if no model is loaded natively
+     */
+    fun getContextMemory(): ContextMemory? = if (nativeContext != 0L) contextMemory else null
+    
+    /**
+     * Reads the memory of the app process natively from /proc/self/status and
+     * smaps_rollup. Unlike ActivityManager.getProcessMemoryInfo this is not rate-limited
+     * and splits anonymous memory (KV cache, compute buffers) from file-backed memory
+     * (mmapped weights). Snapshots at load, after prefill and at the end of decode are
+     * in [ContextMemory.loadMemory] and [NativeMetrics].
+     * 
+     * @return Current snapshot, or null if the native library is unavailable
+     */
+    fun probeMemory(): MemorySnapshot? {
+        if (!nativeLibraryLoaded) return null
+        val values = MemorySnapshot.newArray()
+        return if (nativeProbeMemory(values)) MemorySnapshot.fromArray(values) else null
+    }
+    
+    /**
+     * Gets the process PSS in bytes for BatteryMonitor, read natively.
+     * 
+     * @return PSS in bytes, or -1 if it cannot be read natively
+     */
+    fun getMemoryUsage(): Long = probeMemory()?.pssBytes ?: -1L
+    
+    /**
+     * Gets the process memory measured right after the last native context was freed,
+     * showing what the model registry and the allocator kept.
+     * 
+     * @return Snapshot, or null if no native context has been freed yet
+     */
+    fun getMemoryAfterFree(): MemorySnapshot? = memoryAfterFree
+    
+    /**
+     * Opens a packaged model for direct mapping. Only works for assets stored uncompressed
+     * (noCompress 'gguf' in build.gradle); compressed or missing assets return null.
+     */
+    private fun openModelAsset(assetPath: String): AssetFileDescriptor? {
+        return try {
+            context.assets.openFd(assetPath)
+        } catch (e: IOException) {
+            null
+        }
+    }
+    
     
     /**
      * Gets the model name from the loaded model path.
@@ -202,11 +1173,216 @@ class LLMService(private val context: Context) {
         }
     }
     
+    // Native llama.cpp bindings (llama-wrapper.cpp)
+    private external fun nativeInit(
+        modelPath: String,
+        nThreads: Int,
+        nCtx: Int,
+        nBatch: Int,
+        nUbatch: Int,
+        nSeqMax: Int,
+        kvTypeK: Int,
+        kvTypeV: Int,
+        flashAttn: Int,
+        offloadKqv: Boolean,
+        opOffload: Boolean,
+        loadPhasesOut: LongArray?
+    ): Long
+    private external fun nativeInitFromFd(
+        fd: Int,
+        offset: Long,
+        length: Long,
+        cacheDir: String,
+        nThreads: Int,
+        nCtx: Int,
+        nBatch: Int,
+        nUbatch: Int,
+        nSeqMax: Int,
+        kvTypeK: Int,
+        kvTypeV: Int,
+        flashAttn: Int,
+        offloadKqv: Boolean,
+        opOffload: Boolean,
+        loadPhasesOut: LongArray?
+    ): Long
+    private external fun nativeGenerateDirect(
+        contextPtr: Long,
+        promptBuf: ByteBuffer,
+        promptLength: Int,
+        responseBuf: ByteBuffer,
+        maxTokens: Int,
+        metricsOut: LongArray?
+    ): Int
+    private external fun nativeMaxResponseBytes(contextPtr: Long, maxTokens: Int): Int
+    private external fun nativePretokenize(contextPtr: Long, prompts: Array<String>): Boolean
+    private external fun nativeSubmit(contextPtr: Long, prompt: String, maxTokens: Int, flushEvery: Int): Long
+    private external fun nativeSubmitIndexed(contextPtr: Long, index: Int, maxTokens: Int, flushEvery: Int): Long
+    private external fun nativePoll(
+        contextPtr: Long,
+        requestId: Long,
+        progressOut: LongArray,
+        metricsOut: LongArray?
+    ): String?
+    private external fun nativeCancel(contextPtr: Long, requestId: Long): Boolean
+    private external fun nativeChatCreate(contextPtr: Long, systemPrompt: String): Long
+    private external fun nativeSubmitChat(
+        contextPtr: Long,
+        sessionPtr: Long,
+        userText: String,
+        maxTokens: Int,
+        flushEvery: Int
+    ): Long
+    private external fun nativeChatReset(contextPtr: Long, sessionPtr: Long)
+    private external fun nativeChatFree(contextPtr: Long, sessionPtr: Long)
+    private external fun nativeGenerateBatch(
+        contextPtr: Long,
+        prompts: Array<String>,
+        maxTokens: Int,
+        metricsOut: LongArray?
+    ): Array<String>?
+    private external fun nativeAttachDraft(contextPtr: Long, draftPath: String, nDraft: Int, nThreads: Int): Boolean
+    private external fun nativeGenerateSpeculative(
+        contextPtr: Long,
+        prompt: String,
+        maxTokens: Int,
+        measurePlain: Boolean,
+        statsOut: LongArray?
+    ): String
+    private external fun nativeSetSampling(
+        contextPtr: Long,
+        temperature: Float,
+        topK: Int,
+        topP: Float,
+        minP: Float,
+        seed: Int
+    )
+    private external fun nativeSetStopConditions(
+        contextPtr: Long,
+        stopStrings: Array<String>,
+        deadlineMs: Long,
+        energyBudgetMj: Long
+    )
+    private external fun nativeSetThreadPlacement(
+        contextPtr: Long,
+        prefillPolicy: Int,
+        nThreadsPrefill: Int,
+        decodePolicy: Int,
+        nThreadsDecode: Int
+    ): Boolean
+    private external fun nativeDescribeCpuTopology(): String
+    private external fun nativeStartPowerSampler(supplyPath: String, rateHz: Int, currentScale: Long): Boolean
+    private external fun nativeStopPowerSampler()
+    private external fun nativeGetPowerUw(): Long
+    private external fun nativeStartCpuSampler(rateHz: Int): Boolean
+    private external fun nativeStopCpuSampler()
+    private external fun nativeGetCpuUsage(): Float
+    private external fun nativeGetCpuSampleNs(): Long
+    private external fun nativeStartThermalGovernor(targetMc: Int, hysteresisMc: Int, zoneFilter: String, rateHz: Int): Boolean
+    private external fun nativeStopThermalGovernor()
+    private external fun nativeGetSocTemperatureMc(): Int
+    private external fun nativeWarmPrefix(contextPtr: Long, prefix: String, stateDir: String, statsOut: LongArray?): Boolean
+    private external fun nativeGetContextMemory(contextPtr: Long, out: LongArray): Boolean
+    private external fun nativeProbeMemory(out: LongArray): Boolean
+    private external fun nativeDescribeContextMemory(contextPtr: Long): String
+    private external fun nativeDescribeCpuProfile(contextPtr: Long): String
+    private external fun nativeGetCpuSeries(contextPtr: Long): LongArray?
+    private external fun nativeFree(contextPtr: Long)
+    private external fun nativeSetModelBudget(budgetBytes: Long)
+    private external fun nativeGetResidentModelBytes(): Long
+    private external fun nativeEvictUnusedModels()
+    private external fun nativeRunSweep(
+        modelPaths: Array<String>,
+        threadCounts: IntArray,
+        contextSizes: IntArray,
+        batchSizes: IntArray,
+        maxTokens: IntArray,
+        prompts: Array<String>,
+        warmup: Int,
+        repetitions: Int,
+        cooldownMs: Int
+    ): String
+    
     companion object {
         private const val TAG = "LLMService"
+        private const val DEFAULT_THREADS = 4
+        private const val DEFAULT_MAX_TOKENS = 512
+        const val MAX_PARALLEL_SEQUENCES = 4
+        private const val DEFAULT_DRAFT_TOKENS = 4
+        private const val STREAM_FLUSH_TOKENS = 1
+        private const val POLL_INTERVAL_MS = 10L
+        private const val ASSET_MODEL_DIR = "models"
+        private const val STATE_CACHE_DIR = "kv_state"
+        private const val DEFAULT_POWER_SUPPLY_PATH = "/sys/class/power_supply/battery"
+        private const val DEFAULT_POWER_SAMPLE_HZ = 50
+        private const val DEFAULT_CPU_SAMPLE_HZ = 10
+        private const val DEFAULT_THERMAL_HYSTERESIS_C = 3f
+        private const val DEFAULT_THERMAL_SAMPLE_HZ = 2
+        
+        private val nativeLibraryLoaded: Boolean = try {
+            System.loadLibrary("llama-jni")
+            true
+        } catch (e: UnsatisfiedLinkError) {
+            Log.w(TAG, "llama-jni not available, falling back to mock engine: ${e.message}")
+            false
+        }
     }
 }
 
+/**
+ * Result of one prompt within a batched generation.
+ * 
+ * @property text Generated response
+ * @property latencyMs Time from the start of its batch until this prompt finished
+ * @property metrics Native metrics of this prompt's sequence; its prefill time runs from
+ *           the start of the batch to its first token, and energy is its token share
+ *           of the batch energy
+ */
+data class BatchResponse(
+    val text: String,
+    val latencyMs: Long,
+    val metrics: NativeMetrics
+)
+
+/**
+ * Result of a speculative generation. Throughput and energy cover the decode phase
+ * (drafting and verification), and the plain values a plain decode of the same prompt
+ * and token cap on the target model.
+ * 
+ * @property plainDecodeTokensPerSecond Plain decode throughput, or 0 if it was not measured
+ * @property speedupVsPlain decodeTokensPerSecond relative to plainDecodeTokensPerSecond,
+ *           or 0 if the plain decode was not measured
+ * @property energyPerAcceptedTokenJ Decode energy per accepted draft token in joules,
+ *           or NaN if the power sampler was not running
+ * @property energyPerTokenJ Decode energy per generated token in joules, or NaN
+ * @property plainEnergyPerTokenJ Same for the plain decode, or NaN
+ */
+data class SpeculativeResult(
+    val text: String,
+    val draftedTokens: Int,
+    val acceptedTokens: Int,
+    val verifySteps: Int,
+    val generatedTokens: Int,
+    val acceptanceRate: Float,
+    val tokensPerTargetDecode: Float,
+    val decodeTokensPerSecond: Float,
+    val plainDecodeTokensPerSecond: Float,
+    val speedupVsPlain: Float,
+    val energyPerAcceptedTokenJ: Double,
+    val energyPerTokenJ: Double,
+    val plainEnergyPerTokenJ: Double
+)
+
+/**
+ * Native multi-turn chat session of an [LLMService]; see [LLMService.createChatSession].
+ * The handle is cleared when the session is closed.
+ * 
+ * @property systemPrompt System message the conversation starts with
+ */
+class ChatSession internal constructor(
+    @Volatile internal var handle: Long,
+    val systemPrompt: String
+)
+
 /**
  * Mock MLC-LLM engine implementation for testing purposes.
  * This simulates the MLC-LLM API without requiring the actual library.
@@ -147,6 +147,8 @@ class MainActivity : AppCompatActivity() {
             // Initialize LLM service
             try {
                 llmService = LLMService(this)
+                batteryMonitor?.nativeCpuUsage = llmService?.let { it::getCpuUsage }
+                batteryMonitor?.nativeMemoryUsage = llmService?.let { it::getMemoryUsage }
                 Log.i("MainActivity", "LLMService initialized")
             } catch (e: Exception) {
                 Log.e("MainActivity", "LLMService init failed: ${e.message}")
@@ -302,9 +304,9 @@ class MainActivity : AppCompatActivity() {
                         // Load model
                         Toast.makeText(this@MainActivity, "Loading ${selectedModel?.modelName}...", Toast.LENGTH_SHORT).show()
                         
-                        val modelFileName = selectedModel?.modelPath ?: ""
+                        val modelConfig = selectedModel ?: return@launch
                         val loaded = withContext(Dispatchers.IO) {
-                            llmService?.loadModel(modelFileName) ?: false
+                            llmService?.loadModel(modelConfig) ?: false
                         }
                         
                         if (loaded) {
@@ -416,6 +418,22 @@ class MainActivity : AppCompatActivity() {
             exportResults()
         }
         
+        // Long press runs the JNI text I/O microbenchmark and compares the cost of a Kotlin
+        // and a native CPU usage sample; the results go to logcat
+        btnExport.setOnLongClickListener {
+            lifecycleScope.launch {
+                withContext(Dispatchers.Default) {
+                    JniIoBenchmark.report()
+                    val kotlinUs = batteryMonitor?.measureCpuSampleUs() ?: 0f
+                    val nativeUs = llmService?.getCpuSampleUs() ?: 0f
+                    Log.i(TAG, "CPU usage sample: Kotlin /proc/stat ${"%.1f".format(kotlinUs)} us, " +
+                            "native sampler ${if (nativeUs > 0f) "%.1f us".format(nativeUs) else "not running"}")
+                }
+                Toast.makeText(this@MainActivity, "JNI I/O and CPU sampling benchmarks written to log", Toast.LENGTH_SHORT).show()
+            }
+            true
+        }
+        
         spinnerModel.onItemSelectedListener = object : AdapterView.OnItemSelectedListener {
             override fun onItemSelected(parent: AdapterView<*>?, view: View?, position: Int, id: Long) {
                 selectedModel = availableModels[position]
@@ -502,8 +520,9 @@ class MainActivity : AppCompatActivity() {
     private fun stopBenchmark() {
         lifecycleScope.launch {
             try {
-                // Stop query scheduling
+                // Stop query scheduling and abort a generation in progress
                 QueryScheduler.cancelSchedule(this@MainActivity)
+                llmService?.cancelRequests()
                 
                 // Stop battery monitoring
                 batteryMonitor?.stopMonitoring()
@@ -626,12 +645,7 @@ class MainActivity : AppCompatActivity() {
      * Calculates average inference time from logged results.
      */
     private fun calculateAverageInferenceTime(): Long {
-        val results = dataLogger?.getQueryResults() ?: emptyList()
-        return if (results.isNotEmpty()) {
-            results.map { it.inferenceTimeMs }.average().toLong()
-        } else {
-            0L
-        }
+        return dataLogger?.getAverageInferenceTimeMs() ?: 0L
     }
     
     /**
@@ -733,6 +747,7 @@ class MainActivity : AppCompatActivity() {
             // Cleanup components
             // llmService.cleanup()  // TODO: Enable when LLMService is ready
             batteryMonitor?.cleanup()
+            dataLogger?.close()
             
             Log.d(TAG, "Cleanup completed")
             
@@ -41,6 +41,11 @@ class QueryScheduler(
         private const val KEY_QUERY_INTERVAL = "query_interval"
         private const val KEY_QUERY_INDEX = "query_index"
         
+        // Shared by every scheduled query; its KV state is restored from disk by each new
+        // worker process instead of being prefilled again. Ends in a newline so it stays
+        // a separate token run from the query that follows.
+        private const val SYSTEM_PROMPT = "You are a helpful assistant. Answer concisely.\n"
+        
         // Predefined test queries for comprehensive LLM testing
         private val TEST_QUERIES = listOf(
             "What is machine learning and how does it work?",
@@ -233,14 +238,49 @@ class QueryScheduler(
      */
     suspend fun executeQuery(): QueryResult? = withContext(Dispatchers.IO) {
         try {
+            val queryIndex = currentQueryIndex
             val queryText = getNextQuery()
+            
+            // Tokenize the whole query set once per loaded model; queries are then run by index
+            val prompts = testQueries.map { buildPrompt(it) }
+            if (llmService.pretokenizedPrompts != prompts) {
+                llmService.pretokenize(prompts)
+            }
+            
+            // Warm the system prompt before timing the query, so only the query is prefilled
+            val prefixState = llmService.warmPrefix(SYSTEM_PROMPT)
+            if (prefixState != null) {
+                Log.i(TAG, "System prompt ${prefixState.source.name.lowercase()} in ${prefixState.warmupTimeMs}ms " +
+                        "(restore ${prefixState.restoreUs}us, ${prefixState.stateBytes} bytes)")
+            }
+            
             val startTime = System.currentTimeMillis()
             val batteryLevel = batteryMonitor.getCurrentBatteryLevel()
             
             // Generate response using LLM service
-            val responseText = llmService.generateResponse(queryText)
+            val responseText = if (llmService.pretokenizedPrompts == prompts) {
+                llmService.generateResponseByIndex(queryIndex)
+            } else {
+                llmService.generateResponse(prompts[queryIndex])
+            }
             val endTime = System.currentTimeMillis()
-            val inferenceTimeMs = endTime - startTime
+            
+            // Prefer the native phase timings over wall-clock time when available
+            val nativeMetrics = llmService.getLastMetrics()
+            val inferenceTimeMs = nativeMetrics?.totalTimeMs ?: (endTime - startTime)
+            if (nativeMetrics != null && nativeMetrics.hasGovernor) {
+                Log.i(TAG, "Thermal governor: level ${nativeMetrics.governorLevel} " +
+                        "(${nativeMetrics.governorReason.name.lowercase()}) at ${nativeMetrics.socTemperatureC}C, " +
+                        "decode ${nativeMetrics.decodePlacement} x${nativeMetrics.decodeThreads}, " +
+                        "paced ${nativeMetrics.pacingUs / 1000}ms")
+            }
+            if (nativeMetrics != null && nativeMetrics.stopReason.isLimit) {
+                Log.i(TAG, "Generation stopped by ${nativeMetrics.stopReason} after ${nativeMetrics.generatedTokens} tokens")
+            }
+            if (nativeMetrics != null && nativeMetrics.decodeMemory.isValid) {
+                Log.d(TAG, "Memory at end of decode: ${nativeMetrics.decodeMemory}, " +
+                        "KV in use ${nativeMetrics.kvUsedBytes / 1048576} MiB")
+            }
             
             // Create QueryResult
             QueryResult.createNow(
@@ -249,7 +289,8 @@ class QueryScheduler(
                 inferenceTimeMs = inferenceTimeMs,
                 batteryLevel = batteryLevel,
                 quantization = llmService.quantizationType,
-                modelName = llmService.getModelName() ?: "unknown"
+                modelName = llmService.getModelName() ?: "unknown",
+                nativeMetrics = nativeMetrics
             )
             
         } catch (e: Exception) {
@@ -345,6 +386,15 @@ class QueryScheduler(
         }
     }
     
+    /**
+     * Builds the prompt sent to the model for a query. Every execution path goes through
+     * here, so their results are comparable; QueryResult records the bare query text.
+     * 
+     * @param query Query text
+     * @return The system prompt followed by the query
+     */
+    private fun buildPrompt(query: String): String = SYSTEM_PROMPT + query
+    
     /**
      * Executes a specific query by index for testing purposes.
      * 
@@ -358,9 +408,10 @@ class QueryScheduler(
                 val startTime = System.currentTimeMillis()
                 val batteryLevel = batteryMonitor.getCurrentBatteryLevel()
                 
-                val responseText = llmService.generateResponse(query)
+                val responseText = llmService.generateResponse(buildPrompt(query))
                 val endTime = System.currentTimeMillis()
-                val inferenceTimeMs = endTime - startTime
+                val nativeMetrics = llmService.getLastMetrics()
+                val inferenceTimeMs = nativeMetrics?.totalTimeMs ?: (endTime - startTime)
                 
                 QueryResult.createNow(
                     queryText = query,
@@ -368,7 +419,8 @@ class QueryScheduler(
                     inferenceTimeMs = inferenceTimeMs,
                     batteryLevel = batteryLevel,
                     quantization = llmService.quantizationType,
-                    modelName = llmService.getModelName() ?: "unknown"
+                    modelName = llmService.getModelName() ?: "unknown",
+                    nativeMetrics = nativeMetrics
                 )
             } else {
                 Log.e(TAG, "Invalid query index: $queryIndex")
@@ -381,12 +433,18 @@ class QueryScheduler(
     }
     
     /**
-     * Executes all test queries sequentially for comprehensive testing.
-     * This method is useful for running a complete test suite.
+     * Executes all test queries for comprehensive testing.
+     * Uses batched multi-sequence generation when the native model supports it,
+     * otherwise runs the queries sequentially.
      * 
      * @return List of QueryResult objects for all executed queries
      */
     suspend fun executeAllQueries(): List<QueryResult> = withContext(Dispatchers.IO) {
+        if (llmService.supportsBatchGeneration()) {
+            executeAllQueriesBatched()?.let { return@withContext it }
+            Log.w(TAG, "Batched execution failed, falling back to sequential queries")
+        }
+        
         val results = mutableListOf<QueryResult>()
         
         try {
@@ -419,4 +477,36 @@ class QueryScheduler(
             results
         }
     }
+    
+    /**
+     * Executes all test queries as parallel sequences through [LLMService.generateResponses].
+     * Each result's inference time is the latency until that query's sequence finished,
+     * and its native metrics are those of its own sequence.
+     * 
+     * @return List of QueryResult objects, or null if batched generation failed
+     */
+    private suspend fun executeAllQueriesBatched(): List<QueryResult>? {
+        Log.i(TAG, "Starting batched execution of ${testQueries.size} test queries")
+        
+        val batteryLevel = batteryMonitor.getCurrentBatteryLevel()
+        val responses = llmService.generateResponses(testQueries.map { buildPrompt(it) }) ?: return null
+        
+        val results = testQueries.zip(responses).map { (query, response) ->
+            QueryResult.createNow(
+                queryText = query,
+                responseText = response.text,
+                inferenceTimeMs = response.latencyMs,
+                batteryLevel = batteryLevel,
+                quantization = llmService.quantizationType,
+                modelName = llmService.getModelName() ?: "unknown",
+                nativeMetrics = response.metrics
+            )
+        }
+        
+        results.forEach { dataLogger.logQuery(it) }
+        dataLogger.logBattery(batteryMonitor.logMetrics())
+        
+        Log.i(TAG, "Completed batched execution of all test queries. Success: ${results.size}/${testQueries.size}")
+        return results
+    }
 }
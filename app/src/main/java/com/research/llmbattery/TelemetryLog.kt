@@ -0,0 +1,169 @@
+package com.research.llmbattery
+
+import android.util.Log
+import com.research.llmbattery.models.BatteryMetrics
+import com.research.llmbattery.models.QueryResult
+import java.io.Closeable
+import java.io.File
+
+/**
+ * Append-only, crash-safe telemetry log backed by memory-mapped segment files
+ * (telemetry_log.cpp). Every append is written straight into the mapped segment, so
+ * records survive the process being killed mid-run; the native side msyncs every
+ * few records to survive power loss as well. Nothing is kept in memory, so long
+ * benchmark runs do not grow the heap, and CSV export streams from disk.
+ *
+ * Instances are created with [open] and are safe to use from several threads.
+ */
+class TelemetryLog private constructor(
+    private var handle: Long,
+    val directory: File
+) : Closeable {
+
+    /**
+     * Appends a query result.
+     *
+     * @param result The QueryResult to record
+     * @return True if the record was written
+     */
+    fun appendQuery(result: QueryResult): Boolean {
+        return nativeAppendQuery(
+            handle,
+            result.timestamp,
+            result.queryText,
+            result.responseText,
+            result.inferenceTimeMs,
+            result.batteryLevel,
+            result.quantization,
+            result.modelName,
+            result.nativeMetrics?.toArray()
+        )
+    }
+    
+    /**
+     * Appends a battery sample.
+     *
+     * @param metrics The BatteryMetrics to record
+     * @return True if the record was written
+     */
+    fun appendBattery(metrics: BatteryMetrics): Boolean {
+        return nativeAppendBattery(
+            handle,
+            metrics.timestamp,
+            metrics.batteryLevel,
+            metrics.batteryDrainRate,
+            metrics.cpuUsage,
+            metrics.memoryUsage,
+            metrics.temperature
+        )
+    }
+    
+    /** Forces everything appended so far to disk. */
+    fun sync() = nativeSync(handle)
+    
+    /** Deletes all records. */
+    fun clear(): Boolean = nativeClear(handle)
+    
+    val queryCount: Long
+        get() = nativeCount(handle, TYPE_QUERY)
+    
+    val batteryCount: Long
+        get() = nativeCount(handle, TYPE_BATTERY)
+    
+    /** Sum of inferenceTimeMs over all logged queries. */
+    val inferenceTimeTotalMs: Long
+        get() = nativeInferenceTimeTotalMs(handle)
+    
+    /**
+     * Writes the query and battery records to two CSV files.
+     *
+     * @return Number of records exported, or -1 on error
+     */
+    fun exportCsv(queryFile: File, batteryFile: File): Long =
+        nativeExportCsv(handle, queryFile.absolutePath, batteryFile.absolutePath)
+    
+    /**
+     * Writes all records to one CSV file in the order they were logged.
+     *
+     * @return Number of records exported, or -1 on error
+     */
+    fun exportCombinedCsv(file: File): Long = nativeExportCombinedCsv(handle, file.absolutePath)
+    
+    @Synchronized
+    override fun close() {
+        if (handle != 0L) {
+            nativeClose(handle)
+            handle = 0L
+        }
+    }
+    
+    // Native bindings (telemetry-jni.cpp)
+    private external fun nativeOpen(dir: String, syncEvery: Int, syncIntervalMs: Long): Long
+    private external fun nativeClose(handle: Long)
+    private external fun nativeAppendQuery(
+        handle: Long,
+        timestampMs: Long,
+        query: String,
+        response: String,
+        inferenceTimeMs: Long,
+        batteryLevel: Int,
+        quantization: String,
+        modelName: String,
+        metrics: LongArray?
+    ): Boolean
+    private external fun nativeAppendBattery(
+        handle: Long,
+        timestampMs: Long,
+        batteryLevel: Int,
+        batteryDrainRate: Float,
+        cpuUsage: Float,
+        memoryUsage: Long,
+        temperature: Float
+    ): Boolean
+    private external fun nativeSync(handle: Long)
+    private external fun nativeClear(handle: Long): Boolean
+    private external fun nativeCount(handle: Long, type: Int): Long
+    private external fun nativeInferenceTimeTotalMs(handle: Long): Long
+    private external fun nativeExportCsv(handle: Long, queryPath: String, batteryPath: String): Long
+    private external fun nativeExportCombinedCsv(handle: Long, path: String): Long
+    
+    companion object {
+        private const val TAG = "TelemetryLog"
+        private const val TYPE_QUERY = 1
+        private const val TYPE_BATTERY = 2
+        private const val DEFAULT_SYNC_EVERY = 16
+        private const val DEFAULT_SYNC_INTERVAL_MS = 5000L
+        
+        private val nativeLibraryLoaded: Boolean = try {
+            System.loadLibrary("llm-telemetry")
+            true
+        } catch (e: UnsatisfiedLinkError) {
+            Log.e(TAG, "llm-telemetry not available: ${e.message}")
+            false
+        }
+        
+        /**
+         * Opens the log in a directory, recovering every record committed before the
+         * previous process ended.
+         *
+         * @param directory Directory holding the segment files; created if missing
+         * @param syncEvery msync after this many records
+         * @param syncIntervalMs msync at least this often while records are appended
+         * @return The log, or null if it could not be opened
+         */
+        fun open(
+            directory: File,
+            syncEvery: Int = DEFAULT_SYNC_EVERY,
+            syncIntervalMs: Long = DEFAULT_SYNC_INTERVAL_MS
+        ): TelemetryLog? {
+            if (!nativeLibraryLoaded) return null
+            val log = TelemetryLog(0L, directory)
+            log.handle = log.nativeOpen(directory.absolutePath, syncEvery, syncIntervalMs)
+            if (log.handle == 0L) {
+                Log.e(TAG, "Failed to open telemetry log in ${directory.absolutePath}")
+                return null
+            }
+            return log
+        }
+    }
+}
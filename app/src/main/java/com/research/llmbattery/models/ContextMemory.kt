@@ -0,0 +1,54 @@
+package com.research.llmbattery.models
+
+/**
+ * Data class holding the memory a native context was created with.
+ * Built from the long[] array filled by nativeGetContextMemory; the index layout
+ * mirrors the context_memory_index enum in llm_core.h.
+ *
+ * @property computeBytes Compute buffers of all backends, best-effort: llama.cpp exposes
+ *           them only in its log, so this is parsed from there and is -1 if not found
+ * @property loadMemory Process memory once the model and context were set up
+ */
+data class ContextMemory(
+    val weightsBytes: Long,
+    val kvCacheBytes: Long,
+    val computeBytes: Long,
+    val contextSize: Int,
+    val kvCacheTypeK: KvCacheType,
+    val kvCacheTypeV: KvCacheType,
+    val flashAttention: FlashAttention,
+    val loadMemory: MemorySnapshot
+) {
+    /** Weights, KV cache and compute buffers in bytes; compute is left out when unknown. */
+    val totalBytes: Long
+        get() = weightsBytes + kvCacheBytes + computeBytes.coerceAtLeast(0)
+
+    companion object {
+        private const val INDEX_LOAD_MEMORY = 7
+        const val FIELD_COUNT = INDEX_LOAD_MEMORY + MemorySnapshot.FIELD_COUNT
+
+        /**
+         * Allocates an array of the size the native side expects.
+         * @return A zeroed context memory array
+         */
+        fun newArray(): LongArray = LongArray(FIELD_COUNT)
+
+        /**
+         * Creates a ContextMemory instance from a filled context memory array.
+         * @param values Array filled by nativeGetContextMemory
+         * @return A new ContextMemory instance
+         */
+        fun fromArray(values: LongArray): ContextMemory {
+            return ContextMemory(
+                weightsBytes = values[0],
+                kvCacheBytes = values[1],
+                computeBytes = values[2],
+                contextSize = values[3].toInt(),
+                kvCacheTypeK = KvCacheType.fromCode(values[4].toInt()),
+                kvCacheTypeV = KvCacheType.fromCode(values[5].toInt()),
+                flashAttention = FlashAttention.fromCode(values[6].toInt()),
+                loadMemory = MemorySnapshot.fromArray(values, INDEX_LOAD_MEMORY)
+            )
+        }
+    }
+}
@@ -0,0 +1,49 @@
+package com.research.llmbattery.models
+
+/**
+ * Per-core CPU time series of one generation, sampled natively by the CPU sampler.
+ * Built from the flattened long[] returned by nativeGetCpuSeries: n_cpus followed by
+ * one record per sample of [timeUs, phase, n_cpus utilizations, n_cpus frequencies].
+ */
+data class CpuSeries(
+    val cpuCount: Int,
+    val points: List<Point>
+) {
+    /**
+     * Usage of every core since the previous sample.
+     * @property timeUs Time since the start of prefill
+     * @property isDecode True once the sample falls in the decode phase
+     * @property utilPermille Busy share of each core in permille
+     * @property freqKhz Current frequency of each core, 0 where cpufreq is not exposed
+     */
+    data class Point(
+        val timeUs: Long,
+        val isDecode: Boolean,
+        val utilPermille: List<Int>,
+        val freqKhz: List<Long>
+    )
+
+    companion object {
+        /**
+         * Creates a CpuSeries instance from a flattened native series.
+         * @param values Array returned by nativeGetCpuSeries
+         * @return A new CpuSeries instance, or null if the array is empty or malformed
+         */
+        fun fromArray(values: LongArray): CpuSeries? {
+            if (values.isEmpty()) return null
+            val cpuCount = values[0].toInt()
+            val stride = 2 + 2 * cpuCount
+            if (cpuCount <= 0 || (values.size - 1) % stride != 0) return null
+
+            val points = (1 until values.size step stride).map { start ->
+                Point(
+                    timeUs = values[start],
+                    isDecode = values[start + 1] != 0L,
+                    utilPermille = values.copyOfRange(start + 2, start + 2 + cpuCount).map { it.toInt() },
+                    freqKhz = values.copyOfRange(start + 2 + cpuCount, start + stride).toList()
+                )
+            }
+            return CpuSeries(cpuCount, points)
+        }
+    }
+}
@@ -0,0 +1,20 @@
+package com.research.llmbattery.models
+
+/**
+ * Flash attention mode of a native context. Codes mirror llama_flash_attn_type in llama.h.
+ */
+enum class FlashAttention(val code: Int) {
+    /** llama.cpp enables it when the backend supports it for the model. */
+    AUTO(-1),
+    DISABLED(0),
+    ENABLED(1);
+
+    companion object {
+        /**
+         * Maps a native mode code back to its enum value.
+         * @param code Code reported by the native context
+         * @return The matching mode, or AUTO for unknown codes
+         */
+        fun fromCode(code: Int): FlashAttention = values().firstOrNull { it.code == code } ?: AUTO
+    }
+}
@@ -0,0 +1,29 @@
+package com.research.llmbattery.models
+
+/**
+ * Why the native thermal governor picked the operating point of a generation.
+ * Codes mirror the governor_reason enum in thermal_governor.h.
+ */
+enum class GovernorReason(val code: Int) {
+    /** Inside the thermal envelope, nothing better measured. */
+    HOLD(0),
+    /** Above the target temperature, stepped to a cooler point. */
+    HOT(1),
+    /** Frequencies capped by the kernel, stepped to a cooler point. */
+    THROTTLED(2),
+    /** Cooled below the target minus hysteresis, stepped back to a faster point. */
+    COOL(3),
+    /** A cooler allowed point measured more tokens per joule. */
+    EFFICIENT(4),
+    /** Measuring an allowed point that had no sample yet. */
+    EXPLORE(5);
+
+    companion object {
+        /**
+         * Maps a native reason code back to its enum value.
+         * @param code Code recorded in the native metrics
+         * @return The matching reason, or HOLD for unknown codes
+         */
+        fun fromCode(code: Int): GovernorReason = values().firstOrNull { it.code == code } ?: HOLD
+    }
+}
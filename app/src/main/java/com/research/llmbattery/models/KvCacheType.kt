@@ -0,0 +1,26 @@
+package com.research.llmbattery.models
+
+/**
+ * Precision of the K or V cache of a native context. Codes are the ggml_type values
+ * llama.cpp expects; lower precision shrinks the cache and the memory bandwidth each
+ * decoded token needs, at some cost in accuracy.
+ */
+enum class KvCacheType(val code: Int) {
+    F16(1),
+    Q8_0(8),
+    /** A Q4_0 V cache requires flash attention. */
+    Q4_0(2);
+
+    /** True for the block-quantized types, which need flash attention when used for V. */
+    val isQuantized: Boolean
+        get() = this != F16
+
+    companion object {
+        /**
+         * Maps a native ggml_type code back to its enum value.
+         * @param code Code reported by the native context
+         * @return The matching type, or F16 for types not exposed here
+         */
+        fun fromCode(code: Int): KvCacheType = values().firstOrNull { it.code == code } ?: F16
+    }
+}
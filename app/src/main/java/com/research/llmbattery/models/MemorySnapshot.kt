@@ -0,0 +1,83 @@
+package com.research.llmbattery.models
+
+/**
+ * Data class holding the memory of the app process at one instant, read natively from
+ * /proc/self/status and /proc/self/smaps_rollup. Built from a block of a long[] array;
+ * the index layout mirrors the memory_snapshot_index enum in memory_probe.h.
+ *
+ * Anonymous pages hold the KV cache, compute buffers and heap, file-backed pages mostly
+ * the mmapped model weights. Fields the kernel does not report are -1.
+ *
+ * @property pssBytes Proportional set size: resident pages with shared pages split
+ *           between the processes mapping them (the figure getProcessMemoryInfo reports)
+ * @property pssAnonBytes Anonymous and file-backed parts of pssBytes, kernel 5.9+
+ * @property rssPeakBytes Highest resident set size since the process started
+ */
+data class MemorySnapshot(
+    val rssBytes: Long,
+    val rssAnonBytes: Long,
+    val rssFileBytes: Long,
+    val pssBytes: Long,
+    val pssAnonBytes: Long,
+    val pssFileBytes: Long,
+    val swapBytes: Long,
+    val rssPeakBytes: Long
+) {
+    /** True if the snapshot was taken; false for phases that were not measured. */
+    val isValid: Boolean
+        get() = rssBytes >= 0
+
+    /**
+     * Flattens the snapshot back into its native block layout; the inverse of fromArray.
+     * @param values Array to write into
+     * @param offset Index of the first field in values
+     */
+    fun copyInto(values: LongArray, offset: Int = 0) {
+        longArrayOf(
+            rssBytes,
+            rssAnonBytes,
+            rssFileBytes,
+            pssBytes,
+            pssAnonBytes,
+            pssFileBytes,
+            swapBytes,
+            rssPeakBytes
+        ).copyInto(values, offset)
+    }
+
+    override fun toString(): String {
+        fun mib(bytes: Long) = if (bytes >= 0) "%.1f".format(bytes / 1048576.0) else "?"
+        return "rss ${mib(rssBytes)} MiB (anon ${mib(rssAnonBytes)}, file ${mib(rssFileBytes)}), " +
+                "pss ${mib(pssBytes)} MiB (anon ${mib(pssAnonBytes)}, file ${mib(pssFileBytes)}), " +
+                "peak ${mib(rssPeakBytes)} MiB"
+    }
+
+    companion object {
+        const val FIELD_COUNT = 8
+
+        /**
+         * Allocates an array of the size the native side expects for one snapshot.
+         * @return A zeroed snapshot array
+         */
+        fun newArray(): LongArray = LongArray(FIELD_COUNT)
+
+        /**
+         * Creates a MemorySnapshot instance from a filled snapshot block.
+         * @param values Array filled by nativeProbeMemory, or a metrics or context memory array
+         * @param offset Index of the first field of the block in values
+         * @return A new MemorySnapshot instance
+         */
+        fun fromArray(values: LongArray, offset: Int = 0): MemorySnapshot {
+            return MemorySnapshot(
+                rssBytes = values[offset],
+                rssAnonBytes = values[offset + 1],
+                rssFileBytes = values[offset + 2],
+                pssBytes = values[offset + 3],
+                pssAnonBytes = values[offset + 4],
+                pssFileBytes = values[offset + 5],
+                swapBytes = values[offset + 6],
+                rssPeakBytes = values[offset + 7]
+            )
+        }
+    }
+}
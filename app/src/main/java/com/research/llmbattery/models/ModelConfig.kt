@@ -2,14 +2,55 @@ package com.research.llmbattery.models
 
 /**
  * Data class representing the configuration for an LLM model.
- * Contains information about the model's name, path, quantization type, and size.
+ * Contains information about the model's name, path, quantization type, and size,
+ * plus the settings of the native context created for it. The context defaults match
+ * what LLMService used before they became configurable.
+ *
+ * @property contextSize KV cache cells (tokens of context)
+ * @property batchSize Max tokens per llama_decode call during prefill
+ * @property microBatchSize Micro-batch llama.cpp splits each batch into
+ * @property kvCacheTypeK Precision of the K cache
+ * @property kvCacheTypeV Precision of the V cache; quantized types need flash attention
+ * @property flashAttention Flash attention mode
+ * @property offloadKqv Keep the KV cache and attention on the offload device, if any
+ * @property opOffload Run ops on host-resident weights on the offload device, if any
+ * @property thermalTargetCelsius Hottest SoC thermal zone temperature the native thermal
+ *           governor holds during generation, or 0 to leave placement and pacing alone
  */
 data class ModelConfig(
     val modelName: String,
     val modelPath: String,
     val quantization: String,
-    val sizeInMB: Float
+    val sizeInMB: Float,
+    val contextSize: Int = 2048,
+    val batchSize: Int = 512,
+    val microBatchSize: Int = 512,
+    val kvCacheTypeK: KvCacheType = KvCacheType.F16,
+    val kvCacheTypeV: KvCacheType = KvCacheType.F16,
+    val flashAttention: FlashAttention = FlashAttention.AUTO,
+    val offloadKqv: Boolean = true,
+    val opOffload: Boolean = true,
+    val thermalTargetCelsius: Float = 0f
 ) {
+    /**
+     * Same model with both KV caches at `type`. A quantized type turns disabled flash
+     * attention on, since llama.cpp cannot quantize the V cache without it.
+     * @param type Precision for the K and V cache
+     * @return A copy of this config
+     */
+    fun withKvCacheType(type: KvCacheType): ModelConfig {
+        return copy(
+            kvCacheTypeK = type,
+            kvCacheTypeV = type,
+            flashAttention = if (type.isQuantized && flashAttention == FlashAttention.DISABLED) {
+                FlashAttention.ENABLED
+            } else {
+                flashAttention
+            }
+        )
+    }
+    
+
     companion object {
         /**
          * Factory method for creating a ModelConfig instance for testing purposes.
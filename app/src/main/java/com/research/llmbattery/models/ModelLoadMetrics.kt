@@ -0,0 +1,56 @@
+package com.research.llmbattery.models
+
+/**
+ * Data class holding the phase timings of one native model load.
+ * Built from the long[] array filled by nativeInit / nativeInitFromFd; the index layout
+ * mirrors the load_phase_index enum in model_loader.h. A warm load shows up as a
+ * resident model (no tensor setup or mmap) or as a first touch with few major faults
+ * (weights still in the page cache).
+ *
+ * @property tensorSetupUs llama.cpp metadata parse, tensor creation and mmap of the file
+ * @property mmapUs llama.cpp binding the tensors to its mapping
+ * @property firstTouchUs First decode on the new context, which pages the weights in
+ * @property firstTouchMajorFaults Major page faults of the process during that decode
+ */
+data class ModelLoadMetrics(
+    val openUs: Long,
+    val tensorSetupUs: Long,
+    val mmapUs: Long,
+    val firstTouchUs: Long,
+    val firstTouchMajorFaults: Long,
+    val modelBytes: Long,
+    val wasResident: Boolean,
+    val wasExtracted: Boolean
+) {
+    /** Sum of all load phases in milliseconds. */
+    val totalTimeMs: Long
+        get() = (openUs + tensorSetupUs + mmapUs + firstTouchUs) / 1000
+
+    companion object {
+        const val PHASE_COUNT = 8
+
+        /**
+         * Allocates an array of the size the native side expects.
+         * @return A zeroed load phases array
+         */
+        fun newArray(): LongArray = LongArray(PHASE_COUNT)
+
+        /**
+         * Creates a ModelLoadMetrics instance from a filled load phases array.
+         * @param values Array filled by a native init call
+         * @return A new ModelLoadMetrics instance
+         */
+        fun fromArray(values: LongArray): ModelLoadMetrics {
+            return ModelLoadMetrics(
+                openUs = values[0],
+                tensorSetupUs = values[1],
+                mmapUs = values[2],
+                firstTouchUs = values[3],
+                firstTouchMajorFaults = values[4],
+                modelBytes = values[5],
+                wasResident = values[6] != 0L,
+                wasExtracted = values[7] != 0L
+            )
+        }
+    }
+}
@@ -0,0 +1,216 @@
+package com.research.llmbattery.models
+
+/**
+ * Data class holding the phase-level timings measured natively for one generation.
+ * Built from the long[] metrics array filled by the llama.cpp JNI wrapper; the index
+ * layout mirrors the metrics_index enum in metrics_layout.h.
+ *
+ * prefillMemory and decodeMemory are process snapshots taken after prefill and when
+ * decoding ended (the memory peak of the generation, with the KV cache at its fullest).
+ * They, kvUsedBytes and stateBytes are -1 for batched and speculative generation.
+ */
+data class NativeMetrics(
+    val tokenizeUs: Long,
+    val promptTokens: Int,
+    val reusedPromptTokens: Int,
+    val prefillUs: Long,
+    val generatedTokens: Int,
+    val decodeUs: Long,
+    val sampleUs: Long,
+    val detokenizeUs: Long,
+    val decodeP50Us: Long,
+    val decodeP90Us: Long,
+    val decodeP99Us: Long,
+    val decodeMaxUs: Long,
+    val perfPromptEvalUs: Long,
+    val perfEvalUs: Long,
+    val perfPromptEvalTokens: Int,
+    val perfEvalTokens: Int,
+    val decodeLatencyHistogram: List<Long>,
+    val prefillPlacement: ThreadPlacement,
+    val prefillThreads: Int,
+    val prefillCpuMask: Long,
+    val decodePlacement: ThreadPlacement,
+    val decodeThreads: Int,
+    val decodeCpuMask: Long,
+    val prefillEnergyUj: Long,
+    val decodeEnergyUj: Long,
+    val powerSamples: Int,
+    val prefillCpuUtilPermille: Int,
+    val decodeCpuUtilPermille: Int,
+    val prefillProcessCpuUs: Long,
+    val decodeProcessCpuUs: Long,
+    val governorLevel: Int,
+    val governorReason: GovernorReason,
+    val thermalMilliC: Int,
+    val freqCapPermille: Int,
+    val pacingUs: Long,
+    val stopReason: StopReason,
+    val prefillMemory: MemorySnapshot,
+    val decodeMemory: MemorySnapshot,
+    val kvUsedBytes: Long,
+    val stateBytes: Long
+) {
+    /** Tokenize + prefill + decode time in milliseconds, excluding JNI and Kotlin overhead. */
+    val totalTimeMs: Long
+        get() = (tokenizeUs + prefillUs + decodeUs) / 1000
+    
+    /** Throughput over the prompt tokens that were actually prefilled (not reused). */
+    val prefillTokensPerSecond: Float
+        get() = if (prefillUs > 0) (promptTokens - reusedPromptTokens) * 1_000_000f / prefillUs else 0f
+    
+    val decodeTokensPerSecond: Float
+        get() = if (decodeUs > 0) generatedTokens * 1_000_000f / decodeUs else 0f
+    
+    /** Energy drawn during prefill in joules, NaN when the native power sampler was not running. */
+    val prefillEnergyJ: Double
+        get() = if (prefillEnergyUj >= 0) prefillEnergyUj / 1e6 else Double.NaN
+    
+    /** Energy drawn during decode in joules, NaN when the native power sampler was not running. */
+    val decodeEnergyJ: Double
+        get() = if (decodeEnergyUj >= 0) decodeEnergyUj / 1e6 else Double.NaN
+    
+    /** True if the native CPU sampler was running and the CPU fields are filled in. */
+    val hasCpuUsage: Boolean
+        get() = decodeCpuUtilPermille >= 0
+    
+    /** Mean core utilization during prefill in percent, NaN without the CPU sampler. */
+    val prefillCpuUtilPercent: Float
+        get() = if (hasCpuUsage) prefillCpuUtilPermille / 10f else Float.NaN
+    
+    /** Mean core utilization during decode in percent, NaN without the CPU sampler. */
+    val decodeCpuUtilPercent: Float
+        get() = if (hasCpuUsage) decodeCpuUtilPermille / 10f else Float.NaN
+    
+    /** True if the native thermal governor chose the placement and pacing of this generation. */
+    val hasGovernor: Boolean
+        get() = governorLevel >= 0
+    
+    /** Hottest governed thermal zone when the generation started, NaN without the governor. */
+    val socTemperatureC: Float
+        get() = if (hasGovernor && thermalMilliC >= 0) thermalMilliC / 1000f else Float.NaN
+    
+    /**
+     * Flattens the metrics back into the native array layout; the inverse of fromArray.
+     * @return A metrics array of METRIC_COUNT entries
+     */
+    fun toArray(): LongArray {
+        val values = newArray()
+        longArrayOf(
+            tokenizeUs,
+            promptTokens.toLong(),
+            reusedPromptTokens.toLong(),
+            prefillUs,
+            generatedTokens.toLong(),
+            decodeUs,
+            sampleUs,
+            detokenizeUs,
+            decodeP50Us,
+            decodeP90Us,
+            decodeP99Us,
+            decodeMaxUs,
+            perfPromptEvalUs,
+            perfEvalUs,
+            perfPromptEvalTokens.toLong(),
+            perfEvalTokens.toLong()
+        ).copyInto(values)
+        decodeLatencyHistogram.toLongArray().copyInto(values, INDEX_DECODE_HIST)
+        longArrayOf(
+            prefillPlacement.code.toLong(),
+            prefillThreads.toLong(),
+            prefillCpuMask,
+            decodePlacement.code.toLong(),
+            decodeThreads.toLong(),
+            decodeCpuMask,
+            prefillEnergyUj,
+            decodeEnergyUj,
+            powerSamples.toLong(),
+            prefillCpuUtilPermille.toLong(),
+            decodeCpuUtilPermille.toLong(),
+            prefillProcessCpuUs,
+            decodeProcessCpuUs,
+            governorLevel.toLong(),
+            governorReason.code.toLong(),
+            thermalMilliC.toLong(),
+            freqCapPermille.toLong(),
+            pacingUs,
+            stopReason.code.toLong()
+        ).copyInto(values, INDEX_PLACEMENT)
+        prefillMemory.copyInto(values, INDEX_MEMORY)
+        decodeMemory.copyInto(values, INDEX_MEMORY + MemorySnapshot.FIELD_COUNT)
+        values[INDEX_KV_USED] = kvUsedBytes
+        values[INDEX_KV_USED + 1] = stateBytes
+        return values
+    }
+    
+    companion object {
+        /** Upper bounds of the decode latency histogram buckets; the last bucket is open. */
+        val DECODE_HIST_BOUNDS_US = longArrayOf(2500, 5000, 10000, 20000, 40000, 80000, 160000)
+        
+        private const val INDEX_DECODE_HIST = 16
+        private val INDEX_PLACEMENT = INDEX_DECODE_HIST + DECODE_HIST_BOUNDS_US.size + 1
+        private val INDEX_ENERGY = INDEX_PLACEMENT + 6
+        private val INDEX_CPU = INDEX_ENERGY + 3
+        private val INDEX_GOVERNOR = INDEX_CPU + 4
+        private val INDEX_STOP = INDEX_GOVERNOR + 5
+        private val INDEX_MEMORY = INDEX_STOP + 1
+        private val INDEX_KV_USED = INDEX_MEMORY + 2 * MemorySnapshot.FIELD_COUNT
+        val METRIC_COUNT = INDEX_KV_USED + 2
+        
+        /**
+         * Allocates an array of the size the native side expects.
+         * @return A zeroed metrics array
+         */
+        fun newArray(): LongArray = LongArray(METRIC_COUNT)
+        
+        /**
+         * Creates a NativeMetrics instance from a filled metrics array.
+         * @param values Array filled by a native generate call
+         * @return A new NativeMetrics instance
+         */
+        fun fromArray(values: LongArray): NativeMetrics {
+            return NativeMetrics(
+                tokenizeUs = values[0],
+                promptTokens = values[1].toInt(),
+                reusedPromptTokens = values[2].toInt(),
+                prefillUs = values[3],
+                generatedTokens = values[4].toInt(),
+                decodeUs = values[5],
+                sampleUs = values[6],
+                detokenizeUs = values[7],
+                decodeP50Us = values[8],
+                decodeP90Us = values[9],
+                decodeP99Us = values[10],
+                decodeMaxUs = values[11],
+                perfPromptEvalUs = values[12],
+                perfEvalUs = values[13],
+                perfPromptEvalTokens = values[14].toInt(),
+                perfEvalTokens = values[15].toInt(),
+                decodeLatencyHistogram = values.copyOfRange(INDEX_DECODE_HIST, INDEX_PLACEMENT).toList(),
+                prefillPlacement = ThreadPlacement.fromCode(values[INDEX_PLACEMENT].toInt()),
+                prefillThreads = values[INDEX_PLACEMENT + 1].toInt(),
+                prefillCpuMask = values[INDEX_PLACEMENT + 2],
+                decodePlacement = ThreadPlacement.fromCode(values[INDEX_PLACEMENT + 3].toInt()),
+                decodeThreads = values[INDEX_PLACEMENT + 4].toInt(),
+                decodeCpuMask = values[INDEX_PLACEMENT + 5],
+                prefillEnergyUj = values[INDEX_ENERGY],
+                decodeEnergyUj = values[INDEX_ENERGY + 1],
+                powerSamples = values[INDEX_ENERGY + 2].toInt(),
+                prefillCpuUtilPermille = values[INDEX_CPU].toInt(),
+                decodeCpuUtilPermille = values[INDEX_CPU + 1].toInt(),
+                prefillProcessCpuUs = values[INDEX_CPU + 2],
+                decodeProcessCpuUs = values[INDEX_CPU + 3],
+                governorLevel = values[INDEX_GOVERNOR].toInt(),
+                governorReason = GovernorReason.fromCode(values[INDEX_GOVERNOR + 1].toInt()),
+                thermalMilliC = values[INDEX_GOVERNOR + 2].toInt(),
+                freqCapPermille = values[INDEX_GOVERNOR + 3].toInt(),
+                pacingUs = values[INDEX_GOVERNOR + 4],
+                stopReason = StopReason.fromCode(values[INDEX_STOP].toInt()),
+                prefillMemory = MemorySnapshot.fromArray(values, INDEX_MEMORY),
+                decodeMemory = MemorySnapshot.fromArray(values, INDEX_MEMORY + MemorySnapshot.FIELD_COUNT),
+                kvUsedBytes = values[INDEX_KV_USED],
+                stateBytes = values[INDEX_KV_USED + 1]
+            )
+        }
+    }
+}
@@ -0,0 +1,61 @@
+package com.research.llmbattery.models
+
+/**
+ * Data class describing how a shared prompt prefix was put into the KV cache.
+ * Built from the long[] array filled by nativeWarmPrefix; the index layout mirrors
+ * the state_io_index enum in state_cache.h.
+ *
+ * @property source Where the prefix state came from
+ * @property tokens Prefix length in tokens
+ * @property stateBytes Size of the state file that was read or written, 0 if none
+ * @property restoreUs Time spent restoring, including a lookup that missed
+ * @property prefillUs Time spent prefilling the prefix, 0 when it was restored
+ * @property saveUs Time spent writing the state file
+ */
+data class PrefixState(
+    val source: Source,
+    val tokens: Int,
+    val stateBytes: Long,
+    val restoreUs: Long,
+    val prefillUs: Long,
+    val saveUs: Long
+) {
+    enum class Source {
+        /** Already in the KV cache of the loaded context. */
+        RESIDENT,
+        /** Restored from a state file saved by an earlier process. */
+        RESTORED,
+        /** Prefilled from scratch. */
+        PREFILLED
+    }
+
+    /** Time until the prefix was usable, in milliseconds. */
+    val warmupTimeMs: Float
+        get() = (restoreUs + prefillUs) / 1000f
+
+    companion object {
+        const val FIELD_COUNT = 6
+
+        /**
+         * Allocates an array of the size the native side expects.
+         * @return A zeroed prefix state array
+         */
+        fun newArray(): LongArray = LongArray(FIELD_COUNT)
+
+        /**
+         * Creates a PrefixState instance from a filled prefix state array.
+         * @param values Array filled by nativeWarmPrefix
+         * @return A new PrefixState instance
+         */
+        fun fromArray(values: LongArray): PrefixState {
+            return PrefixState(
+                source = Source.values().getOrElse(values[0].toInt()) { Source.PREFILLED },
+                tokens = values[1].toInt(),
+                stateBytes = values[2],
+                restoreUs = values[3],
+                prefillUs = values[4],
+                saveUs = values[5]
+            )
+        }
+    }
+}
@@ -3,6 +3,7 @@ package com.research.llmbattery.models
 /**
  * Data class representing the outcome and performance metrics of a single LLM query.
  * Contains information about the query, response, timing, battery level, and model details.
+ * When inference ran natively, nativeMetrics holds the phase-level timings.
  */
 data class QueryResult(
     val timestamp: Long,
@@ -11,7 +12,8 @@ data class QueryResult(
     val inferenceTimeMs: Long,
     val batteryLevel: Int,
     val quantization: String,
-    val modelName: String
+    val modelName: String,
+    val nativeMetrics: NativeMetrics? = null
 ) {
     companion object {
         /**
@@ -69,6 +71,7 @@ data class QueryResult(
          * @param batteryLevel Battery level at the time of query execution (0-100)
          * @param quantization The quantization type used for the model
          * @param modelName The name of the model used
+         * @param nativeMetrics Phase-level native timings, if inference ran natively
          * @return A new QueryResult instance with current timestamp
          */
         fun createNow(
@@ -77,7 +80,8 @@ data class QueryResult(
             inferenceTimeMs: Long,
             batteryLevel: Int,
             quantization: String,
-            modelName: String
+            modelName: String,
+            nativeMetrics: NativeMetrics? = null
         ): QueryResult {
             return QueryResult(
                 timestamp = System.currentTimeMillis(),
@@ -86,7 +90,8 @@ data class QueryResult(
                 inferenceTimeMs = inferenceTimeMs,
                 batteryLevel = batteryLevel,
                 quantization = quantization,
-                modelName = modelName
+                modelName = modelName,
+                nativeMetrics = nativeMetrics
             )
         }
     }
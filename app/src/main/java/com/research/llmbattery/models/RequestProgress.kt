@@ -0,0 +1,66 @@
+package com.research.llmbattery.models
+
+/**
+ * Data class describing a request submitted to the native inference engine.
+ * Built from the long[] array filled by nativePoll; the index layout mirrors
+ * the request_progress_index enum in inference_engine.h.
+ *
+ * @property status Where the request is in its lifecycle
+ * @property tokens Tokens streamed so far
+ * @property firstTokenNs Native timestamp of the first streamed piece, 0 before it
+ *           (same clock as System.nanoTime)
+ * @property lastTokenNs Native timestamp of the latest streamed piece, 0 before it
+ */
+data class RequestProgress(
+    val status: Status,
+    val tokens: Int,
+    val firstTokenNs: Long,
+    val lastTokenNs: Long
+) {
+    enum class Status(val code: Int) {
+        /** Waiting behind other requests. */
+        QUEUED(0),
+        /** Being generated. */
+        RUNNING(1),
+        /** Finished normally. */
+        COMPLETED(2),
+        /** Stopped by a decode error. */
+        FAILED(3);
+
+        val isFinished: Boolean
+            get() = this == COMPLETED || this == FAILED
+
+        companion object {
+            /**
+             * Maps a native status code back to its enum value.
+             * @param code Code filled in by nativePoll
+             * @return The matching status, or FAILED for unknown codes
+             */
+            fun fromCode(code: Int): Status = values().firstOrNull { it.code == code } ?: FAILED
+        }
+    }
+
+    companion object {
+        const val FIELD_COUNT = 4
+
+        /**
+         * Allocates an array of the size the native side expects.
+         * @return A zeroed progress array
+         */
+        fun newArray(): LongArray = LongArray(FIELD_COUNT)
+
+        /**
+         * Creates a RequestProgress instance from a filled progress array.
+         * @param values Array filled by nativePoll
+         * @return A new RequestProgress instance
+         */
+        fun fromArray(values: LongArray): RequestProgress {
+            return RequestProgress(
+                status = Status.fromCode(values[0].toInt()),
+                tokens = values[1].toInt(),
+                firstTokenNs = values[2],
+                lastTokenNs = values[3]
+            )
+        }
+    }
+}
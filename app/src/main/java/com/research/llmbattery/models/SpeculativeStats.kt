@@ -0,0 +1,63 @@
+package com.research.llmbattery.models
+
+/**
+ * Data class holding the counters of a speculative generation and of its plain baseline.
+ * Built from the long[] array filled by nativeGenerateSpeculative; the index layout
+ * mirrors the speculative_stats_index enum in llm_core.h.
+ *
+ * @property draftedTokens Tokens proposed by the draft model
+ * @property acceptedTokens Drafted tokens confirmed by the target model
+ * @property verifySteps Target verification decodes
+ * @property decodeUs Drafting and verification time
+ * @property decodeEnergyUj Energy of drafting and verification, -1 without a running power sampler
+ * @property plainGeneratedTokens Tokens of the plain baseline, 0 if it was not run
+ * @property plainDecodeEnergyUj Decode energy of the plain baseline, -1 if unknown
+ */
+data class SpeculativeStats(
+    val draftedTokens: Int,
+    val acceptedTokens: Int,
+    val verifySteps: Int,
+    val generatedTokens: Int,
+    val prefillUs: Long,
+    val draftUs: Long,
+    val verifyUs: Long,
+    val decodeUs: Long,
+    val decodeEnergyUj: Long,
+    val powerSamples: Int,
+    val plainGeneratedTokens: Int,
+    val plainDecodeUs: Long,
+    val plainDecodeEnergyUj: Long
+) {
+    companion object {
+        const val FIELD_COUNT = 13
+
+        /**
+         * Allocates an array of the size the native side expects.
+         * @return A zeroed speculative stats array
+         */
+        fun newArray(): LongArray = LongArray(FIELD_COUNT)
+
+        /**
+         * Creates a SpeculativeStats instance from a filled speculative stats array.
+         * @param values Array filled by nativeGenerateSpeculative
+         * @return A new SpeculativeStats instance
+         */
+        fun fromArray(values: LongArray): SpeculativeStats {
+            return SpeculativeStats(
+                draftedTokens = values[0].toInt(),
+                acceptedTokens = values[1].toInt(),
+                verifySteps = values[2].toInt(),
+                generatedTokens = values[3].toInt(),
+                prefillUs = values[4],
+                draftUs = values[5],
+                verifyUs = values[6],
+                decodeUs = values[7],
+                decodeEnergyUj = values[8],
+                powerSamples = values[9].toInt(),
+                plainGeneratedTokens = values[10].toInt(),
+                plainDecodeUs = values[11],
+                plainDecodeEnergyUj = values[12]
+            )
+        }
+    }
+}
@@ -0,0 +1,41 @@
+package com.research.llmbattery.models
+
+/**
+ * Why a native generation ended.
+ * Codes mirror the stop_reason enum in stop_conditions.h.
+ */
+enum class StopReason(val code: Int) {
+    /** Not recorded (batched and speculative generation). */
+    NONE(0),
+    /** The model produced an end-of-generation token. */
+    END_OF_GENERATION(1),
+    /** The max token limit was reached. */
+    MAX_TOKENS(2),
+    /** The context had no room for another token. */
+    CONTEXT_FULL(3),
+    /** A stop string appeared; the response ends before it. */
+    STOP_STRING(4),
+    /** The wall-clock deadline passed. */
+    DEADLINE(5),
+    /** The power sampler measured the energy budget spent. */
+    ENERGY_BUDGET(6),
+    /** The caller cancelled the generation. */
+    CANCELLED(7),
+    /** Decoding failed. */
+    ERROR(8),
+    /** The generateResponseDirect buffer filled up; the response is cut at a character boundary. */
+    BUFFER_FULL(9);
+
+    /** True if a stop condition set through LLMService.setStopConditions ended the generation. */
+    val isLimit: Boolean
+        get() = this == STOP_STRING || this == DEADLINE || this == ENERGY_BUDGET
+
+    companion object {
+        /**
+         * Maps a native stop reason code back to its enum value.
+         * @param code Code recorded in the native metrics
+         * @return The matching reason, or NONE for unknown codes
+         */
+        fun fromCode(code: Int): StopReason = values().firstOrNull { it.code == code } ?: NONE
+    }
+}
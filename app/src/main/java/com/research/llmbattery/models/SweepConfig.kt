@@ -0,0 +1,33 @@
+package com.research.llmbattery.models
+
+/**
+ * Data class describing an energy-efficiency sweep run by LLMService.runSweep.
+ * Every combination of the lists is one cell, models outermost; the native runner
+ * (sweep_runner.h) gives each cell a fresh context, runs the warmup generations
+ * unrecorded and then every prompt once per repetition.
+ *
+ * @property modelPaths GGUF files to compare, typically one per quantization
+ * @property threadCounts Decode and prefill thread counts
+ * @property contextSizes KV cache sizes in tokens
+ * @property batchSizes Prefill batch sizes; the micro-batch follows the batch size
+ * @property maxTokens Response length limits
+ * @property prompts Prompts run once per repetition in every cell
+ * @property warmup Unrecorded generations at the start of each cell
+ * @property repetitions Recorded passes over the prompts per cell
+ * @property cooldownMs Idle time before each cell so heat from the previous one settles
+ */
+data class SweepConfig(
+    val modelPaths: List<String>,
+    val threadCounts: List<Int> = listOf(2, 4),
+    val contextSizes: List<Int> = listOf(2048),
+    val batchSizes: List<Int> = listOf(512),
+    val maxTokens: List<Int> = listOf(128),
+    val prompts: List<String>,
+    val warmup: Int = 1,
+    val repetitions: Int = 3,
+    val cooldownMs: Int = 0
+) {
+    /** Number of cells the sweep will run. */
+    val cellCount: Int
+        get() = modelPaths.size * threadCounts.size * contextSizes.size * batchSizes.size * maxTokens.size
+}
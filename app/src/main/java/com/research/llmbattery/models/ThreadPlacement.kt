@@ -0,0 +1,28 @@
+package com.research.llmbattery.models
+
+/**
+ * Core sets the native worker threads can be pinned to on heterogeneous (big.LITTLE) CPUs.
+ * Codes mirror the placement_policy enum in cpu_topology.h; clusters are ranked by the
+ * cpu_capacity and cpufreq data the kernel exposes in sysfs.
+ */
+enum class ThreadPlacement(val code: Int) {
+    /** No affinity, the scheduler decides. */
+    OS(0),
+    /** Every online core. */
+    ALL(1),
+    /** Every cluster except the slowest one. */
+    BIG(2),
+    /** Only the fastest cluster. */
+    PRIME(3),
+    /** Only the slowest (efficiency) cluster. */
+    LITTLE(4);
+
+    companion object {
+        /**
+         * Maps a native policy code back to its enum value.
+         * @param code Code recorded in the native metrics
+         * @return The matching placement, or OS for unknown codes
+         */
+        fun fromCode(code: Int): ThreadPlacement = values().firstOrNull { it.code == code } ?: OS
+    }
+}
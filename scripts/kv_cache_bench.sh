@@ -0,0 +1,60 @@
+#!/bin/bash
+
+# Mobile LLM Battery Benchmark - KV cache precision sweep
+# Runs llm-bench once per model and KV cache type and prints throughput, decode energy
+# per token and context memory side by side.
+#
+#   scripts/kv_cache_bench.sh [extra llm-bench options]
+#
+# Energy columns need a power source, e.g. --power-supply /sys/class/power_supply/battery
+# when running on the device. Flash attention stays on for every type so only the KV
+# precision changes between rows (a quantized V cache requires it anyway).
+#
+# Environment overrides:
+#   LLM_BENCH   path to the llm-bench binary (default build-host/llm-bench)
+#   MODEL_DIR   directory holding the GGUF files (default app/src/main/assets/models)
+#   MODELS      model files to compare
+#   KV_TYPES    KV cache types to compare
+
+set -e  # Exit on any error
+
+LLM_BENCH="${LLM_BENCH:-build-host/llm-bench}"
+MODEL_DIR="${MODEL_DIR:-app/src/main/assets/models}"
+MODELS="${MODELS:-qwen2.5-0.5b-instruct-q2_k.gguf qwen2.5-0.5b-instruct-q3_k_m.gguf qwen2.5-0.5b-instruct-q4_k_m.gguf}"
+KV_TYPES="${KV_TYPES:-f16 q8_0 q4_0}"
+
+if [ ! -x "$LLM_BENCH" ]; then
+    echo "Error: llm-bench not found at $LLM_BENCH" >&2
+    echo "Build it with: cmake -S app/src/main/cpp -B build-host -DCMAKE_BUILD_TYPE=Release && cmake --build build-host --target llm-bench" >&2
+    exit 1
+fi
+
+printf "%-36s %-5s %9s %9s %11s %10s %12s\n" \
+       "model" "kv" "kv_mib" "comp_mib" "prefill_t/s" "decode_t/s" "decode_mJ/t"
+
+for model in $MODELS; do
+    if [ ! -f "$MODEL_DIR/$model" ]; then
+        echo "Skipping $model: not found in $MODEL_DIR" >&2
+        continue
+    fi
+    for kv in $KV_TYPES; do
+        if ! output=$("$LLM_BENCH" -m "$MODEL_DIR/$model" --kv-type "$kv" --flash-attn on "$@" 2>/dev/null); then
+            echo "Skipping $model with $kv: llm-bench failed" >&2
+            continue
+        fi
+        echo "$output" | awk -v model="$model" -v kv="$kv" '
+            /^context:/ {
+                for (i = 1; i <= NF; i++) {
+                    if ($i == "KV") kv_mib = $(i + 1)
+                    if ($i == "compute") comp_mib = ($(i + 1) == "unknown,") ? "-" : $(i + 1)
+                }
+            }
+            /^  prefill  / { prefill = $3 }
+            /^  decode  / { decode = $3 }
+            /^  decode energy/ { energy = $4 }
+            END {
+                printf "%-36s %-5s %9s %9s %11s %10s %12s\n", model, kv, kv_mib, comp_mib,
+                       prefill, decode, energy == "" ? "-" : energy
+            }'
+    done
+done